@@ -0,0 +1,172 @@
+/*
+ * bench_baseline.c — Reference points for the core group
+ *
+ *   xoshiro256**     fast userspace PRNG (vs phit_prng_u64 buffered)
+ *   arc4random       OS CSPRNG, userspace buffered (BSD, macOS, glibc 2.36+)
+ *   getrandom        OS CSPRNG, one syscall per call (Linux)
+ *   atomic RR        fetch-add counter, one thread: uncontended (vs phit_route;
+ *                    exec/atomic_rr has it shared between producers)
+ *
+ * The build defines PHIT_BENCH_HAVE_ARC4RANDOM / PHIT_BENCH_HAVE_GETRANDOM
+ * where the symbols exist.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "phit_bench.h"
+
+#if defined(PHIT_BENCH_HAVE_GETRANDOM)
+  #include <sys/random.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+#endif
+
+#define BASE_FILL 4096
+
+/* ---- xoshiro256** (Blackman & Vigna), seeded from the phit pool ---- */
+
+typedef struct {
+    uint64_t s[4];
+} base_xoshiro_t;
+
+static inline uint64_t base_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t base_xoshiro_next(base_xoshiro_t *x) {
+    uint64_t *s = x->s;
+    uint64_t r = base_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = base_rotl(s[3], 45);
+    return r;
+}
+
+static uint64_t base_xoshiro_u64(void *ctx, uint64_t iters) {
+    base_xoshiro_t *x = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc ^= base_xoshiro_next(x);
+    return acc;
+}
+
+static uint64_t base_xoshiro_fill(void *ctx, uint64_t iters) {
+    base_xoshiro_t *x = ctx;
+    static uint8_t buf[BASE_FILL];
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        for (int k = 0; k < BASE_FILL; k += 8) {
+            uint64_t v = base_xoshiro_next(x);
+            memcpy(buf + k, &v, 8);
+        }
+        acc ^= buf[i % BASE_FILL];
+    }
+    return acc;
+}
+
+/* ---- OS generators ---- */
+
+#if defined(PHIT_BENCH_HAVE_ARC4RANDOM)
+static uint64_t base_arc4random_u64(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        uint64_t v;
+        arc4random_buf(&v, sizeof(v));
+        acc ^= v;
+    }
+    return acc;
+}
+
+static uint64_t base_arc4random_fill(void *ctx, uint64_t iters) {
+    (void)ctx;
+    static uint8_t buf[BASE_FILL];
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        arc4random_buf(buf, BASE_FILL);
+        acc ^= buf[i % BASE_FILL];
+    }
+    return acc;
+}
+
+static uint64_t base_arc4random_uniform(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += arc4random_uniform(8);
+    return acc;
+}
+#endif
+
+#if defined(PHIT_BENCH_HAVE_GETRANDOM)
+static uint64_t base_getrandom_u64(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        uint64_t v = 0;
+        if (getrandom(&v, sizeof(v), 0) != (ssize_t)sizeof(v)) v = 0;
+        acc ^= v;
+    }
+    return acc;
+}
+
+static uint64_t base_getrandom_fill(void *ctx, uint64_t iters) {
+    (void)ctx;
+    static uint8_t buf[BASE_FILL];
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        if (getrandom(buf, BASE_FILL, 0) != BASE_FILL) buf[0] = 0;
+        acc ^= buf[i % BASE_FILL];
+    }
+    return acc;
+}
+#endif
+
+/* ---- Atomic round-robin dispatcher ---- */
+
+static uint64_t base_rr_counter;
+
+static inline uint64_t base_fetch_add(uint64_t *p) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)p, 1);
+#else
+    return __atomic_fetch_add(p, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static uint64_t base_atomic_rr8(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += base_fetch_add(&base_rr_counter) % 8;
+    return acc;
+}
+
+void phit_bench_group_baseline(phit_bench_t *b) {
+    base_xoshiro_t x;
+    phit_pool_t pool;
+    phit_pool_init(&pool);
+    for (int i = 0; i < 4; i++) x.s[i] = phit_pool_extract(&pool);
+
+    phit_bench_run(b, "baseline", "xoshiro256** u64", base_xoshiro_u64, &x, 1, "op");
+    phit_bench_run(b, "baseline", "xoshiro256** fill 4K", base_xoshiro_fill, &x,
+                   BASE_FILL, "B");
+#if defined(PHIT_BENCH_HAVE_ARC4RANDOM)
+    phit_bench_run(b, "baseline", "arc4random u64", base_arc4random_u64, NULL, 1, "op");
+    phit_bench_run(b, "baseline", "arc4random fill 4K", base_arc4random_fill, NULL,
+                   BASE_FILL, "B");
+    phit_bench_run(b, "baseline", "arc4random_uniform(8)", base_arc4random_uniform,
+                   NULL, 1, "op");
+#endif
+#if defined(PHIT_BENCH_HAVE_GETRANDOM)
+    phit_bench_run(b, "baseline", "getrandom u64", base_getrandom_u64, NULL, 1, "op");
+    phit_bench_run(b, "baseline", "getrandom fill 4K", base_getrandom_fill, NULL,
+                   BASE_FILL, "B");
+#endif
+    phit_bench_run(b, "baseline", "atomic RR(8) uncontended", base_atomic_rr8, NULL, 1, "op");
+}
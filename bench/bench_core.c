@@ -0,0 +1,259 @@
+/*
+ * bench_core.c — libphit hot paths: timer, sampling, samplers, routing, pool, PRNG
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "phit_bench.h"
+
+#define CORE_BATCH 256
+#define CORE_FILL  4096
+
+typedef struct {
+    phit_prng_t *rng;
+    uint8_t     *buf;
+    int          len;
+} core_fill_t;
+
+static uint64_t core_now_ticks(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_now_ticks();
+    return acc;
+}
+
+static uint64_t core_now_ns(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_now_ns();
+    return acc;
+}
+
+static uint64_t core_sample(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_sample();
+    return acc;
+}
+
+static uint64_t core_compound2(void *ctx, uint64_t iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_sample_compound(2);
+    return acc;
+}
+
+static uint64_t core_adaptive(void *ctx, uint64_t iters) {
+    double target = *(const double *)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_sample_adaptive(target);
+    return acc;
+}
+
+static uint64_t core_sampler(void *ctx, uint64_t iters) {
+    const phit_sampler_t *k = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += k->sample();
+    return acc;
+}
+
+static uint64_t core_sample_batch(void *ctx, uint64_t iters) {
+    uint32_t *out = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        phit_sample_batch(out, CORE_BATCH);
+        acc += out[i % CORE_BATCH];
+    }
+    return acc;
+}
+
+static uint64_t core_route(void *ctx, uint64_t iters) {
+    int k = *(const int *)ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += (uint64_t)phit_route(k);
+    return acc;
+}
+
+/* phit_route_const with literal K: the mask path for powers of two */
+#define CORE_ROUTE_CONST(K)                                             \
+    static uint64_t core_route_const##K(void *ctx, uint64_t iters) {    \
+        (void)ctx;                                                      \
+        uint64_t acc = 0;                                               \
+        for (uint64_t i = 0; i < iters; i++) acc += (uint64_t)phit_route_const(K); \
+        return acc;                                                     \
+    }
+CORE_ROUTE_CONST(2)
+CORE_ROUTE_CONST(8)
+CORE_ROUTE_CONST(64)
+
+static uint64_t core_route2_8(void *ctx, uint64_t iters) {
+    phit_load_t *loads = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        int d = phit_route2(loads, 8);
+        loads[d].depth++;               /* single thread: plain update */
+        acc += (uint64_t)d;
+    }
+    return acc;
+}
+
+static uint64_t core_router8(void *ctx, uint64_t iters) {
+    phit_router_t *r = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += (uint64_t)phit_router_route(r);
+    return acc;
+}
+
+static uint64_t core_pool_extract(void *ctx, uint64_t iters) {
+    phit_pool_t *p = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc ^= phit_pool_extract(p);
+    return acc;
+}
+
+static uint64_t core_prng_u64(void *ctx, uint64_t iters) {
+    phit_prng_t *rng = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc ^= phit_prng_u64(rng);
+    return acc;
+}
+
+static uint64_t core_prng_fill(void *ctx, uint64_t iters) {
+    core_fill_t *f = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        phit_prng_fill(f->rng, f->buf, f->len);
+        acc ^= f->buf[i % (uint64_t)f->len];
+    }
+    return acc;
+}
+
+/* Paced requests: one direct-mode word every 50 us, as a consumer that is
+ * not saturating the source would ask. Latency is per request; the rate
+ * column is the request pace, not a throughput. */
+static volatile uint64_t core_paced_sink;
+
+static void core_prng_paced(phit_bench_t *b, const char *name, int harvester) {
+    if (!phit_bench_selected(b, "prng", name)) return;
+    int n = b->quick ? 200 : 2000;
+    double *lat = malloc(sizeof(double) * (size_t)n);
+    phit_prng_t rng;
+    phit_prng_init(&rng);
+    if (harvester) {
+        phit_bench_unpin(b);        /* the harvester must not share --cpu */
+        phit_harvester_start(0);
+        phit_bench_repin(b);
+    }
+    struct timespec gap = { 0, 50000 };
+    nanosleep(&gap, NULL);
+    uint64_t acc = 0, t_start = phit_now_ns();
+    for (int i = 0; i < n; i++) {
+        nanosleep(&gap, NULL);
+        uint64_t t0 = phit_now_ticks();
+        acc ^= phit_prng_u64(&rng);
+        uint64_t t1 = phit_now_ticks();
+        lat[i] = (double)(t1 - t0) * phit_timer_caps()->ns_per_unit - b->timer_cost_ns;
+    }
+    double wall = (double)(phit_now_ns() - t_start);
+    core_paced_sink = acc;
+    phit_harvester_stats_t hs;
+    phit_harvester_stats(&hs);
+    if (harvester) phit_harvester_stop();
+
+    phit_bench_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.group = "prng";
+    res.name = name;
+    res.items_per_op = 1;
+    res.item = "op";
+    res.reps = 1;
+    res.rate_median = res.rate_min = res.rate_max = n / (wall / 1e9);
+    phit_bench_percentiles(lat, n, &res);
+    if (harvester) {
+        snprintf(res.note, sizeof(res.note), "%llu underruns, duty %.1f%%",
+                 (unsigned long long)hs.underruns, hs.duty * 100);
+    } else {
+        snprintf(res.note, sizeof(res.note), "inline harvest");
+    }
+    phit_bench_report(b, &res);
+    free(lat);
+}
+
+void phit_bench_group_core(phit_bench_t *b) {
+    static uint32_t batch[CORE_BATCH];
+    static uint8_t fill_buf[CORE_FILL];
+
+    phit_bench_run(b, "timer", "phit_now_ticks", core_now_ticks, NULL, 1, "op");
+    phit_bench_run(b, "timer", "phit_now_ns", core_now_ns, NULL, 1, "op");
+
+    phit_bench_run(b, "sample", "phit_sample", core_sample, NULL, 1, "op");
+    phit_bench_run(b, "sample", "phit_sample_compound(2)", core_compound2, NULL, 1, "op");
+    phit_bench_run(b, "sample", "phit_sample_batch(256)", core_sample_batch, batch,
+                   CORE_BATCH, "sample");
+    static const double adapt_low = 3.0, adapt_high = 16.0;
+    phit_bench_run(b, "sample", "phit_sample_adaptive(3)", core_adaptive, (void *)&adapt_low, 1, "op");
+    phit_bench_run(b, "sample", "phit_sample_adaptive(16)", core_adaptive, (void *)&adapt_high, 1, "op");
+
+    /* Every compile-time specialized sampler (PHIT_SAMPLERS) */
+    for (int i = 0; i < phit_sampler_count(); i++) {
+        const phit_sampler_t *k = phit_sampler_get(i);
+        phit_bench_run(b, "sampler", k->name, core_sampler, (void *)k, 1, "op");
+    }
+
+    /* K=2..64: powers of two and the odd sizes that used to carry modulo bias */
+    static const int route_k[] = { 2, 3, 4, 5, 7, 8, 12, 16, 24, 32, 48, 64 };
+    static char route_names[12][32];
+    for (int i = 0; i < 12; i++) {
+        snprintf(route_names[i], sizeof(route_names[i]), "phit_route(%d)", route_k[i]);
+        phit_bench_run(b, "route", route_names[i], core_route, (void *)&route_k[i], 1, "op");
+    }
+    phit_bench_run(b, "route", "phit_route_const(2)", core_route_const2, NULL, 1, "op");
+    phit_bench_run(b, "route", "phit_route_const(8)", core_route_const8, NULL, 1, "op");
+    phit_bench_run(b, "route", "phit_route_const(64)", core_route_const64, NULL, 1, "op");
+
+    static phit_load_t loads[8];
+    phit_bench_run(b, "route", "phit_route2(8)", core_route2_8, loads, 1, "op");
+    if (phit_bench_selected(b, "route", "phit_router_route(8)")) {
+        phit_router_t *r = malloc(sizeof(phit_router_t));
+        phit_router_init(r, 8, 0);
+        while (!phit_router_calibrate(r, 10000)) {}
+        phit_bench_run(b, "route", "phit_router_route(8)", core_router8, r, 1, "op");
+        free(r);
+    }
+
+    phit_pool_t pool;
+    phit_pool_init(&pool);
+    phit_bench_run(b, "pool", "phit_pool_extract", core_pool_extract, &pool, 1, "op");
+
+    phit_prng_t direct, buffered;
+    phit_prng_init(&direct);
+    phit_prng_init_buffered(&buffered, 0, 0);
+    phit_bench_run(b, "prng", "phit_prng_u64 direct", core_prng_u64, &direct, 1, "op");
+    phit_bench_run(b, "prng", "phit_prng_u64 buffered", core_prng_u64, &buffered, 1, "op");
+    /* Direct mode served from the background ring; underruns harvest inline */
+    if (phit_bench_selected(b, "prng", "phit_prng_u64 direct+harvester")) {
+        phit_bench_unpin(b);
+        phit_harvester_start(100);
+        phit_bench_repin(b);
+        phit_bench_run(b, "prng", "phit_prng_u64 direct+harvester", core_prng_u64, &direct,
+                       1, "op");
+        phit_harvester_stop();
+    }
+    core_prng_paced(b, "phit_prng_u64 direct paced", 0);
+    core_prng_paced(b, "phit_prng_u64 direct+harvester paced", 1);
+
+    core_fill_t fill = { &buffered, fill_buf, CORE_FILL };
+    static char names[4][40];
+    for (int level = PHIT_SIMD_SCALAR; level <= phit_simd_level(); level++) {
+        if (phit_simd_select(level) != level) continue;
+        snprintf(names[level], sizeof(names[level]), "phit_prng_fill 4K %s",
+                 phit_simd_name(level));
+        phit_bench_run(b, "prng", names[level], core_prng_fill, &fill, CORE_FILL, "B");
+    }
+    phit_simd_select(phit_simd_level());
+}
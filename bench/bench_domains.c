@@ -0,0 +1,94 @@
+/*
+ * bench_domains.c — Cross-domain sampling: phits/s against phit_sample_compound
+ *
+ * Rates are phits per second: samples/s times phits per sample, both
+ * measured. phit_sample_compound(2) gets two local reads' entropy
+ * (phit_sampler_profile's phits_per_read, twice); phit_sample_domains
+ * gets its local read plus what each fresh helper publication adds
+ * (phit_domains_profile). Helpers go to distinct nodes of the
+ * PHIT_TOPO_PERF topology, P before E on a hybrid part; the note names
+ * the split and the fresh share.
+ *
+ * Each helper spins a core. With fewer cores than helpers plus the
+ * consumer they time-share with it, publications go stale between
+ * samples and the cross-domain phits drop accordingly.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phit_bench.h"
+#include "phit_domains.h"
+
+static volatile uint32_t domains_sink;
+
+static void domains_report(phit_bench_t *b, const char *name, double *rates, int reps,
+                           const char *note) {
+    phit_bench_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.group = "domains";
+    res.name = name;
+    res.items_per_op = 1;
+    res.item = "phit";
+    res.reps = reps;
+    res.rate_median = phit_bench_median(rates, reps);
+    res.rate_min = rates[0];
+    res.rate_max = rates[reps - 1];
+    res.lat_p50_ns = res.lat_p99_ns = res.lat_p999_ns = res.lat_max_ns = -1;
+    snprintf(res.note, sizeof(res.note), "%s", note);
+    phit_bench_report(b, &res);
+}
+
+void phit_bench_group_domains(phit_bench_t *b) {
+    int samples = b->quick ? 20000 : 200000;
+    int reps = b->reps < 5 ? b->reps : 5;
+    double rates[PHIT_BENCH_MAX_REPS];
+    char note[64];
+
+    static phit_topo_t topo;
+    phit_topo_discover(&topo, PHIT_TOPO_PERF);
+
+    /* The LCG-10 two-read kernel is phit_sample_compound(2)'s workload */
+    const phit_sampler_t *k2 = NULL;
+    for (int i = 0; i < phit_sampler_count(); i++) {
+        const phit_sampler_t *k = phit_sampler_get(i);
+        if (k->kind == PHIT_WL_LCG && k->iters == 10 && k->reads == 2) k2 = k;
+    }
+    if (k2 && phit_bench_selected(b, "domains", "compound(2)")) {
+        phit_sampler_profile_t p;
+        for (int r = 0; r < reps; r++) {
+            phit_sampler_profile(k2, samples, &p);
+            uint32_t sink = 0;
+            uint64_t t0 = phit_now_ns();
+            for (int i = 0; i < samples; i++) sink += phit_sample_compound(2);
+            double ns = (double)(phit_now_ns() - t0) / samples;
+            domains_sink = sink;
+            rates[r] = 2 * p.phits_per_read / ns * 1e9;
+        }
+        snprintf(note, sizeof(note), "%.2f phits/sample", 2 * p.phits_per_read);
+        domains_report(b, "compound(2)", rates, reps, note);
+    }
+
+    static const int helpers[] = { 1, 2 };
+    for (int i = 0; i < 2; i++) {
+        char name[48];
+        snprintf(name, sizeof(name), "domains helpers=%d", helpers[i]);
+        if (!phit_bench_selected(b, "domains", name)) continue;
+        phit_domains_t *d = phit_domains_start(&topo, helpers[i]);
+        if (!d) continue;
+        phit_domains_profile_t p;
+        memset(&p, 0, sizeof(p));
+        for (int r = 0; r < reps; r++) {
+            phit_domains_profile(d, samples, &p);
+            rates[r] = p.phits_per_sample / p.ns_per_sample * 1e9;
+        }
+        snprintf(note, sizeof(note), "%.2f+%.2f phits/sample, %.2f fresh, %s %d node(s)",
+                 p.local_phits, p.cross_phits, p.fresh_rate, phit_topo_kind_name(topo.kind),
+                 topo.num_nodes);
+        domains_report(b, name, rates, reps, note);
+        phit_domains_stop(d);
+    }
+}
@@ -0,0 +1,291 @@
+/*
+ * bench_exec.c — Task dispatch throughput: phit_exec vs shared-state queues
+ *
+ * T threads split into T/2 producers and T/2 workers. Producers submit a
+ * fixed task count as fast as they can; a run ends when every task has
+ * executed. Dispatchers:
+ *
+ *   phit_route     phit_exec_submit (per-task phit_route)
+ *   phit_route2    phit_exec_submit2 (two choices by ring depth)
+ *   phit_batch     phit_exec_submit_batch, 64 tasks per call
+ *   cdf_router     phit_exec_submit_router, one calibrated router per producer
+ *   async_batch    phit_exec_submit_async_batch, 64 tasks per call, one
+ *                  completion queue per producer drained as it goes
+ *   atomic_rr      phit_exec rings, target from a shared fetch-add counter
+ *   mutex_queue    one mutex + condvar queue shared by all workers
+ *
+ * Each run checks that every task executed exactly once.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "phit_bench.h"
+#include "phit_exec.h"
+
+enum { EXEC_PHIT, EXEC_ROUTE2, EXEC_BATCH, EXEC_ROUTER, EXEC_ASYNC, EXEC_RR, EXEC_MUTEX,
+       EXEC_KINDS };
+
+static const char *exec_kind_name[EXEC_KINDS] = {
+    "phit_route", "phit_route2", "phit_batch", "cdf_router", "async_batch", "atomic_rr",
+    "mutex_queue"
+};
+
+#define EXEC_BATCH_N 64
+
+static unsigned char *exec_runs;
+
+static void exec_task(void *arg) {
+    volatile uint64_t x = (uintptr_t)arg;
+    for (int i = 0; i < 8; i++) x = x * 6364136223846793005ULL + 1;
+    exec_runs[(uintptr_t)arg]++;
+}
+
+/* ---- Mutex queue baseline ---- */
+
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    phit_task_t    *ring;
+    int             cap, head, count, closed;
+} mq_t;
+
+static void mq_push(mq_t *q, phit_task_fn fn, void *arg) {
+    pthread_mutex_lock(&q->mu);
+    while (q->count == q->cap) pthread_cond_wait(&q->not_full, &q->mu);
+    phit_task_t *t = &q->ring[(q->head + q->count) % q->cap];
+    t->fn = fn;
+    t->arg = arg;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mu);
+}
+
+static void *mq_worker(void *p) {
+    mq_t *q = p;
+    for (;;) {
+        pthread_mutex_lock(&q->mu);
+        while (q->count == 0 && !q->closed) pthread_cond_wait(&q->not_empty, &q->mu);
+        if (q->count == 0) {
+            pthread_mutex_unlock(&q->mu);
+            return NULL;
+        }
+        phit_task_t t = q->ring[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->mu);
+        t.fn(t.arg);
+    }
+}
+
+/* ---- Producers ---- */
+
+typedef struct {
+    int          kind;
+    phit_exec_t *exec;
+    mq_t        *mq;
+    int          workers;
+    uintptr_t    first, count;
+    volatile int *go;
+    volatile int *ready;
+} exec_producer_t;
+
+static uint64_t exec_rr_counter;
+
+static void *exec_producer(void *p) {
+    exec_producer_t *a = p;
+    phit_router_t *router = NULL;
+    if (a->kind == EXEC_ROUTER) {
+        router = malloc(sizeof(phit_router_t));
+        phit_router_init(router, a->workers, 50000);
+        while (!phit_router_calibrate(router, 10000)) {}
+    }
+    __atomic_fetch_add(a->ready, 1, __ATOMIC_ACQ_REL);
+    while (!__atomic_load_n(a->go, __ATOMIC_ACQUIRE)) sched_yield();
+
+    uintptr_t end = a->first + a->count;
+    switch (a->kind) {
+    case EXEC_PHIT:
+        for (uintptr_t i = a->first; i < end; i++) phit_exec_submit(a->exec, exec_task, (void *)i);
+        break;
+    case EXEC_ROUTE2:
+        for (uintptr_t i = a->first; i < end; i++) phit_exec_submit2(a->exec, exec_task, (void *)i);
+        break;
+    case EXEC_BATCH: {
+        phit_task_t tasks[EXEC_BATCH_N];
+        for (uintptr_t i = a->first; i < end; i += EXEC_BATCH_N) {
+            int n = end - i < EXEC_BATCH_N ? (int)(end - i) : EXEC_BATCH_N;
+            for (int k = 0; k < n; k++) {
+                tasks[k].fn = exec_task;
+                tasks[k].arg = (void *)(i + (uintptr_t)k);
+            }
+            phit_exec_submit_batch(a->exec, tasks, n);
+        }
+        break;
+    }
+    case EXEC_ROUTER:
+        for (uintptr_t i = a->first; i < end; i++)
+            phit_exec_submit_router(a->exec, router, exec_task, (void *)i);
+        break;
+    case EXEC_ASYNC: {
+        phit_cq_t *cq = phit_cq_create(0);
+        phit_task_t tasks[EXEC_BATCH_N];
+        phit_cqe_t cqe[EXEC_BATCH_N];
+        uintptr_t i = a->first, completed = 0;
+        while (cq && completed < a->count) {
+            int n = end - i < EXEC_BATCH_N ? (int)(end - i) : EXEC_BATCH_N;
+            for (int k = 0; k < n; k++) {
+                tasks[k].fn = exec_task;
+                tasks[k].arg = (void *)(i + (uintptr_t)k);
+            }
+            int queued = n ? phit_exec_submit_async_batch(a->exec, cq, tasks, n, NULL) : 0;
+            i += (uintptr_t)queued;
+            if ((queued < n || i == end) && !phit_cq_wait(cq, 1000)) sched_yield();
+            int got;
+            while ((got = phit_cq_poll(cq, cqe, EXEC_BATCH_N)) > 0) completed += (uintptr_t)got;
+        }
+        phit_cq_destroy(cq);
+        break;
+    }
+    case EXEC_RR:
+        for (uintptr_t i = a->first; i < end; i++) {
+            uint64_t n = __atomic_fetch_add(&exec_rr_counter, 1, __ATOMIC_RELAXED);
+            phit_exec_submit_to(a->exec, (int)(n % (uint64_t)a->workers), exec_task, (void *)i);
+        }
+        break;
+    case EXEC_MUTEX:
+        for (uintptr_t i = a->first; i < end; i++) mq_push(a->mq, exec_task, (void *)i);
+        break;
+    }
+    free(router);
+    return NULL;
+}
+
+/* One run: tasks/s, or -1 if a task was lost or duplicated */
+static double exec_run(int kind, int threads, int tasks) {
+    int workers = threads / 2, producers = threads - workers;
+    memset(exec_runs, 0, (size_t)tasks);
+
+    phit_exec_t *exec = NULL;
+    mq_t mq;
+    pthread_t wt[PHIT_EXEC_MAX_WORKERS];
+    if (kind == EXEC_MUTEX) {
+        memset(&mq, 0, sizeof(mq));
+        pthread_mutex_init(&mq.mu, NULL);
+        pthread_cond_init(&mq.not_empty, NULL);
+        pthread_cond_init(&mq.not_full, NULL);
+        mq.cap = PHIT_EXEC_QUEUE_CAPACITY * workers;
+        mq.ring = malloc(sizeof(phit_task_t) * (size_t)mq.cap);
+        for (int w = 0; w < workers; w++) {
+            if (pthread_create(&wt[w], NULL, mq_worker, &mq) != 0)
+                phit_bench_fatal("exec", "cannot start a worker");
+        }
+    } else {
+        exec = phit_exec_create(workers, 0, 0);
+        if (!exec) phit_bench_fatal("exec", "phit_exec_create failed");
+    }
+
+    volatile int go = 0, ready = 0;
+    pthread_t *pt = malloc(sizeof(pthread_t) * (size_t)producers);
+    exec_producer_t *pa = malloc(sizeof(exec_producer_t) * (size_t)producers);
+    uintptr_t share = (uintptr_t)(tasks / producers);
+    for (int p = 0; p < producers; p++) {
+        pa[p].kind = kind;
+        pa[p].exec = exec;
+        pa[p].mq = &mq;
+        pa[p].workers = workers;
+        pa[p].first = share * (uintptr_t)p;
+        pa[p].count = p == producers - 1 ? (uintptr_t)tasks - pa[p].first : share;
+        pa[p].go = &go;
+        pa[p].ready = &ready;
+        if (pthread_create(&pt[p], NULL, exec_producer, &pa[p]) != 0)
+            phit_bench_fatal("exec", "cannot start a producer");
+    }
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < producers) sched_yield();
+
+    uint64_t t0 = phit_now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    for (int p = 0; p < producers; p++) pthread_join(pt[p], NULL);
+    if (kind == EXEC_MUTEX) {
+        pthread_mutex_lock(&mq.mu);
+        mq.closed = 1;
+        pthread_cond_broadcast(&mq.not_empty);
+        pthread_mutex_unlock(&mq.mu);
+        for (int w = 0; w < workers; w++) pthread_join(wt[w], NULL);
+    } else {
+        phit_exec_shutdown(exec);
+    }
+    uint64_t t1 = phit_now_ns();
+
+    if (kind == EXEC_MUTEX) {
+        free(mq.ring);
+        pthread_mutex_destroy(&mq.mu);
+        pthread_cond_destroy(&mq.not_empty);
+        pthread_cond_destroy(&mq.not_full);
+    } else {
+        phit_exec_destroy(exec);
+    }
+    free(pt);
+    free(pa);
+
+    for (int i = 0; i < tasks; i++) {
+        if (exec_runs[i] != 1) return -1;
+    }
+    return tasks / ((double)(t1 - t0) / 1e9);
+}
+
+void phit_bench_group_exec(phit_bench_t *b) {
+    static char names[EXEC_KINDS * 8][40];
+    int tasks = b->quick ? 20000 : 400000;
+    int reps = b->reps < 5 ? b->reps : 5;
+    int slot = 0;
+    exec_runs = malloc((size_t)tasks);
+
+    for (int threads = 4; threads <= b->threads_max && threads <= 2 * PHIT_EXEC_MAX_WORKERS;
+         threads *= 2) {
+        for (int kind = 0; kind < EXEC_KINDS; kind++) {
+            char *name = names[slot % (EXEC_KINDS * 8)];
+            snprintf(name, 40, "%s T=%d", exec_kind_name[kind], threads);
+            if (!phit_bench_selected(b, "exec", name)) continue;
+            slot++;
+
+            /* A run that lost or duplicated a task has no rate: it fails
+             * the bench and stays out of the statistics */
+            double rates[PHIT_BENCH_MAX_REPS];
+            int good = 0, lost = 0;
+            for (int r = 0; r < reps; r++) {
+                double rate = exec_run(kind, threads, tasks);
+                if (rate < 0) lost++;
+                else rates[good++] = rate;
+            }
+            char why[64];
+            if (lost) {
+                snprintf(why, sizeof(why), "lost or duplicated tasks in %d of %d runs", lost, reps);
+                phit_bench_fail(b, "exec", name, why);
+            }
+            if (good == 0) continue;
+            phit_bench_result_t res;
+            memset(&res, 0, sizeof(res));
+            res.group = "exec";
+            res.name = name;
+            res.items_per_op = 1;
+            res.item = "task";
+            res.reps = good;
+            res.rate_median = phit_bench_median(rates, good);
+            res.rate_min = rates[0];
+            res.rate_max = rates[good - 1];
+            res.lat_p50_ns = res.lat_p99_ns = res.lat_p999_ns = res.lat_max_ns = -1;
+            snprintf(res.note, sizeof(res.note), "%d producers, %d workers, %s",
+                     threads - threads / 2, threads / 2, lost ? "FAILED" : "exactly-once");
+            phit_bench_report(b, &res);
+        }
+    }
+    free(exec_runs);
+}
@@ -0,0 +1,146 @@
+/*
+ * bench_scaling.c — Per-thread PRNG throughput, 1 to --threads threads
+ *
+ * T threads each draw phit_prng_u64() from their own buffered-mode PRNG,
+ * element t of one array, until the run's deadline. Rate is all draws
+ * per second of wall time; the note is the speedup over T=1 of the same
+ * layout.
+ *
+ *   packed   phit_prng_t[T]: neighbouring elements share cache lines
+ *   padded   phit_prng_array_create(T): one line group per element
+ *
+ * With fewer cores than threads the rate flattens at the core count for
+ * both; false sharing shows as packed falling behind padded before that.
+ * The curve is about cores, so it never runs on --cpu: the threads get
+ * the process's original mask, and the note says so when --cpu is set.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "phit_bench.h"
+
+#define SCALING_MAX_THREADS 64
+#define SCALING_BATCH       256
+
+enum { SCALING_PACKED, SCALING_PADDED, SCALING_KINDS };
+
+static const char *scaling_kind_name[SCALING_KINDS] = { "packed", "padded" };
+
+typedef struct {
+    phit_prng_t  *rng;
+    volatile int *go;
+    volatile int *stop;
+    volatile int *ready;
+    uint64_t      draws;
+    uint64_t      acc;
+} scaling_thread_t;
+
+static void *scaling_thread(void *p) {
+    scaling_thread_t *a = p;
+    __atomic_fetch_add(a->ready, 1, __ATOMIC_ACQ_REL);
+    while (!__atomic_load_n(a->go, __ATOMIC_ACQUIRE)) sched_yield();
+
+    uint64_t draws = 0, acc = 0;
+    while (!__atomic_load_n(a->stop, __ATOMIC_RELAXED)) {
+        for (int i = 0; i < SCALING_BATCH; i++) acc += phit_prng_u64(a->rng);
+        draws += SCALING_BATCH;
+    }
+    a->draws = draws;
+    a->acc = acc;
+    return NULL;
+}
+
+/* One run of rep_ms: draws per second across all threads */
+static double scaling_run(phit_prng_t **rngs, int threads, int rep_ms, scaling_thread_t *ta,
+                          pthread_t *th) {
+    volatile int go = 0, stop = 0, ready = 0;
+    for (int t = 0; t < threads; t++) {
+        ta[t].rng = rngs[t];
+        ta[t].go = &go;
+        ta[t].stop = &stop;
+        ta[t].ready = &ready;
+        if (pthread_create(&th[t], NULL, scaling_thread, &ta[t]) != 0)
+            phit_bench_fatal("scaling", "cannot start a thread");
+    }
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < threads) sched_yield();
+    uint64_t t0 = phit_now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    while (phit_now_ns() - t0 < (uint64_t)rep_ms * 1000000) sched_yield();
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    uint64_t draws = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(th[t], NULL);
+        draws += ta[t].draws;
+    }
+    uint64_t t1 = phit_now_ns();
+    return (double)draws / ((double)(t1 - t0) / 1e9);
+}
+
+void phit_bench_group_scaling(phit_bench_t *b) {
+    static char names[SCALING_KINDS * 8][32];
+    int reps = b->reps < 5 ? b->reps : 5;
+    int slot = 0;
+    double base[SCALING_KINDS] = { 0, 0 };
+    /* Threads inherit this mask: one --cpu would turn false sharing into
+     * time-slicing on a single core */
+    phit_bench_unpin(b);
+
+    for (int threads = 1; threads <= b->threads_max && threads <= SCALING_MAX_THREADS;
+         threads *= 2) {
+        scaling_thread_t ta[SCALING_MAX_THREADS];
+        pthread_t th[SCALING_MAX_THREADS];
+        phit_prng_t *rngs[SCALING_MAX_THREADS];
+        for (int kind = 0; kind < SCALING_KINDS; kind++) {
+            char *name = names[slot % (SCALING_KINDS * 8)];
+            snprintf(name, 32, "%s T=%d", scaling_kind_name[kind], threads);
+            if (!phit_bench_selected(b, "scaling", name)) continue;
+            slot++;
+
+            phit_prng_t *packed = NULL;
+            phit_prng_padded_t *padded = NULL;
+            if (kind == SCALING_PACKED) {
+                packed = calloc((size_t)threads, sizeof(phit_prng_t));
+                if (!packed) continue;
+                for (int t = 0; t < threads; t++) {
+                    phit_prng_init_buffered(&packed[t], 0, 0);
+                    rngs[t] = &packed[t];
+                }
+            } else {
+                padded = phit_prng_array_create(threads);
+                if (!padded) continue;
+                for (int t = 0; t < threads; t++) rngs[t] = &padded[t].rng;
+            }
+
+            double rates[PHIT_BENCH_MAX_REPS];
+            for (int r = 0; r < reps; r++) rates[r] = scaling_run(rngs, threads, b->rep_ms, ta, th);
+            phit_bench_result_t res;
+            memset(&res, 0, sizeof(res));
+            res.group = "scaling";
+            res.name = name;
+            res.items_per_op = 1;
+            res.item = "op";
+            res.reps = reps;
+            res.rate_median = phit_bench_median(rates, reps);
+            res.rate_min = rates[0];
+            res.rate_max = rates[reps - 1];
+            res.lat_p50_ns = res.lat_p99_ns = res.lat_p999_ns = res.lat_max_ns = -1;
+            if (threads == 1) base[kind] = res.rate_median;
+            if (base[kind] > 0) {
+                snprintf(res.note, sizeof(res.note), "%.2fx vs T=1, %zu B/element%s",
+                         res.rate_median / base[kind],
+                         kind == SCALING_PACKED ? sizeof(phit_prng_t) : sizeof(phit_prng_padded_t),
+                         b->cpu >= 0 ? ", --cpu ignored" : "");
+            }
+            phit_bench_report(b, &res);
+
+            free(packed);
+            phit_prng_array_destroy(padded);
+        }
+    }
+}
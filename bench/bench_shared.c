@@ -0,0 +1,117 @@
+/*
+ * bench_shared.c — Thread startup seeding: private pool vs shared pool
+ *
+ * T threads start behind a barrier; each seeds a PRNG and draws one
+ * value. The latency columns are per-thread seeding time (p50/p99/max
+ * across all threads of all reps); the rate is threads seeded per
+ * second of wall time from release to the last thread done.
+ *
+ *   private   phit_prng_init_buffered (PHIT_PRNG_SEED_ROUNDS harvests + rekey)
+ *   shared    phit_prng_init_shared   (two lock-free shared extractions)
+ *   local     phit_prng_local         (thread-local shared-mode PRNG)
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "phit_bench.h"
+
+enum { SHARED_PRIVATE, SHARED_SHARED, SHARED_LOCAL, SHARED_KINDS };
+
+static const char *shared_kind_name[SHARED_KINDS] = { "private", "shared", "local" };
+
+typedef struct {
+    int           kind;
+    volatile int *go;
+    volatile int *ready;
+    uint64_t      seed_ns;
+    uint64_t      done_ns;
+    uint64_t      value;
+} shared_thread_t;
+
+static void *shared_thread(void *p) {
+    shared_thread_t *a = p;
+    __atomic_fetch_add(a->ready, 1, __ATOMIC_ACQ_REL);
+    while (!__atomic_load_n(a->go, __ATOMIC_ACQUIRE)) sched_yield();
+
+    uint64_t t0 = phit_now_ns();
+    phit_prng_t rng, *r = &rng;
+    if (a->kind == SHARED_PRIVATE) phit_prng_init_buffered(&rng, 0, 0);
+    else if (a->kind == SHARED_SHARED) phit_prng_init_shared(&rng, 0, 0);
+    else r = phit_prng_local();
+    a->value = phit_prng_u64(r);
+    a->done_ns = phit_now_ns();
+    a->seed_ns = a->done_ns - t0;
+    return NULL;
+}
+
+/* One run: wall ns from release to the last thread done */
+static double shared_run(int kind, int threads, shared_thread_t *ta, pthread_t *th) {
+    volatile int go = 0, ready = 0;
+    for (int t = 0; t < threads; t++) {
+        ta[t].kind = kind;
+        ta[t].go = &go;
+        ta[t].ready = &ready;
+        if (pthread_create(&th[t], NULL, shared_thread, &ta[t]) != 0)
+            phit_bench_fatal("shared", "cannot start a thread");
+    }
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < threads) sched_yield();
+    uint64_t t0 = phit_now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    uint64_t end = t0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(th[t], NULL);
+        if (ta[t].done_ns > end) end = ta[t].done_ns;
+    }
+    return (double)(end - t0);
+}
+
+void phit_bench_group_shared(phit_bench_t *b) {
+    static const int counts[] = { 16, 128 };
+    static char names[SHARED_KINDS * 2][40];
+    int reps = b->reps < 5 ? b->reps : 5;
+    int slot = 0;
+
+    /* The shared pool bootstraps once per process; pay it outside the timing */
+    (void)phit_shared_extract();
+
+    for (int c = 0; c < (b->quick ? 1 : 2); c++) {
+        int threads = counts[c];
+        shared_thread_t *ta = calloc((size_t)threads, sizeof(shared_thread_t));
+        pthread_t *th = malloc(sizeof(pthread_t) * (size_t)threads);
+        double *lat = malloc(sizeof(double) * (size_t)(threads * reps));
+        for (int kind = 0; kind < SHARED_KINDS; kind++) {
+            char *name = names[slot % (SHARED_KINDS * 2)];
+            snprintf(name, 40, "%s T=%d", shared_kind_name[kind], threads);
+            if (!phit_bench_selected(b, "shared", name)) continue;
+            slot++;
+
+            double rates[PHIT_BENCH_MAX_REPS];
+            for (int r = 0; r < reps; r++) {
+                rates[r] = threads / (shared_run(kind, threads, ta, th) / 1e9);
+                for (int t = 0; t < threads; t++) lat[r * threads + t] = (double)ta[t].seed_ns;
+            }
+            phit_bench_result_t res;
+            memset(&res, 0, sizeof(res));
+            res.group = "shared";
+            res.name = name;
+            res.items_per_op = 1;
+            res.item = "thread";
+            res.reps = reps;
+            res.rate_median = phit_bench_median(rates, reps);
+            res.rate_min = rates[0];
+            res.rate_max = rates[reps - 1];
+            phit_bench_percentiles(lat, threads * reps, &res);
+            snprintf(res.note, sizeof(res.note), "per-thread seed + first u64");
+            phit_bench_report(b, &res);
+        }
+        free(lat);
+        free(th);
+        free(ta);
+    }
+}
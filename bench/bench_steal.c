@@ -0,0 +1,142 @@
+/*
+ * bench_steal.c — Skewed task cost: phase routing, two choices and stealing
+ *
+ * One producer submits N tasks through phit_exec into W workers.
+ * Task cost is Pareto-distributed spin work, so a few tasks are orders of
+ * magnitude heavier than the median and phase routing's even task *count*
+ * stops meaning even *load*. Rings are sized to hold the whole run, so the
+ * producer never blocks and only worker imbalance shows.
+ *
+ *   route        phit_exec_submit, PHIT_EXEC_SINGLE_PRODUCER
+ *   route2       phit_exec_submit2 (two choices by ring depth)
+ *   route+steal  phit_exec_submit, plus PHIT_EXEC_STEAL
+ *
+ * Rate is N / makespan (first submit to last completion); the latency
+ * columns are per-task submit-to-completion, median over reps.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "phit_bench.h"
+#include "phit_exec.h"
+
+#define STEAL_BASE_SPIN 200      /* spin iterations of the lightest task */
+#define STEAL_MAX_SPIN  2000000  /* cap on the heaviest */
+
+typedef struct {
+    uint32_t spin;
+    uint64_t submit_ns;
+    uint64_t done_ns;
+} steal_task_t;
+
+static steal_task_t *steal_tasks;
+
+static void steal_task(void *arg) {
+    steal_task_t *t = &steal_tasks[(uintptr_t)arg];
+    volatile uint64_t x = (uintptr_t)arg;
+    for (uint32_t i = 0; i < t->spin; i++) x = x * 6364136223846793005ULL + 1;
+    t->done_ns = phit_now_ns();
+}
+
+/* Pareto(alpha) with scale STEAL_BASE_SPIN, by inversion */
+static void steal_costs(int n, double alpha, phit_prng_t *rng) {
+    for (int i = 0; i < n; i++) {
+        double u = 1.0 - phit_prng_double(rng);          /* (0, 1] */
+        double c = STEAL_BASE_SPIN * pow(u, -1.0 / alpha);
+        steal_tasks[i].spin = c > STEAL_MAX_SPIN ? STEAL_MAX_SPIN : (uint32_t)c;
+    }
+}
+
+enum { STEAL_ROUTE, STEAL_ROUTE2, STEAL_STEAL, STEAL_KINDS };
+
+static const char *steal_kind_name[STEAL_KINDS] = { "route", "route2", "route+steal" };
+
+/* One run: makespan in ns, per-task latencies into lat[], steals into *stolen */
+static double steal_run(int workers, int kind, int n, double *lat, uint64_t *stolen) {
+    int flags = PHIT_EXEC_SINGLE_PRODUCER | (kind == STEAL_STEAL ? PHIT_EXEC_STEAL : 0);
+    phit_exec_t *e = phit_exec_create(workers, n, flags);
+    if (!e) phit_bench_fatal("steal", "phit_exec_create failed");
+    uint64_t t0 = phit_now_ns();
+    for (int i = 0; i < n; i++) {
+        steal_tasks[i].submit_ns = phit_now_ns();
+        if (kind == STEAL_ROUTE2) phit_exec_submit2(e, steal_task, (void *)(uintptr_t)i);
+        else phit_exec_submit(e, steal_task, (void *)(uintptr_t)i);
+    }
+    phit_exec_shutdown(e);
+
+    uint64_t end = t0;
+    for (int i = 0; i < n; i++) {
+        if (steal_tasks[i].done_ns > end) end = steal_tasks[i].done_ns;
+        lat[i] = (double)(steal_tasks[i].done_ns - steal_tasks[i].submit_ns);
+    }
+    *stolen = 0;
+    for (int w = 0; w < workers; w++) *stolen += phit_exec_stolen(e, w);
+    phit_exec_destroy(e);
+    return (double)(end - t0);
+}
+
+void phit_bench_group_steal(phit_bench_t *b) {
+    static const double alphas[] = { 1.5, 1.1 };
+    static char names[24][48];
+    int n = b->quick ? 2000 : 20000;
+    int reps = b->reps < 5 ? b->reps : 5;
+    int slot = 0;
+    steal_tasks = calloc((size_t)n, sizeof(steal_task_t));
+    double *lat = malloc(sizeof(double) * (size_t)n);
+    phit_prng_t rng;
+    phit_prng_init(&rng);
+
+    for (int workers = 4; workers <= 8 && workers <= b->threads_max; workers *= 2) {
+        for (int a = 0; a < 2; a++) {
+            for (int kind = 0; kind < STEAL_KINDS; kind++) {
+                char *name = names[slot % 24];
+                snprintf(name, 48, "%s pareto(%.1f) W=%d", steal_kind_name[kind],
+                         alphas[a], workers);
+                if (!phit_bench_selected(b, "steal", name)) continue;
+                slot++;
+
+                double rates[PHIT_BENCH_MAX_REPS], spans[PHIT_BENCH_MAX_REPS];
+                double p50[PHIT_BENCH_MAX_REPS], p99[PHIT_BENCH_MAX_REPS];
+                double p999[PHIT_BENCH_MAX_REPS], pmax[PHIT_BENCH_MAX_REPS];
+                uint64_t stolen = 0;
+                for (int r = 0; r < reps; r++) {
+                    uint64_t s;
+                    steal_costs(n, alphas[a], &rng);
+                    spans[r] = steal_run(workers, kind, n, lat, &s);
+                    rates[r] = n / (spans[r] / 1e9);
+                    stolen += s;
+                    phit_bench_result_t pr;
+                    phit_bench_percentiles(lat, n, &pr);
+                    p50[r] = pr.lat_p50_ns;
+                    p99[r] = pr.lat_p99_ns;
+                    p999[r] = pr.lat_p999_ns;
+                    pmax[r] = pr.lat_max_ns;
+                }
+                phit_bench_result_t res;
+                memset(&res, 0, sizeof(res));
+                res.group = "steal";
+                res.name = name;
+                res.items_per_op = 1;
+                res.item = "task";
+                res.reps = reps;
+                res.rate_median = phit_bench_median(rates, reps);
+                res.rate_min = rates[0];
+                res.rate_max = rates[reps - 1];
+                res.lat_p50_ns = phit_bench_median(p50, reps);
+                res.lat_p99_ns = phit_bench_median(p99, reps);
+                res.lat_p999_ns = phit_bench_median(p999, reps);
+                res.lat_max_ns = phit_bench_median(pmax, reps);
+                snprintf(res.note, sizeof(res.note), "makespan %.2f ms, %.0f stolen/run",
+                         phit_bench_median(spans, reps) / 1e6, (double)stolen / reps);
+                phit_bench_report(b, &res);
+            }
+        }
+    }
+    free(lat);
+    free(steal_tasks);
+}
@@ -0,0 +1,162 @@
+/*
+ * bench_stoch.c — Stochastic arithmetic: phit-keyed comparators vs an LFSR
+ *
+ * Rates (bits per second over 64 Kbit streams):
+ *
+ *   encode phit   phit_stoch_encode: PHIT_STOCH_BITS expansion planes
+ *                 per 64 comparator decisions
+ *   encode lfsr   the classic encoder: one 16-bit Galois LFSR step and
+ *                 one compare per decision
+ *   and, mux, count   the word loops of phit_stoch.h
+ *
+ * Accuracy ("mul N=..."): mean absolute error of a * b over random
+ * inputs for stream length N, phit streams keyed by two pool extractions
+ * vs two LFSRs with independent seeds. The rate is encode both, AND and
+ * count, per multiply.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "phit_bench.h"
+#include "phit_stoch.h"
+
+#define STOCH_BITS   (1 << 16)
+#define STOCH_TRIALS 256
+
+typedef struct {
+    phit_bitstream_t a, b, c, sel;
+    phit_pool_t      pool;
+    uint16_t         lfsr_a, lfsr_b;
+} stoch_ctx_t;
+
+/* 16-bit maximal Galois LFSR, x^16 + x^14 + x^13 + x^11 + 1 */
+static inline uint16_t stoch_lfsr_step(uint16_t s) {
+    return (uint16_t)((s >> 1) ^ (-(s & 1u) & 0xB400u));
+}
+
+static void stoch_encode_lfsr(phit_bitstream_t *s, double p, uint16_t *state) {
+    uint32_t q = (uint32_t)(p * 65536.0 + 0.5);
+    uint16_t r = *state;
+    for (size_t w = 0; w < s->nwords; w++) {
+        uint64_t v = 0;
+        for (int i = 0; i < 64; i++) {
+            r = stoch_lfsr_step(r);
+            v |= (uint64_t)(r < q) << i;
+        }
+        s->words[w] = v;
+    }
+    *state = r;
+}
+
+static uint64_t stoch_encode_phit(void *ctx, uint64_t iters) {
+    stoch_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) phit_stoch_encode(&c->a, 0.3, i);
+    return c->a.words[0];
+}
+
+static uint64_t stoch_encode_lfsr_op(void *ctx, uint64_t iters) {
+    stoch_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) stoch_encode_lfsr(&c->a, 0.3, &c->lfsr_a);
+    return c->a.words[0];
+}
+
+static uint64_t stoch_and(void *ctx, uint64_t iters) {
+    stoch_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) phit_stoch_and(&c->c, &c->a, &c->b);
+    return c->c.words[0];
+}
+
+static uint64_t stoch_mux(void *ctx, uint64_t iters) {
+    stoch_ctx_t *c = ctx;
+    for (uint64_t i = 0; i < iters; i++) phit_stoch_mux(&c->c, &c->a, &c->b, &c->sel);
+    return c->c.words[0];
+}
+
+static uint64_t stoch_count(void *ctx, uint64_t iters) {
+    stoch_ctx_t *c = ctx;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) acc += phit_stoch_count(&c->a);
+    return acc;
+}
+
+/* MAE of a*b over STOCH_TRIALS (or fewer) input pairs at nwords words */
+static void stoch_accuracy(phit_bench_t *b, stoch_ctx_t *c, size_t nwords, const char *name) {
+    int trials = b->quick ? 32 : STOCH_TRIALS;
+    size_t saved = c->a.nwords;
+    c->a.nwords = c->b.nwords = c->c.nwords = nwords;
+
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+    double err_phit = 0, err_lfsr = 0;
+    uint64_t t0 = phit_now_ns();
+    for (int t = 0; t < trials; t++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        double pa = (double)(x >> 11) / 9007199254740992.0;
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        double pb = (double)(x >> 11) / 9007199254740992.0;
+        phit_stoch_encode_pool(&c->a, pa, &c->pool);
+        phit_stoch_encode_pool(&c->b, pb, &c->pool);
+        phit_stoch_and(&c->c, &c->a, &c->b);
+        err_phit += fabs(phit_stoch_value(&c->c) - pa * pb);
+    }
+    uint64_t t1 = phit_now_ns();
+    x = 0x2545F4914F6CDD1DULL;
+    for (int t = 0; t < trials; t++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        double pa = (double)(x >> 11) / 9007199254740992.0;
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        double pb = (double)(x >> 11) / 9007199254740992.0;
+        c->lfsr_a = (uint16_t)(phit_pool_extract(&c->pool) | 1);
+        c->lfsr_b = (uint16_t)(phit_pool_extract(&c->pool) | 1);
+        stoch_encode_lfsr(&c->a, pa, &c->lfsr_a);
+        stoch_encode_lfsr(&c->b, pb, &c->lfsr_b);
+        phit_stoch_and(&c->c, &c->a, &c->b);
+        err_lfsr += fabs(phit_stoch_value(&c->c) - pa * pb);
+    }
+    c->a.nwords = c->b.nwords = c->c.nwords = saved;
+
+    phit_bench_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.group = "stoch";
+    res.name = name;
+    res.items_per_op = 1;
+    res.item = "mul";
+    res.reps = 1;
+    res.rate_median = res.rate_min = res.rate_max = trials / ((double)(t1 - t0) / 1e9);
+    res.lat_p50_ns = res.lat_p99_ns = res.lat_p999_ns = res.lat_max_ns = -1;
+    snprintf(res.note, sizeof(res.note), "MAE phit %.5f, lfsr %.5f", err_phit / trials,
+             err_lfsr / trials);
+    phit_bench_report(b, &res);
+}
+
+void phit_bench_group_stoch(phit_bench_t *b) {
+    static stoch_ctx_t ctx;
+    static char names[6][32];
+    if (!ctx.a.words) {
+        if (!phit_bitstream_init(&ctx.a, STOCH_BITS) || !phit_bitstream_init(&ctx.b, STOCH_BITS) ||
+            !phit_bitstream_init(&ctx.c, STOCH_BITS) || !phit_bitstream_init(&ctx.sel, STOCH_BITS))
+            return;
+        phit_pool_init(&ctx.pool);
+        ctx.lfsr_a = 0xACE1u;
+        phit_stoch_encode(&ctx.b, 0.6, 1);
+        phit_stoch_encode(&ctx.sel, 0.5, 2);
+    }
+
+    phit_bench_run(b, "stoch", "encode phit 64Kbit", stoch_encode_phit, &ctx, STOCH_BITS, "bit");
+    phit_bench_run(b, "stoch", "encode lfsr 64Kbit", stoch_encode_lfsr_op, &ctx, STOCH_BITS, "bit");
+    phit_bench_run(b, "stoch", "and 64Kbit", stoch_and, &ctx, STOCH_BITS, "bit");
+    phit_bench_run(b, "stoch", "mux 64Kbit", stoch_mux, &ctx, STOCH_BITS, "bit");
+    phit_bench_run(b, "stoch", "count 64Kbit", stoch_count, &ctx, STOCH_BITS, "bit");
+
+    /* Accuracy vs length: 64 bits to 64 Kbit */
+    for (int i = 0; i < 6; i++) {
+        size_t nwords = (size_t)1 << (2 * i);
+        snprintf(names[i], sizeof(names[i]), "mul N=%zu", nwords * 64);
+        if (!phit_bench_selected(b, "stoch", names[i])) continue;
+        stoch_accuracy(b, &ctx, nwords, names[i]);
+    }
+}
@@ -0,0 +1,172 @@
+/*
+ * bench_topo.c — Node-local routing: remote task executions, phit_route vs hierarchical
+ *
+ * One producer per node (up to 8), each restricted to its node, submits
+ * tasks whose 64-byte payload it has just written; the executor has one
+ * worker group per node (phit_exec_create_topo). A task is remote when
+ * its worker's node is not the producer's: its payload crosses the
+ * interconnect (or the chiplet boundary) on a real machine. Rates are
+ * tasks per second, the note is the remote share. Dispatchers:
+ *
+ *   phit_route       phit_exec_submit: uniform over every worker
+ *   local            phit_exec_submit_local, no spill
+ *   local spill=1/8  ... remote with probability 1/8
+ *   local depth      ... remote when the local ring is half full
+ *
+ * On a single-node host the nodes are synthetic (2 x 2 workers): the
+ * remote share is still exact, the cost of a remote payload is not.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "phit_bench.h"
+#include "phit_exec.h"
+
+#define TOPO_MAX_PRODUCERS 8
+
+enum { TOPO_ROUTE, TOPO_LOCAL, TOPO_SPILL, TOPO_DEPTH, TOPO_KINDS };
+
+static const char *topo_kind_name[TOPO_KINDS] = {
+    "phit_route", "local", "local spill=1/8", "local depth"
+};
+
+typedef struct {
+    uint64_t node;              /* producer's node */
+    uint64_t data[7];
+} topo_payload_t;
+
+static phit_topo_t topo;
+static struct {
+    uint64_t n;
+    char     pad[PHIT_CACHE_LINE - sizeof(uint64_t)];
+} topo_remote[PHIT_TOPO_MAX_NODES];
+
+static void topo_task(void *arg) {
+    topo_payload_t *p = arg;
+    uint64_t sum = 0;
+    for (int i = 0; i < 7; i++) sum += p->data[i];
+    p->data[0] = sum;
+    int node = phit_topo_current_node(&topo);
+    if ((uint64_t)node != p->node) __atomic_fetch_add(&topo_remote[node].n, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    phit_exec_t    *exec;
+    int             kind;
+    int             node;
+    topo_payload_t *payload;
+    int             count;
+    volatile int   *go;
+    volatile int   *ready;
+} topo_producer_t;
+
+static void *topo_producer(void *p) {
+    topo_producer_t *a = p;
+    phit_topo_pin(&topo, a->node);
+    for (int i = 0; i < a->count; i++) a->payload[i].node = (uint64_t)a->node;   /* first touch */
+    __atomic_fetch_add(a->ready, 1, __ATOMIC_ACQ_REL);
+    while (!__atomic_load_n(a->go, __ATOMIC_ACQUIRE)) sched_yield();
+
+    for (int i = 0; i < a->count; i++) {
+        topo_payload_t *t = &a->payload[i];
+        t->data[1] = (uint64_t)i;
+        if (a->kind == TOPO_ROUTE) phit_exec_submit(a->exec, topo_task, t);
+        else phit_exec_submit_local(a->exec, topo_task, t);
+    }
+    return NULL;
+}
+
+/* One run: tasks/s, and the remote share in *remote */
+static double topo_run(int kind, int producers, int workers_per_node, int tasks,
+                       topo_payload_t *payload, double *remote) {
+    phit_exec_t *exec = phit_exec_create_topo(&topo, workers_per_node, 0, 0);
+    if (!exec) phit_bench_fatal("topo", "phit_exec_create_topo failed");
+    if (kind == TOPO_SPILL) phit_exec_set_spill(exec, 0.125, -1);
+    else if (kind == TOPO_DEPTH) phit_exec_set_spill(exec, 0, 0);
+    else phit_exec_set_spill(exec, 0, -1);
+    memset(topo_remote, 0, sizeof(topo_remote));
+
+    volatile int go = 0, ready = 0;
+    pthread_t th[TOPO_MAX_PRODUCERS];
+    topo_producer_t pa[TOPO_MAX_PRODUCERS];
+    int share = tasks / producers;
+    for (int p = 0; p < producers; p++) {
+        pa[p].exec = exec;
+        pa[p].kind = kind;
+        pa[p].node = p;
+        pa[p].payload = payload + (size_t)p * (size_t)share;
+        pa[p].count = share;
+        pa[p].go = &go;
+        pa[p].ready = &ready;
+        if (pthread_create(&th[p], NULL, topo_producer, &pa[p]) != 0)
+            phit_bench_fatal("topo", "cannot start a producer");
+    }
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < producers) sched_yield();
+    uint64_t t0 = phit_now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    for (int p = 0; p < producers; p++) pthread_join(th[p], NULL);
+    phit_exec_shutdown(exec);
+    uint64_t t1 = phit_now_ns();
+    phit_exec_destroy(exec);
+
+    uint64_t n = 0;
+    for (int k = 0; k < topo.num_nodes; k++) n += topo_remote[k].n;
+    *remote = (double)n / (share * producers);
+    return share * producers / ((double)(t1 - t0) / 1e9);
+}
+
+void phit_bench_group_topo(phit_bench_t *b) {
+    static char names[TOPO_KINDS][48];
+    int tasks = b->quick ? 20000 : 400000;
+    int reps = b->reps < 5 ? b->reps : 5;
+
+    int workers_per_node = 0;
+    phit_topo_discover(&topo, PHIT_TOPO_NUMA);
+    if (topo.num_nodes < 2) phit_topo_discover(&topo, PHIT_TOPO_CACHE);
+    if (topo.num_nodes < 2) {
+        phit_topo_synthetic(&topo, 2, 2);
+        workers_per_node = 2;
+    }
+    int producers = topo.num_nodes < TOPO_MAX_PRODUCERS ? topo.num_nodes : TOPO_MAX_PRODUCERS;
+    if (workers_per_node == 0) {
+        /* Workers for the other threads' share of each node */
+        int fewest = topo.node_cpus[0];
+        for (int n = 1; n < topo.num_nodes; n++)
+            if (topo.node_cpus[n] < fewest) fewest = topo.node_cpus[n];
+        workers_per_node = fewest > 1 ? fewest - 1 : 1;
+        while (workers_per_node * topo.num_nodes > PHIT_EXEC_MAX_WORKERS) workers_per_node--;
+    }
+    topo_payload_t *payload = calloc((size_t)tasks, sizeof(topo_payload_t));
+    if (!payload) return;
+
+    for (int kind = 0; kind < TOPO_KINDS; kind++) {
+        snprintf(names[kind], sizeof(names[kind]), "%s N=%d", topo_kind_name[kind], topo.num_nodes);
+        if (!phit_bench_selected(b, "topo", names[kind])) continue;
+
+        double rates[PHIT_BENCH_MAX_REPS], remote[PHIT_BENCH_MAX_REPS];
+        for (int r = 0; r < reps; r++)
+            rates[r] = topo_run(kind, producers, workers_per_node, tasks, payload, &remote[r]);
+        phit_bench_result_t res;
+        memset(&res, 0, sizeof(res));
+        res.group = "topo";
+        res.name = names[kind];
+        res.items_per_op = 1;
+        res.item = "task";
+        res.reps = reps;
+        res.rate_median = phit_bench_median(rates, reps);
+        res.rate_min = rates[0];
+        res.rate_max = rates[reps - 1];
+        res.lat_p50_ns = res.lat_p99_ns = res.lat_p999_ns = res.lat_max_ns = -1;
+        snprintf(res.note, sizeof(res.note), "remote %.1f%%, %s nodes x %d workers",
+                 100 * phit_bench_median(remote, reps), phit_topo_kind_name(topo.kind),
+                 workers_per_node);
+        phit_bench_report(b, &res);
+    }
+    free(payload);
+}
@@ -0,0 +1,404 @@
+/*
+ * phit_bench.c — Benchmark harness and driver for libphit
+ *
+ *   phit_bench [--reps N] [--warmup-ms N] [--rep-ms N] [--lat-samples N]
+ *              [--cpu N] [--threads N] [--format text|json|csv]
+ *              [--filter STR] [--list] [--quick]
+ *
+ * Rates are the median over --reps repetitions (min/max alongside);
+ * latencies are percentiles of individually timed operations, net of the
+ * timer read. Multi-threaded groups run 4..--threads threads. JSON and
+ * CSV go to stdout for regression tracking.
+ *
+ * --cpu pins the single-threaded groups (core, baseline, stoch). Groups
+ * that start threads run under the process's original mask, and so do
+ * the harvester threads of the core group's +harvester rows; otherwise
+ * every thread would inherit the one CPU and time-slice on it.
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* sched_setaffinity */
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phit_bench.h"
+
+#if defined(__linux__)
+  #include <sched.h>
+  #include <unistd.h>
+#elif defined(_WIN32)
+  #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+/* ---- Platform ---- */
+
+void phit_bench_fail(phit_bench_t *b, const char *group, const char *name, const char *why) {
+    fprintf(stderr, "phit_bench: %s/%s FAILED: %s\n", group, name, why);
+    b->failures++;
+}
+
+void phit_bench_fatal(const char *group, const char *what) {
+    fprintf(stderr, "phit_bench: %s: %s\n", group, what);
+    exit(1);
+}
+
+#if defined(__linux__)
+static cpu_set_t phit_bench__mask;
+#elif defined(_WIN32)
+static DWORD_PTR phit_bench__mask;
+#endif
+static int phit_bench__saved;
+
+int phit_bench_pin(int cpu) {
+#if defined(__linux__)
+    if (!phit_bench__saved)
+        phit_bench__saved = sched_getaffinity(0, sizeof(phit_bench__mask), &phit_bench__mask) == 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR old = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+    if (old && !phit_bench__saved) {
+        phit_bench__mask = old;
+        phit_bench__saved = 1;
+    }
+    return old != 0;
+#else
+    (void)cpu;          /* macOS only has affinity hints */
+    return 0;
+#endif
+}
+
+void phit_bench_unpin(phit_bench_t *b) {
+    if (b->cpu < 0 || !phit_bench__saved) return;
+#if defined(__linux__)
+    sched_setaffinity(0, sizeof(phit_bench__mask), &phit_bench__mask);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), phit_bench__mask);
+#endif
+}
+
+void phit_bench_repin(phit_bench_t *b) {
+    if (b->cpu >= 0) phit_bench_pin(b->cpu);
+}
+
+int phit_bench_ncpu(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* ---- Statistics ---- */
+
+static int phit_bench__cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double phit_bench__rank(const double *sorted, int n, double q) {
+    int i = (int)(q * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+double phit_bench_median(double *samples, int n) {
+    qsort(samples, (size_t)n, sizeof(double), phit_bench__cmp);
+    return phit_bench__rank(samples, n, 0.5);
+}
+
+void phit_bench_percentiles(double *samples, int n, phit_bench_result_t *r) {
+    qsort(samples, (size_t)n, sizeof(double), phit_bench__cmp);
+    r->lat_p50_ns  = phit_bench__rank(samples, n, 0.50);
+    r->lat_p99_ns  = phit_bench__rank(samples, n, 0.99);
+    r->lat_p999_ns = phit_bench__rank(samples, n, 0.999);
+    r->lat_max_ns  = samples[n - 1];
+}
+
+/* ---- Harness ---- */
+
+int phit_bench_selected(phit_bench_t *b, const char *group, const char *name) {
+    char full[128];
+    snprintf(full, sizeof(full), "%s/%s", group, name);
+    if (b->filter && !strstr(full, b->filter)) return 0;
+    if (b->list) {
+        printf("%s\n", full);
+        return 0;
+    }
+    return 1;
+}
+
+void phit_bench_report(phit_bench_t *b, const phit_bench_result_t *r) {
+    if (b->count >= PHIT_BENCH_MAX_RESULTS) return;
+    b->results[b->count++] = *r;
+    if (strcmp(b->format, "text") == 0) {
+        char unit[16];
+        snprintf(unit, sizeof(unit), "%s/s", r->item);
+        printf("  %-10s %-28s %9.3g %-7s [%9.3g, %9.3g]",
+               r->group, r->name, r->rate_median, unit,
+               r->rate_min, r->rate_max);
+        if (r->lat_p50_ns >= 0) {
+            printf("  %8.1f %8.1f %9.1f ns", r->lat_p50_ns, r->lat_p99_ns,
+                   r->lat_p999_ns);
+        }
+        if (r->note[0]) printf("  %s", r->note);
+        printf("\n");
+        fflush(stdout);
+    }
+}
+
+static double phit_bench__ns(uint64_t t0, uint64_t t1) {
+    return (double)(t1 - t0) * phit_timer_caps()->ns_per_unit;
+}
+
+void phit_bench_run(phit_bench_t *b, const char *group, const char *name,
+                    phit_bench_fn fn, void *ctx, double items_per_op,
+                    const char *item) {
+    if (!phit_bench_selected(b, group, name)) return;
+    volatile uint64_t sink = 0;
+
+    /* Warm-up, doubling the batch until it fills warmup_ms; the last
+     * batch sizes the repetitions */
+    uint64_t iters = 1;
+    double warm_ns = 0, batch_ns = 0;
+    while (warm_ns < b->warmup_ms * 1e6) {
+        uint64_t t0 = phit_now_ticks();
+        sink ^= fn(ctx, iters);
+        uint64_t t1 = phit_now_ticks();
+        batch_ns = phit_bench__ns(t0, t1);
+        warm_ns += batch_ns;
+        if (batch_ns < b->rep_ms * 1e6) iters *= 2;
+    }
+    double op_ns = batch_ns / (double)iters;
+    uint64_t rep_iters = (uint64_t)(b->rep_ms * 1e6 / (op_ns > 0 ? op_ns : 1));
+    if (rep_iters < 1) rep_iters = 1;
+
+    double rates[PHIT_BENCH_MAX_REPS];
+    int reps = b->reps < PHIT_BENCH_MAX_REPS ? b->reps : PHIT_BENCH_MAX_REPS;
+    for (int r = 0; r < reps; r++) {
+        uint64_t t0 = phit_now_ticks();
+        sink ^= fn(ctx, rep_iters);
+        uint64_t t1 = phit_now_ticks();
+        double ns = phit_bench__ns(t0, t1);
+        rates[r] = (double)rep_iters * items_per_op / (ns > 0 ? ns : 1) * 1e9;
+    }
+
+    phit_bench_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.group = group;
+    res.name = name;
+    res.items_per_op = items_per_op;
+    res.item = item;
+    res.reps = reps;
+    res.rate_median = phit_bench_median(rates, reps);
+    res.rate_min = rates[0];
+    res.rate_max = rates[reps - 1];
+
+    /* Latency: single operations, bounded to a few rep_ms of wall time */
+    int n = b->lat_samples;
+    if (op_ns * n > 4 * b->rep_ms * 1e6) n = (int)(4 * b->rep_ms * 1e6 / op_ns);
+    if (n < 100) n = 100;
+    double *lat = malloc(sizeof(double) * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        uint64_t t0 = phit_now_ticks();
+        sink ^= fn(ctx, 1);
+        uint64_t t1 = phit_now_ticks();
+        double ns = phit_bench__ns(t0, t1) - b->timer_cost_ns;
+        lat[i] = ns > 0 ? ns : 0;
+    }
+    phit_bench_percentiles(lat, n, &res);
+    free(lat);
+
+    (void)sink;
+    phit_bench_report(b, &res);
+}
+
+/* ---- Output ---- */
+
+static void phit_bench__header(const phit_bench_t *b) {
+    const phit_timer_caps_t *caps = phit_timer_caps();
+    if (strcmp(b->format, "text") == 0) {
+        printf("phit_bench: timer %s (tick %.2f ns, read %.1f ns), simd %s, "
+               "%d cpus, pinned %d, %d reps x %d ms\n\n",
+               phit_timer_backend_name(), caps->tick_ns, caps->read_ns,
+               phit_simd_name(phit_simd_level()), phit_bench_ncpu(), b->cpu,
+               b->reps, b->rep_ms);
+        printf("  %-10s %-28s %17s %22s  %8s %8s %9s\n", "group", "benchmark",
+               "median", "[min, max]", "p50", "p99", "p99.9");
+    }
+}
+
+static void phit_bench__json_str(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c == '\n') fputs("\\n", stdout);
+        else if (c == '\t') fputs("\\t", stdout);
+        else if (c < 0x20 || c == 0x7f) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+/* RFC 4180 field: always quoted, embedded quotes doubled */
+static void phit_bench__csv_str(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"') putchar('"');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void phit_bench__write(const phit_bench_t *b) {
+    const phit_timer_caps_t *caps = phit_timer_caps();
+    if (strcmp(b->format, "csv") == 0) {
+        printf("group,name,item,items_per_op,reps,rate_median,rate_min,rate_max,"
+               "p50_ns,p99_ns,p999_ns,max_ns,note\n");
+        for (int i = 0; i < b->count; i++) {
+            const phit_bench_result_t *r = &b->results[i];
+            phit_bench__csv_str(r->group);
+            putchar(',');
+            phit_bench__csv_str(r->name);
+            putchar(',');
+            phit_bench__csv_str(r->item);
+            printf(",%g,%d,%.6g,%.6g,%.6g,%.2f,%.2f,%.2f,%.2f,",
+                   r->items_per_op, r->reps, r->rate_median, r->rate_min, r->rate_max,
+                   r->lat_p50_ns, r->lat_p99_ns, r->lat_p999_ns, r->lat_max_ns);
+            phit_bench__csv_str(r->note);
+            putchar('\n');
+        }
+    } else if (strcmp(b->format, "json") == 0) {
+        printf("{\n  \"machine\": {\"timer\": \"%s\", \"tick_ns\": %.3f, "
+               "\"read_ns\": %.2f, \"simd\": \"%s\", \"cpus\": %d, \"pinned_cpu\": %d},\n",
+               phit_timer_backend_name(), caps->tick_ns, caps->read_ns,
+               phit_simd_name(phit_simd_level()), phit_bench_ncpu(), b->cpu);
+        printf("  \"config\": {\"reps\": %d, \"warmup_ms\": %d, \"rep_ms\": %d, "
+               "\"lat_samples\": %d, \"threads_max\": %d, \"timer_cost_ns\": %.2f},\n",
+               b->reps, b->warmup_ms, b->rep_ms, b->lat_samples, b->threads_max,
+               b->timer_cost_ns);
+        printf("  \"results\": [\n");
+        for (int i = 0; i < b->count; i++) {
+            const phit_bench_result_t *r = &b->results[i];
+            printf("    {\"group\": ");
+            phit_bench__json_str(r->group);
+            printf(", \"name\": ");
+            phit_bench__json_str(r->name);
+            printf(", \"item\": ");
+            phit_bench__json_str(r->item);
+            printf(", \"items_per_op\": %g, \"reps\": %d,\n"
+                   "     \"rate\": {\"median\": %.6g, \"min\": %.6g, \"max\": %.6g}",
+                   r->items_per_op, r->reps,
+                   r->rate_median, r->rate_min, r->rate_max);
+            if (r->lat_p50_ns >= 0) {
+                printf(",\n     \"latency_ns\": {\"p50\": %.2f, \"p99\": %.2f, "
+                       "\"p999\": %.2f, \"max\": %.2f}",
+                       r->lat_p50_ns, r->lat_p99_ns, r->lat_p999_ns, r->lat_max_ns);
+            }
+            if (r->note[0]) {
+                printf(", \"note\": ");
+                phit_bench__json_str(r->note);
+            }
+            printf("}%s\n", i + 1 < b->count ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+}
+
+/* ---- Driver ---- */
+
+static void phit_bench__usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--reps N] [--warmup-ms N] [--rep-ms N] [--lat-samples N]\n"
+            "          [--cpu N] [--threads N] [--format text|json|csv]\n"
+            "          [--filter STR] [--list] [--quick]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    static phit_bench_t b;
+    b.reps = 11;
+    b.warmup_ms = 50;
+    b.rep_ms = 20;
+    b.lat_samples = 100000;
+    b.cpu = -1;
+    b.threads_max = 0;
+    b.format = "text";
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if      (!strcmp(a, "--reps") && v)        { b.reps = atoi(v); i++; }
+        else if (!strcmp(a, "--warmup-ms") && v)   { b.warmup_ms = atoi(v); i++; }
+        else if (!strcmp(a, "--rep-ms") && v)      { b.rep_ms = atoi(v); i++; }
+        else if (!strcmp(a, "--lat-samples") && v) { b.lat_samples = atoi(v); i++; }
+        else if (!strcmp(a, "--cpu") && v)         { b.cpu = atoi(v); i++; }
+        else if (!strcmp(a, "--threads") && v)     { b.threads_max = atoi(v); i++; }
+        else if (!strcmp(a, "--format") && v)      { b.format = v; i++; }
+        else if (!strcmp(a, "--filter") && v)      { b.filter = v; i++; }
+        else if (!strcmp(a, "--list"))            { b.list = 1; }
+        else if (!strcmp(a, "--quick"))           { b.quick = 1; }
+        else { phit_bench__usage(argv[0]); return 2; }
+    }
+    if (strcmp(b.format, "text") && strcmp(b.format, "json") && strcmp(b.format, "csv")) {
+        phit_bench__usage(argv[0]);
+        return 2;
+    }
+    if (b.quick) {
+        b.reps = 3;
+        b.warmup_ms = 5;
+        b.rep_ms = 2;
+        b.lat_samples = 2000;
+    }
+    if (b.reps < 1) b.reps = 1;
+    if (b.rep_ms < 1) b.rep_ms = 1;
+    if (b.lat_samples < 100) b.lat_samples = 100;
+    if (b.threads_max <= 0) b.threads_max = b.quick ? 4 : 64;
+
+    if (b.cpu >= 0 && !phit_bench_pin(b.cpu)) {
+        fprintf(stderr, "phit_bench: cannot pin to cpu %d, running unpinned\n", b.cpu);
+        b.cpu = -1;
+    }
+
+    /* Timer cost to subtract from single-op latencies */
+    {
+        enum { N = 4096 };
+        static double d[N];
+        for (int i = 0; i < N; i++) {
+            uint64_t t0 = phit_now_ticks();
+            uint64_t t1 = phit_now_ticks();
+            d[i] = phit_bench__ns(t0, t1);
+        }
+        b.timer_cost_ns = phit_bench_median(d, N);
+    }
+
+    if (!b.list) phit_bench__header(&b);
+    phit_bench_group_core(&b);
+    phit_bench_group_baseline(&b);
+    phit_bench_group_stoch(&b);
+    /* The rest start threads: off --cpu, which they would all inherit */
+    phit_bench_unpin(&b);
+    phit_bench_group_exec(&b);
+    phit_bench_group_steal(&b);
+    phit_bench_group_shared(&b);
+    phit_bench_group_scaling(&b);
+    phit_bench_group_topo(&b);
+    phit_bench_group_domains(&b);
+    if (!b.list) phit_bench__write(&b);
+    return b.failures ? 1 : 0;
+}
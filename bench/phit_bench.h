@@ -0,0 +1,107 @@
+/*
+ * phit_bench.h — Benchmark harness shared by the phit_bench groups
+ *
+ * Every benchmark is a function that performs `iters` operations and
+ * returns a checksum (so the work cannot be discarded). The harness
+ * warms it up, sizes one repetition to --rep-ms, times --reps
+ * repetitions and reports the median/min/max rate, then times
+ * --lat-samples single operations for p50/p99/p999 latency with the
+ * timer's own cost subtracted.
+ *
+ * Groups that measure something the single-op model cannot express
+ * (multi-threaded runs, makespans) fill a phit_bench_result_t
+ * themselves and hand it to phit_bench_report().
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#ifndef PHIT_BENCH_H
+#define PHIT_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "libphit.h"
+
+#define PHIT_BENCH_MAX_RESULTS 256
+#define PHIT_BENCH_MAX_REPS    101
+
+typedef uint64_t (*phit_bench_fn)(void *ctx, uint64_t iters);
+
+typedef struct {
+    const char *group;
+    const char *name;
+    double      items_per_op;   /* values/bytes per operation, for the rate */
+    const char *item;           /* "op", "B", "task", ... */
+    int         reps;
+    double      rate_median;    /* items per second */
+    double      rate_min;
+    double      rate_max;
+    double      lat_p50_ns;     /* per operation; < 0 = not measured */
+    double      lat_p99_ns;
+    double      lat_p999_ns;
+    double      lat_max_ns;
+    char        note[64];       /* free-form extra column */
+} phit_bench_result_t;
+
+typedef struct {
+    int      reps;
+    int      warmup_ms;
+    int      rep_ms;
+    int      lat_samples;
+    int      cpu;               /* --cpu for single-threaded groups, -1 = none */
+    int      threads_max;       /* upper bound for multi-threaded groups */
+    int      quick;
+    const char *format;         /* "text", "json" or "csv" */
+    const char *filter;         /* substring of "group/name", NULL = all */
+    int      list;              /* print names instead of running */
+    double   timer_cost_ns;     /* back-to-back phit_now_ticks() */
+    int      failures;          /* phit_bench_fail calls; exit status 1 if any */
+    int      count;
+    phit_bench_result_t results[PHIT_BENCH_MAX_RESULTS];
+} phit_bench_t;
+
+/* Run and record one single-threaded benchmark */
+void phit_bench_run(phit_bench_t *b, const char *group, const char *name,
+                    phit_bench_fn fn, void *ctx, double items_per_op,
+                    const char *item);
+
+/* Record a result measured by the caller (rate fields filled in) */
+void phit_bench_report(phit_bench_t *b, const phit_bench_result_t *r);
+
+/* Whether "group/name" passes --filter (and is not just being listed) */
+int  phit_bench_selected(phit_bench_t *b, const char *group, const char *name);
+
+/* Percentiles of n samples, sorted in place */
+void phit_bench_percentiles(double *samples, int n, phit_bench_result_t *r);
+double phit_bench_median(double *samples, int n);
+
+/* Record a benchmark whose own check failed (lost tasks, ...): printed to
+ * stderr now, phit_bench exits 1 after the remaining groups have run */
+void phit_bench_fail(phit_bench_t *b, const char *group, const char *name, const char *why);
+
+/* Report a driver that cannot run (a thread would not start) and exit 1 */
+void phit_bench_fatal(const char *group, const char *what);
+
+/* Pin the calling thread to a CPU; 0 if the platform cannot. The first
+ * call saves the mask it replaces for phit_bench_unpin. */
+int  phit_bench_pin(int cpu);
+/* --cpu is for single-threaded measurements: threads inherit their
+ * creator's mask, so start them between unpin (restores the saved mask)
+ * and repin (back onto b->cpu). Both do nothing without --cpu. */
+void phit_bench_unpin(phit_bench_t *b);
+void phit_bench_repin(phit_bench_t *b);
+int  phit_bench_ncpu(void);
+
+/* Groups */
+void phit_bench_group_core(phit_bench_t *b);
+void phit_bench_group_baseline(phit_bench_t *b);
+void phit_bench_group_exec(phit_bench_t *b);
+void phit_bench_group_steal(phit_bench_t *b);
+void phit_bench_group_shared(phit_bench_t *b);
+void phit_bench_group_scaling(phit_bench_t *b);
+void phit_bench_group_stoch(phit_bench_t *b);
+void phit_bench_group_topo(phit_bench_t *b);
+void phit_bench_group_domains(phit_bench_t *b);
+
+#endif /* PHIT_BENCH_H */
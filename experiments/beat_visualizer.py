@@ -14,7 +14,8 @@ import os
 import math
 
 sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
-from triphase_sim import simple_system, m1_max_system
+from triphase_sim import simple_system, m1_max_system, load_sweep, sweep_select, \
+    sweep_phase_levels
 
 
 def visualize_beat(f_alpha: float = 5.0, f_beta: float = 3.0,
@@ -131,11 +132,47 @@ def visualize_information_density():
     print(f"    Max extra bits ≈ {math.log2(3228/24):.1f}")
 
 
+def visualize_sweep(path: str, timer: str = "counter", load: int = 0):
+    """
+    Risultati misurati di phit_sweep: phits per lettura per workload e
+    numero di letture, una barra per configurazione (slot = il minore).
+    """
+    rows = load_sweep(path)
+    if not rows:
+        print(f"  {path}: no rows")
+        return
+    rows = sweep_select(rows, timer=timer, load=load)
+    if not rows:
+        print(f"  {path}: nothing for timer={timer} load={load}")
+        return
+    slots = min(r["slots"] for r in rows)
+    rows = [r for r in rows if r["slots"] == slots]
+
+    print(f"\n  === Sweep: {rows[0]['host']} ({rows[0]['arch']}), timer {timer}, "
+          f"load {load}, {slots} slots ===\n")
+    print(f"  {'Workload':>12} | {'Reads':>5} | {'H/read':>6} | {'H_min':>5} | "
+          f"{'Phases':>6} | {'ns':>7} | {'Uniform':>7}")
+    print(f"  {'-'*12}-+-{'-'*5}-+-{'-'*6}-+-{'-'*5}-+-{'-'*6}-+-{'-'*7}-+-{'-'*7}")
+    for r in rows:
+        name = f"{r['workload']}-{r['iters']}"
+        bar = '#' * int(round(r["phits_per_read"] * 4))
+        print(f"  {name:>12} | {r['reads']:5d} | {r['phits_per_read']:6.2f} | "
+              f"{r['min_entropy']:5.2f} | {sweep_phase_levels(r):6.1f} | "
+              f"{r['ns_per_sample']:7.1f} | {'yes' if r['uniform'] else 'NO':>7} {bar}")
+
+
 if __name__ == "__main__":
     print("╔══════════════════════════════════════════════════════════╗")
     print("║  TRIPHASE: Beat Pattern Visualizer                      ║")
     print("╚══════════════════════════════════════════════════════════╝")
 
+    # Measured data: python3 beat_visualizer.py sweep-HOST.csv [timer] [load]
+    if len(sys.argv) > 1:
+        timer = sys.argv[2] if len(sys.argv) > 2 else "counter"
+        load = int(sys.argv[3]) if len(sys.argv) > 3 else 0
+        visualize_sweep(sys.argv[1], timer, load)
+        sys.exit(0)
+
     # Simple case: 5:3 ratio
     visualize_beat(5.0, 3.0, duration=1.0, resolution=40)
 
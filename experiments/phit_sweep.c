@@ -0,0 +1,483 @@
+/*
+ * phit_sweep — Parameter sweep over the phase-extraction experiments
+ * ==================================================================
+ *
+ * One run per machine instead of phase_extract.c, phase_extract_v2.c,
+ * phi_adaptive.c, phi_exploit.c and phi_uniform.c by hand. Every
+ * configuration of the grid
+ *
+ *   workload x reads per sample x timer x slot count x load threads
+ *
+ * is measured the way those experiments did it: raw workload-plus-read
+ * deltas quantized to the timer tick (Shannon and min-entropy per read,
+ * distinct levels), phit_sample_compound-style keys over `reads` reads,
+ * and the keys reduced to `slots` slots (chi-squared against the
+ * Wilson-Hilferty 1% critical value, lag-1 autocorrelation). Background
+ * load threads (ROADMAP item 7) spin the MIX workload next to the
+ * sampler.
+ *
+ *   phit_sweep [-o FILE] [-n SAMPLES] [-j JOBS] [-w NOP:8,LCG:10,...]
+ *              [-r 1,2,4] [-t counter,ns] [-s 2,8,64] [-l 0,1] [-q]
+ *
+ * Configurations are independent, so JOBS of them run at once. Each job
+ * owns a group of 1 + max(load) CPUs: the sampler pinned to the first,
+ * its load threads to the rest. JOBS defaults to as many groups as the
+ * online CPUs hold; when they do not fit the groups overlap and the
+ * `isolated` column says 0. Affinity is Linux-only; elsewhere threads
+ * run where the scheduler puts them.
+ *
+ * Timers: "counter" is phit_now_ticks() (CNTVCT_EL0, RDTSC, rdtime),
+ * "ns" the portable phit_now_ns() clock, with its tick and dead low bits
+ * probed here the way phit_timer_probe does for the counter.
+ *
+ * Output is one CSV per host, one row per configuration in grid order
+ * (default sweep-HOST.csv, "-" for stdout); triphase_sim.load_sweep()
+ * reads it and beat_visualizer.py plots it.
+ *
+ * Compile: cmake -S . -B build && cmake --build build --target phit_sweep
+ *          or cc -O2 -o phit_sweep phit_sweep.c -lm -lpthread
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* sched_setaffinity */
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define LIBPHIT_IMPLEMENTATION
+#include "../src/libphit.h"
+#include "../src/phit_topo.h"
+
+#define SWEEP_MAX_AXIS   16
+#define SWEEP_LEVELS     256
+#define SWEEP_MAX_SLOTS  4096
+#define SWEEP_MAX_LOAD   64
+#define SWEEP_WARMUP_NS  2000000ULL     /* load threads running before sampling */
+
+enum { SWEEP_COUNTER, SWEEP_NS, SWEEP_TIMERS };
+
+static const char *sweep_timer_name[SWEEP_TIMERS] = { "counter", "ns" };
+
+/* A timer as the samplers see it: units, quantum, dead low bits */
+typedef struct {
+    double   tick_ns;
+    uint64_t tick_mul;          /* 2^32 / tick, as phit__quantize */
+    int      lsb_shift;
+} sweep_timer_t;
+
+typedef struct {
+    int kind, iters, reads, timer, slots, load;
+} sweep_config_t;
+
+typedef struct {
+    double ns_per_sample;
+    double phits_per_read;      /* Shannon entropy of the quantized deltas */
+    double min_entropy;         /* -log2 of the most frequent delta's share */
+    double delta_mean;          /* ticks */
+    double chi2, chi2_crit;
+    double autocorr;            /* slot index, lag 1 */
+    int    levels;
+    int    cpu;                 /* sampler's CPU, -1 unpinned */
+    int    isolated;
+} sweep_result_t;
+
+static sweep_timer_t   timers[SWEEP_TIMERS];
+static sweep_config_t *configs;
+static sweep_result_t *results;
+static int             num_configs, samples = 100000, group_size, num_groups, verbose = 1;
+static int             cpus[PHIT_TOPO_MAX_CPUS], num_cpus;
+static uint64_t        next_config;
+
+/* ---- Timers ---- */
+
+static inline uint64_t sweep_read(int timer) {
+    return timer == SWEEP_NS ? phit_now_ns() : phit_now_ticks();
+}
+
+/* phit_timer_probe's tick and dead-bit estimate, for phit_now_ns() */
+static void sweep_probe_ns(sweep_timer_t *t) {
+    uint64_t prev = phit_now_ns(), bits = prev, first = 0, last = 0;
+    int reads = 0, repeats = 0, changes = 0;
+    for (int i = 0; i < PHIT_TIMER_PROBE_SAMPLES; i++) {
+        uint64_t now = phit_now_ns();
+        reads++;
+        bits |= now;
+        if (now == prev) {
+            repeats++;
+        } else {
+            if (changes++ == 0) first = now;
+            last = now;
+            prev = now;
+        }
+    }
+    /* Repeats: the clock is coarser than a read and the edge spacing is
+     * its tick; otherwise every ns of a delta counts */
+    double tick = repeats * 4 > reads && changes > 1 ? (double)(last - first) / (changes - 1) : 1.0;
+    t->lsb_shift = 0;
+    while (t->lsb_shift < 16 && !(bits & (1ULL << t->lsb_shift))) t->lsb_shift++;
+    if (tick < (double)(1u << t->lsb_shift)) tick = (double)(1u << t->lsb_shift);
+    t->tick_ns = tick;
+    t->tick_mul = (uint64_t)(4294967296.0 / tick);
+}
+
+static void sweep_probe(void) {
+    const phit_timer_caps_t *caps = phit_timer_caps();
+    timers[SWEEP_COUNTER].tick_ns = caps->tick_ns;
+    timers[SWEEP_COUNTER].tick_mul = caps->tick_mul;
+    timers[SWEEP_COUNTER].lsb_shift = caps->lsb_shift;
+    sweep_probe_ns(&timers[SWEEP_NS]);
+}
+
+static inline int sweep_level(const sweep_timer_t *t, uint64_t delta) {
+    if (delta > (1ULL << 30)) return SWEEP_LEVELS - 1;
+    uint64_t q = (delta * t->tick_mul + (1ULL << 31)) >> 32;
+    return q < SWEEP_LEVELS ? (int)q : SWEEP_LEVELS - 1;
+}
+
+/* ---- Workloads: the sampler kernels' bodies with a runtime trip count ---- */
+
+static inline void sweep_workload(int kind, int iters, volatile uint64_t *xp) {
+    volatile uint64_t x = *xp;
+    switch (kind) {
+    case PHIT_WL_NOP:    PHIT__WL_NOP(x, iters); break;
+    case PHIT_WL_LCG:    PHIT__WL_LCG(x, iters); break;
+    case PHIT_WL_MIX:    PHIT__WL_MIX(x, iters); break;
+    case PHIT_WL_MEM:    PHIT__WL_MEM(x, iters); break;
+    default:             PHIT__WL_BRANCH(x, iters); break;
+    }
+    *xp = x;
+    phit__sink = x;
+}
+
+/* ---- Placement ---- */
+
+static int sweep_pin(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0) return 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+/* k-th CPU of job group g; groups wrap when they outnumber the CPUs */
+static int sweep_group_cpu(int g, int k) {
+    return num_cpus ? cpus[(g * group_size + k) % num_cpus] : -1;
+}
+
+typedef struct {
+    int cpu;
+    int stop;
+    pthread_t thread;
+} sweep_load_t;
+
+static void *sweep_load_main(void *p) {
+    sweep_load_t *l = p;
+    sweep_pin(l->cpu);
+    volatile uint64_t x = 0xCAFEBABE ^ (uint64_t)l->cpu;
+    while (!PHIT__LOAD_INT(&l->stop)) PHIT__WL_MIX(x, 64);
+    phit__sink = x;
+    return NULL;
+}
+
+/* ---- One configuration ---- */
+
+static void sweep_measure(const sweep_config_t *c, int group, uint32_t *counts,
+                          sweep_result_t *r) {
+    const sweep_timer_t *tm = &timers[c->timer];
+    uint64_t hist[SWEEP_LEVELS] = { 0 };
+    memset(counts, 0, sizeof(uint32_t) * (size_t)c->slots);
+    memset(r, 0, sizeof(*r));
+    r->cpu = sweep_pin(sweep_group_cpu(group, 0)) ? sweep_group_cpu(group, 0) : -1;
+    r->isolated = r->cpu >= 0 && num_groups * group_size <= num_cpus;
+
+    sweep_load_t load[SWEEP_MAX_LOAD];
+    int started = 0;
+    for (; started < c->load; started++) {
+        load[started].cpu = sweep_group_cpu(group, 1 + started);
+        load[started].stop = 0;
+        if (pthread_create(&load[started].thread, NULL, sweep_load_main, &load[started]) != 0)
+            break;
+    }
+    uint64_t warm = phit_now_ns();
+    while (phit_now_ns() - warm < SWEEP_WARMUP_NS) sched_yield();
+
+    double sx = 0, sxx = 0, sxy = 0;
+    uint64_t sum = 0;
+    uint32_t last = 0;
+    uint64_t prev = sweep_read(c->timer);
+    uint64_t t0 = phit_now_ns();
+    for (int s = 0; s < samples; s++) {
+        uint32_t key = 0;
+        for (int i = 0; i < c->reads; i++) {
+            volatile uint64_t x = 0xDEADBEEF ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL);
+            sweep_workload(c->kind, c->iters, &x);
+            uint64_t now = sweep_read(c->timer);
+            int q = sweep_level(tm, now - prev);
+            hist[q]++;
+            sum += (uint64_t)q;
+            prev = now;
+            uint64_t t = now >> tm->lsb_shift;
+            uint32_t sample = (uint32_t)((t & 0x3) | (((uint32_t)(t >> 2) ^ (uint32_t)x) << 2));
+            key ^= phit_hash32(sample + (uint32_t)i);
+            key = (key << 7) | (key >> 25);
+        }
+        uint32_t slot = (uint32_t)(((uint64_t)phit_hash32(key) * (uint64_t)c->slots) >> 32);
+        counts[slot]++;
+        sx += slot;
+        sxx += (double)slot * slot;
+        if (s) sxy += (double)slot * last;
+        last = slot;
+    }
+    r->ns_per_sample = (double)(phit_now_ns() - t0) / samples;
+
+    for (int i = 0; i < started; i++) PHIT__STORE_INT(&load[i].stop, 1);
+    for (int i = 0; i < started; i++) pthread_join(load[i].thread, NULL);
+
+    uint64_t reads = (uint64_t)samples * (uint64_t)c->reads, top = 0;
+    for (int l = 0; l < SWEEP_LEVELS; l++) {
+        if (!hist[l]) continue;
+        double p = (double)hist[l] / (double)reads;
+        r->phits_per_read -= p * log2(p);
+        r->levels++;
+        if (hist[l] > top) top = hist[l];
+    }
+    r->min_entropy = -log2((double)top / (double)reads);
+    r->delta_mean = (double)sum / (double)reads;
+
+    double e = (double)samples / c->slots;
+    for (int k = 0; k < c->slots; k++) r->chi2 += (counts[k] - e) * (counts[k] - e) / e;
+    /* Wilson-Hilferty, z = 2.326 (ROADMAP item 4) */
+    double df = c->slots - 1, v = 2.0 / (9.0 * df);
+    r->chi2_crit = df * pow(1.0 - v + 2.326 * sqrt(v), 3);
+
+    double n = samples, mean = sx / n, var = sxx / n - mean * mean;
+    r->autocorr = var > 0 ? (sxy / (n - 1) - mean * mean) / var : 0;
+}
+
+static void *sweep_job_main(void *p) {
+    int group = (int)(intptr_t)p;
+    uint32_t *counts = malloc(sizeof(uint32_t) * SWEEP_MAX_SLOTS);
+    if (!counts) return NULL;
+    for (;;) {
+        uint64_t i = PHIT__FETCH_ADD64(&next_config, 1);
+        if (i >= (uint64_t)num_configs) break;
+        const sweep_config_t *c = &configs[i];
+        sweep_measure(c, group, counts, &results[i]);
+        if (verbose) {
+            fprintf(stderr, "[%3d/%d] %-6s %3d x%d %-7s slots=%-4d load=%d  %.2f phits/read\n",
+                    (int)i + 1, num_configs, phit_workload_name(c->kind), c->iters, c->reads,
+                    sweep_timer_name[c->timer], c->slots, c->load, results[i].phits_per_read);
+        }
+    }
+    free(counts);
+    return NULL;
+}
+
+/* ---- Output ---- */
+
+static const char *sweep_arch(void) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return "aarch64";
+#elif defined(__x86_64__) || defined(_M_X64)
+    return "x86_64";
+#elif defined(__riscv)
+    return "riscv64";
+#else
+    return "unknown";
+#endif
+}
+
+static int sweep_write(FILE *f, const char *host) {
+    fprintf(f, "host,arch,timer,tick_ns,workload,iters,reads,slots,load,cpu,isolated,samples,"
+               "ns_per_sample,phits_per_read,min_entropy,levels,delta_mean,phits_per_sample,"
+               "phits_per_us,chi2,chi2_crit,uniform,autocorr1\n");
+    for (int i = 0; i < num_configs; i++) {
+        const sweep_config_t *c = &configs[i];
+        const sweep_result_t *r = &results[i];
+        double per_sample = r->phits_per_read * c->reads;
+        fprintf(f, "%s,%s,%s,%.3f,%s,%d,%d,%d,%d,%d,%d,%d,%.2f,%.4f,%.4f,%d,%.3f,%.4f,%.3f,"
+                   "%.2f,%.2f,%d,%.5f\n",
+                host, sweep_arch(), sweep_timer_name[c->timer], timers[c->timer].tick_ns,
+                phit_workload_name(c->kind), c->iters, c->reads, c->slots, c->load, r->cpu,
+                r->isolated, samples, r->ns_per_sample, r->phits_per_read, r->min_entropy,
+                r->levels, r->delta_mean, per_sample, per_sample / r->ns_per_sample * 1e3,
+                r->chi2, r->chi2_crit, r->chi2 < r->chi2_crit, r->autocorr);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+/* ---- Command line ---- */
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-o FILE] [-n SAMPLES] [-j JOBS] [-w KIND:ITERS,...]\n"
+                    "       %*s [-r READS,...] [-t counter,ns] [-s SLOTS,...] [-l LOAD,...] [-q]\n",
+            argv0, (int)strlen(argv0), "");
+    exit(2);
+}
+
+/* "1,2,4" -> {1, 2, 4}; count or -1 */
+static int parse_ints(const char *s, int *out, int lo, int hi) {
+    int n = 0;
+    while (*s && n < SWEEP_MAX_AXIS) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s || v < lo || v > hi) return -1;
+        out[n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return *s ? -1 : n;
+}
+
+/* "LCG:10,MEM:16" -> kinds and iteration counts */
+static int parse_workloads(const char *s, int *kinds, int *iters) {
+    int n = 0;
+    while (*s && n < SWEEP_MAX_AXIS) {
+        const char *colon = strchr(s, ':');
+        if (!colon) return -1;
+        int kind = -1;
+        for (int k = 0; k < PHIT_WL_KINDS; k++) {
+            const char *name = phit_workload_name(k);
+            size_t len = strlen(name);
+            if ((size_t)(colon - s) == len && !strncasecmp(s, name, len)) kind = k;
+        }
+        char *end;
+        long v = strtol(colon + 1, &end, 10);
+        if (kind < 0 || end == colon + 1 || v < 1 || v > 100000) return -1;
+        kinds[n] = kind;
+        iters[n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return *s ? -1 : n;
+}
+
+static int parse_timers(const char *s, int *out) {
+    int n = 0;
+    while (*s && n < SWEEP_MAX_AXIS) {
+        size_t len = strcspn(s, ",");
+        int t = -1;
+        for (int k = 0; k < SWEEP_TIMERS; k++)
+            if (len == strlen(sweep_timer_name[k]) && !strncmp(s, sweep_timer_name[k], len)) t = k;
+        if (t < 0) return -1;
+        out[n++] = t;
+        s += len;
+        if (*s == ',') s++;
+    }
+    return *s ? -1 : n;
+}
+
+int main(int argc, char **argv) {
+    const char *out = NULL;
+    const char *wl = "NOP:8,LCG:10,MIX:20,MEM:16,BRANCH:32";
+    const char *rd = "1,2,4", *tm = "counter,ns", *sl = "2,8,64", *ld = "0,1";
+    int jobs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) {
+            verbose = 0;
+            continue;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        if (!strcmp(argv[i], "-o")) out = argv[++i];
+        else if (!strcmp(argv[i], "-n")) samples = (int)strtod(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-j")) jobs = (int)strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-w")) wl = argv[++i];
+        else if (!strcmp(argv[i], "-r")) rd = argv[++i];
+        else if (!strcmp(argv[i], "-t")) tm = argv[++i];
+        else if (!strcmp(argv[i], "-s")) sl = argv[++i];
+        else if (!strcmp(argv[i], "-l")) ld = argv[++i];
+        else usage(argv[0]);
+    }
+
+    int kinds[SWEEP_MAX_AXIS], iters[SWEEP_MAX_AXIS], reads[SWEEP_MAX_AXIS];
+    int tims[SWEEP_MAX_AXIS], slots[SWEEP_MAX_AXIS], loads[SWEEP_MAX_AXIS];
+    int nw = parse_workloads(wl, kinds, iters), nr = parse_ints(rd, reads, 1, 16);
+    int nt = parse_timers(tm, tims), ns = parse_ints(sl, slots, 2, SWEEP_MAX_SLOTS);
+    int nl = parse_ints(ld, loads, 0, SWEEP_MAX_LOAD);
+    if (nw < 1 || nr < 1 || nt < 1 || ns < 1 || nl < 1 || samples < 2 || jobs < 0) usage(argv[0]);
+
+    /* Grid in row order: workload, reads, timer, slots, load */
+    num_configs = nw * nr * nt * ns * nl;
+    configs = calloc((size_t)num_configs, sizeof(sweep_config_t));
+    results = calloc((size_t)num_configs, sizeof(sweep_result_t));
+    if (!configs || !results) return 1;
+    int n = 0, max_load = 0;
+    for (int a = 0; a < nw; a++)
+        for (int b = 0; b < nr; b++)
+            for (int c = 0; c < nt; c++)
+                for (int d = 0; d < ns; d++)
+                    for (int e = 0; e < nl; e++) {
+                        sweep_config_t *cf = &configs[n++];
+                        cf->kind = kinds[a];
+                        cf->iters = iters[a];
+                        cf->reads = reads[b];
+                        cf->timer = tims[c];
+                        cf->slots = slots[d];
+                        cf->load = loads[e];
+                        if (loads[e] > max_load) max_load = loads[e];
+                    }
+
+    /* CPU groups, node by node so a group stays on one node where it can */
+    static phit_topo_t topo;
+    phit_topo_discover(&topo, PHIT_TOPO_NUMA);
+    for (int nd = 0; nd < topo.num_nodes; nd++)
+        for (int k = 0; phit_topo_node_cpu(&topo, nd, k) >= 0 && num_cpus < PHIT_TOPO_MAX_CPUS; k++)
+            cpus[num_cpus++] = phit_topo_node_cpu(&topo, nd, k);
+    group_size = 1 + max_load;
+    num_groups = jobs ? jobs : (num_cpus / group_size > 0 ? num_cpus / group_size : 1);
+    if (num_groups > num_configs) num_groups = num_configs;
+
+    sweep_probe();
+    phit__wl_table_fill();
+
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    for (char *h = host; *h; h++)
+        if (*h == ',' || *h == '/' || *h == ' ') *h = '_';
+    char path[300];
+    if (!out) {
+        snprintf(path, sizeof(path), "sweep-%s.csv", host);
+        out = path;
+    }
+    if (verbose) {
+        fprintf(stderr, "phit_sweep: %s, %d configs x %d samples, %d job(s) of %d CPU(s) on %d online\n",
+                host, num_configs, samples, num_groups, group_size, num_cpus);
+    }
+
+    pthread_t th[PHIT_TOPO_MAX_CPUS];
+    if (num_groups > PHIT_TOPO_MAX_CPUS) num_groups = PHIT_TOPO_MAX_CPUS;
+    /* Jobs pull configs from one counter: fewer threads only take longer */
+    int started = 0;
+    while (started < num_groups &&
+           pthread_create(&th[started], NULL, sweep_job_main, (void *)(intptr_t)started) == 0)
+        started++;
+    if (started == 0) sweep_job_main((void *)(intptr_t)0);
+    for (int g = 0; g < started; g++) pthread_join(th[g], NULL);
+
+    FILE *f = strcmp(out, "-") ? fopen(out, "w") : stdout;
+    if (!f) {
+        perror(out);
+        return 1;
+    }
+    int err = sweep_write(f, host);
+    if (f != stdout) err |= fclose(f);
+    if (verbose && !err && f != stdout) fprintf(stderr, "phit_sweep: wrote %s\n", out);
+    free(configs);
+    free(results);
+    return err ? 1 : 0;
+}
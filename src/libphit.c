@@ -0,0 +1,27 @@
+/*
+ * libphit.c — Compiled form of libphit.h
+ *
+ * Instantiates the header implementations (libphit.h and its companions
+ * phit_exec.h, phit_topo.h, phit_domains.h, phit_battery.h, phit_calib.h
+ * and phit_stoch.h) for the static and shared libphit targets.
+ *
+ * The build defines PHIT_SIMD_EXTERNAL when it also compiles the per-ISA
+ * kernel units in src/simd/; without it this file is self-contained:
+ *
+ *   cc -O2 -c libphit.c
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* sched_getcpu, sched_setaffinity: shared pool slots, phit_topo.h */
+#endif
+
+#define LIBPHIT_IMPLEMENTATION
+#include "libphit.h"
+#include "phit_exec.h"
+#include "phit_topo.h"
+#include "phit_domains.h"
+#include "phit_battery.h"
+#include "phit_calib.h"
+#include "phit_stoch.h"
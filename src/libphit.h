@@ -11,6 +11,9 @@
  *
  * Define LIBPHIT_IMPLEMENTATION in exactly ONE .c file before including.
  * All other files can include without the define for declarations only.
+ * Link with -lpthread on POSIX (the opt-in background harvester).
+ * The CMake build compiles the implementation once as libphit (static and
+ * shared, see src/libphit.c) with the SIMD kernels in per-ISA units.
  *
  * Platforms: macOS (ARM64/x86), Windows (x64/x86), Linux (ARM64/x86), FreeBSD
  *
@@ -46,23 +49,417 @@ extern "C" {
 #define PHIT_PRNG_SEED_ROUNDS 16
 #endif
 
+/* Batch sampling: LCG steps of spacing workload between timer reads */
+#ifndef PHIT_BATCH_SPACER_ITERS
+#define PHIT_BATCH_SPACER_ITERS 4
+#endif
+
+/* Batch sampling: timestamps collected per pipeline stage */
+#ifndef PHIT_BATCH_CHUNK
+#define PHIT_BATCH_CHUNK 512
+#endif
+
+/* CDF router: delta values covered by the slot map */
+#ifndef PHIT_ROUTER_MAX_DELTA
+#define PHIT_ROUTER_MAX_DELTA 2048
+#endif
+
+/* CDF router: default calibration sample count */
+#ifndef PHIT_ROUTER_CALIB_SAMPLES
+#define PHIT_ROUTER_CALIB_SAMPLES 500000
+#endif
+
+/* CDF router: routes between drift-tracking rebuilds (0 = calibrate once) */
+#ifndef PHIT_ROUTER_TRACK_WINDOW
+#define PHIT_ROUTER_TRACK_WINDOW 8192
+#endif
+
+/* Padding unit for per-thread and per-destination counters */
+#ifndef PHIT_CACHE_LINE
+#define PHIT_CACHE_LINE 64
+#endif
+
+/* Sampling clock for phit_now_ticks():
+ *   PHIT_TIMER_COUNTER  hardware counter (CNTVCT_EL0, RDTSC, rdtime) where
+ *                       the architecture has one, else phit_now_ns()
+ *   PHIT_TIMER_NS       always the portable phit_now_ns() */
+#define PHIT_TIMER_NS      0
+#define PHIT_TIMER_COUNTER 1
+
+#ifndef PHIT_TIMER_BACKEND
+#define PHIT_TIMER_BACKEND PHIT_TIMER_COUNTER
+#endif
+
+/* Timer probe: wall-time and sample bounds for phit_timer_probe() */
+#ifndef PHIT_TIMER_PROBE_NS
+#define PHIT_TIMER_PROBE_NS 2000000ULL
+#endif
+
+#ifndef PHIT_TIMER_PROBE_SAMPLES
+#define PHIT_TIMER_PROBE_SAMPLES 20000
+#endif
+
+/* Buffered PRNG: default outputs between reseeds */
+#ifndef PHIT_PRNG_RESEED_OUTPUTS
+#define PHIT_PRNG_RESEED_OUTPUTS (1u << 16)
+#endif
+
+/* Shared pool: per-core harvester slots (one cache line each) */
+#ifndef PHIT_SHARED_SLOTS
+#define PHIT_SHARED_SLOTS 64
+#endif
+
+/* Shared pool: harvests a slot collects before folding into the accumulator */
+#ifndef PHIT_SHARED_FOLD
+#define PHIT_SHARED_FOLD 8
+#endif
+
+/* Shared pool: harvests the accumulator must hold before the first
+ * extraction; the first caller harvests them inline */
+#ifndef PHIT_SHARED_MIN_HARVESTS
+#define PHIT_SHARED_MIN_HARVESTS (4 * PHIT_PRNG_SEED_ROUNDS)
+#endif
+
+/* Background harvester: ring size in 64-bit words, a power of two. The
+ * ring is static (16 bytes per word), which bounds its memory. */
+#ifndef PHIT_HARVESTER_RING
+#define PHIT_HARVESTER_RING 1024
+#endif
+
+/* Background harvester: default CPU cap, percent of one core */
+#ifndef PHIT_HARVESTER_DUTY
+#define PHIT_HARVESTER_DUTY 10
+#endif
+
+/* Background harvester: words per refill burst, and the poll interval
+ * while the ring is full */
+#ifndef PHIT_HARVESTER_BURST
+#define PHIT_HARVESTER_BURST 64
+#endif
+
+#ifndef PHIT_HARVESTER_IDLE_US
+#define PHIT_HARVESTER_IDLE_US 1000
+#endif
+
+/* Instrumentation: per-thread call counters and latency histograms for
+ * the hot paths (phit_stats_snapshot). 0 compiles every hook out. */
+#ifndef PHIT_STATS
+#define PHIT_STATS 0
+#endif
+
+/* Instrumentation: time one call in PHIT_STATS_SAMPLE (power of two) */
+#ifndef PHIT_STATS_SAMPLE
+#define PHIT_STATS_SAMPLE 64
+#endif
+
+/* Instrumentation: threads with a private counter block; later threads
+ * share one block updated with atomic adds */
+#ifndef PHIT_STATS_MAX_THREADS
+#define PHIT_STATS_MAX_THREADS 256
+#endif
+
+/* Health tests: compile the SP 800-90B style repetition count and
+ * adaptive proportion tests into phit_pool_harvest. 0 removes them. */
+#ifndef PHIT_HEALTH_TESTS
+#define PHIT_HEALTH_TESTS 1
+#endif
+
+/* Health tests: cutoffs for an assessed H = 0.5 bit of min-entropy per
+ * raw delta and a false-alarm rate of 2^-20 (SP 800-90B 4.4.1/4.4.2):
+ * RCT C = 1 + ceil(20 / H); APT table value for W = 512, H = 0.5. */
+#ifndef PHIT_HEALTH_RCT_CUTOFF
+#define PHIT_HEALTH_RCT_CUTOFF 41
+#endif
+
+#ifndef PHIT_HEALTH_APT_WINDOW
+#define PHIT_HEALTH_APT_WINDOW 512
+#endif
+
+#ifndef PHIT_HEALTH_APT_CUTOFF
+#define PHIT_HEALTH_APT_CUTOFF 410
+#endif
+
+/* Sampler kernels: one compile-time specialization per X(kind, iters,
+ * reads) entry (see "Sampler kernels"). Kinds are the PHIT_WL_* names
+ * without the prefix. Override before the implementation to change the
+ * family; library builds use this default. */
+#ifndef PHIT_SAMPLERS
+#define PHIT_SAMPLERS(X) \
+    X(NOP, 8, 1)     X(NOP, 8, 2)     X(NOP, 8, 4)     \
+    X(LCG, 10, 1)    X(LCG, 10, 2)    X(LCG, 10, 4)    \
+    X(MIX, 20, 1)    X(MIX, 20, 2)    X(MIX, 20, 4)    \
+    X(MEM, 16, 1)    X(MEM, 16, 2)    X(MEM, 16, 4)    \
+    X(BRANCH, 32, 1) X(BRANCH, 32, 2) X(BRANCH, 32, 4)
+#endif
+
+/* Sampler kernels: workload deltas per kernel in phit_sampler_profile */
+#ifndef PHIT_SAMPLER_PROFILE_SAMPLES
+#define PHIT_SAMPLER_PROFILE_SAMPLES 4096
+#endif
+
+/* Sampler kernels: default phits (delta entropy, bits) each timer read
+ * must carry for phit_sampler_select */
+#ifndef PHIT_SAMPLER_TARGET_PHITS
+#define PHIT_SAMPLER_TARGET_PHITS 2.0
+#endif
+
+/* Adaptive sampling: phit_route() draws its key from the calling thread's
+ * read-count controller instead of a fixed phit_sample_compound(2).
+ * 0 restores the fixed two reads. */
+#ifndef PHIT_ROUTE_ADAPTIVE
+#define PHIT_ROUTE_ADAPTIVE 1
+#endif
+
+/* Adaptive sampling: phits per key above log2(destinations) */
+#ifndef PHIT_ADAPT_MARGIN
+#define PHIT_ADAPT_MARGIN 2.0
+#endif
+
+/* Adaptive sampling: bounds on reads per key and LCG steps per read.
+ * Workloads lengthen only once reads are at the maximum. */
+#ifndef PHIT_ADAPT_MAX_READS
+#define PHIT_ADAPT_MAX_READS 4
+#endif
+
+#ifndef PHIT_ADAPT_MIN_ITERS
+#define PHIT_ADAPT_MIN_ITERS 10
+#endif
+
+#ifndef PHIT_ADAPT_MAX_ITERS
+#define PHIT_ADAPT_MAX_ITERS 80
+#endif
+
+/* Adaptive sampling: one key in PHIT_ADAPT_PROBE (power of two) also
+ * times its reads; the estimate is refreshed every PHIT_ADAPT_WINDOW
+ * timed deltas */
+#ifndef PHIT_ADAPT_PROBE
+#define PHIT_ADAPT_PROBE 16
+#endif
+
+#ifndef PHIT_ADAPT_WINDOW
+#define PHIT_ADAPT_WINDOW 256
+#endif
+
+/* Buffered PRNG: outputs between clock checks for time-based reseed.
+ * Must be a power of two. */
+#ifndef PHIT_PRNG_CLOCK_STRIDE
+#define PHIT_PRNG_CLOCK_STRIDE 256
+#endif
+
 /* ====================================================================
  * Types
  * ==================================================================== */
 
+/* Health flags (phit_health_t.flags, phit_pool_health) */
+#define PHIT_HEALTH_RCT 1   /* one raw value repeated PHIT_HEALTH_RCT_CUTOFF times */
+#define PHIT_HEALTH_APT 2   /* one raw value filled PHIT_HEALTH_APT_CUTOFF of a window */
+
+/* Continuous health tests on raw samples: O(1) state, O(1) per sample */
+typedef struct {
+    uint64_t rct_value;        /* repetition count: current run */
+    uint64_t apt_value;        /* adaptive proportion: window reference */
+    uint32_t rct_run;
+    uint32_t apt_count;
+    uint32_t apt_index;        /* position in the APT window */
+    uint32_t flags;            /* sticky PHIT_HEALTH_* until cleared */
+    uint64_t samples;
+    uint64_t failures;         /* test trips, both kinds */
+} phit_health_t;
+
 /* Entropy pool: 256-bit state */
 typedef struct {
     uint64_t pool[PHIT_POOL_LANES];
     uint64_t mix_counter;
     int      bits_collected;
+    uint64_t last_ticks;       /* previous harvest's timer read */
+    phit_health_t health;      /* on the raw inter-harvest deltas */
 } phit_pool_t;
 
-/* PRNG state */
+/* PRNG state.
+ * Direct mode (phit_prng_init): every output is a fresh pool extraction.
+ * Buffered mode (phit_prng_init_buffered): outputs come from a counter-mode
+ * expansion keyed from the pool, rekeyed every reseed_outputs values or
+ * every reseed_ns nanoseconds, whichever comes first.
+ * Shared mode (phit_prng_init_shared): buffered, keyed from the
+ * process-wide shared pool instead of the private one. */
 typedef struct {
     phit_pool_t pool;
     uint64_t    generated;
+    /* Buffered mode only (reseed_outputs == 0 means direct mode) */
+    uint64_t    key[2];
+    uint64_t    counter;
+    uint64_t    reseed_outputs;
+    uint64_t    reseed_ns;
+    uint64_t    remaining;      /* outputs left before the next reseed */
+    uint64_t    last_reseed;    /* phit_now_ns() at the last reseed */
+    int         shared;         /* keys come from phit_shared_extract() */
 } phit_prng_t;
 
+/* Per-thread state padded to whole cache lines. Arrays of the plain
+ * structs put neighbouring threads' hot fields on one line; elements of
+ * these never share one, provided the array is cache-line aligned
+ * (phit_prng_array_create). */
+#define PHIT__PAD_TO_LINE(n) (((n) + PHIT_CACHE_LINE - 1) / PHIT_CACHE_LINE * PHIT_CACHE_LINE)
+
+typedef union {
+    phit_pool_t pool;
+    char        pad[PHIT__PAD_TO_LINE(sizeof(phit_pool_t))];
+} phit_pool_padded_t;
+
+typedef union {
+    phit_prng_t rng;
+    char        pad[PHIT__PAD_TO_LINE(sizeof(phit_prng_t))];
+} phit_prng_padded_t;
+
+/* Timer capabilities, measured once per process (phit_timer_probe).
+ * "Units" are phit_now_ticks() units: counter ticks for the hardware
+ * backends, ns for the portable one. The struct is plain data so it can
+ * be cached and reinstalled. */
+typedef struct {
+    int      backend;          /* PHIT_TIMER_COUNTER or PHIT_TIMER_NS in use */
+    double   ns_per_unit;      /* phit_now_ticks() unit, in ns */
+    double   tick;             /* effective quantum, in units */
+    double   tick_ns;          /* effective quantum, in ns */
+    double   read_ns;          /* mean cost of one phit_now_ticks() read */
+    uint64_t tick_mul;         /* 2^32 / tick, for division-free quantize */
+    int      lsb_shift;        /* low timestamp bits that never change */
+    int      delta_levels;     /* distinct workload deltas, in ticks */
+    double   delta_mean;       /* mean workload delta, in ticks */
+    double   delta_entropy;    /* Shannon entropy of workload deltas, bits */
+    uint64_t probe_cost_ns;    /* wall time the probe took */
+} phit_timer_caps_t;
+
+/* CDF-calibrated router (experiments/phi_uniform.c), one per thread.
+ * slot_map resolves most deltas with one byte load (2 KB with the default
+ * MAX_DELTA). Deltas whose probability mass straddles a slot boundary are
+ * marked PHIT_ROUTER_SPLIT and placed inside their CDF interval
+ * [cdf_lo, cdf_lo + cdf_span) (16-bit fixed point) by timer LSBs, which
+ * keeps routing uniform when a few delta values dominate. The histogram
+ * is touched during calibration only. */
+#define PHIT_ROUTER_SPLIT 0xFF
+
+typedef struct {
+    uint8_t  slot_map[PHIT_ROUTER_MAX_DELTA];
+    uint16_t cdf_lo[PHIT_ROUTER_MAX_DELTA];
+    uint16_t cdf_span[PHIT_ROUTER_MAX_DELTA];
+    int      num_slots;        /* 1..255 */
+    int      ready;            /* tables built from calib_target samples */
+    uint32_t calib_count;      /* sum of hist */
+    uint32_t calib_target;
+    uint32_t since_rebuild;    /* routes observed since the last rebuild */
+    uint32_t hist[PHIT_ROUTER_MAX_DELTA];
+} phit_router_t;
+
+/* Load hint for phit_route2(), one per destination. depth is whatever
+ * the destination's owner counts as queued work (phit_load_add); each
+ * hint sits on its own cache line so updates never false-share, and
+ * routers read it relaxed. Allocate arrays cache-line aligned. */
+typedef struct {
+    int64_t depth;
+    char    pad[PHIT_CACHE_LINE - sizeof(int64_t)];
+} phit_load_t;
+
+/* Background harvester counters (phit_harvester_stats) */
+typedef struct {
+    int      running;
+    int      duty_limit;       /* percent of one core */
+    uint64_t capacity;         /* ring words */
+    uint64_t depth;            /* words ready now */
+    uint64_t produced;         /* words harvested since the first start */
+    uint64_t consumed;
+    uint64_t underruns;        /* pops that found the ring empty while running */
+    double   refill_rate;      /* words/s over the last burst */
+    double   duty;             /* harvesting time / wall time since start */
+} phit_harvester_stats_t;
+
+/* Instrumented operations and counted events (phit_stats_snapshot) */
+enum {
+    PHIT_STAT_SAMPLE,
+    PHIT_STAT_COMPOUND,
+    PHIT_STAT_ROUTE,
+    PHIT_STAT_HARVEST,
+    PHIT_STAT_EXTRACT,
+    PHIT_STAT_OPS
+};
+
+enum {
+    PHIT_EVENT_ROUTE_REJECT,        /* range-reduction rejection resample */
+    PHIT_EVENT_ROUTER_FALLBACK,     /* phit_router_route before calibration */
+    PHIT_EVENT_PRNG_INLINE,         /* private-pool word harvested inline */
+    PHIT_EVENT_HARVESTER_UNDERRUN,  /* harvester running, ring empty */
+    PHIT_EVENT_SHARED_BOOTSTRAP,    /* caller paid the shared pool bootstrap */
+    PHIT_EVENT_HEALTH_FAIL,         /* RCT or APT trip on a raw delta */
+    PHIT_EVENT_COUNT
+};
+
+/* Bucket b of hist holds timed calls of [2^b, 2^(b+1)) ns; the last
+ * bucket is open-ended */
+#define PHIT_STATS_BUCKETS 16
+
+typedef struct {
+    int      enabled;          /* built with PHIT_STATS */
+    int      threads;          /* threads that touched an instrumented path */
+    int      sample_every;     /* PHIT_STATS_SAMPLE */
+    double   timer_read_ns;    /* phit_timer_caps()->read_ns */
+    uint64_t calls[PHIT_STAT_OPS];
+    uint64_t hist[PHIT_STAT_OPS][PHIT_STATS_BUCKETS];
+    uint64_t events[PHIT_EVENT_COUNT];
+} phit_stats_t;
+
+/* Workload kinds of the sampler kernels (after experiments/phase_extract_v2.c) */
+enum {
+    PHIT_WL_NOP,        /* nop slide: timer phase only */
+    PHIT_WL_LCG,        /* volatile LCG chain (phit_sample's warm-up) */
+    PHIT_WL_MIX,        /* LCG + xorshift (phit_workload, phit_pool_harvest) */
+    PHIT_WL_MEM,        /* dependent loads/stores in a 64 KB table */
+    PHIT_WL_BRANCH,     /* branches on the previous sample's bits */
+    PHIT_WL_KINDS
+};
+
+/* One compile-time specialized sampler: `sample` runs `reads` workload +
+ * timer read rounds and folds them like phit_sample_compound(reads);
+ * `delta` times one workload in phit_now_ticks() units. */
+typedef uint32_t (*phit_sampler_fn)(void);
+
+typedef struct {
+    const char    *name;       /* "LCG-10x2" */
+    int            kind;       /* PHIT_WL_* */
+    int            iters;
+    int            reads;
+    phit_sampler_fn sample;
+    uint64_t     (*delta)(void);
+} phit_sampler_t;
+
+/* Measured cost and entropy of one kernel (phit_sampler_profile) */
+typedef struct {
+    double ns_per_key;         /* one sample() call */
+    double phits_per_read;     /* Shannon entropy of delta(), in timer ticks */
+    double delta_mean;         /* ticks */
+    int    levels;             /* distinct deltas seen */
+} phit_sampler_profile_t;
+
+/* Per-thread read-count controller (phit_sample_adaptive, phit_route).
+ * hist is a decayed histogram of timed workload deltas, in timer ticks
+ * from `base`; each window turns it into a Shannon estimate of phits per
+ * read and halves it. */
+#define PHIT_ADAPT_BINS 64
+
+typedef struct {
+    uint32_t hist[PHIT_ADAPT_BINS];
+    uint32_t base;             /* tick value of bin 0 */
+    uint32_t observed;         /* timed deltas since the last estimate */
+    uint32_t calls;
+    int      iters;            /* LCG steps per read */
+    double   phits;            /* per read; 0 until the first window */
+    double   inv_phits;
+    double   target_max;       /* largest target asked for this window */
+    double   phits_short;      /* estimate at half the length, 0 = unknown */
+    uint64_t retry_at;         /* estimate count to retry half the length */
+    uint64_t keys;             /* keys drawn */
+    uint64_t reads;            /* timer reads spent on them */
+    uint64_t estimates;
+} phit_adapt_t;
+
 /* Phit sample result */
 typedef struct {
     uint32_t key;
@@ -76,6 +473,72 @@ typedef struct {
 
 /* --- Timer --- */
 uint64_t phit_now_ns(void);
+const char *phit_timer_backend_name(void);
+
+/* Raw sampling clock. Counter reads are unserialized: they may execute
+ * out of order by a few cycles, which only adds phase jitter. */
+#if PHIT_TIMER_BACKEND == PHIT_TIMER_COUNTER && \
+    (defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__)))
+  #define PHIT__TIMER_COUNTER_NAME "cntvct_el0"
+  static inline uint64_t phit_now_ticks(void) {
+      uint64_t v;
+      __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+      return v;
+  }
+#elif PHIT_TIMER_BACKEND == PHIT_TIMER_COUNTER && defined(_MSC_VER) && defined(_M_ARM64)
+  #include <intrin.h>
+  #define PHIT__TIMER_COUNTER_NAME "cntvct_el0"
+  static inline uint64_t phit_now_ticks(void) {
+      return (uint64_t)_ReadStatusReg(ARM64_CNTVCT);
+  }
+#elif PHIT_TIMER_BACKEND == PHIT_TIMER_COUNTER && \
+    (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  #define PHIT__TIMER_COUNTER_NAME "rdtsc"
+  static inline uint64_t phit_now_ticks(void) {
+      uint32_t lo, hi;
+      __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+      return ((uint64_t)hi << 32) | lo;
+  }
+  /* RDTSCP: also returns IA32_TSC_AUX (the CPU number on Linux/Windows) */
+  static inline uint64_t phit_now_ticks_cpu(uint32_t *cpu) {
+      uint32_t lo, hi, aux;
+      __asm__ __volatile__("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux));
+      *cpu = aux;
+      return ((uint64_t)hi << 32) | lo;
+  }
+  #define PHIT_HAVE_TICKS_CPU 1
+#elif PHIT_TIMER_BACKEND == PHIT_TIMER_COUNTER && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #define PHIT__TIMER_COUNTER_NAME "rdtsc"
+  static inline uint64_t phit_now_ticks(void) {
+      return (uint64_t)__rdtsc();
+  }
+  static inline uint64_t phit_now_ticks_cpu(uint32_t *cpu) {
+      unsigned int aux;
+      uint64_t t = (uint64_t)__rdtscp(&aux);
+      *cpu = aux;
+      return t;
+  }
+  #define PHIT_HAVE_TICKS_CPU 1
+#elif PHIT_TIMER_BACKEND == PHIT_TIMER_COUNTER && defined(__riscv) && __riscv_xlen == 64
+  #define PHIT__TIMER_COUNTER_NAME "rdtime"
+  static inline uint64_t phit_now_ticks(void) {
+      uint64_t v;
+      __asm__ __volatile__("rdtime %0" : "=r"(v));
+      return v;
+  }
+#else
+  #define PHIT__TIMER_NS_ONLY 1
+  static inline uint64_t phit_now_ticks(void) {
+      return phit_now_ns();
+  }
+#endif
+
+/* --- Timer capabilities --- */
+void     phit_timer_probe(phit_timer_caps_t *caps);
+const phit_timer_caps_t *phit_timer_caps(void);     /* probes on first use */
+void     phit_timer_caps_set(const phit_timer_caps_t *caps);
+int      phit_quantize(uint64_t delta);   /* phit_now_ticks() delta -> timer ticks */
 
 /* --- Core sampling --- */
 uint32_t phit_hash32(uint32_t key);
@@ -83,9 +546,82 @@ uint64_t phit_hash64(uint64_t key);
 void     phit_workload(void);
 uint32_t phit_sample(void);
 uint32_t phit_sample_compound(int num_reads);
+void     phit_sample_batch(uint32_t *out, int count);
+void     phit_sample_compound_batch(uint32_t *out, int count, int num_reads);
+
+/* --- Sampler kernels ---
+ * PHIT_SAMPLERS instantiates one sampler per (workload, iterations, reads)
+ * with every loop bound a constant, so nothing inside a kernel branches
+ * on its configuration. phit_sampler_select() profiles the family on this
+ * host and picks the cheapest kernel with the requested read count whose
+ * deltas carry at least target_phits bits per read (the highest-entropy
+ * one if none does); phit_sample_selected() calls it. Before any selection
+ * phit_sample_selected() is phit_sample_compound(2). profiles, when not
+ * NULL, receives phit_sampler_count() entries. */
+int      phit_sampler_count(void);
+const phit_sampler_t *phit_sampler_get(int index);
+void     phit_sampler_profile(const phit_sampler_t *k, int samples, phit_sampler_profile_t *out);
+const phit_sampler_t *phit_sampler_select(int reads, double target_phits,
+                                          phit_sampler_profile_t *profiles);
+const phit_sampler_t *phit_sampler_selected(void);   /* NULL before selection */
+uint32_t phit_sample_selected(void);
+const char *phit_workload_name(int kind);
+
+/* --- Adaptive sampling ---
+ * A key carrying at least target_phits, from as few timer reads as the
+ * calling thread's delta entropy allows (1..PHIT_ADAPT_MAX_READS, longer
+ * workloads past that). Until the first estimate it behaves as
+ * phit_sample_compound(2). phit_route() uses it with a target of
+ * log2(n) + PHIT_ADAPT_MARGIN under PHIT_ROUTE_ADAPTIVE. */
+uint32_t phit_sample_adaptive(double target_phits);
+int      phit_adapt_reads(double target_phits);     /* reads the next key would take */
+void     phit_adapt_state(phit_adapt_t *out);       /* calling thread's controller */
+void     phit_adapt_reset(void);
 
 /* --- Routing --- */
-int      phit_route(int num_destinations);
+int      phit_route(int num_destinations);   /* exact uniform; 0 if n < 2 */
+/* The 32-bit key phit_route() reduces: phit_sample_adaptive sized for n
+ * under PHIT_ROUTE_ADAPTIVE, else phit_sample_compound(2) */
+uint32_t phit_route_key(int num_destinations);
+
+/* Multiply-shift range reduction (Lemire): x -> [0, n) without a divide.
+ * Bias is below n / 2^32; phit_route() and phit_prng_range() add the
+ * rejection step that makes them exact. */
+static inline uint32_t phit_reduce32(uint32_t x, uint32_t n) {
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+/* phit_route() for a compile-time constant n: a power of two folds to a
+ * mask of the same key phit_route() would draw, anything else is an
+ * ordinary phit_route() call */
+static inline int phit_route_const(int n) {
+    if (n > 0 && (n & (n - 1)) == 0) return n == 1 ? 0 : (int)(phit_route_key(n) & (uint32_t)(n - 1));
+    return phit_route(n);
+}
+
+/* Power-of-two choices: two distinct candidates from the low and high
+ * halves of one phit_sample_compound(2) key; the shallower one wins
+ * (ties go to the first). Max load O(log log n) instead of
+ * O(log n / log log n). */
+void     phit_route_pair(int num_destinations, int *first, int *second);
+int      phit_route2(const phit_load_t *loads, int num_destinations);
+void     phit_load_add(phit_load_t *load, int64_t delta);   /* atomic, relaxed */
+
+/* --- CDF router --- */
+int      phit_router_init(phit_router_t *r, int num_slots, uint32_t calib_samples);
+int      phit_router_calibrate(phit_router_t *r, int budget);
+void     phit_router_rebuild(phit_router_t *r);
+uint64_t phit_router_delta(void);
+int      phit_router_route(phit_router_t *r);
+
+/* Slot for a delta in timer ticks; lsb supplies the tie-break for split deltas */
+static inline int phit_router_slot(const phit_router_t *r, uint64_t delta, uint32_t lsb) {
+    if (delta >= PHIT_ROUTER_MAX_DELTA) delta = PHIT_ROUTER_MAX_DELTA - 1;
+    int slot = r->slot_map[delta];
+    if (slot != PHIT_ROUTER_SPLIT) return slot;
+    uint32_t pos = r->cdf_lo[delta] + ((r->cdf_span[delta] * (lsb & 0xFFFF)) >> 16);
+    return (int)((pos * (uint32_t)r->num_slots) >> 16);
+}
 
 /* --- Entropy pool --- */
 void     phit_pool_init(phit_pool_t *p);
@@ -93,14 +629,81 @@ void     phit_pool_feed(phit_pool_t *p, uint64_t sample);
 void     phit_pool_harvest(phit_pool_t *p);
 uint64_t phit_pool_extract(phit_pool_t *p);
 
+/* --- Health tests ---
+ * phit_pool_harvest() runs the repetition count and adaptive proportion
+ * tests on each raw timer delta before it is hashed into the pool. A trip
+ * sets a sticky flag on the pool and bumps a process-wide counter. */
+uint32_t phit_health_update(phit_health_t *h, uint64_t sample);   /* flags raised */
+int      phit_pool_health(const phit_pool_t *p);                   /* PHIT_HEALTH_* */
+void     phit_pool_health_clear(phit_pool_t *p);
+uint64_t phit_health_failures(void);                               /* all pools */
+
+/* --- Shared pool (process-wide, lock-free) ---
+ * Any thread harvests into its core's slot; a slot holding
+ * PHIT_SHARED_FOLD harvests folds into one accumulator with atomic XOR.
+ * Extraction takes a ticket, so concurrent callers never get the same
+ * word, and mutates the accumulator after reading (forward-secure).
+ * Before PHIT_SHARED_MIN_HARVESTS are folded one caller harvests the
+ * deficit and concurrent callers wait for it. */
+void     phit_shared_feed(int harvests);
+uint64_t phit_shared_extract(void);
+uint64_t phit_shared_harvests(void);      /* harvests folded so far */
+
+/* --- Background harvester (opt-in, one per process) ---
+ * A library-owned thread keeps a ring of conditioned words topped up.
+ * Direct-mode phit_prng_u64() and private-pool reseeds pop from it and
+ * harvest inline only on underrun. Memory is the static ring; the thread
+ * sleeps so that harvesting stays under duty_percent of one core. */
+int      phit_harvester_start(int duty_percent);   /* 0 = PHIT_HARVESTER_DUTY; 1 = running */
+void     phit_harvester_stop(void);                 /* joins; ring contents stay poppable */
+int      phit_harvester_pop(uint64_t *out);         /* 1 = popped, 0 = empty */
+void     phit_harvester_stats(phit_harvester_stats_t *st);
+
 /* --- PRNG --- */
 void     phit_prng_init(phit_prng_t *rng);
+void     phit_prng_init_buffered(phit_prng_t *rng, uint64_t reseed_outputs,
+                                 uint64_t reseed_ns);
+/* Buffered mode keyed from the shared pool: init is two extractions
+ * instead of PHIT_PRNG_SEED_ROUNDS harvests; each later reseed feeds
+ * PHIT_POOL_LANES fresh harvests back first. */
+void     phit_prng_init_shared(phit_prng_t *rng, uint64_t reseed_outputs,
+                               uint64_t reseed_ns);
+phit_prng_t *phit_prng_local(void);       /* calling thread's shared-mode PRNG */
+/* n cache-line aligned PRNGs, each phit_prng_init_buffered(&a[i].rng, 0, 0);
+ * NULL when out of memory. Free with phit_prng_array_destroy. */
+phit_prng_padded_t *phit_prng_array_create(int n);
+void     phit_prng_array_destroy(phit_prng_padded_t *a);
+void     phit_prng_reseed(phit_prng_t *rng);
 uint64_t phit_prng_u64(phit_prng_t *rng);
 uint32_t phit_prng_u32(phit_prng_t *rng);
 double   phit_prng_double(phit_prng_t *rng);
 uint32_t phit_prng_range(phit_prng_t *rng, uint32_t max);
 void     phit_prng_fill(phit_prng_t *rng, void *buf, int len);
 
+/* --- SIMD dispatch (bulk fill) --- */
+enum {
+    PHIT_SIMD_SCALAR = 0,
+    PHIT_SIMD_NEON   = 1,
+    PHIT_SIMD_AVX2   = 2,
+    PHIT_SIMD_AVX512 = 3
+};
+int         phit_simd_level(void);        /* best level supported by this CPU */
+int         phit_simd_select(int level);  /* cap dispatch; returns level in use */
+const char *phit_simd_name(int level);
+/* Keystream XOR in place: buf[i] ^= byte offset + i of the expansion of
+ * key (word w = phit_hash64(key[0] + w * G) ^ key[1], the buffered-mode
+ * formula), on the dispatched kernels. Any split of a stream into calls
+ * with advancing offsets gives the same bytes as one call. */
+void        phit_expand_xor(const uint64_t key[2], uint64_t offset, void *buf, size_t len);
+
+/* --- Instrumentation (PHIT_STATS) ---
+ * Lock-free: sums every thread's counters with relaxed loads, so a
+ * snapshot taken under load is approximate by a few in-flight calls. */
+void        phit_stats_snapshot(phit_stats_t *out);
+const char *phit_stats_op_name(int op);
+const char *phit_stats_event_name(int event);
+double      phit_stats_percentile(const phit_stats_t *s, int op, double q);   /* ns */
+
 /* --- Self-test --- */
 int      phit_selftest(void);
 
@@ -108,6 +711,183 @@ int      phit_selftest(void);
 }
 #endif
 
+/* ====================================================================
+ * SIMD kernels
+ *
+ * Buffered-mode output word i is phit_hash64(key0 + i * G) ^ key1, so any
+ * run of words can be produced independently of its neighbours. The SIMD
+ * kernels below compute exactly the scalar formula over 4/8/16 counters per
+ * iteration (64-bit multiplies are emulated from 32x32 products where the
+ * ISA lacks them) and produce bit-identical output on every platform.
+ * Define PHIT_NO_SIMD to build the scalar path only.
+ *
+ * Header-only builds compile every kernel into the implementation file
+ * with per-function target attributes. Library builds define
+ * PHIT_SIMD_EXTERNAL next to LIBPHIT_IMPLEMENTATION and take the kernels
+ * from per-ISA units instead: each unit defines PHIT_SIMD_UNIT_NEON,
+ * PHIT_SIMD_UNIT_AVX2 or PHIT_SIMD_UNIT_AVX512, includes this header and
+ * is compiled with that ISA's flags (see src/simd/). Either way the
+ * kernel is only called after runtime dispatch has checked the CPU.
+ * ==================================================================== */
+
+#if defined(PHIT_SIMD_UNIT_NEON) || defined(PHIT_SIMD_UNIT_AVX2) || \
+    defined(PHIT_SIMD_UNIT_AVX512)
+  #define PHIT__SIMD_UNIT 1
+#endif
+
+#if defined(LIBPHIT_IMPLEMENTATION) || defined(PHIT__SIMD_UNIT)
+
+#define PHIT__WEYL 0x9E3779B97F4A7C15ULL
+#define PHIT__MIX1 0xBF58476D1CE4E5B9ULL
+#define PHIT__MIX2 0x94D049BB133111EBULL
+
+#if !defined(PHIT_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+  #define PHIT__HAVE_NEON 1
+#endif
+#if !defined(PHIT_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+  #define PHIT__HAVE_X86_SIMD 1
+#endif
+
+#if defined(PHIT__SIMD_UNIT)
+  /* Per-ISA unit: external linkage, ISA enabled by the unit's flags */
+  #define PHIT__KERNEL
+  #define PHIT__TARGET(isa)
+#elif !defined(PHIT_SIMD_EXTERNAL)
+  #define PHIT__SIMD_INLINE 1
+  #define PHIT__KERNEL static
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #define PHIT__TARGET(isa)
+  #else
+    #define PHIT__TARGET(isa) __attribute__((target(isa)))
+  #endif
+#endif
+
+#if defined(PHIT__HAVE_NEON) && (defined(PHIT__SIMD_INLINE) || defined(PHIT_SIMD_UNIT_NEON))
+#include <arm_neon.h>
+
+/* a * c mod 2^64 per lane, c split into 32-bit halves */
+static inline uint64x2_t phit__mul64_neon(uint64x2_t a, uint32x2_t c_lo, uint32x2_t c_hi) {
+    uint32x2_t a_lo = vmovn_u64(a);
+    uint32x2_t a_hi = vshrn_n_u64(a, 32);
+    uint64x2_t cross = vmull_u32(a_hi, c_lo);
+    cross = vmlal_u32(cross, a_lo, c_hi);
+    return vaddq_u64(vmull_u32(a_lo, c_lo), vshlq_n_u64(cross, 32));
+}
+
+static inline uint64x2_t phit__mix_neon(uint64x2_t z) {
+    z = veorq_u64(z, vshrq_n_u64(z, 30));
+    z = phit__mul64_neon(z, vdup_n_u32((uint32_t)PHIT__MIX1),
+                            vdup_n_u32((uint32_t)(PHIT__MIX1 >> 32)));
+    z = veorq_u64(z, vshrq_n_u64(z, 27));
+    z = phit__mul64_neon(z, vdup_n_u32((uint32_t)PHIT__MIX2),
+                            vdup_n_u32((uint32_t)(PHIT__MIX2 >> 32)));
+    return veorq_u64(z, vshrq_n_u64(z, 31));
+}
+
+/* 4 words per iteration */
+PHIT__KERNEL void phit__expand_neon(uint64_t k0, uint64_t k1, uint64_t ctr,
+                                    uint8_t *dst, size_t nwords) {
+    uint64_t base = k0 + ctr * PHIT__WEYL;
+    uint64_t init[4] = { base, base + PHIT__WEYL,
+                         base + 2 * PHIT__WEYL, base + 3 * PHIT__WEYL };
+    uint64x2_t z0 = vld1q_u64(init);
+    uint64x2_t z1 = vld1q_u64(init + 2);
+    const uint64x2_t step = vdupq_n_u64(4 * PHIT__WEYL);
+    const uint64x2_t key = vdupq_n_u64(k1);
+    for (size_t i = 0; i < nwords; i += 4) {
+        vst1q_u64((uint64_t *)(void *)(dst + i * 8),       veorq_u64(phit__mix_neon(z0), key));
+        vst1q_u64((uint64_t *)(void *)(dst + i * 8 + 16),  veorq_u64(phit__mix_neon(z1), key));
+        z0 = vaddq_u64(z0, step);
+        z1 = vaddq_u64(z1, step);
+    }
+}
+#endif
+
+#if defined(PHIT__HAVE_X86_SIMD) && (defined(PHIT__SIMD_INLINE) || \
+    defined(PHIT_SIMD_UNIT_AVX2) || defined(PHIT_SIMD_UNIT_AVX512))
+#include <immintrin.h>
+#endif
+
+#if defined(PHIT__HAVE_X86_SIMD) && (defined(PHIT__SIMD_INLINE) || defined(PHIT_SIMD_UNIT_AVX2))
+/* a * c mod 2^64 per lane from three 32x32->64 products */
+PHIT__TARGET("avx2")
+static inline __m256i phit__mul64_avx2(__m256i a, __m256i c_lo, __m256i c_hi) {
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), c_lo),
+                                     _mm256_mul_epu32(a, c_hi));
+    return _mm256_add_epi64(_mm256_mul_epu32(a, c_lo), _mm256_slli_epi64(cross, 32));
+}
+
+PHIT__TARGET("avx2")
+static inline __m256i phit__mix_avx2(__m256i z) {
+    const __m256i m1_lo = _mm256_set1_epi64x((long long)(PHIT__MIX1 & 0xFFFFFFFFu));
+    const __m256i m1_hi = _mm256_set1_epi64x((long long)(PHIT__MIX1 >> 32));
+    const __m256i m2_lo = _mm256_set1_epi64x((long long)(PHIT__MIX2 & 0xFFFFFFFFu));
+    const __m256i m2_hi = _mm256_set1_epi64x((long long)(PHIT__MIX2 >> 32));
+    z = _mm256_xor_si256(z, _mm256_srli_epi64(z, 30));
+    z = phit__mul64_avx2(z, m1_lo, m1_hi);
+    z = _mm256_xor_si256(z, _mm256_srli_epi64(z, 27));
+    z = phit__mul64_avx2(z, m2_lo, m2_hi);
+    return _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+}
+
+/* 8 words per iteration */
+PHIT__TARGET("avx2")
+PHIT__KERNEL void phit__expand_avx2(uint64_t k0, uint64_t k1, uint64_t ctr,
+                                    uint8_t *dst, size_t nwords) {
+    uint64_t base = k0 + ctr * PHIT__WEYL;
+    __m256i z0 = _mm256_set_epi64x((long long)(base + 3 * PHIT__WEYL),
+                                   (long long)(base + 2 * PHIT__WEYL),
+                                   (long long)(base + PHIT__WEYL),
+                                   (long long)base);
+    __m256i z1 = _mm256_add_epi64(z0, _mm256_set1_epi64x((long long)(4 * PHIT__WEYL)));
+    const __m256i step = _mm256_set1_epi64x((long long)(8 * PHIT__WEYL));
+    const __m256i key = _mm256_set1_epi64x((long long)k1);
+    for (size_t i = 0; i < nwords; i += 8) {
+        _mm256_storeu_si256((__m256i *)(void *)(dst + i * 8),
+                            _mm256_xor_si256(phit__mix_avx2(z0), key));
+        _mm256_storeu_si256((__m256i *)(void *)(dst + i * 8 + 32),
+                            _mm256_xor_si256(phit__mix_avx2(z1), key));
+        z0 = _mm256_add_epi64(z0, step);
+        z1 = _mm256_add_epi64(z1, step);
+    }
+}
+#endif
+
+#if defined(PHIT__HAVE_X86_SIMD) && (defined(PHIT__SIMD_INLINE) || defined(PHIT_SIMD_UNIT_AVX512))
+PHIT__TARGET("avx512f,avx512dq")
+static inline __m512i phit__mix_avx512(__m512i z) {
+    z = _mm512_xor_si512(z, _mm512_srli_epi64(z, 30));
+    z = _mm512_mullo_epi64(z, _mm512_set1_epi64((long long)PHIT__MIX1));
+    z = _mm512_xor_si512(z, _mm512_srli_epi64(z, 27));
+    z = _mm512_mullo_epi64(z, _mm512_set1_epi64((long long)PHIT__MIX2));
+    return _mm512_xor_si512(z, _mm512_srli_epi64(z, 31));
+}
+
+/* 16 words per iteration */
+PHIT__TARGET("avx512f,avx512dq")
+PHIT__KERNEL void phit__expand_avx512(uint64_t k0, uint64_t k1, uint64_t ctr,
+                                      uint8_t *dst, size_t nwords) {
+    uint64_t base = k0 + ctr * PHIT__WEYL;
+    __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i z0 = _mm512_add_epi64(_mm512_set1_epi64((long long)base),
+                                  _mm512_mullo_epi64(lane, _mm512_set1_epi64((long long)PHIT__WEYL)));
+    __m512i z1 = _mm512_add_epi64(z0, _mm512_set1_epi64((long long)(8 * PHIT__WEYL)));
+    const __m512i step = _mm512_set1_epi64((long long)(16 * PHIT__WEYL));
+    const __m512i key = _mm512_set1_epi64((long long)k1);
+    for (size_t i = 0; i < nwords; i += 16) {
+        _mm512_storeu_si512((void *)(dst + i * 8),
+                            _mm512_xor_si512(phit__mix_avx512(z0), key));
+        _mm512_storeu_si512((void *)(dst + i * 8 + 64),
+                            _mm512_xor_si512(phit__mix_avx512(z1), key));
+        z0 = _mm512_add_epi64(z0, step);
+        z1 = _mm512_add_epi64(z1, step);
+    }
+}
+#endif
+
+#endif /* LIBPHIT_IMPLEMENTATION || PHIT__SIMD_UNIT */
+
 /* ====================================================================
  * Implementation
  * ==================================================================== */
@@ -115,15 +895,70 @@ int      phit_selftest(void);
 #ifdef LIBPHIT_IMPLEMENTATION
 
 #include <math.h>
+#include <stdlib.h>
 
-/* Prevent compiler from optimizing away workloads.
- * Thread-local: each thread gets its own sink — no shared state. */
 #if defined(_MSC_VER)
-  static __declspec(thread) volatile uint64_t phit__sink;
+  #define PHIT__TLS __declspec(thread)
+  #define PHIT__ALIGNED(n) __declspec(align(n))
 #elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
-  static _Thread_local volatile uint64_t phit__sink;
+  #define PHIT__TLS _Thread_local
+  #define PHIT__ALIGNED(n) __attribute__((aligned(n)))
+#else
+  #define PHIT__TLS __thread
+  #define PHIT__ALIGNED(n) __attribute__((aligned(n)))
+#endif
+
+/* Prevent compiler from optimizing away workloads.
+ * Thread-local: each thread gets its own sink — no shared state. */
+static PHIT__TLS volatile uint64_t phit__sink;
+
+/* ---- Threads (background harvester, phit_exec.h workers) ---- */
+
+#if defined(_WIN32)
+  #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+  typedef HANDLE             phit__thread_t;
+  typedef SRWLOCK            phit__mutex_t;
+  typedef CONDITION_VARIABLE phit__cond_t;
+  #define phit__mutex_init(m)   InitializeSRWLock(m)
+  #define phit__mutex_destroy(m) ((void)(m))
+  #define phit__mutex_lock(m)   AcquireSRWLockExclusive(m)
+  #define phit__mutex_unlock(m) ReleaseSRWLockExclusive(m)
+  #define phit__cond_init(c)    InitializeConditionVariable(c)
+  #define phit__cond_destroy(c) ((void)(c))
+  #define phit__cond_wait(c, m) SleepConditionVariableSRW((c), (m), INFINITE, 0)
+  #define phit__cond_wait_us(c, m, us) \
+      SleepConditionVariableSRW((c), (m), ((us) + 999) / 1000, 0)
+  #define phit__cond_signal(c)  WakeConditionVariable(c)
+  #define phit__cond_broadcast(c) WakeAllConditionVariable(c)
+  #define phit__yield()         SwitchToThread()
 #else
-  static __thread volatile uint64_t phit__sink;
+  #include <pthread.h>
+  #include <sched.h>
+  typedef pthread_t          phit__thread_t;
+  typedef pthread_mutex_t    phit__mutex_t;
+  typedef pthread_cond_t     phit__cond_t;
+  #define phit__mutex_init(m)   pthread_mutex_init((m), NULL)
+  #define phit__mutex_destroy(m) pthread_mutex_destroy(m)
+  #define phit__mutex_lock(m)   pthread_mutex_lock(m)
+  #define phit__mutex_unlock(m) pthread_mutex_unlock(m)
+  #define phit__cond_init(c)    pthread_cond_init((c), NULL)
+  #define phit__cond_destroy(c) pthread_cond_destroy(c)
+  #define phit__cond_wait(c, m) pthread_cond_wait((c), (m))
+  #define phit__cond_signal(c)  pthread_cond_signal(c)
+  #define phit__cond_broadcast(c) pthread_cond_broadcast(c)
+  #define phit__yield()         sched_yield()
+  #include <time.h>
+  static void phit__cond_wait_us(phit__cond_t *c, phit__mutex_t *m, long us) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += us * 1000;
+      ts.tv_sec += ts.tv_nsec / 1000000000L;
+      ts.tv_nsec %= 1000000000L;
+      pthread_cond_timedwait(c, m, &ts);
+  }
 #endif
 
 /* ---- Platform timer ---- */
@@ -162,6 +997,14 @@ int      phit_selftest(void);
   }
 #endif
 
+const char *phit_timer_backend_name(void) {
+#if defined(PHIT__TIMER_NS_ONLY)
+    return "ns";
+#else
+    return PHIT__TIMER_COUNTER_NAME;
+#endif
+}
+
 /* ---- Hash functions ---- */
 
 uint32_t phit_hash32(uint32_t key) {
@@ -179,14 +1022,55 @@ uint64_t phit_hash64(uint64_t key) {
     return key;
 }
 
-/* ---- Workload ---- */
+/* ---- Workload ----
+ *
+ * Workload bodies shared by the samplers and the kernel family. Each
+ * steps `x` (a volatile uint64_t) n times; n is a constant at every use,
+ * so the loops have fixed trip counts.
+ */
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define PHIT__NOP() __nop()
+#else
+  #define PHIT__NOP() __asm__ volatile("nop")
+#endif
+
+#define PHIT__LCG_STEP(x) ((x) = (x) * 6364136223846793005ULL + 1442695040888963407ULL)
+
+/* 64 KB for PHIT_WL_MEM; filled on the first profile, zeros before */
+#define PHIT__WL_TABLE 65536
+static volatile uint8_t phit__wl_table[PHIT__WL_TABLE];
+
+#define PHIT__WL_NOP(x, n) \
+    do { for (int w_ = 0; w_ < (n); w_++) PHIT__NOP(); } while (0)
+#define PHIT__WL_LCG(x, n) \
+    do { for (int w_ = 0; w_ < (n); w_++) PHIT__LCG_STEP(x); } while (0)
+#define PHIT__WL_MIX(x, n) \
+    do { for (int w_ = 0; w_ < (n); w_++) { PHIT__LCG_STEP(x); (x) ^= (x) >> 17; } } while (0)
+#define PHIT__WL_MEM(x, n) \
+    do { \
+        for (int w_ = 0; w_ < (n); w_++) { \
+            uint64_t v_ = (x); \
+            v_ ^= v_ << 13; v_ ^= v_ >> 7; v_ ^= v_ << 17; \
+            phit__wl_table[(v_ >> 16) & (PHIT__WL_TABLE - 1)] = (uint8_t)v_; \
+            (x) = v_ + phit__wl_table[v_ & (PHIT__WL_TABLE - 1)]; \
+        } \
+    } while (0)
+#define PHIT__WL_BRANCH(x, n) \
+    do { \
+        uint64_t b_ = (x) ^ phit__sink; \
+        volatile int s_ = 0; \
+        for (int w_ = 0; w_ < (n); w_++) { \
+            if ((b_ >> (w_ & 31)) & 1) s_ += w_; \
+            else s_ -= w_; \
+        } \
+        (x) += (uint64_t)(int64_t)s_; \
+    } while (0)
 
 void phit_workload(void) {
     volatile uint64_t x = 0xCAFEBABE;
-    for (int i = 0; i < PHIT_WORKLOAD_ITERS; i++) {
-        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-        x ^= x >> 17;
-    }
+    PHIT__WL_MIX(x, PHIT_WORKLOAD_ITERS);
     phit__sink = x;
 }
 
@@ -196,88 +1080,1017 @@ static inline uint64_t phit__rotl64(uint64_t x, int k) {
     return (x << k) | (x >> (64 - k));
 }
 
+/* ---- Publication helpers (caps are written once, read everywhere) ---- */
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define PHIT__LOAD_ACQUIRE(p)     (_ReadWriteBarrier(), *(volatile int *)(p))
+  #define PHIT__STORE_RELEASE(p, v) do { _ReadWriteBarrier(); *(volatile int *)(p) = (v); } while (0)
+  #define PHIT__LOAD_RELAXED64(p)   (*(volatile int64_t *)(p))
+  #define PHIT__ADD_RELAXED64(p, v) ((void)_InterlockedExchangeAdd64((volatile __int64 *)(p), (v)))
+  #define PHIT__FETCH_ADD64(p, v)   ((uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)(p), (__int64)(v)))
+  #define PHIT__XOR64(p, v)         ((void)_InterlockedXor64((volatile __int64 *)(p), (__int64)(v)))
+  #define PHIT__XCHG64(p, v)        ((uint64_t)_InterlockedExchange64((volatile __int64 *)(p), (__int64)(v)))
+  #define PHIT__LOAD_PTR(p)         (_ReadWriteBarrier(), *(void *volatile *)(p))
+  #define PHIT__XCHG_PTR(p, v)      _InterlockedExchangePointer((void *volatile *)(p), (void *)(v))
+  #define PHIT__CAS_PTR(p, exp, v) \
+      (_InterlockedCompareExchangePointer((void *volatile *)(p), (void *)(v), (void *)(exp)) == \
+       (void *)(exp))
+#else
+  #define PHIT__LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define PHIT__STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define PHIT__LOAD_RELAXED64(p)   __atomic_load_n((p), __ATOMIC_RELAXED)
+  #define PHIT__ADD_RELAXED64(p, v) ((void)__atomic_fetch_add((p), (v), __ATOMIC_RELAXED))
+  #define PHIT__FETCH_ADD64(p, v)   __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+  #define PHIT__XOR64(p, v)         ((void)__atomic_fetch_xor((p), (v), __ATOMIC_ACQ_REL))
+  #define PHIT__XCHG64(p, v)        __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+  #define PHIT__LOAD_PTR(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define PHIT__XCHG_PTR(p, v)      __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+  #define PHIT__CAS_PTR(p, exp, v) \
+      __atomic_compare_exchange_n((p), &(exp), (v), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+/* ---- Ring atomics (harvester ring, phit_exec.h rings; int flags) ---- */
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define PHIT__LOAD64(p)        (_ReadWriteBarrier(), *(volatile uint64_t *)(p))
+  #define PHIT__PEEK64(p)        (*(volatile uint64_t *)(p))
+  #define PHIT__STORE64(p, v)    do { _ReadWriteBarrier(); *(volatile uint64_t *)(p) = (v); } while (0)
+  #define PHIT__CAS64(p, exp, v) \
+      ((uint64_t)_InterlockedCompareExchange64((volatile __int64 *)(p), (__int64)(v), \
+                                               (__int64)(exp)) == (exp))
+  #define PHIT__LOAD_INT(p)      (_ReadWriteBarrier(), *(volatile int *)(p))
+  #define PHIT__STORE_INT(p, v)  do { _ReadWriteBarrier(); *(volatile int *)(p) = (v); } while (0)
+  #define PHIT__FENCE()          MemoryBarrier()
+  #define PHIT__PAUSE()          YieldProcessor()
+#else
+  #define PHIT__LOAD64(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define PHIT__PEEK64(p)        __atomic_load_n((p), __ATOMIC_RELAXED)
+  #define PHIT__STORE64(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define PHIT__CAS64(p, exp, v) \
+      __atomic_compare_exchange_n((p), &(exp), (v), 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+  #define PHIT__LOAD_INT(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define PHIT__STORE_INT(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define PHIT__FENCE()          __atomic_thread_fence(__ATOMIC_SEQ_CST)
+  #if defined(__x86_64__) || defined(__i386__)
+    #define PHIT__PAUSE()        __builtin_ia32_pause()
+  #elif defined(__aarch64__)
+    #define PHIT__PAUSE()        __asm__ __volatile__("yield")
+  #else
+    #define PHIT__PAUSE()        ((void)0)
+  #endif
+#endif
+
+/* ---- Instrumentation ----
+ *
+ * Each thread claims a counter block on first use and is its only writer
+ * (relaxed store of count + 1, a plain add on x86/ARM64). Threads past
+ * PHIT_STATS_MAX_THREADS share the last block with atomic adds. One call
+ * in PHIT_STATS_SAMPLE per op is timed, which keeps the timer reads off
+ * the average. With PHIT_STATS 0 the hooks are empty macros. */
+
+static const char *const phit__stat_op_names[PHIT_STAT_OPS] = {
+    "phit_sample", "phit_sample_compound", "phit_route", "phit_pool_harvest",
+    "phit_pool_extract"
+};
+
+static const char *const phit__stat_event_names[PHIT_EVENT_COUNT] = {
+    "route_reject", "router_fallback", "prng_inline", "harvester_underrun",
+    "shared_bootstrap", "health_fail"
+};
+
+const char *phit_stats_op_name(int op) {
+    return op >= 0 && op < PHIT_STAT_OPS ? phit__stat_op_names[op] : "?";
+}
+
+const char *phit_stats_event_name(int event) {
+    return event >= 0 && event < PHIT_EVENT_COUNT ? phit__stat_event_names[event] : "?";
+}
+
+double phit_stats_percentile(const phit_stats_t *s, int op, double q) {
+    if (op < 0 || op >= PHIT_STAT_OPS) return 0;
+    uint64_t total = 0, seen = 0;
+    for (int b = 0; b < PHIT_STATS_BUCKETS; b++) total += s->hist[op][b];
+    if (total == 0) return 0;
+    for (int b = 0; b < PHIT_STATS_BUCKETS; b++) {
+        seen += s->hist[op][b];
+        if ((double)seen >= q * (double)total) return (double)(2ULL << b);   /* bucket top */
+    }
+    return (double)(2ULL << (PHIT_STATS_BUCKETS - 1));
+}
+
+#if PHIT_STATS
+
+typedef struct {
+    uint64_t calls[PHIT_STAT_OPS];
+    uint64_t hist[PHIT_STAT_OPS][PHIT_STATS_BUCKETS];
+    uint64_t events[PHIT_EVENT_COUNT];
+    int      shared;                /* overflow block: atomic adds */
+} phit__stats_block_t;
+
+static PHIT__ALIGNED(PHIT_CACHE_LINE) phit__stats_block_t phit__stats_blocks[PHIT_STATS_MAX_THREADS];
+static uint64_t phit__stats_threads;
+static PHIT__TLS phit__stats_block_t *phit__stats_mine;
+
+static phit__stats_block_t *phit__stats_block(void) {
+    phit__stats_block_t *b = phit__stats_mine;
+    if (b) return b;
+    uint64_t i = PHIT__FETCH_ADD64(&phit__stats_threads, 1);
+    if (i >= PHIT_STATS_MAX_THREADS - 1) {
+        i = PHIT_STATS_MAX_THREADS - 1;
+        PHIT__STORE_RELEASE(&phit__stats_blocks[i].shared, 1);
+    }
+    phit__stats_mine = b = &phit__stats_blocks[i];
+    return b;
+}
+
+static inline uint64_t phit__stats_inc(phit__stats_block_t *b, uint64_t *c) {
+    if (b->shared) return PHIT__FETCH_ADD64(c, 1);
+    uint64_t v = (uint64_t)PHIT__LOAD_RELAXED64(c);
+  #if defined(_MSC_VER) && !defined(__clang__)
+    *(volatile uint64_t *)c = v + 1;
+  #else
+    __atomic_store_n(c, v + 1, __ATOMIC_RELAXED);
+  #endif
+    return v;
+}
+
+static void phit__stats_time(phit__stats_block_t *b, int op, uint64_t t0) {
+    uint64_t t1 = phit_now_ticks();
+    double ns = (double)(t1 - t0) * phit_timer_caps()->ns_per_unit;
+    int bucket = 0;
+    while (bucket < PHIT_STATS_BUCKETS - 1 && ns >= (double)(2ULL << bucket)) bucket++;
+    phit__stats_inc(b, &b->hist[op][bucket]);
+}
+
+static void phit__stats_event(int ev) {
+    phit__stats_block_t *b = phit__stats_block();
+    phit__stats_inc(b, &b->events[ev]);
+}
+
+  #define PHIT__STAT_BEGIN(op)                                                   \
+      phit__stats_block_t *phit__sb = phit__stats_block();                      \
+      uint64_t phit__st0 = (phit__stats_inc(phit__sb, &phit__sb->calls[op]) &    \
+                            (PHIT_STATS_SAMPLE - 1)) == 0 ? phit_now_ticks() : 0
+  #define PHIT__STAT_END(op) \
+      do { if (phit__st0) phit__stats_time(phit__sb, (op), phit__st0); } while (0)
+  #define PHIT__STAT_EVENT(ev) phit__stats_event(ev)
+
+#else
+  #define PHIT__STAT_BEGIN(op) ((void)0)
+  #define PHIT__STAT_END(op)   ((void)0)
+  #define PHIT__STAT_EVENT(ev) ((void)0)
+#endif
+
+void phit_stats_snapshot(phit_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->sample_every = PHIT_STATS_SAMPLE;
+    out->timer_read_ns = phit_timer_caps()->read_ns;
+#if PHIT_STATS
+    out->enabled = 1;
+    uint64_t n = (uint64_t)PHIT__LOAD_RELAXED64(&phit__stats_threads);
+    out->threads = (int)n;
+    if (n > PHIT_STATS_MAX_THREADS) n = PHIT_STATS_MAX_THREADS;
+    for (uint64_t t = 0; t < n; t++) {
+        const phit__stats_block_t *b = &phit__stats_blocks[t];
+        for (int op = 0; op < PHIT_STAT_OPS; op++) {
+            out->calls[op] += (uint64_t)PHIT__LOAD_RELAXED64(&b->calls[op]);
+            for (int k = 0; k < PHIT_STATS_BUCKETS; k++)
+                out->hist[op][k] += (uint64_t)PHIT__LOAD_RELAXED64(&b->hist[op][k]);
+        }
+        for (int ev = 0; ev < PHIT_EVENT_COUNT; ev++)
+            out->events[ev] += (uint64_t)PHIT__LOAD_RELAXED64(&b->events[ev]);
+    }
+#endif
+}
+
+/* ---- Timer capabilities ----
+ *
+ * The probe replaces the hardcoded 42 ns (M1 Max 24 MHz) quantum:
+ *   1. spin on back-to-back reads: smallest nonzero step = tick,
+ *      elapsed / reads = read cost, OR of all readings = dead LSBs;
+ *   2. time the calibrated workload and histogram deltas in ticks.
+ * Both loops stop at PHIT_TIMER_PROBE_NS or PHIT_TIMER_PROBE_SAMPLES.
+ */
+
+static phit_timer_caps_t phit__caps;
+/* Published caps are immutable. phit__caps_live is NULL until the first
+ * publication; phit__caps_claim (0 -> 1) picks the one caller that fills
+ * phit__caps, so probes are single-flight and nothing is written while
+ * readers hold it. */
+static phit_timer_caps_t *phit__caps_live = NULL;
+static uint64_t phit__caps_claim = 0;
+
+void phit_timer_probe(phit_timer_caps_t *caps) {
+    memset(caps, 0, sizeof(phit_timer_caps_t));
+#if defined(PHIT__TIMER_NS_ONLY)
+    caps->backend = PHIT_TIMER_NS;
+#else
+    caps->backend = PHIT_TIMER_COUNTER;
+#endif
+    uint64_t start = phit_now_ns();
+    uint64_t start_units = phit_now_ticks();
+    uint64_t deadline = start + PHIT_TIMER_PROBE_NS / 2;
+
+    /* Step 1: resolution, read cost, dead LSBs */
+    uint64_t prev = phit_now_ticks();
+    uint64_t first_change = 0, last_change = 0;
+    uint64_t bits = prev;
+    int reads = 0, repeats = 0, changes = 0;
+    for (int i = 0; i < PHIT_TIMER_PROBE_SAMPLES; i++) {
+        uint64_t t = phit_now_ticks();
+        reads++;
+        bits |= t;
+        if (t == prev) {
+            repeats++;
+        } else {
+            if (changes++ == 0) first_change = t;
+            last_change = t;
+            prev = t;
+        }
+        if ((i & 63) == 63 && phit_now_ns() >= deadline) break;
+    }
+    uint64_t mid = phit_now_ns();
+    uint64_t mid_units = phit_now_ticks();
+
+    caps->ns_per_unit = mid_units > start_units
+        ? (double)(mid - start) / (double)(mid_units - start_units) : 1.0;
+    uint64_t acc = 0;
+    uint64_t r0 = phit_now_ns();
+    for (int i = 0; i < 1024; i++) acc += phit_now_ticks();
+    caps->read_ns = (double)(phit_now_ns() - r0) / 1024.0;
+    phit__sink = acc;
+    /* Repeated readings mean reads outpace the clock and every tick edge
+     * is seen, so the mean edge spacing is the tick (41.67 ns on M1 Max,
+     * even though ns values step by 41 or 42). Otherwise the clock is
+     * finer than one read and every unit of a delta carries information. */
+    if (repeats * 4 > reads && changes > 1) {
+        caps->tick = (double)(last_change - first_change) / (double)(changes - 1);
+    } else {
+        caps->tick = 1.0;
+    }
+    int shift = 0;
+    while (shift < 16 && !(bits & (1ULL << shift))) shift++;
+    caps->lsb_shift = shift;
+    /* A counter that only steps by 2^shift cannot resolve less */
+    if (caps->tick < (double)(1u << shift)) caps->tick = (double)(1u << shift);
+    caps->tick_ns = caps->tick * caps->ns_per_unit;
+    caps->tick_mul = (uint64_t)(4294967296.0 / caps->tick);
+
+    /* Step 2: workload delta distribution in ticks */
+    enum { LEVELS = 256 };
+    uint32_t hist[LEVELS] = {0};
+    uint64_t sum = 0;
+    int n = 0;
+    deadline = start + PHIT_TIMER_PROBE_NS;
+    for (int i = 0; i < PHIT_TIMER_PROBE_SAMPLES; i++) {
+        uint64_t t1 = phit_now_ticks();
+        phit_workload();
+        uint64_t t2 = phit_now_ticks();
+        uint64_t q = ((t2 - t1) * caps->tick_mul + (1ULL << 31)) >> 32;
+        if (q >= LEVELS) q = LEVELS - 1;
+        hist[q]++;
+        sum += q;
+        n++;
+        if ((i & 63) == 63 && phit_now_ns() >= deadline) break;
+    }
+    for (int l = 0; l < LEVELS; l++) {
+        if (!hist[l]) continue;
+        double p = (double)hist[l] / n;
+        caps->delta_levels++;
+        caps->delta_entropy -= p * log2(p);
+    }
+    caps->delta_mean = (double)sum / n;
+    caps->probe_cost_ns = phit_now_ns() - start;
+}
+
+static void phit__caps_normalize(phit_timer_caps_t *c) {
+    if (c->tick < 1.0) c->tick = 1.0;
+    c->tick_mul = (uint64_t)(4294967296.0 / c->tick);
+}
+
+/* 1 when this caller claimed phit__caps; 0 once someone else has */
+static int phit__caps_claim_first(void) {
+    uint64_t idle = 0;
+    while (PHIT__PEEK64(&phit__caps_claim) == 0) {
+        if (PHIT__CAS64(&phit__caps_claim, idle, 1)) return 1;
+        idle = 0;
+    }
+    return 0;
+}
+
+/* Install caps unless some are published or being probed; for cached
+ * calibrations that are as valid as a fresh probe (phit_calib.h) */
+static int phit__timer_caps_offer(const phit_timer_caps_t *caps) {
+    if (!phit__caps_claim_first()) return 0;
+    phit__caps = *caps;
+    phit__caps_normalize(&phit__caps);
+    (void)PHIT__XCHG_PTR(&phit__caps_live, &phit__caps);
+    return 1;
+}
+
+/* Replacing live caps publishes a fresh copy; the superseded one is never
+ * freed, since readers may still hold it */
+void phit_timer_caps_set(const phit_timer_caps_t *caps) {
+    if (phit__timer_caps_offer(caps)) return;
+    phit_timer_caps_t *c = malloc(sizeof(phit_timer_caps_t));
+    if (!c) return;
+    *c = *caps;
+    phit__caps_normalize(c);
+    (void)PHIT__XCHG_PTR(&phit__caps_live, c);
+}
+
+/* The first caller probes; concurrent first callers wait for its result */
+const phit_timer_caps_t *phit_timer_caps(void) {
+    phit_timer_caps_t *live = PHIT__LOAD_PTR(&phit__caps_live);
+    if (live) return live;
+    if (phit__caps_claim_first()) {
+        phit_timer_probe(&phit__caps);
+        phit__caps_normalize(&phit__caps);
+        /* A phit_timer_caps_set meanwhile published its own copy: keep it */
+        phit_timer_caps_t *none = NULL;
+        (void)PHIT__CAS_PTR(&phit__caps_live, none, &phit__caps);
+    }
+    while (!(live = PHIT__LOAD_PTR(&phit__caps_live))) phit__yield();
+    return live;
+}
+
 /* ---- Quantize delta to timer ticks ---- */
 
-static inline int phit__quantize(uint64_t delta_ns) {
-    return (int)((delta_ns + 21) / 42);
+static inline int phit__quantize(uint64_t delta) {
+    return (int)((delta * phit_timer_caps()->tick_mul + (1ULL << 31)) >> 32);
+}
+
+int phit_quantize(uint64_t delta) {
+    return phit__quantize(delta);
+}
+
+/* Timestamp with dead low bits removed, for sampling keys */
+static inline uint64_t phit__sample_now(void) {
+    return phit_now_ticks() >> phit_timer_caps()->lsb_shift;
 }
 
 /* ---- Core sampling ---- */
 
 uint32_t phit_sample(void) {
+    PHIT__STAT_BEGIN(PHIT_STAT_SAMPLE);
     /* Workload with timer-seeded variation */
     volatile uint64_t x = 0xDEADBEEF;
-    for (int i = 0; i < 10; i++) {
-        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-    }
+    PHIT__WL_LCG(x, 10);
     phit__sink = x;
 
-    uint64_t t = phit_now_ns();
+    uint64_t t = phit__sample_now();
     /* Combine timer LSBs (uniform) with workload result (phase-dependent) */
     uint32_t key = (uint32_t)((t & 0x3) | (((uint32_t)(t >> 2) ^ (uint32_t)x) << 2));
+    PHIT__STAT_END(PHIT_STAT_SAMPLE);
     return phit_hash32(key);
 }
 
 uint32_t phit_sample_compound(int num_reads) {
+    PHIT__STAT_BEGIN(PHIT_STAT_COMPOUND);
     uint32_t key = 0;
     for (int i = 0; i < num_reads; i++) {
         volatile uint64_t x = 0xDEADBEEF ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL);
-        for (int j = 0; j < 10; j++) {
-            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-        }
+        PHIT__WL_LCG(x, 10);
         phit__sink = x;
 
-        uint64_t t = phit_now_ns();
+        uint64_t t = phit__sample_now();
         uint32_t sample = (uint32_t)((t & 0x3) | (((uint32_t)(t >> 2) ^ (uint32_t)x) << 2));
         key ^= phit_hash32(sample + (uint32_t)i);
         key = (key << 7) | (key >> 25);  /* rotate to spread bits */
     }
+    PHIT__STAT_END(PHIT_STAT_COMPOUND);
     return phit_hash32(key);
 }
 
-/* ---- Routing ---- */
+/* ---- Batch sampling ----
+ *
+ * Same key formula as phit_sample / phit_sample_compound, in two passes:
+ *   1. timer reads only, separated by a short running volatile LCG chain
+ *      (no per-read warm-up rebuild, no function call per sample);
+ *   2. combine + phit_hash32 over the collected timestamps, read-major so
+ *      each inner loop is a straight vectorizable pass over samples.
+ * Only the low 32 timestamp bits enter the key, so they are stored as u32.
+ */
 
-int phit_route(int num_destinations) {
-    /* Use compound sampling (N=2) for adequate entropy.
-     * Single reads produce too few distinct levels for uniform routing. */
-    return (int)(phit_sample_compound(2) % (uint32_t)num_destinations);
+/* Non-volatile replica of the 10-iteration warm-up: its value is fixed */
+static inline uint32_t phit__warmup_value(uint64_t x) {
+    for (int j = 0; j < 10; j++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return (uint32_t)x;
 }
 
-/* ---- Entropy pool ---- */
+static inline uint32_t phit__combine(uint32_t t, uint32_t x) {
+    return (t & 0x3) | (((t >> 2) ^ x) << 2);
+}
 
-void phit_pool_init(phit_pool_t *p) {
+/* Take n * reads timestamps in time order; read i of sample k lands at
+ * ts[i * n + k] so the hashing pass walks memory contiguously. */
+static void phit__collect_timestamps(uint32_t *ts, int n, int reads) {
+    int shift = phit_timer_caps()->lsb_shift;
+    volatile uint64_t x = phit__sink;
+    for (int k = 0; k < n; k++) {
+        for (int i = 0; i < reads; i++) {
+            for (int j = 0; j < PHIT_BATCH_SPACER_ITERS; j++) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            ts[i * n + k] = (uint32_t)(phit_now_ticks() >> shift);
+        }
+    }
+    phit__sink = x;
+}
+
+void phit_sample_batch(uint32_t *out, int count) {
+    uint32_t x = phit__warmup_value(0xDEADBEEF);
+    while (count > 0) {
+        int n = count < PHIT_BATCH_CHUNK ? count : PHIT_BATCH_CHUNK;
+        phit__collect_timestamps(out, n, 1);
+        for (int k = 0; k < n; k++) {
+            out[k] = phit_hash32(phit__combine(out[k], x));
+        }
+        out += n;
+        count -= n;
+    }
+}
+
+void phit_sample_compound_batch(uint32_t *out, int count, int num_reads) {
+    if (num_reads <= 0) {
+        for (int k = 0; k < count; k++) out[k] = phit_hash32(0);
+        return;
+    }
+    if (num_reads > PHIT_BATCH_CHUNK) {
+        for (int k = 0; k < count; k++) out[k] = phit_sample_compound(num_reads);
+        return;
+    }
+
+    uint32_t ts[PHIT_BATCH_CHUNK];
+    int per_chunk = PHIT_BATCH_CHUNK / num_reads;
+    while (count > 0) {
+        int n = count < per_chunk ? count : per_chunk;
+        phit__collect_timestamps(ts, n, num_reads);
+
+        for (int k = 0; k < n; k++) out[k] = 0;
+        for (int i = 0; i < num_reads; i++) {
+            uint32_t x = phit__warmup_value(0xDEADBEEF ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL));
+            const uint32_t *tr = ts + i * n;
+            for (int k = 0; k < n; k++) {
+                uint32_t key = out[k] ^ phit_hash32(phit__combine(tr[k], x) + (uint32_t)i);
+                out[k] = (key << 7) | (key >> 25);
+            }
+        }
+        for (int k = 0; k < n; k++) out[k] = phit_hash32(out[k]);
+
+        out += n;
+        count -= n;
+    }
+}
+
+/* ---- Sampler kernels ----
+ *
+ * PHIT__SAMPLER_DEFINE expands one PHIT_SAMPLERS entry into a sampler with
+ * the phit_sample_compound() key formula and a delta probe, both with the
+ * workload, its trip count and the read count fixed at compile time. The
+ * table below lists them in PHIT_SAMPLERS order; selection only changes
+ * which entry phit_sample_selected() calls.
+ */
+
+#define PHIT__SAMPLER_DEFINE(kind, iters, reads) \
+    static uint32_t phit__sampler_##kind##_##iters##_##reads(void) { \
+        uint32_t key = 0; \
+        for (int i = 0; i < (reads); i++) { \
+            volatile uint64_t x = 0xDEADBEEF ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL); \
+            PHIT__WL_##kind(x, iters); \
+            phit__sink = x; \
+            uint32_t sample = phit__combine((uint32_t)phit__sample_now(), (uint32_t)x); \
+            key ^= phit_hash32(sample + (uint32_t)i); \
+            key = (key << 7) | (key >> 25); \
+        } \
+        return phit_hash32(key); \
+    } \
+    static uint64_t phit__sampler_##kind##_##iters##_##reads##_delta(void) { \
+        volatile uint64_t x = 0xDEADBEEF; \
+        uint64_t t1 = phit_now_ticks(); \
+        PHIT__WL_##kind(x, iters); \
+        uint64_t t2 = phit_now_ticks(); \
+        phit__sink = x; \
+        return t2 - t1; \
+    }
+
+#define PHIT__SAMPLER_ENTRY(kind, iters, reads) \
+    { #kind "-" #iters "x" #reads, PHIT_WL_##kind, iters, reads, \
+      phit__sampler_##kind##_##iters##_##reads, phit__sampler_##kind##_##iters##_##reads##_delta },
+
+PHIT_SAMPLERS(PHIT__SAMPLER_DEFINE)
+
+static const phit_sampler_t phit__samplers[] = { PHIT_SAMPLERS(PHIT__SAMPLER_ENTRY) };
+
+#define PHIT__SAMPLER_COUNT ((int)(sizeof(phit__samplers) / sizeof(phit__samplers[0])))
+
+/* Index into phit__samplers, -1 until phit_sampler_select */
+static int phit__sampler_index = -1;
+
+int phit_sampler_count(void) {
+    return PHIT__SAMPLER_COUNT;
+}
+
+const phit_sampler_t *phit_sampler_get(int index) {
+    return index >= 0 && index < PHIT__SAMPLER_COUNT ? &phit__samplers[index] : NULL;
+}
+
+const char *phit_workload_name(int kind) {
+    static const char *names[PHIT_WL_KINDS] = { "nop", "lcg", "mix", "mem", "branch" };
+    return kind >= 0 && kind < PHIT_WL_KINDS ? names[kind] : "?";
+}
+
+/* Give PHIT_WL_MEM distinct bytes to chase; racing fills write the same */
+static void phit__wl_table_fill(void) {
+    static int filled = 0;
+    if (PHIT__LOAD_ACQUIRE(&filled)) return;
+    for (int i = 0; i < PHIT__WL_TABLE; i++) {
+        phit__wl_table[i] = (uint8_t)phit_hash32((uint32_t)i);
+    }
+    PHIT__STORE_RELEASE(&filled, 1);
+}
+
+/* ns per sample() call over about `reads` timer reads */
+static double phit__sampler_cost(const phit_sampler_t *k, int reads) {
+    int calls = reads / k->reads > 64 ? reads / k->reads : 64;
+    uint32_t acc = 0;
+    uint64_t t0 = phit_now_ns();
+    for (int i = 0; i < calls; i++) acc += k->sample();
+    double ns = (double)(phit_now_ns() - t0) / calls;
+    phit__sink = acc;
+    return ns;
+}
+
+void phit_sampler_profile(const phit_sampler_t *k, int samples, phit_sampler_profile_t *out) {
+    enum { LEVELS = 256 };
+    uint32_t hist[LEVELS] = {0};
+    memset(out, 0, sizeof(phit_sampler_profile_t));
+    if (samples < 1) samples = PHIT_SAMPLER_PROFILE_SAMPLES;
+    phit__wl_table_fill();
+
+    uint64_t sum = 0;
+    for (int i = 0; i < samples; i++) {
+        uint64_t q = (uint64_t)phit__quantize(k->delta());
+        if (q >= LEVELS) q = LEVELS - 1;
+        hist[q]++;
+        sum += q;
+    }
+    for (int l = 0; l < LEVELS; l++) {
+        if (!hist[l]) continue;
+        double p = (double)hist[l] / samples;
+        out->levels++;
+        out->phits_per_read -= p * log2(p);
+    }
+    out->delta_mean = (double)sum / samples;
+    out->ns_per_key = phit__sampler_cost(k, samples);
+}
+
+const phit_sampler_t *phit_sampler_select(int reads, double target_phits,
+                                          phit_sampler_profile_t *profiles) {
+    if (target_phits <= 0) target_phits = PHIT_SAMPLER_TARGET_PHITS;
+    int any_reads = 1;
+    for (int i = 0; i < PHIT__SAMPLER_COUNT; i++) {
+        if (phit__samplers[i].reads == reads) any_reads = 0;
+    }
+    int best = -1, richest = -1;
+    double best_ns = 0, richest_phits = -1;
+    phit_sampler_profile_t prof[PHIT__SAMPLER_COUNT];
+    for (int i = 0; i < PHIT__SAMPLER_COUNT; i++) {
+        const phit_sampler_t *k = &phit__samplers[i];
+        /* Entropy depends on the workload only: measure it once per
+         * (kind, iters) so read-count variants compare on equal terms */
+        int same = -1;
+        for (int j = 0; j < i && same < 0; j++) {
+            if (phit__samplers[j].kind == k->kind && phit__samplers[j].iters == k->iters) same = j;
+        }
+        if (same < 0) {
+            phit_sampler_profile(k, PHIT_SAMPLER_PROFILE_SAMPLES, &prof[i]);
+        } else {
+            prof[i] = prof[same];
+            prof[i].ns_per_key = phit__sampler_cost(k, PHIT_SAMPLER_PROFILE_SAMPLES);
+        }
+        if (profiles) profiles[i] = prof[i];
+        if (!any_reads && k->reads != reads) continue;
+        if (prof[i].phits_per_read >= target_phits && (best < 0 || prof[i].ns_per_key < best_ns)) {
+            best = i;
+            best_ns = prof[i].ns_per_key;
+        }
+        if (prof[i].phits_per_read > richest_phits) {
+            richest = i;
+            richest_phits = prof[i].phits_per_read;
+        }
+    }
+    if (best < 0) best = richest;
+    if (best >= 0) PHIT__STORE_RELEASE(&phit__sampler_index, best);
+    return phit_sampler_get(best);
+}
+
+const phit_sampler_t *phit_sampler_selected(void) {
+    return phit_sampler_get(PHIT__LOAD_ACQUIRE(&phit__sampler_index));
+}
+
+uint32_t phit_sample_selected(void) {
+    int i = PHIT__LOAD_ACQUIRE(&phit__sampler_index);
+    return i >= 0 ? phit__samplers[i].sample() : phit_sample_compound(2);
+}
+
+/* ---- Adaptive sampling ----
+ *
+ * phit_sample_compound(2) is a fixed guess (experiments/phi_adaptive.c,
+ * test_compound_keys): quiet hosts get enough from one read, noisy VMs
+ * may not from two. The controller keeps a per-thread entropy estimate
+ * and sizes each key from it:
+ *
+ *   reads = ceil(target / phits), capped at PHIT_ADAPT_MAX_READS
+ *
+ * Estimation rides on one key in PHIT_ADAPT_PROBE, which takes one extra
+ * timer read before its first workload so every read yields a workload
+ * delta. Once a window is full the Miller-Madow corrected Shannon entropy
+ * of the histogram becomes the new estimate. A window whose widest target
+ * needs more than PHIT_ADAPT_MAX_READS reads doubles the workload length,
+ * within [PHIT_ADAPT_MIN_ITERS, PHIT_ADAPT_MAX_ITERS]; past that, keys are
+ * capped at the maximum and carry less than asked.
+ * The histogram is halved after every estimate and re-centred on the
+ * window mean, so it follows drift within a few windows.
+ */
+
+static PHIT__TLS phit_adapt_t phit__adapt;
+
+static void phit__adapt_estimate(phit_adapt_t *a) {
+    uint64_t n = 0, sum = 0;
+    int levels = 0;
+    for (int b = 0; b < PHIT_ADAPT_BINS; b++) {
+        n += a->hist[b];
+        sum += (uint64_t)a->hist[b] * (uint64_t)b;
+        levels += a->hist[b] != 0;
+    }
+    double h = 0;
+    for (int b = 0; b < PHIT_ADAPT_BINS; b++) {
+        if (!a->hist[b]) continue;
+        double p = (double)a->hist[b] / (double)n;
+        h -= p * log2(p);
+    }
+    h += (double)(levels - 1) / (2.0 * (double)n * 0.6931471805599453);
+    if (h < 0.05) h = 0.05;   /* a stuck timer still needs a finite read count */
+
+    /* Workload length: double it while the window's widest target runs
+     * out of reads; go back once the shorter length would do, or retry it
+     * every 64 estimates in case the host has quietened */
+    int iters = a->iters;
+    double need = a->target_max;
+    if (need / h > PHIT_ADAPT_MAX_READS && iters * 2 <= PHIT_ADAPT_MAX_ITERS) {
+        a->phits_short = h;
+        a->retry_at = a->estimates + 64;
+        iters *= 2;
+    } else if (iters / 2 >= PHIT_ADAPT_MIN_ITERS &&
+               ((a->phits_short > 0 && need / a->phits_short <= PHIT_ADAPT_MAX_READS) ||
+                a->estimates >= a->retry_at)) {
+        a->phits_short = 0;
+        iters /= 2;
+    }
+
+    /* Halve the history and re-centre it; a changed workload starts over */
+    uint32_t mean = (uint32_t)(a->base + sum / (n ? n : 1));
+    uint32_t base = mean > PHIT_ADAPT_BINS / 2 ? mean - PHIT_ADAPT_BINS / 2 : 0;
+    uint32_t hist[PHIT_ADAPT_BINS] = {0};
+    if (iters == a->iters) {
+        for (int b = 0; b < PHIT_ADAPT_BINS; b++) {
+            int64_t nb = (int64_t)b + (int64_t)a->base - (int64_t)base;
+            if (nb < 0) nb = 0;
+            if (nb >= PHIT_ADAPT_BINS) nb = PHIT_ADAPT_BINS - 1;
+            hist[nb] += a->hist[b] / 2;
+        }
+    }
+    memcpy(a->hist, hist, sizeof(hist));
+    a->base = base;
+    a->iters = iters;
+    a->phits = h;
+    a->inv_phits = 1.0 / h;
+    a->observed = 0;
+    a->target_max = 0;
+    a->estimates++;
+}
+
+static inline int phit__adapt_reads(const phit_adapt_t *a, double target) {
+    if (a->phits <= 0) return 2;
+    int reads = (int)(target * a->inv_phits + 0.999);
+    if (reads < 1) reads = 1;
+    if (reads > PHIT_ADAPT_MAX_READS) reads = PHIT_ADAPT_MAX_READS;
+    return reads;
+}
+
+uint32_t phit_sample_adaptive(double target_phits) {
+    PHIT__STAT_BEGIN(PHIT_STAT_COMPOUND);
+    phit_adapt_t *a = &phit__adapt;
+    if (!a->iters) a->iters = PHIT_ADAPT_MIN_ITERS;
+    int reads = phit__adapt_reads(a, target_phits);
+    int iters = a->iters;
+    int probe = (++a->calls & (PHIT_ADAPT_PROBE - 1)) == 0;
+    if (target_phits > a->target_max) a->target_max = target_phits;
+    int shift = phit_timer_caps()->lsb_shift;
+
+    uint32_t key = 0;
+    uint64_t prev = probe ? phit_now_ticks() : 0;
+    for (int i = 0; i < reads; i++) {
+        volatile uint64_t x = 0xDEADBEEF ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL);
+        PHIT__WL_LCG(x, iters);
+        phit__sink = x;
+        uint64_t t = phit_now_ticks();
+        if (probe) {
+            int64_t bin = (int64_t)phit__quantize(t - prev) - (int64_t)a->base;
+            if (bin < 0) bin = 0;
+            if (bin >= PHIT_ADAPT_BINS) bin = PHIT_ADAPT_BINS - 1;
+            a->hist[bin]++;
+            a->observed++;
+            prev = t;
+        }
+        uint32_t sample = phit__combine((uint32_t)(t >> shift), (uint32_t)x);
+        key ^= phit_hash32(sample + (uint32_t)i);
+        key = (key << 7) | (key >> 25);
+    }
+    if (probe && a->observed >= PHIT_ADAPT_WINDOW) phit__adapt_estimate(a);
+    a->keys++;
+    a->reads += (uint64_t)(reads + probe);
+    PHIT__STAT_END(PHIT_STAT_COMPOUND);
+    return phit_hash32(key);
+}
+
+int phit_adapt_reads(double target_phits) {
+    return phit__adapt_reads(&phit__adapt, target_phits);
+}
+
+void phit_adapt_state(phit_adapt_t *out) {
+    *out = phit__adapt;
+    if (!out->iters) out->iters = PHIT_ADAPT_MIN_ITERS;
+}
+
+void phit_adapt_reset(void) {
+    memset(&phit__adapt, 0, sizeof(phit_adapt_t));
+}
+
+/* Phits a key for n destinations is sized for */
+static inline double phit__route_target(uint32_t n) {
+    int bits = 0;
+    while (bits < 32 && (1ULL << bits) < n) bits++;
+    return (double)bits + PHIT_ADAPT_MARGIN;
+}
+
+#if PHIT_ROUTE_ADAPTIVE
+  #define PHIT__ROUTE_KEY(n) phit_sample_adaptive(phit__route_target(n))
+#else
+  #define PHIT__ROUTE_KEY(n) phit_sample_compound(2)
+#endif
+
+/* ---- Routing ---- */
+
+int phit_route(int num_destinations) {
+    /* Compound sampling for adequate entropy: single reads produce too
+     * few distinct levels for uniform routing on most hosts, so the read
+     * count follows the thread's delta entropy (PHIT_ROUTE_ADAPTIVE). */
+    if (num_destinations < 2) return 0;
+    PHIT__STAT_BEGIN(PHIT_STAT_ROUTE);
+    uint32_t n = (uint32_t)num_destinations;
+    uint64_t m = (uint64_t)PHIT__ROUTE_KEY(n) * n;
+    if ((uint32_t)m < n) {
+        /* p < n / 2^32: reject the 2^32 mod n low values that would bias */
+        uint32_t t = (0u - n) % n;
+        while ((uint32_t)m < t) {
+            PHIT__STAT_EVENT(PHIT_EVENT_ROUTE_REJECT);
+            m = (uint64_t)PHIT__ROUTE_KEY(n) * n;
+        }
+    }
+    PHIT__STAT_END(PHIT_STAT_ROUTE);
+    return (int)(m >> 32);
+}
+
+uint32_t phit_route_key(int num_destinations) {
+    return PHIT__ROUTE_KEY(num_destinations < 2 ? 2u : (uint32_t)num_destinations);
+}
+
+void phit_route_pair(int num_destinations, int *first, int *second) {
+    if (num_destinations < 2) {
+        *first = *second = 0;
+        return;
+    }
+    /* 16 bits per candidate; the second skips the first so they differ */
+    uint32_t key = phit_sample_compound(2);
+    int a = (int)(((key & 0xFFFF) * (uint32_t)num_destinations) >> 16);
+    int b = (int)(((key >> 16) * (uint32_t)(num_destinations - 1)) >> 16);
+    *first = a;
+    *second = b >= a ? b + 1 : b;
+}
+
+int phit_route2(const phit_load_t *loads, int num_destinations) {
+    int a, b;
+    phit_route_pair(num_destinations, &a, &b);
+    return PHIT__LOAD_RELAXED64(&loads[b].depth) < PHIT__LOAD_RELAXED64(&loads[a].depth) ? b : a;
+}
+
+void phit_load_add(phit_load_t *load, int64_t delta) {
+    PHIT__ADD_RELAXED64(&load->depth, delta);
+}
+
+/* ---- CDF router ----
+ *
+ * Calibration is incremental: phit_router_calibrate() takes at most
+ * `budget` samples per call, and phit_router_route() keeps feeding the
+ * histogram with its own readings until calib_target is reached. Until
+ * then routes fall back to hashing the same reading, so startup never
+ * blocks on the full sample count. Split deltas take their tie-break
+ * from the hashed end timestamp, the same LSB source phit_sample uses.
+ *
+ * The delta distribution shifts with the caller's loop and with DVFS
+ * (the non-stationarity finding in phi_uniform.c), so once ready the
+ * router keeps observing its own deltas and rebuilds every
+ * PHIT_ROUTER_TRACK_WINDOW routes, decaying older history to half a
+ * window's weight each time.
+ */
+
+int phit_router_init(phit_router_t *r, int num_slots, uint32_t calib_samples) {
+    memset(r, 0, sizeof(phit_router_t));
+    if (num_slots < 1 || num_slots >= PHIT_ROUTER_SPLIT) return 0;
+    r->num_slots = num_slots;
+    r->calib_target = calib_samples ? calib_samples : PHIT_ROUTER_CALIB_SAMPLES;
+    return 1;
+}
+
+/* Workload delta in timer ticks (phit_timer_caps), the router's index */
+uint64_t phit_router_delta(void) {
+    uint64_t t1 = phit_now_ticks();
+    phit_workload();
+    uint64_t t2 = phit_now_ticks();
+    return (uint64_t)phit__quantize(t2 - t1);
+}
+
+/* Rescale the histogram to about `target` samples of history, so the
+ * next window of observations outweighs everything before it. */
+static void phit__router_decay(phit_router_t *r, uint32_t target) {
+    if (r->calib_count <= target) return;
+    double f = (double)target / (double)r->calib_count;
+    uint32_t total = 0;
+    for (int d = 0; d < PHIT_ROUTER_MAX_DELTA; d++) {
+        r->hist[d] = (uint32_t)((double)r->hist[d] * f + 0.5);
+        total += r->hist[d];
+    }
+    r->calib_count = total;
+    r->since_rebuild = 0;
+}
+
+static void phit__router_observe(phit_router_t *r, uint64_t delta) {
+    /* Out-of-range deltas are clamped by routing, so count them in the last bin */
+    if (delta >= PHIT_ROUTER_MAX_DELTA) delta = PHIT_ROUTER_MAX_DELTA - 1;
+    r->hist[delta]++;
+    r->calib_count++;
+    if (!r->ready) {
+        if (r->calib_count < r->calib_target) return;
+    } else if (!PHIT_ROUTER_TRACK_WINDOW || ++r->since_rebuild < PHIT_ROUTER_TRACK_WINDOW) {
+        return;
+    }
+    phit_router_rebuild(r);
+    if (PHIT_ROUTER_TRACK_WINDOW) phit__router_decay(r, PHIT_ROUTER_TRACK_WINDOW / 2);
+}
+
+/* Delta d owns the CDF interval [F(d-1), F(d)) scaled to 2^16; it maps
+ * straight to a slot when that interval lies inside one slot. */
+void phit_router_rebuild(phit_router_t *r) {
+    if (r->calib_count == 0) return;
+    uint64_t K = (uint64_t)r->num_slots;
+    double scale = 65536.0 / (double)r->calib_count;
+    uint64_t cumulative = 0;
+    uint64_t hi = 0;
+    for (int d = 0; d < PHIT_ROUTER_MAX_DELTA; d++) {
+        uint64_t lo = hi;
+        cumulative += r->hist[d];
+        hi = (uint64_t)((double)cumulative * scale);
+        if (hi > 65536) hi = 65536;
+        uint64_t span = hi - lo;
+
+        uint64_t first = (lo * K) >> 16;
+        uint64_t last = span ? ((hi - 1) * K) >> 16 : first;
+        if (first >= K) first = K - 1;
+        if (last >= K) last = K - 1;
+
+        r->cdf_lo[d] = (uint16_t)(lo > 0xFFFF ? 0xFFFF : lo);
+        r->cdf_span[d] = (uint16_t)(span > 0xFFFF ? 0xFFFF : span);
+        r->slot_map[d] = (uint8_t)(first == last ? first : PHIT_ROUTER_SPLIT);
+    }
+    r->ready = 1;
+}
+
+int phit_router_calibrate(phit_router_t *r, int budget) {
+    for (int i = 0; i < budget && !r->ready; i++) {
+        phit__router_observe(r, phit_router_delta());
+    }
+    return r->ready;
+}
+
+int phit_router_route(phit_router_t *r) {
+    uint64_t t1 = phit_now_ticks();
+    phit_workload();
+    uint64_t t2 = phit_now_ticks();
+    uint64_t delta = (uint64_t)phit__quantize(t2 - t1);
+    int was_ready = r->ready;
+    if (PHIT_ROUTER_TRACK_WINDOW || !was_ready) phit__router_observe(r, delta);
+    if (was_ready) return phit_router_slot(r, delta, phit_hash32((uint32_t)t2));
+
+    PHIT__STAT_EVENT(PHIT_EVENT_ROUTER_FALLBACK);
+    uint32_t key = phit_hash32(phit__combine((uint32_t)t2, (uint32_t)delta));
+    return (int)phit_reduce32(key, (uint32_t)r->num_slots);
+}
+
+/* ---- Health tests ----
+ *
+ * Repetition count: a run of one raw value reaching the cutoff. Adaptive
+ * proportion: the first value of each window recurring cutoff times in
+ * it. Both compare against a single stored value, so a sample costs two
+ * compares and a few increments; failures are the only shared writes. */
+
+static uint64_t phit__health_failures;
+
+uint32_t phit_health_update(phit_health_t *h, uint64_t sample) {
+    uint32_t raised = 0;
+    h->samples++;
+    if (h->rct_run && sample == h->rct_value) {
+        if (++h->rct_run == PHIT_HEALTH_RCT_CUTOFF) raised |= PHIT_HEALTH_RCT;
+    } else {
+        h->rct_value = sample;
+        h->rct_run = 1;
+    }
+    if (h->apt_index == 0) {
+        h->apt_value = sample;
+        h->apt_count = 1;
+    } else if (sample == h->apt_value) {
+        if (++h->apt_count == PHIT_HEALTH_APT_CUTOFF) raised |= PHIT_HEALTH_APT;
+    }
+    if (++h->apt_index == PHIT_HEALTH_APT_WINDOW) h->apt_index = 0;
+
+    if (raised) {
+        h->flags |= raised;
+        h->failures++;
+        PHIT__ADD_RELAXED64(&phit__health_failures, 1);
+        PHIT__STAT_EVENT(PHIT_EVENT_HEALTH_FAIL);
+    }
+    return raised;
+}
+
+int phit_pool_health(const phit_pool_t *p) {
+    return (int)p->health.flags;
+}
+
+void phit_pool_health_clear(phit_pool_t *p) {
+    p->health.flags = 0;
+}
+
+uint64_t phit_health_failures(void) {
+    return (uint64_t)PHIT__LOAD_RELAXED64(&phit__health_failures);
+}
+
+/* ---- Entropy pool ---- */
+
+void phit_pool_init(phit_pool_t *p) {
     memset(p, 0, sizeof(phit_pool_t));
 }
 
+/* Each feed touches one lane only, so the next three feeds do not wait on
+ * its read-modify-write and their hashes overlap in the pipeline; the
+ * lanes are combined at extraction. */
 void phit_pool_feed(phit_pool_t *p, uint64_t sample) {
-    p->mix_counter++;
+    uint64_t n = ++p->mix_counter;
 
-    uint64_t z = sample + p->mix_counter * 0x9E3779B97F4A7C15ULL;
+    uint64_t z = sample + n * 0x9E3779B97F4A7C15ULL;
     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
     z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
     z = z ^ (z >> 31);
 
-    int slot = (int)(p->mix_counter & 3);
-    p->pool[slot] ^= z;
-    p->pool[(slot + 1) & 3] ^= phit__rotl64(p->pool[slot], 17);
+    uint64_t *lane = &p->pool[n & 3];
+    *lane = phit__rotl64(*lane, 17) ^ z;
 
     p->bits_collected += 2;
 }
 
 void phit_pool_harvest(phit_pool_t *p) {
+    PHIT__STAT_BEGIN(PHIT_STAT_HARVEST);
     volatile uint64_t x = 0xCAFEBABE;
-    for (int i = 0; i < PHIT_WORKLOAD_ITERS; i++) {
-        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-        x ^= x >> 17;
-    }
+    PHIT__WL_MIX(x, PHIT_WORKLOAD_ITERS);
     phit__sink = x;
 
-    uint64_t t = phit_now_ns();
+    uint64_t t = phit_now_ticks();
+#if PHIT_HEALTH_TESTS
+    /* The raw delta since the previous harvest, before any hashing */
+    if (p->last_ticks) phit_health_update(&p->health, t - p->last_ticks);
+    p->last_ticks = t;
+#endif
     phit_pool_feed(p, t);
     phit_pool_feed(p, (uint64_t)x ^ t);
+    PHIT__STAT_END(PHIT_STAT_HARVEST);
 }
 
 uint64_t phit_pool_extract(phit_pool_t *p) {
+    PHIT__STAT_BEGIN(PHIT_STAT_EXTRACT);
     for (int i = 0; i < PHIT_POOL_LANES; i++) {
         phit_pool_harvest(p);
     }
@@ -291,9 +2104,466 @@ uint64_t phit_pool_extract(phit_pool_t *p) {
     p->pool[0] ^= phit__rotl64(out, 7);
     p->pool[1] ^= phit__rotl64(out, 23);
 
+    PHIT__STAT_END(PHIT_STAT_EXTRACT);
+    return out;
+}
+
+/* ---- Shared pool ----
+ *
+ * Slots are indexed by the current CPU where the platform reports it
+ * (GetCurrentProcessorNumber, sched_getcpu with _GNU_SOURCE) and by a
+ * per-thread index otherwise. A feed harvests into a private pool and
+ * XORs it into the slot, so threads sharing a slot never lose each
+ * other's input; the thread that fills a slot folds it into the
+ * accumulator. Folds are whitened with their position in the harvest
+ * count, so equal contributions cannot cancel. */
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+  #include <sched.h>
+#endif
+
+typedef struct {
+    uint64_t lane[4];
+    uint64_t pending;               /* harvests not yet folded */
+    char     pad[PHIT_CACHE_LINE - 5 * sizeof(uint64_t)];
+} phit__shared_slot_t;
+
+static PHIT__ALIGNED(PHIT_CACHE_LINE) phit__shared_slot_t phit__shared_slots[PHIT_SHARED_SLOTS];
+
+static PHIT__ALIGNED(PHIT_CACHE_LINE) struct {
+    uint64_t lane[4];               /* accumulator */
+    char     pad0[PHIT_CACHE_LINE - 4 * sizeof(uint64_t)];
+    uint64_t harvests;              /* folded so far */
+    uint64_t tickets;               /* extractions so far */
+    uint64_t threads;               /* slot index fallback */
+    uint64_t boot;                  /* 0 idle, 1 bootstrapping, 2 bootstrapped */
+} phit__shared;
+
+static int phit__shared_slot(void) {
+#if defined(_WIN32)
+    return (int)(GetCurrentProcessorNumber() % PHIT_SHARED_SLOTS);
+#else
+  #if defined(__linux__) && defined(_GNU_SOURCE)
+    int cpu = sched_getcpu();
+    if (cpu >= 0) return cpu % PHIT_SHARED_SLOTS;
+  #endif
+    static PHIT__TLS int index = -1;
+    if (index < 0) index = (int)(PHIT__FETCH_ADD64(&phit__shared.threads, 1) % PHIT_SHARED_SLOTS);
+    return index;
+#endif
+}
+
+static void phit__shared_fold(phit__shared_slot_t *s) {
+    uint64_t n = PHIT__XCHG64(&s->pending, 0);
+    if (n == 0) return;
+    uint64_t base = PHIT__FETCH_ADD64(&phit__shared.harvests, n);
+    for (int i = 0; i < 4; i++) {
+        uint64_t v = PHIT__XCHG64(&s->lane[i], 0);
+        PHIT__XOR64(&phit__shared.lane[i], phit_hash64(v ^ ((base + (uint64_t)i) * PHIT__WEYL)));
+    }
+}
+
+/* Feed pools are per call; the health state outlives them per thread */
+static PHIT__TLS phit_health_t phit__shared_health;
+
+static void phit__shared_feed(int harvests, int fold_now) {
+    phit_pool_t local;
+    phit_pool_init(&local);
+    local.health = phit__shared_health;
+    for (int i = 0; i < harvests; i++) phit_pool_harvest(&local);
+    phit__shared_health = local.health;
+
+    phit__shared_slot_t *s = &phit__shared_slots[phit__shared_slot()];
+    for (int i = 0; i < 4; i++) PHIT__XOR64(&s->lane[i], local.pool[i]);
+    uint64_t pending = PHIT__FETCH_ADD64(&s->pending, (uint64_t)harvests) + (uint64_t)harvests;
+    if (fold_now || pending >= PHIT_SHARED_FOLD) phit__shared_fold(s);
+}
+
+void phit_shared_feed(int harvests) {
+    if (harvests > 0) phit__shared_feed(harvests, 0);
+}
+
+uint64_t phit_shared_harvests(void) {
+    return (uint64_t)PHIT__LOAD_RELAXED64(&phit__shared.harvests);
+}
+
+/* Until PHIT_SHARED_MIN_HARVESTS are folded, one caller harvests the
+ * deficit inline and the others wait for it rather than harvest too */
+static void phit__shared_bootstrap(void) {
+    uint64_t idle = 0, spins = 0;
+    while (PHIT__PEEK64(&phit__shared.boot) == 0) {
+        if (PHIT__CAS64(&phit__shared.boot, idle, 1)) {
+            uint64_t have = phit_shared_harvests();
+            if (have < PHIT_SHARED_MIN_HARVESTS) {
+                PHIT__STAT_EVENT(PHIT_EVENT_SHARED_BOOTSTRAP);
+                phit__shared_feed((int)(PHIT_SHARED_MIN_HARVESTS - have), 1);
+            }
+            PHIT__STORE64(&phit__shared.boot, 2);
+            return;
+        }
+        idle = 0;
+    }
+    while (PHIT__LOAD64(&phit__shared.boot) != 2 &&
+           phit_shared_harvests() < PHIT_SHARED_MIN_HARVESTS) {
+        PHIT__PAUSE();
+        if ((++spins & 63) == 0) phit__yield();
+    }
+}
+
+uint64_t phit_shared_extract(void) {
+    if (phit_shared_harvests() < PHIT_SHARED_MIN_HARVESTS) phit__shared_bootstrap();
+
+    uint64_t ticket = PHIT__FETCH_ADD64(&phit__shared.tickets, 1);
+    uint64_t l[4];
+    for (int i = 0; i < 4; i++)
+        l[i] = (uint64_t)PHIT__LOAD_RELAXED64(&phit__shared.lane[i]);
+    uint64_t out = l[0];
+    out ^= phit__rotl64(l[1], 13);
+    out ^= phit__rotl64(l[2], 29);
+    out ^= phit__rotl64(l[3], 43);
+    out = phit_hash64(out ^ phit_hash64(ticket * PHIT__WEYL));
+
+    /* Forward-secure: later extractions see a mutated accumulator */
+    PHIT__XOR64(&phit__shared.lane[ticket & 3], phit__rotl64(out, 7));
     return out;
 }
 
+/* ---- Background harvester ----
+ *
+ * Single producer (the harvester thread), many consumers: consumers claim
+ * the head slot with a CAS (Vyukov sequence numbers as in phit_exec.h),
+ * so a pop never blocks or syscalls. After each refill burst the thread
+ * sleeps busy * (100 - duty) / duty, which caps its CPU share, and while
+ * the ring is full it polls every PHIT_HARVESTER_IDLE_US. */
+
+typedef char phit__harvester_ring_pow2[(PHIT_HARVESTER_RING & (PHIT_HARVESTER_RING - 1)) == 0 ? 1 : -1];
+
+typedef struct {
+    uint64_t seq;
+    uint64_t word;
+} phit__hv_slot_t;
+
+static phit__hv_slot_t phit__hv_slots[PHIT_HARVESTER_RING];
+
+static PHIT__ALIGNED(PHIT_CACHE_LINE) struct {
+    uint64_t       tail;            /* harvester thread */
+    char           pad0[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t       head;            /* consumers */
+    char           pad1[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t       underruns;       /* consumers, empty pops only */
+    char           pad2[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t       state;           /* 0 stopped, 1 running, 2 starting/stopping */
+    uint64_t       ready;           /* ring and sync objects initialized */
+    uint64_t       busy_ns;
+    uint64_t       start_ns;
+    uint64_t       rate;            /* words/s, last burst */
+    int            duty;
+    phit__thread_t thread;
+    phit__mutex_t  mu;
+    phit__cond_t   cv;
+} phit__hv;
+
+/* Sleep that phit_harvester_stop() can cut short */
+static void phit__hv_sleep(uint64_t us) {
+    phit__mutex_lock(&phit__hv.mu);
+    if (PHIT__LOAD64(&phit__hv.state) == 1) phit__cond_wait_us(&phit__hv.cv, &phit__hv.mu, (long)us);
+    phit__mutex_unlock(&phit__hv.mu);
+}
+
+static void phit__hv_loop(void) {
+    const uint64_t mask = PHIT_HARVESTER_RING - 1;
+    phit_pool_t pool;
+    phit_pool_init(&pool);
+    for (int i = 0; i < PHIT_PRNG_SEED_ROUNDS; i++) phit_pool_harvest(&pool);
+
+    while (PHIT__LOAD64(&phit__hv.state) == 1) {
+        uint64_t tail = phit__hv.tail;
+        uint64_t room = PHIT_HARVESTER_RING - (tail - PHIT__LOAD64(&phit__hv.head));
+        if (room == 0) {
+            phit__hv_sleep(PHIT_HARVESTER_IDLE_US);
+            continue;
+        }
+        if (room > PHIT_HARVESTER_BURST) room = PHIT_HARVESTER_BURST;
+        uint64_t t0 = phit_now_ns(), n = 0;
+        for (; n < room; n++) {
+            phit__hv_slot_t *slot = &phit__hv_slots[tail & mask];
+            if (PHIT__LOAD64(&slot->seq) != tail) break;     /* consumer mid-read */
+            slot->word = phit_pool_extract(&pool);
+            PHIT__STORE64(&slot->seq, tail + 1);
+            tail++;
+        }
+        PHIT__STORE64(&phit__hv.tail, tail);
+        uint64_t busy = phit_now_ns() - t0;
+        PHIT__STORE64(&phit__hv.busy_ns, phit__hv.busy_ns + busy);
+        if (busy) PHIT__STORE64(&phit__hv.rate, n * 1000000000ULL / busy);
+
+        uint64_t rest_ns = busy * (uint64_t)(100 - phit__hv.duty) / (uint64_t)phit__hv.duty;
+        if (n == 0) rest_ns = PHIT_HARVESTER_IDLE_US * 1000ULL;
+        if (rest_ns >= 1000) phit__hv_sleep(rest_ns / 1000);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI phit__hv_main(LPVOID arg) {
+    (void)arg;
+    phit__hv_loop();
+    return 0;
+}
+#else
+static void *phit__hv_main(void *arg) {
+    (void)arg;
+    phit__hv_loop();
+    return NULL;
+}
+#endif
+
+int phit_harvester_start(int duty_percent) {
+    uint64_t idle = 0;
+    if (!PHIT__CAS64(&phit__hv.state, idle, 2)) return PHIT__LOAD64(&phit__hv.state) == 1;
+    if (!phit__hv.ready) {
+        for (uint64_t i = 0; i < PHIT_HARVESTER_RING; i++) phit__hv_slots[i].seq = i;
+        phit__mutex_init(&phit__hv.mu);
+        phit__cond_init(&phit__hv.cv);
+        PHIT__STORE64(&phit__hv.ready, 1);
+    }
+    if (duty_percent <= 0) duty_percent = PHIT_HARVESTER_DUTY;
+    phit__hv.duty = duty_percent > 100 ? 100 : duty_percent;
+    PHIT__STORE64(&phit__hv.busy_ns, 0);
+    phit__hv.start_ns = phit_now_ns();
+    PHIT__STORE64(&phit__hv.state, 1);
+#if defined(_WIN32)
+    phit__hv.thread = CreateThread(NULL, 0, phit__hv_main, NULL, 0, NULL);
+    int ok = phit__hv.thread != NULL;
+#else
+    int ok = pthread_create(&phit__hv.thread, NULL, phit__hv_main, NULL) == 0;
+#endif
+    if (!ok) PHIT__STORE64(&phit__hv.state, 0);
+    return ok;
+}
+
+void phit_harvester_stop(void) {
+    uint64_t running = 1;
+    if (!PHIT__CAS64(&phit__hv.state, running, 2)) return;
+    phit__mutex_lock(&phit__hv.mu);
+    phit__cond_broadcast(&phit__hv.cv);
+    phit__mutex_unlock(&phit__hv.mu);
+#if defined(_WIN32)
+    WaitForSingleObject(phit__hv.thread, INFINITE);
+    CloseHandle(phit__hv.thread);
+#else
+    pthread_join(phit__hv.thread, NULL);
+#endif
+    PHIT__STORE64(&phit__hv.state, 0);
+}
+
+int phit_harvester_pop(uint64_t *out) {
+    if (!PHIT__LOAD64(&phit__hv.ready)) return 0;
+    phit__hv_slot_t *slot;
+    uint64_t pos = PHIT__LOAD64(&phit__hv.head);
+    for (;;) {
+        slot = &phit__hv_slots[pos & (PHIT_HARVESTER_RING - 1)];
+        int64_t diff = (int64_t)(PHIT__LOAD64(&slot->seq) - (pos + 1));
+        if (diff == 0) {
+            if (PHIT__CAS64(&phit__hv.head, pos, pos + 1)) break;
+#if defined(_MSC_VER) && !defined(__clang__)
+            pos = PHIT__LOAD64(&phit__hv.head);
+#endif
+        } else if (diff < 0) {
+            if (PHIT__LOAD64(&phit__hv.state) == 1) {
+                PHIT__ADD_RELAXED64(&phit__hv.underruns, 1);
+                PHIT__STAT_EVENT(PHIT_EVENT_HARVESTER_UNDERRUN);
+            }
+            return 0;
+        } else {
+            pos = PHIT__LOAD64(&phit__hv.head);
+        }
+    }
+    *out = slot->word;
+    PHIT__STORE64(&slot->seq, pos + PHIT_HARVESTER_RING);
+    return 1;
+}
+
+void phit_harvester_stats(phit_harvester_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->running = PHIT__LOAD64(&phit__hv.state) == 1;
+    st->duty_limit = phit__hv.duty;
+    st->capacity = PHIT_HARVESTER_RING;
+    st->produced = PHIT__LOAD64(&phit__hv.tail);
+    st->consumed = PHIT__LOAD64(&phit__hv.head);
+    st->depth = st->produced > st->consumed ? st->produced - st->consumed : 0;
+    st->underruns = (uint64_t)PHIT__LOAD_RELAXED64(&phit__hv.underruns);
+    st->refill_rate = (double)PHIT__LOAD64(&phit__hv.rate);
+    uint64_t wall = st->running ? phit_now_ns() - phit__hv.start_ns : 0;
+    if (wall) st->duty = (double)PHIT__LOAD64(&phit__hv.busy_ns) / (double)wall;
+}
+
+/* ---- Bulk expansion kernels (SIMD bodies: see "SIMD kernels" above) ---- */
+
+typedef void (*phit__expand_fn)(uint64_t k0, uint64_t k1, uint64_t ctr,
+                                uint8_t *dst, size_t nwords);
+
+static void phit__expand_scalar(uint64_t k0, uint64_t k1, uint64_t ctr,
+                                uint8_t *dst, size_t nwords) {
+    uint64_t z = k0 + ctr * PHIT__WEYL;
+    for (size_t i = 0; i < nwords; i++) {
+        uint64_t v = phit_hash64(z) ^ k1;
+        memcpy(dst + i * 8, &v, 8);
+        z += PHIT__WEYL;
+    }
+}
+
+#if defined(PHIT_SIMD_EXTERNAL)
+  #if defined(PHIT__HAVE_NEON)
+void phit__expand_neon(uint64_t k0, uint64_t k1, uint64_t ctr, uint8_t *dst, size_t nwords);
+  #endif
+  #if defined(PHIT__HAVE_X86_SIMD)
+void phit__expand_avx2(uint64_t k0, uint64_t k1, uint64_t ctr, uint8_t *dst, size_t nwords);
+void phit__expand_avx512(uint64_t k0, uint64_t k1, uint64_t ctr, uint8_t *dst, size_t nwords);
+  #endif
+#endif
+
+#if defined(PHIT__HAVE_X86_SIMD)
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <immintrin.h>
+    #include <intrin.h>
+  #endif
+
+static int phit__x86_simd_level(void) {
+  #if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return PHIT_SIMD_SCALAR;
+    __cpuid(r, 1);
+    if (!(r[2] & (1 << 27))) return PHIT_SIMD_SCALAR;          /* OSXSAVE */
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(r, 7, 0);
+    if ((xcr0 & 0xE6) == 0xE6 && (r[1] & (1 << 16)) && (r[1] & (1 << 17)))
+        return PHIT_SIMD_AVX512;                               /* F + DQ */
+    if ((xcr0 & 0x06) == 0x06 && (r[1] & (1 << 5)))
+        return PHIT_SIMD_AVX2;
+    return PHIT_SIMD_SCALAR;
+  #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+        return PHIT_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return PHIT_SIMD_AVX2;
+    return PHIT_SIMD_SCALAR;
+  #endif
+}
+#endif
+
+typedef struct {
+    phit__expand_fn fn;
+    int             lanes;   /* words per kernel iteration */
+} phit__kernel_t;
+
+static const phit__kernel_t phit__kernels[] = {
+    { phit__expand_scalar, 1 },
+#if defined(PHIT__HAVE_NEON)
+    { phit__expand_neon,   4 },
+#else
+    { phit__expand_scalar, 1 },
+#endif
+#if defined(PHIT__HAVE_X86_SIMD)
+    { phit__expand_avx2,   8 },
+    { phit__expand_avx512, 16 },
+#else
+    { phit__expand_scalar, 1 },
+    { phit__expand_scalar, 1 },
+#endif
+};
+
+/* Dispatch state is written once (idempotently) on first use */
+static int phit__simd_best = -1;
+static int phit__simd_active = -1;
+
+int phit_simd_level(void) {
+    if (phit__simd_best < 0) {
+#if defined(PHIT__HAVE_X86_SIMD)
+        phit__simd_best = phit__x86_simd_level();
+#elif defined(PHIT__HAVE_NEON)
+        phit__simd_best = PHIT_SIMD_NEON;
+#else
+        phit__simd_best = PHIT_SIMD_SCALAR;
+#endif
+    }
+    return phit__simd_best;
+}
+
+int phit_simd_select(int level) {
+    int best = phit_simd_level();
+    if (level < PHIT_SIMD_SCALAR) level = PHIT_SIMD_SCALAR;
+    /* Never select an ISA the CPU lacks, nor one from another architecture */
+    if (level > best) level = best;
+    if (level == PHIT_SIMD_NEON && best != PHIT_SIMD_NEON) level = PHIT_SIMD_SCALAR;
+    phit__simd_active = level;
+    return level;
+}
+
+const char *phit_simd_name(int level) {
+    switch (level) {
+        case PHIT_SIMD_NEON:   return "neon";
+        case PHIT_SIMD_AVX2:   return "avx2";
+        case PHIT_SIMD_AVX512: return "avx512";
+        default:               return "scalar";
+    }
+}
+
+/* Write nwords expanded words at dst: scalar head up to 64-byte alignment,
+ * vector body, scalar tail. Output is independent of alignment. */
+static void phit__expand_words(uint64_t k0, uint64_t k1, uint64_t ctr,
+                               uint8_t *dst, size_t nwords) {
+    if (phit__simd_active < 0) phit_simd_select(phit_simd_level());
+    const phit__kernel_t *k = &phit__kernels[phit__simd_active];
+    if (k->lanes == 1 || nwords < (size_t)k->lanes * 2) {
+        phit__expand_scalar(k0, k1, ctr, dst, nwords);
+        return;
+    }
+
+    size_t head = 0;
+    if (((uintptr_t)dst & 7) == 0) {
+        head = ((64 - ((uintptr_t)dst & 63)) & 63) / 8;
+    }
+    size_t body = (nwords - head) / (size_t)k->lanes * (size_t)k->lanes;
+    size_t tail = nwords - head - body;
+
+    phit__expand_scalar(k0, k1, ctr, dst, head);
+    k->fn(k0, k1, ctr + head, dst + head * 8, body);
+    phit__expand_scalar(k0, k1, ctr + head + body, dst + (head + body) * 8, tail);
+}
+
+#define PHIT__XOR_BLOCK_WORDS 512   /* 4 KB of keystream on the stack */
+
+void phit_expand_xor(const uint64_t key[2], uint64_t offset, void *buf, size_t len) {
+    PHIT__ALIGNED(64) uint64_t ks[PHIT__XOR_BLOCK_WORDS];
+    uint8_t *p = (uint8_t *)buf;
+    uint64_t word = offset >> 3;
+    size_t skip = (size_t)(offset & 7);     /* into the first word */
+    while (len > 0) {
+        size_t words = (skip + len + 7) / 8;
+        if (words > PHIT__XOR_BLOCK_WORDS) words = PHIT__XOR_BLOCK_WORDS;
+        phit__expand_words(key[0], key[1], word, (uint8_t *)ks, words);
+
+        const uint8_t *k = (const uint8_t *)ks + skip;
+        size_t n = words * 8 - skip;
+        if (n > len) n = len;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t a, b;
+            memcpy(&a, p + i, 8);
+            memcpy(&b, k + i, 8);
+            a ^= b;
+            memcpy(p + i, &a, 8);
+        }
+        for (; i < n; i++) p[i] ^= k[i];
+
+        p += n;
+        len -= n;
+        word += words;
+        skip = 0;
+    }
+}
+
 /* ---- PRNG ---- */
 
 void phit_prng_init(phit_prng_t *rng) {
@@ -303,9 +2573,91 @@ void phit_prng_init(phit_prng_t *rng) {
     }
 }
 
+/* Buffered mode: reseed_outputs == 0 selects PHIT_PRNG_RESEED_OUTPUTS,
+ * reseed_ns == 0 disables the time-based reseed. */
+void phit_prng_init_buffered(phit_prng_t *rng, uint64_t reseed_outputs,
+                             uint64_t reseed_ns) {
+    phit_prng_init(rng);
+    rng->reseed_outputs = reseed_outputs ? reseed_outputs : PHIT_PRNG_RESEED_OUTPUTS;
+    rng->reseed_ns = reseed_ns;
+    phit_prng_reseed(rng);
+}
+
+/* A private-pool word: popped from the background harvester when it has
+ * one, harvested inline otherwise */
+static uint64_t phit__prng_extract(phit_prng_t *rng) {
+    uint64_t v;
+    if (phit_harvester_pop(&v)) return v;
+    PHIT__STAT_EVENT(PHIT_EVENT_PRNG_INLINE);
+    return phit_pool_extract(&rng->pool);
+}
+
+/* The private pool stays empty: every key comes from the shared pool */
+void phit_prng_init_shared(phit_prng_t *rng, uint64_t reseed_outputs,
+                           uint64_t reseed_ns) {
+    memset(rng, 0, sizeof(phit_prng_t));
+    rng->shared = 1;
+    rng->reseed_outputs = reseed_outputs ? reseed_outputs : PHIT_PRNG_RESEED_OUTPUTS;
+    rng->reseed_ns = reseed_ns;
+    phit_prng_reseed(rng);
+}
+
+phit_prng_t *phit_prng_local(void) {
+    static PHIT__TLS phit_prng_t rng;
+    if (!rng.shared) phit_prng_init_shared(&rng, 0, 0);
+    return &rng;
+}
+
+/* The block pointer sits in the word before the aligned array */
+phit_prng_padded_t *phit_prng_array_create(int n) {
+    if (n <= 0) return NULL;
+    char *mem = calloc(1, sizeof(phit_prng_padded_t) * (size_t)n + sizeof(void *) + PHIT_CACHE_LINE);
+    if (!mem) return NULL;
+    uintptr_t at = ((uintptr_t)mem + sizeof(void *) + PHIT_CACHE_LINE - 1) &
+                   ~(uintptr_t)(PHIT_CACHE_LINE - 1);
+    phit_prng_padded_t *a = (phit_prng_padded_t *)at;
+    ((void **)a)[-1] = mem;
+    for (int i = 0; i < n; i++) phit_prng_init_buffered(&a[i].rng, 0, 0);
+    return a;
+}
+
+void phit_prng_array_destroy(phit_prng_padded_t *a) {
+    if (a) free(((void **)a)[-1]);
+}
+
+/* Rekey the expansion from the pool. Each extraction runs the
+ * forward-secure pool mutation, so old keys cannot be recovered. */
+void phit_prng_reseed(phit_prng_t *rng) {
+    if (!rng->reseed_outputs) return;
+    if (rng->shared) {
+        /* Give back fresh entropy on every reseed after the first */
+        if (rng->generated) phit_shared_feed(PHIT_POOL_LANES);
+        rng->key[0] = phit_shared_extract();
+        rng->key[1] = phit_shared_extract();
+    } else {
+        rng->key[0] = phit__prng_extract(rng);
+        rng->key[1] = phit__prng_extract(rng);
+    }
+    rng->remaining = rng->reseed_outputs;
+    if (rng->reseed_ns) rng->last_reseed = phit_now_ns();
+}
+
+/* Counter-mode expansion: SplitMix64 finalizer over a keyed Weyl sequence */
+static inline uint64_t phit__prng_expand(const phit_prng_t *rng, uint64_t ctr) {
+    return phit_hash64(rng->key[0] + ctr * PHIT__WEYL) ^ rng->key[1];
+}
+
 uint64_t phit_prng_u64(phit_prng_t *rng) {
     rng->generated++;
-    return phit_pool_extract(&rng->pool);
+    if (!rng->reseed_outputs) return phit__prng_extract(rng);
+
+    if (rng->remaining == 0 ||
+        (rng->reseed_ns && (rng->counter & (PHIT_PRNG_CLOCK_STRIDE - 1)) == 0 &&
+         phit_now_ns() - rng->last_reseed >= rng->reseed_ns)) {
+        phit_prng_reseed(rng);
+    }
+    rng->remaining--;
+    return phit__prng_expand(rng, rng->counter++);
 }
 
 uint32_t phit_prng_u32(phit_prng_t *rng) {
@@ -316,13 +2668,55 @@ double phit_prng_double(phit_prng_t *rng) {
     return (double)(phit_prng_u64(rng) >> 11) / (double)(1ULL << 53);
 }
 
+/* Lemire multiply-shift with rejection: exact, one divide only on the
+ * rare rejection path */
 uint32_t phit_prng_range(phit_prng_t *rng, uint32_t max) {
-    if (max == 0) return 0;
-    return (uint32_t)(phit_prng_u64(rng) % max);
+    if (max < 2) return 0;
+    uint64_t m = (phit_prng_u64(rng) >> 32) * max;
+    if ((uint32_t)m < max) {
+        uint32_t t = (0u - max) % max;
+        while ((uint32_t)m < t) {
+            PHIT__STAT_EVENT(PHIT_EVENT_ROUTE_REJECT);
+            m = (phit_prng_u64(rng) >> 32) * max;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/* Buffered-mode bulk fill: whole reseed intervals go straight to the
+ * vector kernels; the clock is consulted once per chunk. */
+#define PHIT__FILL_CHUNK_WORDS 65536
+
+static void phit__prng_fill_buffered(phit_prng_t *rng, uint8_t *p, int len) {
+    size_t words = (size_t)len / 8;
+    while (words > 0) {
+        if (rng->remaining == 0 ||
+            (rng->reseed_ns && phit_now_ns() - rng->last_reseed >= rng->reseed_ns)) {
+            phit_prng_reseed(rng);
+        }
+        size_t n = words;
+        if (n > rng->remaining) n = (size_t)rng->remaining;
+        if (rng->reseed_ns && n > PHIT__FILL_CHUNK_WORDS) n = PHIT__FILL_CHUNK_WORDS;
+
+        phit__expand_words(rng->key[0], rng->key[1], rng->counter, p, n);
+        rng->counter += n;
+        rng->remaining -= n;
+        rng->generated += n;
+        p += n * 8;
+        words -= n;
+    }
+    if (len & 7) {
+        uint64_t v = phit_prng_u64(rng);
+        memcpy(p, &v, (size_t)(len & 7));
+    }
 }
 
 void phit_prng_fill(phit_prng_t *rng, void *buf, int len) {
     uint8_t *p = (uint8_t *)buf;
+    if (rng->reseed_outputs) {
+        if (len > 0) phit__prng_fill_buffered(rng, p, len);
+        return;
+    }
     while (len >= 8) {
         uint64_t v = phit_prng_u64(rng);
         memcpy(p, &v, 8);
@@ -380,6 +2774,11 @@ int phit_selftest(void) {
     uint64_t t2 = phit_now_ns();
     if (t2 <= t1) pass = 0;
 
+    /* Test 6: the continuous health tests held over the run above */
+#if PHIT_HEALTH_TESTS
+    if (rng.pool.health.samples == 0 || phit_pool_health(&rng.pool)) pass = 0;
+#endif
+
     return pass;
 }
 
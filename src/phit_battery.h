@@ -0,0 +1,536 @@
+/*
+ * phit_battery.h — Streaming Statistical Test Battery
+ * ===================================================
+ *
+ * Companion to libphit.h. Runs the quality tests of phit_prng.c as
+ * constant-memory accumulators over an unbounded stream of 64-bit words,
+ * so a run is bounded by time, not by an array:
+ *
+ *   monobit        ones in every bit
+ *   runs           adjacent bit transitions (runs = streams + transitions)
+ *   bytes          chi² of the 256 byte values, df 255
+ *   serial         Good's serial test on overlapping nibble pairs, df 240
+ *   contingency    top nibble of word i vs word i + 1, chi², df 225
+ *   autocorr       bit disagreements between word i and word i - d,
+ *                  d = 1..lags (as experiment_deep_autocorrelation in
+ *                  experiments/phase_extract_v2.c, without the array)
+ *
+ * State is O(lags + bins): a window of lags + PHIT_BATTERY_BLOCK words
+ * and the count tables, about 40 KB, so allocate it rather than putting
+ * it on a small stack. Words are processed a block at a time; the window
+ * keeps the last `lags` words so lag pairs span block boundaries.
+ *
+ * phit_battery_run() runs one battery per thread, each on its own
+ * buffered PRNG filled through phit_prng_fill(), and merges them. Merged
+ * batteries count several independent streams; every statistic accounts
+ * for the stream count.
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_battery.h (it includes libphit.h), or link
+ * the libphit library, which already contains it. Link with -lm -lpthread.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_BATTERY_H
+#define PHIT_BATTERY_H
+
+#include "libphit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+/* Largest autocorrelation lag, in 64-bit words */
+#ifndef PHIT_BATTERY_MAX_LAG
+#define PHIT_BATTERY_MAX_LAG 500
+#endif
+
+/* Words per processing block */
+#ifndef PHIT_BATTERY_BLOCK
+#define PHIT_BATTERY_BLOCK 4096
+#endif
+
+/* Significance level of the pass flags; autocorr is Bonferroni-corrected
+ * over its lags */
+#ifndef PHIT_BATTERY_ALPHA
+#define PHIT_BATTERY_ALPHA 0.001
+#endif
+
+#ifndef PHIT_BATTERY_MAX_THREADS
+#define PHIT_BATTERY_MAX_THREADS 256
+#endif
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+enum {
+    PHIT_BATTERY_MONOBIT,
+    PHIT_BATTERY_RUNS,
+    PHIT_BATTERY_BYTES,
+    PHIT_BATTERY_SERIAL,
+    PHIT_BATTERY_CONTINGENCY,
+    PHIT_BATTERY_AUTOCORR,
+    PHIT_BATTERY_TESTS
+};
+
+typedef struct {
+    int      lags;
+    uint64_t words;                         /* 64-bit samples consumed */
+    uint64_t streams;                       /* independent streams merged */
+    uint64_t ones;
+    uint64_t transitions;
+    uint64_t bytes[256];
+    uint64_t nib1[16];                      /* serial: nibbles */
+    uint64_t nib2[256];                     /* serial: overlapping nibble pairs */
+    uint64_t table[16][16];                 /* contingency */
+    uint64_t differ[PHIT_BATTERY_MAX_LAG + 1];   /* autocorr: differing bits */
+    uint64_t pairs[PHIT_BATTERY_MAX_LAG + 1];    /* autocorr: word pairs */
+    /* Stream carry: the last word, and the last `lags` lead the window */
+    uint64_t last;
+    int      history;
+    uint64_t window[PHIT_BATTERY_MAX_LAG + PHIT_BATTERY_BLOCK];
+} phit_battery_t;
+
+typedef struct {
+    uint64_t words;
+    uint64_t streams;
+    double   stat[PHIT_BATTERY_TESTS];      /* z for monobit/runs/autocorr, else chi² */
+    double   p[PHIT_BATTERY_TESTS];         /* two-sided; autocorr Bonferroni-adjusted */
+    int      pass[PHIT_BATTERY_TESTS];      /* p >= PHIT_BATTERY_ALPHA */
+    int      all_pass;
+    int      worst_lag;                     /* autocorr: lag with the largest |z| */
+    double   worst_r;                       /* its bit correlation, 1 - 2 * differ / bits */
+} phit_battery_result_t;
+
+/* ====================================================================
+ * API Declarations
+ * ==================================================================== */
+
+/* lags: 0..PHIT_BATTERY_MAX_LAG (clamped) */
+void        phit_battery_init(phit_battery_t *b, int lags);
+/* Append words to this battery's stream, in any chunk size */
+void        phit_battery_feed(phit_battery_t *b, const uint64_t *words, size_t n);
+/* Add src's counts to dst as independent streams; dst keeps its own window */
+void        phit_battery_merge(phit_battery_t *dst, const phit_battery_t *src);
+void        phit_battery_result(const phit_battery_t *b, phit_battery_result_t *r);
+const char *phit_battery_test_name(int test);
+
+/* Feed `words` PRNG words split over `threads` threads (0 = 1), each with
+ * its own phit_prng_init_buffered() generator and battery, merged into
+ * out (initialized by the caller, which fixes the lags). Returns the wall
+ * time in ns, 0 on failure. */
+uint64_t    phit_battery_run(phit_battery_t *out, uint64_t words, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_BATTERY_IMPLEMENTED)
+#define PHIT_BATTERY_IMPLEMENTED
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Thread shim: libphit.h implementation */
+
+static const char *const phit__battery_names[PHIT_BATTERY_TESTS] = {
+    "monobit", "runs", "bytes", "serial", "contingency", "autocorr"
+};
+
+const char *phit_battery_test_name(int test) {
+    return test >= 0 && test < PHIT_BATTERY_TESTS ? phit__battery_names[test] : "?";
+}
+
+void phit_battery_init(phit_battery_t *b, int lags) {
+    memset(b, 0, sizeof(*b));
+    if (lags < 0) lags = 0;
+    if (lags > PHIT_BATTERY_MAX_LAG) lags = PHIT_BATTERY_MAX_LAG;
+    b->lags = lags;
+    b->streams = 1;
+}
+
+/* ---- Bit counting ----
+ * Portable SWAR, no POPCNT needed (the baseline x86-64 target lacks it):
+ * byte counts of up to 31 words add in place before one 16-bit fold. */
+
+static inline uint64_t phit__battery_bytecount(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    return (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+static inline uint64_t phit__battery_fold(uint64_t acc) {
+    acc = (acc & 0x00FF00FF00FF00FFULL) + ((acc >> 8) & 0x00FF00FF00FF00FFULL);
+    return (acc * 0x0001000100010001ULL) >> 48;
+}
+
+static inline int phit__battery_pop64(uint64_t x) {
+    return (int)((phit__battery_bytecount(x) * 0x0101010101010101ULL) >> 56);
+}
+
+/* Differing bits between a[i] and b[i], i < n */
+static uint64_t phit__battery_differ(const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t total = 0;
+    size_t i = 0;
+    while (i < n) {
+        size_t end = n - i > 31 ? i + 31 : n;
+        uint64_t acc = 0;
+        for (; i < end; i++) acc += phit__battery_bytecount(a[i] ^ b[i]);
+        total += phit__battery_fold(acc);
+    }
+    return total;
+}
+
+/* Set bits in a[i], i < n (phit_stoch_count) */
+static uint64_t phit__battery_count(const uint64_t *a, size_t n) {
+    uint64_t total = 0;
+    size_t i = 0;
+    while (i < n) {
+        size_t end = n - i > 31 ? i + 31 : n;
+        uint64_t acc = 0;
+        for (; i < end; i++) acc += phit__battery_bytecount(a[i]);
+        total += phit__battery_fold(acc);
+    }
+    return total;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+/* Hardware counts, picked at runtime: POPCNT, then AVX-512 VPOPCNTQ (the
+ * compiler vectorizes the builtin), about 3x and 8x the SWAR loop */
+__attribute__((target("popcnt")))
+static uint64_t phit__battery_differ_popcnt(const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i] ^ b[i]);
+    return total;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t phit__battery_differ_vpopcnt(const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i] ^ b[i]);
+    return total;
+}
+
+__attribute__((target("popcnt")))
+static uint64_t phit__battery_count_popcnt(const uint64_t *a, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i]);
+    return total;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t phit__battery_count_vpopcnt(const uint64_t *a, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i]);
+    return total;
+}
+
+static int phit__battery_isa = -1;
+
+/* 2 = VPOPCNTQ, 1 = POPCNT, 0 = SWAR */
+static int phit__battery_cpu_isa(void) {
+    int isa = PHIT__LOAD_ACQUIRE(&phit__battery_isa);
+    if (isa < 0) {
+        __builtin_cpu_init();
+        isa = __builtin_cpu_supports("avx512vpopcntdq") && __builtin_cpu_supports("avx512f") ? 2
+            : __builtin_cpu_supports("popcnt") ? 1 : 0;
+        PHIT__STORE_RELEASE(&phit__battery_isa, isa);
+    }
+    return isa;
+}
+
+static uint64_t phit__battery_differ_best(const uint64_t *a, const uint64_t *b, size_t n) {
+    int isa = phit__battery_cpu_isa();
+    if (isa == 2) return phit__battery_differ_vpopcnt(a, b, n);
+    if (isa == 1) return phit__battery_differ_popcnt(a, b, n);
+    return phit__battery_differ(a, b, n);
+}
+
+static uint64_t phit__battery_count_best(const uint64_t *a, size_t n) {
+    int isa = phit__battery_cpu_isa();
+    if (isa == 2) return phit__battery_count_vpopcnt(a, n);
+    if (isa == 1) return phit__battery_count_popcnt(a, n);
+    return phit__battery_count(a, n);
+}
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+/* NEON CNT: the builtin vectorizes on every ARM64 target */
+static uint64_t phit__battery_differ_best(const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i] ^ b[i]);
+    return total;
+}
+
+static uint64_t phit__battery_count_best(const uint64_t *a, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (uint64_t)__builtin_popcountll(a[i]);
+    return total;
+}
+#else
+#define phit__battery_differ_best phit__battery_differ
+#define phit__battery_count_best  phit__battery_count
+#endif
+
+/* ---- Block accumulation ----
+ * window[history .. history + n) are new words; window[0 .. history) the
+ * stream's previous words, oldest first. */
+
+static void phit__battery_block(phit_battery_t *b, size_t n) {
+    uint64_t *w = b->window + b->history;
+    uint64_t prev = b->last;
+    int have_prev = b->words > 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t x = w[i];
+        b->ones += (uint64_t)phit__battery_pop64(x);
+        b->transitions += (uint64_t)phit__battery_pop64((x ^ (x >> 1)) & 0x7FFFFFFFFFFFFFFFULL);
+        for (int k = 0; k < 8; k++) b->bytes[(x >> (8 * k)) & 0xFF]++;
+
+        /* Nibbles LSB first; the first pair spans the word boundary */
+        unsigned last = (unsigned)(prev >> 60);
+        for (int k = 0; k < 16; k++) {
+            unsigned nib = (unsigned)(x >> (4 * k)) & 15;
+            b->nib1[nib]++;
+            if (have_prev || k) b->nib2[last << 4 | nib]++;
+            last = nib;
+        }
+        if (have_prev) {
+            b->transitions += (prev >> 63) ^ (x & 1);
+            b->table[prev >> 60][x >> 60]++;
+        }
+        prev = x;
+        have_prev = 1;
+    }
+
+    /* Lag d pairs every new word with the word d back, history included */
+    for (int d = 1; d <= b->lags; d++) {
+        size_t skip = d > b->history ? (size_t)(d - b->history) : 0;
+        if (skip >= n) continue;
+        b->differ[d] += phit__battery_differ_best(w + skip, w + skip - d, n - skip);
+        b->pairs[d] += n - skip;
+    }
+
+    b->words += n;
+    b->last = prev;
+    size_t total = (size_t)b->history + n;
+    size_t keep = total < (size_t)b->lags ? total : (size_t)b->lags;
+    memmove(b->window, b->window + total - keep, keep * sizeof(uint64_t));
+    b->history = (int)keep;
+}
+
+void phit_battery_feed(phit_battery_t *b, const uint64_t *words, size_t n) {
+    while (n) {
+        size_t m = n < PHIT_BATTERY_BLOCK ? n : PHIT_BATTERY_BLOCK;
+        memcpy(b->window + b->history, words, m * sizeof(uint64_t));
+        phit__battery_block(b, m);
+        words += m;
+        n -= m;
+    }
+}
+
+void phit_battery_merge(phit_battery_t *dst, const phit_battery_t *src) {
+    dst->words += src->words;
+    dst->streams += src->streams;
+    dst->ones += src->ones;
+    dst->transitions += src->transitions;
+    for (int i = 0; i < 256; i++) {
+        dst->bytes[i] += src->bytes[i];
+        dst->nib2[i] += src->nib2[i];
+        dst->table[i >> 4][i & 15] += src->table[i >> 4][i & 15];
+    }
+    for (int i = 0; i < 16; i++) dst->nib1[i] += src->nib1[i];
+    int lags = dst->lags < src->lags ? dst->lags : src->lags;
+    for (int d = 1; d <= lags; d++) {
+        dst->differ[d] += src->differ[d];
+        dst->pairs[d] += src->pairs[d];
+    }
+}
+
+/* ---- Statistics ---- */
+
+static double phit__battery_p_z(double z) {
+    return erfc(fabs(z) / sqrt(2.0));
+}
+
+/* Upper tail of chi²(df) through the Wilson-Hilferty normal form */
+static double phit__battery_p_chi2(double x, double df) {
+    if (x <= 0) return 1.0;
+    double v = 2.0 / (9.0 * df);
+    double z = (cbrt(x / df) - (1.0 - v)) / sqrt(v);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+void phit_battery_result(const phit_battery_t *b, phit_battery_result_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->words = b->words;
+    r->streams = b->streams;
+    for (int t = 0; t < PHIT_BATTERY_TESTS; t++) r->p[t] = 1.0;
+    double bits = 64.0 * (double)b->words;
+
+    if (b->words) {
+        double pi = (double)b->ones / bits;
+        r->stat[PHIT_BATTERY_MONOBIT] = ((double)b->ones - bits / 2) / sqrt(bits / 4);
+
+        /* Transitions between adjacent bits of each stream */
+        double adj = bits - (double)b->streams;
+        double q = pi * (1 - pi);
+        if (adj > 0 && q > 0)
+            r->stat[PHIT_BATTERY_RUNS] = ((double)b->transitions - 2 * adj * q) / (2 * q * sqrt(adj));
+
+        double chi2 = 0, e = bits / 8 / 256;
+        for (int i = 0; i < 256; i++) chi2 += ((double)b->bytes[i] - e) * ((double)b->bytes[i] - e) / e;
+        r->stat[PHIT_BATTERY_BYTES] = chi2;
+
+        /* Good: psi²_2 - psi²_1 over overlapping nibble tuples */
+        double n1 = 0, n2 = 0, s1 = 0, s2 = 0;
+        for (int i = 0; i < 16; i++) {
+            n1 += (double)b->nib1[i];
+            s1 += (double)b->nib1[i] * (double)b->nib1[i];
+        }
+        for (int i = 0; i < 256; i++) {
+            n2 += (double)b->nib2[i];
+            s2 += (double)b->nib2[i] * (double)b->nib2[i];
+        }
+        if (n2 > 0) r->stat[PHIT_BATTERY_SERIAL] = (256 * s2 / n2 - n2) - (16 * s1 / n1 - n1);
+
+        double rows[16] = {0}, cols[16] = {0}, n = 0;
+        for (int i = 0; i < 16; i++) {
+            for (int j = 0; j < 16; j++) {
+                rows[i] += (double)b->table[i][j];
+                cols[j] += (double)b->table[i][j];
+                n += (double)b->table[i][j];
+            }
+        }
+        chi2 = 0;
+        for (int i = 0; i < 16 && n > 0; i++) {
+            for (int j = 0; j < 16; j++) {
+                double ex = rows[i] * cols[j] / n;
+                if (ex > 0) chi2 += ((double)b->table[i][j] - ex) * ((double)b->table[i][j] - ex) / ex;
+            }
+        }
+        r->stat[PHIT_BATTERY_CONTINGENCY] = chi2;
+
+        /* Each lag: 64 bits per pair, differing with p = 1/2 */
+        double worst = 0;
+        for (int d = 1; d <= b->lags; d++) {
+            if (!b->pairs[d]) continue;
+            double pb = 64.0 * (double)b->pairs[d];
+            double z = ((double)b->differ[d] - pb / 2) / sqrt(pb / 4);
+            if (fabs(z) > fabs(worst) || !r->worst_lag) {
+                worst = z;
+                r->worst_lag = d;
+                r->worst_r = 1.0 - 2.0 * (double)b->differ[d] / pb;
+            }
+        }
+        r->stat[PHIT_BATTERY_AUTOCORR] = worst;
+
+        r->p[PHIT_BATTERY_MONOBIT] = phit__battery_p_z(r->stat[PHIT_BATTERY_MONOBIT]);
+        r->p[PHIT_BATTERY_RUNS] = phit__battery_p_z(r->stat[PHIT_BATTERY_RUNS]);
+        r->p[PHIT_BATTERY_BYTES] = phit__battery_p_chi2(r->stat[PHIT_BATTERY_BYTES], 255);
+        r->p[PHIT_BATTERY_SERIAL] = phit__battery_p_chi2(r->stat[PHIT_BATTERY_SERIAL], 240);
+        r->p[PHIT_BATTERY_CONTINGENCY] = phit__battery_p_chi2(chi2, 225);
+        if (r->worst_lag) {
+            double p = phit__battery_p_z(worst) * (double)b->lags;
+            r->p[PHIT_BATTERY_AUTOCORR] = p < 1.0 ? p : 1.0;
+        }
+    }
+    r->all_pass = 1;
+    for (int t = 0; t < PHIT_BATTERY_TESTS; t++) {
+        r->pass[t] = r->p[t] >= PHIT_BATTERY_ALPHA;
+        r->all_pass = r->all_pass && r->pass[t];
+    }
+}
+
+/* ---- Parallel runner ---- */
+
+typedef struct {
+    phit_battery_t *battery;
+    uint64_t        words;
+} phit__battery_job_t;
+
+static void phit__battery_job(phit__battery_job_t *j) {
+    phit_battery_t *b = j->battery;
+    phit_prng_t rng;
+    phit_prng_init_buffered(&rng, 0, 0);
+    for (uint64_t left = j->words; left;) {
+        size_t m = left < PHIT_BATTERY_BLOCK ? (size_t)left : PHIT_BATTERY_BLOCK;
+        phit_prng_fill(&rng, b->window + b->history, (int)(m * sizeof(uint64_t)));
+        phit__battery_block(b, m);
+        left -= m;
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI phit__battery_main(LPVOID arg) {
+    phit__battery_job((phit__battery_job_t *)arg);
+    return 0;
+}
+#else
+static void *phit__battery_main(void *arg) {
+    phit__battery_job((phit__battery_job_t *)arg);
+    return NULL;
+}
+#endif
+
+uint64_t phit_battery_run(phit_battery_t *out, uint64_t words, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > PHIT_BATTERY_MAX_THREADS) threads = PHIT_BATTERY_MAX_THREADS;
+    phit_battery_t *bs = malloc(sizeof(phit_battery_t) * (size_t)threads);
+    phit__battery_job_t jobs[PHIT_BATTERY_MAX_THREADS];
+    phit__thread_t th[PHIT_BATTERY_MAX_THREADS];
+    int started[PHIT_BATTERY_MAX_THREADS] = { 0 };
+    if (!bs) return 0;
+
+    uint64_t t0 = phit_now_ns();
+    for (int t = 0; t < threads; t++) {
+        phit_battery_init(&bs[t], out->lags);
+        jobs[t].battery = &bs[t];
+        jobs[t].words = words / (uint64_t)threads + ((uint64_t)t < words % (uint64_t)threads);
+        /* Thread 0's share runs here */
+        if (t == 0) continue;
+#if defined(_WIN32)
+        th[t] = CreateThread(NULL, 0, phit__battery_main, &jobs[t], 0, NULL);
+        started[t] = th[t] != NULL;
+#else
+        started[t] = pthread_create(&th[t], NULL, phit__battery_main, &jobs[t]) == 0;
+#endif
+    }
+    /* A share whose thread did not start runs here too */
+    for (int t = 0; t < threads; t++) {
+        if (!started[t]) phit__battery_job(&jobs[t]);
+    }
+    for (int t = 1; t < threads; t++) {
+        if (!started[t]) continue;
+#if defined(_WIN32)
+        WaitForSingleObject(th[t], INFINITE);
+        CloseHandle(th[t]);
+#else
+        pthread_join(th[t], NULL);
+#endif
+    }
+    uint64_t elapsed = phit_now_ns() - t0;
+
+    /* Every battery is its own stream; an empty out takes the first */
+    for (int t = 0; t < threads; t++) {
+        if (t == 0 && out->words == 0) memcpy(out, &bs[0], sizeof(phit_battery_t));
+        else phit_battery_merge(out, &bs[t]);
+    }
+    free(bs);
+    return elapsed ? elapsed : 1;
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_BATTERY_H */
@@ -0,0 +1,609 @@
+/*
+ * phit_calib.h — Persisted Calibration Cache
+ * ==========================================
+ *
+ * Companion to libphit.h. A process pays two calibrations before timing
+ * is meaningful: the timer probe behind phit_timer_caps() (up to
+ * PHIT_TIMER_PROBE_NS) and the CDF router histogram (PHIT_ROUTER_CALIB_SAMPLES
+ * workload deltas, as router_calibrate() in experiments/phi_uniform.c).
+ * Short-lived processes pay both every time. This header keeps them in a
+ * small versioned file:
+ *
+ *   key      CPU model, microcode, cpufreq governor, timer backend,
+ *            PHIT_WORKLOAD_ITERS and PHIT_ROUTER_MAX_DELTA of the build
+ *   caps     phit_timer_caps_t (tick, read cost, delta statistics)
+ *   router   histogram, slot map and CDF tables of a calibrated router
+ *
+ * Loading reads the file, rejects it on any key, version, size or checksum
+ * mismatch, then spot-checks it against a few thousand fresh samples
+ * (PHIT_CALIB_CHECK_SAMPLES):
+ *
+ *   timer    phit_now_ticks() units per ns over the check, against
+ *            caps.ns_per_unit (PHIT_CALIB_UNIT_TOL)
+ *   deltas   distance between the CDFs of the fresh workload deltas
+ *            and the cached histogram, allowing each delta to move by
+ *            PHIT_CALIB_DELTA_SLACK (PHIT_CALIB_MAX_DISTANCE)
+ *
+ * The slack is there because a ready router tracks drift on its own
+ * (PHIT_ROUTER_TRACK_WINDOW): a delta distribution that piles on two or
+ * three tick values shifts by a tick between runs, which tracking absorbs
+ * within a window, while a governor or load change moves it by far more.
+ *
+ * phit_calib_start() is the startup entry point. On a hit the caps are
+ * installed and the router is ready at once. On a miss the router is left
+ * to calibrate incrementally as usual (phit_router_route() falls back to
+ * hashing meanwhile), a background thread recalibrates from scratch and
+ * rewrites the file, and phit_calib_adopt() hands its tables to the
+ * caller's router once it is done. When only the delta check fails the
+ * cached caps are still installed; the timer is not re-probed.
+ *
+ * The file is written to a temporary name and renamed, so concurrent
+ * processes never read a torn cache. It holds host-order plain data,
+ * which the key already ties to one machine.
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_calib.h (it includes libphit.h), or link the
+ * libphit library, which already contains it.
+ *
+ *   phit_router_t router;
+ *   phit_calib_start(NULL, &router, num_workers);   // default path
+ *   ...
+ *   phit_calib_adopt(&router);     // cheap, one-shot; call from the router's thread
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_CALIB_H
+#define PHIT_CALIB_H
+
+#include "libphit.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+/* Fresh workload deltas taken to validate a loaded cache */
+#ifndef PHIT_CALIB_CHECK_SAMPLES
+#define PHIT_CALIB_CHECK_SAMPLES 4096
+#endif
+
+/* Largest accepted CDF difference between the fresh deltas and the
+ * cached histogram, after the slack below. Sampling noise at 4096 samples
+ * is about 0.02 (1.36 / sqrt(n) at 5%). */
+#ifndef PHIT_CALIB_MAX_DISTANCE
+#define PHIT_CALIB_MAX_DISTANCE 0.1
+#endif
+
+/* Relative move of a workload delta the check tolerates (at least one tick) */
+#ifndef PHIT_CALIB_DELTA_SLACK
+#define PHIT_CALIB_DELTA_SLACK 0.05
+#endif
+
+/* Largest accepted relative error of the cached ns_per_unit */
+#ifndef PHIT_CALIB_UNIT_TOL
+#define PHIT_CALIB_UNIT_TOL 0.02
+#endif
+
+#ifndef PHIT_CALIB_PATH_MAX
+#define PHIT_CALIB_PATH_MAX 512
+#endif
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+#define PHIT_CALIB_VERSION 1
+
+/* phit_calib_load / phit_calib_start results */
+enum {
+    PHIT_CALIB_HIT,         /* valid: caps installed, router ready */
+    PHIT_CALIB_MISSING,     /* no file (or no path) */
+    PHIT_CALIB_MISMATCH,    /* other machine, build or version, or corrupt */
+    PHIT_CALIB_STALE_TIMER, /* the timer no longer matches the cached caps */
+    PHIT_CALIB_STALE_DELTAS /* caps fine (installed), delta distribution moved */
+};
+
+/* What a cache is valid for. Strings are NUL padded so keys compare
+ * with memcmp. */
+typedef struct {
+    char     cpu[64];           /* CPU model string */
+    char     governor[16];      /* cpufreq scaling governor, "" if none */
+    uint32_t microcode;         /* 0 where the OS does not report it */
+    int32_t  backend;           /* PHIT_TIMER_COUNTER or PHIT_TIMER_NS */
+    uint32_t workload_iters;    /* PHIT_WORKLOAD_ITERS */
+    uint32_t max_delta;         /* PHIT_ROUTER_MAX_DELTA */
+} phit_calib_key_t;
+
+/* Spot check of a cache against the running machine (phit_calib_check) */
+typedef struct {
+    double   unit_error;        /* |measured / cached ns_per_unit - 1| */
+    double   distance;          /* largest CDF difference, after the slack */
+    int      samples;
+    uint64_t check_ns;          /* wall time the check took */
+} phit_calib_check_t;
+
+/* ====================================================================
+ * API
+ * ==================================================================== */
+
+void phit_calib_key(phit_calib_key_t *key);
+/* Default cache file: $PHIT_CALIB_CACHE, else libphit-calib.bin under
+ * $XDG_CACHE_HOME, $HOME/.cache or %LOCALAPPDATA%. 0 if none applies. */
+int  phit_calib_path(char *buf, size_t size);
+
+/* Write phit_timer_caps() and r's tables (r may be NULL: caps only, and a
+ * later load leaves its router alone). A NULL path is the default.
+ * 1 on success. */
+int  phit_calib_save(const char *path, const phit_router_t *r);
+/* Read, validate and install a cache. On PHIT_CALIB_HIT, r (when not
+ * NULL) is a ready router with num_slots slots; otherwise r is untouched.
+ * check, when not NULL, receives the spot check of a well-formed file. */
+int  phit_calib_load(const char *path, phit_router_t *r, int num_slots,
+                     phit_calib_check_t *check);
+/* Spot check of caps and a calibrated router's histogram */
+void phit_calib_check(const phit_timer_caps_t *caps, const phit_router_t *r,
+                      int samples, phit_calib_check_t *out);
+
+/* Load, or on any miss initialise r for incremental calibration and
+ * recalibrate num_slots slots on a background thread that saves the
+ * result. Returns the load status. One background run per process. */
+int  phit_calib_start(const char *path, phit_router_t *r, int num_slots);
+/* Copy the background result into r, keeping r's slot count. One-shot:
+ * 1 on the call that adopts it, 0 while it is still running (or never
+ * started) and on every call after the adoption, which leaves r as is,
+ * so a router that has since calibrated further is not rolled back. */
+int  phit_calib_adopt(phit_router_t *r);
+/* Join the background run. 1 if it saved the cache. */
+int  phit_calib_wait(void);
+
+const char *phit_calib_status_name(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_CALIB_IMPLEMENTED)
+#define PHIT_CALIB_IMPLEMENTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__APPLE__) || defined(__FreeBSD__)
+  #include <sys/types.h>
+  #include <sys/sysctl.h>
+#endif
+#if defined(_WIN32)
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+#endif
+
+#define PHIT__CALIB_MAGIC "PHITCAL"
+
+typedef struct {
+    char              magic[8];
+    uint32_t          version;
+    uint32_t          bytes;             /* sizeof(phit__calib_file_t) */
+    phit_calib_key_t  key;
+    phit_timer_caps_t caps;
+    int64_t           created_unix;
+    int32_t           has_router;
+    int32_t           num_slots;
+    uint32_t          calib_count;
+    uint32_t          hist[PHIT_ROUTER_MAX_DELTA];
+    uint8_t           slot_map[PHIT_ROUTER_MAX_DELTA];
+    uint16_t          cdf_lo[PHIT_ROUTER_MAX_DELTA];
+    uint16_t          cdf_span[PHIT_ROUTER_MAX_DELTA];
+    uint64_t          checksum;          /* of every byte before it */
+} phit__calib_file_t;
+
+/* ---- Key ---- */
+
+/* Value of the first "name : value" line of /proc/cpuinfo */
+#if defined(__linux__)
+static int phit__calib_cpuinfo(const char *text, const char *name, char *out, size_t size) {
+    size_t len = strlen(name);
+    for (const char *p = text; *p; ) {
+        const char *eol = strchr(p, '\n');
+        if (!eol) eol = p + strlen(p);
+        if (!strncmp(p, name, len) && (p[len] == ' ' || p[len] == '\t' || p[len] == ':')) {
+            const char *v = strchr(p, ':');
+            if (v && v < eol) {
+                v++;
+                while (v < eol && *v == ' ') v++;
+                size_t n = (size_t)(eol - v);
+                if (n >= size) n = size - 1;
+                memcpy(out, v, n);
+                out[n] = 0;
+                return 1;
+            }
+        }
+        p = *eol ? eol + 1 : eol;
+    }
+    return 0;
+}
+
+static void phit__calib_read_file(const char *path, char *out, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    size_t n = fread(out, 1, size - 1, f);
+    fclose(f);
+    out[n] = 0;
+}
+#endif
+
+void phit_calib_key(phit_calib_key_t *key) {
+    memset(key, 0, sizeof(phit_calib_key_t));
+    /* As phit_timer_probe, without probing */
+#if defined(PHIT__TIMER_NS_ONLY)
+    key->backend = PHIT_TIMER_NS;
+#else
+    key->backend = PHIT_TIMER_COUNTER;
+#endif
+    key->workload_iters = PHIT_WORKLOAD_ITERS;
+    key->max_delta = PHIT_ROUTER_MAX_DELTA;
+#if defined(__linux__)
+    /* The first processor's block is enough: one model per machine */
+    char text[8192] = "";
+    phit__calib_read_file("/proc/cpuinfo", text, sizeof(text));
+    char v[32];
+    if (!phit__calib_cpuinfo(text, "model name", key->cpu, sizeof(key->cpu))) {
+        /* ARM: implementer and part number */
+        char part[16] = "";
+        if (phit__calib_cpuinfo(text, "CPU implementer", v, sizeof(v)) &&
+            phit__calib_cpuinfo(text, "CPU part", part, sizeof(part)))
+            snprintf(key->cpu, sizeof(key->cpu), "%s/%s", v, part);
+    }
+    if (phit__calib_cpuinfo(text, "microcode", v, sizeof(v)))
+        key->microcode = (uint32_t)strtoul(v, NULL, 0);
+    phit__calib_read_file("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor",
+                          key->governor, sizeof(key->governor));
+    key->governor[strcspn(key->governor, "\n")] = 0;
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+  #if defined(__APPLE__)
+    const char *name = "machdep.cpu.brand_string";
+  #else
+    const char *name = "hw.model";
+  #endif
+    size_t len = sizeof(key->cpu) - 1;
+    if (sysctlbyname(name, key->cpu, &len, NULL, 0) != 0) key->cpu[0] = 0;
+#elif defined(_WIN32)
+    const char *id = getenv("PROCESSOR_IDENTIFIER");
+    if (id) snprintf(key->cpu, sizeof(key->cpu), "%s", id);
+#endif
+}
+
+int phit_calib_path(char *buf, size_t size) {
+    const char *env = getenv("PHIT_CALIB_CACHE");
+    if (env && *env) return snprintf(buf, size, "%s", env) < (int)size;
+#if defined(_WIN32)
+    const char *dir = getenv("LOCALAPPDATA");
+    if (dir && *dir) return snprintf(buf, size, "%s\\libphit-calib.bin", dir) < (int)size;
+#else
+    const char *dir = getenv("XDG_CACHE_HOME");
+    if (dir && *dir) return snprintf(buf, size, "%s/libphit-calib.bin", dir) < (int)size;
+    dir = getenv("HOME");
+    if (dir && *dir) return snprintf(buf, size, "%s/.cache/libphit-calib.bin", dir) < (int)size;
+#endif
+    return 0;
+}
+
+/* ---- File ---- */
+
+static uint64_t phit__calib_checksum(const phit__calib_file_t *f) {
+    const uint8_t *p = (const uint8_t *)f;
+    size_t n = offsetof(phit__calib_file_t, checksum);
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < n; i += 8) {
+        uint64_t w = 0;
+        memcpy(&w, p + i, n - i < 8 ? n - i : 8);
+        h = phit_hash64(h ^ w);
+    }
+    return h;
+}
+
+/* Parent directory of path, one level (the default $HOME/.cache) */
+static void phit__calib_mkdir_parent(const char *path) {
+    char dir[PHIT_CALIB_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+#if defined(_WIN32)
+    char *bslash = strrchr(dir, '\\');
+    if (bslash > slash) slash = bslash;
+#endif
+    if (!slash || slash == dir) return;
+    *slash = 0;
+#if defined(_WIN32)
+    _mkdir(dir);
+#else
+    mkdir(dir, 0700);
+#endif
+}
+
+int phit_calib_save(const char *path, const phit_router_t *r) {
+    char def[PHIT_CALIB_PATH_MAX], tmp[PHIT_CALIB_PATH_MAX + 32];
+    if (!path) {
+        if (!phit_calib_path(def, sizeof(def))) return 0;
+        path = def;
+    }
+    phit__calib_file_t *f = calloc(1, sizeof(phit__calib_file_t));
+    if (!f) return 0;
+    memcpy(f->magic, PHIT__CALIB_MAGIC, sizeof(f->magic));
+    f->version = PHIT_CALIB_VERSION;
+    f->bytes = (uint32_t)sizeof(phit__calib_file_t);
+    phit_calib_key(&f->key);
+    f->caps = *phit_timer_caps();
+    f->created_unix = (int64_t)time(NULL);
+    if (r && r->ready) {
+        f->has_router = 1;
+        f->num_slots = r->num_slots;
+        f->calib_count = r->calib_count;
+        memcpy(f->hist, r->hist, sizeof(f->hist));
+        memcpy(f->slot_map, r->slot_map, sizeof(f->slot_map));
+        memcpy(f->cdf_lo, r->cdf_lo, sizeof(f->cdf_lo));
+        memcpy(f->cdf_span, r->cdf_span, sizeof(f->cdf_span));
+    }
+    f->checksum = phit__calib_checksum(f);
+
+    /* Unique temporary name, then rename over the old cache */
+    snprintf(tmp, sizeof(tmp), "%s.%llx.tmp", path,
+             (unsigned long long)(phit_hash64(phit_now_ns()) & 0xFFFFFFFFULL));
+    FILE *out = fopen(tmp, "wb");
+    if (!out) {
+        phit__calib_mkdir_parent(path);
+        out = fopen(tmp, "wb");
+    }
+    int ok = 0;
+    if (out) {
+        ok = fwrite(f, sizeof(phit__calib_file_t), 1, out) == 1;
+        ok = (fclose(out) == 0) && ok;
+#if defined(_WIN32)
+        if (ok) remove(path);   /* rename does not replace on Windows */
+#endif
+        if (ok) ok = rename(tmp, path) == 0;
+        if (!ok) remove(tmp);
+    }
+    free(f);
+    return ok;
+}
+
+/* ---- Validation ---- */
+
+void phit_calib_check(const phit_timer_caps_t *caps, const phit_router_t *r,
+                      int samples, phit_calib_check_t *out) {
+    memset(out, 0, sizeof(phit_calib_check_t));
+    if (samples < 1) samples = PHIT_CALIB_CHECK_SAMPLES;
+    /* Quantize with the cached tick, not the installed one */
+    double tick = caps->tick < 1.0 ? 1.0 : caps->tick;
+    uint64_t mul = (uint64_t)(4294967296.0 / tick);
+    uint32_t *hist = r ? calloc(PHIT_ROUTER_MAX_DELTA, sizeof(uint32_t)) : NULL;
+
+    uint64_t t0 = phit_now_ns(), u0 = phit_now_ticks();
+    for (int i = 0; i < samples; i++) {
+        uint64_t t1 = phit_now_ticks();
+        phit_workload();
+        uint64_t t2 = phit_now_ticks();
+        uint64_t q = ((t2 - t1) * mul + (1ULL << 31)) >> 32;
+        if (q >= PHIT_ROUTER_MAX_DELTA) q = PHIT_ROUTER_MAX_DELTA - 1;
+        if (hist) hist[q]++;
+    }
+    uint64_t u1 = phit_now_ticks(), t1 = phit_now_ns();
+    out->samples = samples;
+    out->check_ns = t1 - t0;
+
+    if (u1 > u0 && caps->ns_per_unit > 0) {
+        double ns_per_unit = (double)(t1 - t0) / (double)(u1 - u0);
+        double e = ns_per_unit / caps->ns_per_unit - 1.0;
+        out->unit_error = e < 0 ? -e : e;
+    } else {
+        out->unit_error = 1.0;
+    }
+    if (hist) {
+        /* CDFs, then the largest lead of either one over the other
+         * shifted right by the slack */
+        double *fc = malloc(2 * PHIT_ROUTER_MAX_DELTA * sizeof(double)), *ff;
+        if (fc) {
+            ff = fc + PHIT_ROUTER_MAX_DELTA;
+            double cached = r->calib_count ? (double)r->calib_count : 1.0;
+            uint64_t fresh_sum = 0, cached_sum = 0;
+            for (int d = 0; d < PHIT_ROUTER_MAX_DELTA; d++) {
+                fresh_sum += hist[d];
+                cached_sum += r->hist[d];
+                ff[d] = (double)fresh_sum / samples;
+                fc[d] = (double)cached_sum / cached;
+            }
+            double dist = 0;
+            for (int d = 0; d < PHIT_ROUTER_MAX_DELTA; d++) {
+                int h = (int)(d * PHIT_CALIB_DELTA_SLACK + 0.999);
+                int j = d + (h < 1 ? 1 : h);
+                if (j >= PHIT_ROUTER_MAX_DELTA) j = PHIT_ROUTER_MAX_DELTA - 1;
+                if (ff[d] - fc[j] > dist) dist = ff[d] - fc[j];
+                if (fc[d] - ff[j] > dist) dist = fc[d] - ff[j];
+            }
+            out->distance = dist;
+            free(fc);
+        } else {
+            out->distance = 1.0;
+        }
+        free(hist);
+    }
+}
+
+int phit_calib_load(const char *path, phit_router_t *r, int num_slots,
+                    phit_calib_check_t *check) {
+    char def[PHIT_CALIB_PATH_MAX];
+    if (!path) {
+        if (!phit_calib_path(def, sizeof(def))) return PHIT_CALIB_MISSING;
+        path = def;
+    }
+    FILE *in = fopen(path, "rb");
+    if (!in) return PHIT_CALIB_MISSING;
+    phit__calib_file_t *f = malloc(sizeof(phit__calib_file_t));
+    int ok = f && fread(f, sizeof(phit__calib_file_t), 1, in) == 1 && fgetc(in) == EOF;
+    fclose(in);
+
+    phit_calib_key_t key;
+    if (ok) {
+        phit_calib_key(&key);
+        ok = !memcmp(f->magic, PHIT__CALIB_MAGIC, sizeof(f->magic)) &&
+             f->version == PHIT_CALIB_VERSION &&
+             f->bytes == (uint32_t)sizeof(phit__calib_file_t) &&
+             f->checksum == phit__calib_checksum(f) &&
+             !memcmp(&f->key, &key, sizeof(key)) &&
+             (!r || (f->has_router && num_slots >= 1 && num_slots < PHIT_ROUTER_SPLIT));
+    }
+    if (!ok) {
+        free(f);
+        return PHIT_CALIB_MISMATCH;
+    }
+
+    /* The router struct carries the cached histogram into the check */
+    phit_router_t *cached = r ? calloc(1, sizeof(phit_router_t)) : NULL;
+    if (cached) {
+        cached->num_slots = f->num_slots;
+        cached->calib_count = f->calib_count;
+        memcpy(cached->hist, f->hist, sizeof(f->hist));
+        memcpy(cached->slot_map, f->slot_map, sizeof(f->slot_map));
+        memcpy(cached->cdf_lo, f->cdf_lo, sizeof(f->cdf_lo));
+        memcpy(cached->cdf_span, f->cdf_span, sizeof(f->cdf_span));
+    }
+    phit_calib_check_t c;
+    phit_calib_check(&f->caps, cached, PHIT_CALIB_CHECK_SAMPLES, &c);
+    if (check) *check = c;
+
+    int status = PHIT_CALIB_HIT;
+    if (c.unit_error > PHIT_CALIB_UNIT_TOL) {
+        status = PHIT_CALIB_STALE_TIMER;
+    } else {
+        /* Installed only if no probe has claimed the caps; either is valid */
+        phit__timer_caps_offer(&f->caps);
+        if (cached && c.distance > PHIT_CALIB_MAX_DISTANCE) status = PHIT_CALIB_STALE_DELTAS;
+    }
+    if (status == PHIT_CALIB_HIT && cached) {
+        phit_router_init(r, num_slots, 0);
+        r->calib_count = cached->calib_count;
+        memcpy(r->hist, cached->hist, sizeof(r->hist));
+        if (num_slots == cached->num_slots) {
+            memcpy(r->slot_map, cached->slot_map, sizeof(r->slot_map));
+            memcpy(r->cdf_lo, cached->cdf_lo, sizeof(r->cdf_lo));
+            memcpy(r->cdf_span, cached->cdf_span, sizeof(r->cdf_span));
+            r->ready = 1;
+        } else {
+            phit_router_rebuild(r);
+        }
+    }
+    free(cached);
+    free(f);
+    return status;
+}
+
+/* ---- Background recalibration ---- */
+
+static struct {
+    phit__thread_t thread;
+    int            launched;      /* never reset: one run per process */
+    int            joinable;
+    int            done;          /* release: router and saved are final */
+    int            saved;
+    uint64_t       adopted;       /* first phit_calib_adopt wins */
+    int            num_slots;
+    char           path[PHIT_CALIB_PATH_MAX];
+    phit_router_t  router;
+} phit__calib_bg;
+
+static void phit__calib_recalibrate(void) {
+    /* Probes if the load did not install caps */
+    (void)phit_timer_caps();
+    phit_router_t *r = &phit__calib_bg.router;
+    phit_router_init(r, phit__calib_bg.num_slots, 0);
+    while (!phit_router_calibrate(r, 65536)) {}
+    phit__calib_bg.saved = phit_calib_save(phit__calib_bg.path[0] ? phit__calib_bg.path : NULL, r);
+    PHIT__STORE_RELEASE(&phit__calib_bg.done, 1);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI phit__calib_main(LPVOID arg) {
+    (void)arg;
+    phit__calib_recalibrate();
+    return 0;
+}
+#else
+static void *phit__calib_main(void *arg) {
+    (void)arg;
+    phit__calib_recalibrate();
+    return NULL;
+}
+#endif
+
+int phit_calib_start(const char *path, phit_router_t *r, int num_slots) {
+    int status = phit_calib_load(path, r, num_slots, NULL);
+    if (status == PHIT_CALIB_HIT) return status;
+    if (r) phit_router_init(r, num_slots, 0);
+    if (phit__calib_bg.launched || num_slots < 1 || num_slots >= PHIT_ROUTER_SPLIT) return status;
+
+    phit__calib_bg.num_slots = num_slots;
+    phit__calib_bg.path[0] = 0;
+    if (path) snprintf(phit__calib_bg.path, sizeof(phit__calib_bg.path), "%s", path);
+#if defined(_WIN32)
+    phit__calib_bg.thread = CreateThread(NULL, 0, phit__calib_main, NULL, 0, NULL);
+    phit__calib_bg.joinable = phit__calib_bg.thread != NULL;
+#else
+    phit__calib_bg.joinable = pthread_create(&phit__calib_bg.thread, NULL, phit__calib_main, NULL) == 0;
+#endif
+    phit__calib_bg.launched = phit__calib_bg.joinable;
+    return status;
+}
+
+int phit_calib_adopt(phit_router_t *r) {
+    if (!phit__calib_bg.launched || !PHIT__LOAD_ACQUIRE(&phit__calib_bg.done)) return 0;
+    if (PHIT__XCHG64(&phit__calib_bg.adopted, 1) != 0) return 0;
+    const phit_router_t *src = &phit__calib_bg.router;
+    int num_slots = r->num_slots;
+    if (num_slots == src->num_slots) {
+        memcpy(r, src, sizeof(phit_router_t));
+    } else {
+        r->calib_count = src->calib_count;
+        r->since_rebuild = 0;
+        memcpy(r->hist, src->hist, sizeof(r->hist));
+        phit_router_rebuild(r);
+    }
+    return 1;
+}
+
+int phit_calib_wait(void) {
+    if (!phit__calib_bg.joinable) return PHIT__LOAD_ACQUIRE(&phit__calib_bg.done) && phit__calib_bg.saved;
+#if defined(_WIN32)
+    WaitForSingleObject(phit__calib_bg.thread, INFINITE);
+    CloseHandle(phit__calib_bg.thread);
+#else
+    pthread_join(phit__calib_bg.thread, NULL);
+#endif
+    phit__calib_bg.joinable = 0;
+    return phit__calib_bg.saved;
+}
+
+const char *phit_calib_status_name(int status) {
+    switch (status) {
+    case PHIT_CALIB_HIT:          return "hit";
+    case PHIT_CALIB_MISSING:      return "missing";
+    case PHIT_CALIB_MISMATCH:     return "mismatch";
+    case PHIT_CALIB_STALE_TIMER:  return "stale timer";
+    case PHIT_CALIB_STALE_DELTAS: return "stale deltas";
+    default:                      return "?";
+    }
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_CALIB_H */
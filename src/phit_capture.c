@@ -0,0 +1,407 @@
+/*
+ * phit_capture — Raw-sample capture for offline entropy estimation
+ * ================================================================
+ *
+ * Streams raw workload deltas (bit-packed to the measured width) and
+ * conditioned pool output into the chunked binary format of
+ * phit_capture.h, for NIST ea_non_iid, TestU01 or dieharder:
+ *
+ *   phit_capture -o FILE [-n SAMPLES] [-k CHUNK] [-c RATIO] [-w BITS]
+ *   phit_capture -i FILE            header, per-chunk checks, raw statistics
+ *
+ * FILE "-" is stdout. A calibration pass of 65536 deltas picks raw_base
+ * (the minimum) and raw_bits (covering the 99.99th percentile); -w forces
+ * the width. -c 0 drops the conditioned stream.
+ *
+ * The sampling thread only fills memory: full chunks go to a writer
+ * thread through PHIT_CAPTURE_BUFFERS preallocated buffers, so file I/O
+ * never runs between two timer reads. If the disk falls behind and every
+ * buffer is queued, the sampler waits and records the wait in the next
+ * chunk's stall_ns, so back-pressure is visible instead of silently
+ * stretching the deltas.
+ *
+ * Compile: cmake -S . -B build && cmake --build build --target phit_capture
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libphit.h"
+#include "phit_capture.h"
+
+#define PHIT_CAPTURE_BUFFERS 4
+#define CALIB_SAMPLES 65536
+
+/* ---- Buffers: free list -> sampler -> write queue -> writer -> free list ---- */
+
+typedef struct {
+    uint8_t *mem;
+    size_t   len;
+} cap_buf_t;
+
+typedef struct {
+    FILE           *out;
+    cap_buf_t       bufs[PHIT_CAPTURE_BUFFERS];
+    int             free_list[PHIT_CAPTURE_BUFFERS], free_n;
+    int             queue[PHIT_CAPTURE_BUFFERS], q_head, q_n;
+    int             done, write_error;
+    uint64_t        bytes_written;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+} cap_io_t;
+
+static void *cap_writer(void *p) {
+    cap_io_t *io = p;
+    pthread_mutex_lock(&io->mu);
+    for (;;) {
+        while (io->q_n == 0 && !io->done) pthread_cond_wait(&io->cv, &io->mu);
+        if (io->q_n == 0) break;
+        int b = io->queue[io->q_head];
+        io->q_head = (io->q_head + 1) % PHIT_CAPTURE_BUFFERS;
+        io->q_n--;
+        pthread_mutex_unlock(&io->mu);
+
+        size_t len = io->bufs[b].len;
+        int err = fwrite(io->bufs[b].mem, 1, len, io->out) != len;
+
+        pthread_mutex_lock(&io->mu);
+        io->write_error |= err;
+        io->bytes_written += len;
+        io->free_list[io->free_n++] = b;
+        pthread_cond_broadcast(&io->cv);
+    }
+    pthread_mutex_unlock(&io->mu);
+    return NULL;
+}
+
+/* Next free buffer; *stall_ns gets the time spent waiting for one */
+static int cap_acquire(cap_io_t *io, uint64_t *stall_ns) {
+    pthread_mutex_lock(&io->mu);
+    uint64_t t0 = io->free_n ? 0 : phit_now_ns();
+    while (io->free_n == 0) pthread_cond_wait(&io->cv, &io->mu);
+    int b = io->free_list[--io->free_n];
+    pthread_mutex_unlock(&io->mu);
+    *stall_ns = t0 ? phit_now_ns() - t0 : 0;
+    return b;
+}
+
+static void cap_submit(cap_io_t *io, int b, size_t len) {
+    pthread_mutex_lock(&io->mu);
+    io->bufs[b].len = len;
+    io->queue[(io->q_head + io->q_n) % PHIT_CAPTURE_BUFFERS] = b;
+    io->q_n++;
+    pthread_cond_broadcast(&io->cv);
+    pthread_mutex_unlock(&io->mu);
+}
+
+/* ---- Sampling ---- */
+
+static inline uint64_t cap_delta(uint64_t *t_end) {
+    uint64_t t1 = phit_now_ticks();
+    phit_workload();
+    uint64_t t2 = phit_now_ticks();
+    *t_end = t2;
+    return t2 - t1;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* phit_pool_extract()'s digest and forward mutation, minus its harvests */
+static uint64_t cap_digest(phit_pool_t *p) {
+    uint64_t out = p->pool[0] ^ rotl64(p->pool[1], 13) ^ rotl64(p->pool[2], 29) ^
+                   rotl64(p->pool[3], 43);
+    p->pool[0] ^= rotl64(out, 7);
+    p->pool[1] ^= rotl64(out, 23);
+    return out;
+}
+
+static void platform_name(char *buf, size_t len) {
+    const char *os =
+#if defined(__APPLE__)
+        "macos";
+#elif defined(__linux__)
+        "linux";
+#elif defined(__FreeBSD__)
+        "freebsd";
+#elif defined(_WIN32)
+        "windows";
+#else
+        "unknown";
+#endif
+    const char *arch =
+#if defined(__aarch64__) || defined(_M_ARM64)
+        "arm64";
+#elif defined(__x86_64__) || defined(_M_X64)
+        "x86_64";
+#elif defined(__riscv)
+        "riscv64";
+#else
+        "unknown";
+#endif
+    snprintf(buf, len, "%s %s", os, arch);
+}
+
+static int capture(const char *path, uint64_t samples, uint32_t chunk, uint32_t ratio, int force_bits) {
+    const phit_timer_caps_t *caps = phit_timer_caps();
+    phit_capture_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PHIT_CAPTURE_MAGIC, sizeof(PHIT_CAPTURE_MAGIC));
+    h.version = PHIT_CAPTURE_VERSION;
+    h.header_bytes = sizeof(h);
+    h.endian = PHIT_CAPTURE_ENDIAN;
+    h.cond_ratio = ratio;
+    h.chunk_samples = chunk;
+    h.workload_iters = PHIT_WORKLOAD_ITERS;
+    h.timer_backend = caps->backend;
+    platform_name(h.platform, sizeof(h.platform));
+    snprintf(h.timer, sizeof(h.timer), "%s", phit_timer_backend_name());
+    h.ns_per_unit = caps->ns_per_unit;
+    h.tick = caps->tick;
+    h.tick_ns = caps->tick_ns;
+    h.read_ns = caps->read_ns;
+    h.delta_mean = caps->delta_mean;
+    h.delta_entropy = caps->delta_entropy;
+    h.lsb_shift = caps->lsb_shift;
+    h.delta_levels = caps->delta_levels;
+
+    /* Calibration: base = minimum, width covers the 99.99th percentile */
+    uint64_t *cal = malloc(sizeof(uint64_t) * CALIB_SAMPLES), t;
+    for (int i = 0; i < CALIB_SAMPLES; i++) cal[i] = cap_delta(&t);
+    qsort(cal, CALIB_SAMPLES, sizeof(uint64_t), cmp_u64);
+    h.raw_base = cal[0];
+    uint64_t span = cal[CALIB_SAMPLES - 1 - CALIB_SAMPLES / 10000] - cal[0];
+    int bits = 1;
+    while (bits < PHIT_CAPTURE_MAX_BITS && (span >> bits)) bits++;
+    h.raw_bits = (uint32_t)(force_bits ? force_bits : bits);
+    free(cal);
+
+    FILE *out = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    static char iobuf[1 << 20];
+    setvbuf(out, iobuf, _IOFBF, sizeof(iobuf));
+
+    cap_io_t io;
+    memset(&io, 0, sizeof(io));
+    io.out = out;
+    pthread_mutex_init(&io.mu, NULL);
+    pthread_cond_init(&io.cv, NULL);
+    size_t cap_bytes = sizeof(phit_capture_chunk_t) + phit_capture_raw_bytes(chunk, h.raw_bits) +
+                       (ratio ? 8 * (size_t)(chunk / ratio + 1) : 0) + 8;
+    for (int b = 0; b < PHIT_CAPTURE_BUFFERS; b++) {
+        io.bufs[b].mem = malloc(cap_bytes);
+        io.free_list[io.free_n++] = b;
+    }
+
+    h.start_ns = phit_now_ns();
+    h.start_unix = (int64_t)time(NULL);
+    int b = io.free_list[--io.free_n];
+    memcpy(io.bufs[b].mem, &h, sizeof(h));
+    cap_submit(&io, b, sizeof(h));
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, cap_writer, &io) != 0) {
+        fprintf(stderr, "phit_capture: cannot start the writer thread\n");
+        return 1;
+    }
+
+    const uint64_t vmax = h.raw_bits == 32 ? 0xFFFFFFFFULL : (1ULL << h.raw_bits) - 1;
+    phit_pool_t pool;
+    phit_pool_init(&pool);
+    uint64_t stall = 0, stalled_chunks = 0, clamped_total = 0, total = samples;
+    uint64_t t0 = phit_now_ns();
+    for (uint32_t index = 0; samples; index++) {
+        uint32_t n = samples < chunk ? (uint32_t)samples : chunk;
+        b = cap_acquire(&io, &stall);
+        stalled_chunks += stall != 0;
+        uint8_t *mem = io.bufs[b].mem;
+        phit_capture_chunk_t *c = (phit_capture_chunk_t *)mem;
+        uint8_t *raw = mem + sizeof(*c);
+        uint8_t *rp = raw;
+        uint8_t *cond = raw + phit_capture_raw_bytes(n, h.raw_bits);
+        memset(c, 0, sizeof(*c));
+        c->magic = PHIT_CAPTURE_CHUNK_MAGIC;
+        c->index = index;
+        c->samples = n;
+        c->stall_ns = stall;
+
+        uint64_t acc = 0, t_end = 0;
+        int acc_bits = 0;
+        uint32_t words = 0;
+        c->t_first = phit_now_ticks();
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t d = cap_delta(&t_end);
+            uint64_t v = d > h.raw_base ? d - h.raw_base : 0;
+            if (v > vmax) {
+                v = vmax;
+                c->clamped++;
+            }
+            acc |= v << acc_bits;
+            acc_bits += (int)h.raw_bits;
+            while (acc_bits >= 8) {
+                *rp++ = (uint8_t)acc;
+                acc >>= 8;
+                acc_bits -= 8;
+            }
+            if (ratio) {
+                phit_pool_feed(&pool, t_end ^ (d << 40));
+                if ((i + 1) % ratio == 0) {
+                    uint64_t w = cap_digest(&pool);
+                    memcpy(cond + 8 * words++, &w, sizeof(w));
+                }
+            }
+        }
+        if (acc_bits) *rp++ = (uint8_t)acc;
+        c->t_last = t_end;
+        c->raw_bytes = (uint32_t)(rp - raw);
+        c->cond_bytes = 8 * words;
+        clamped_total += c->clamped;
+        /* Packed raw bytes end where the conditioned words start */
+        cap_submit(&io, b, sizeof(*c) + c->raw_bytes + c->cond_bytes);
+        samples -= n;
+    }
+    uint64_t t1 = phit_now_ns();
+
+    pthread_mutex_lock(&io.mu);
+    io.done = 1;
+    pthread_cond_broadcast(&io.cv);
+    pthread_mutex_unlock(&io.mu);
+    pthread_join(writer, NULL);
+    int err = io.write_error | (fflush(out) != 0);
+    if (out != stdout) err |= fclose(out) != 0;
+    for (int k = 0; k < PHIT_CAPTURE_BUFFERS; k++) free(io.bufs[k].mem);
+    pthread_mutex_destroy(&io.mu);
+    pthread_cond_destroy(&io.cv);
+
+    fprintf(stderr, "phit_capture: %s, %s timer, base %llu, %u bits/delta, %llu samples, "
+            "%llu bytes, %.2f Msample/s, %llu clamped, %llu stalled chunks%s\n",
+            h.platform, h.timer, (unsigned long long)h.raw_base, h.raw_bits,
+            (unsigned long long)total, (unsigned long long)io.bytes_written,
+            (double)total / ((double)(t1 - t0) / 1e3), (unsigned long long)clamped_total,
+            (unsigned long long)stalled_chunks, err ? ", WRITE ERROR" : "");
+    return err;
+}
+
+/* ---- Reader ---- */
+
+static int info(const char *path) {
+    FILE *in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+    phit_capture_header_t h;
+    if (fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, PHIT_CAPTURE_MAGIC, 8) ||
+        h.endian != PHIT_CAPTURE_ENDIAN || h.header_bytes != sizeof(h) ||
+        h.raw_bits < 1 || h.raw_bits > PHIT_CAPTURE_MAX_BITS) {
+        fprintf(stderr, "%s: not a phit_capture v%d file (or other byte order)\n", path,
+                PHIT_CAPTURE_VERSION);
+        return 1;
+    }
+    printf("%s: version %u, %s, %s timer (backend %d)\n", path, h.version, h.platform, h.timer,
+           h.timer_backend);
+    printf("  calibration: unit %.3f ns, tick %.2f units (%.2f ns), read %.1f ns, "
+           "dead LSBs %d, %d delta levels, %.2f bits\n", h.ns_per_unit, h.tick, h.tick_ns,
+           h.read_ns, h.lsb_shift, h.delta_levels, h.delta_entropy);
+    printf("  raw: base %llu, %u bits; conditioned: 1 word / %u deltas; %u deltas/chunk, "
+           "workload %u iters\n", (unsigned long long)h.raw_base, h.raw_bits, h.cond_ratio,
+           h.chunk_samples, h.workload_iters);
+
+    /* Entropy of the raw values, at most 2^16 distinct levels tracked */
+    enum { LEVELS = 1 << 16 };
+    uint64_t *hist = calloc(LEVELS, sizeof(uint64_t));
+    uint64_t chunks = 0, samples = 0, clamped = 0, cond = 0, stalls = 0, stall_ns = 0, bad = 0;
+    double sum = 0;
+    uint8_t *buf = NULL;
+    size_t cap = 0;
+    phit_capture_chunk_t c;
+    while (fread(&c, sizeof(c), 1, in) == 1) {
+        size_t len = (size_t)c.raw_bytes + c.cond_bytes;
+        if (c.magic != PHIT_CAPTURE_CHUNK_MAGIC || c.index != chunks ||
+            c.raw_bytes != phit_capture_raw_bytes(c.samples, h.raw_bits) || c.cond_bytes % 8) {
+            bad++;
+            break;
+        }
+        if (len > cap) {
+            cap = len;
+            buf = realloc(buf, cap);
+        }
+        if (fread(buf, 1, len, in) != len) {
+            bad++;
+            break;
+        }
+        for (uint32_t i = 0; i < c.samples; i++) {
+            uint32_t v = phit_capture_unpack(buf, h.raw_bits, i);
+            hist[v < LEVELS ? v : LEVELS - 1]++;
+            sum += v;
+        }
+        chunks++;
+        samples += c.samples;
+        clamped += c.clamped;
+        cond += c.cond_bytes / 8;
+        stalls += c.stall_ns != 0;
+        stall_ns += c.stall_ns;
+    }
+    double shannon = 0, pmax = 0;
+    int levels = 0;
+    for (int v = 0; v < LEVELS; v++) {
+        if (!hist[v]) continue;
+        double p = (double)hist[v] / (double)samples;
+        levels++;
+        shannon -= p * log2(p);
+        if (p > pmax) pmax = p;
+    }
+    printf("  %llu chunks, %llu deltas (mean %.2f above base, %d levels, H %.3f bits, "
+           "H_inf %.3f bits), %llu clamped\n", (unsigned long long)chunks,
+           (unsigned long long)samples, samples ? sum / (double)samples : 0, levels, shannon,
+           pmax > 0 ? -log2(pmax) : 0, (unsigned long long)clamped);
+    printf("  %llu conditioned words; %llu stalled chunks (%.3f ms waiting)%s\n",
+           (unsigned long long)cond, (unsigned long long)stalls, stall_ns / 1e6,
+           bad ? "; TRUNCATED OR CORRUPT" : "");
+    free(hist);
+    free(buf);
+    if (in != stdin) fclose(in);
+    return bad ? 1 : 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s -o FILE [-n SAMPLES] [-k CHUNK] [-c RATIO] [-w BITS]\n"
+                    "       %s -i FILE\n", argv0, argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *out = NULL, *in = NULL;
+    double samples = 1 << 24;
+    long chunk = 1 << 20, ratio = 32, bits = 0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (!strcmp(argv[i], "-o")) out = argv[++i];
+        else if (!strcmp(argv[i], "-i")) in = argv[++i];
+        else if (!strcmp(argv[i], "-n")) samples = strtod(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-k")) chunk = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-c")) ratio = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-w")) bits = strtol(argv[++i], NULL, 0);
+        else usage(argv[0]);
+    }
+    if (in) return info(in);
+    if (!out || samples < 1 || chunk < 1 || chunk > (1L << 28) || ratio < 0 ||
+        bits < 0 || bits > PHIT_CAPTURE_MAX_BITS)
+        usage(argv[0]);
+    return capture(out, (uint64_t)samples, (uint32_t)chunk, (uint32_t)ratio, (int)bits);
+}
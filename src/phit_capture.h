@@ -0,0 +1,96 @@
+/*
+ * phit_capture.h — On-disk format of phit_capture raw-sample dumps
+ * ================================================================
+ *
+ * A capture is one header followed by chunks, each chunk a chunk header,
+ * its bit-packed raw deltas and its conditioned bytes:
+ *
+ *   phit_capture_header_t
+ *   { phit_capture_chunk_t, raw[raw_bytes], cond[cond_bytes] } ...
+ *
+ * Raw deltas are phit_now_ticks() differences around one phit_workload()
+ * call, before any hashing. Each is stored as min(delta - raw_base,
+ * 2^raw_bits - 1), packed LSB first starting at the chunk's first raw
+ * byte; saturated values are counted in the chunk's `clamped`.
+ * Conditioned bytes are 64-bit words, one per cond_ratio raw deltas,
+ * from a phit_pool_t fed with every delta's end timestamp (the digest
+ * phit_pool_extract() returns, without extra harvests).
+ *
+ * Fields are host byte order, checked through `endian`; every supported
+ * platform is little endian, so a dump reads the same everywhere. The
+ * readers below only need this header.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_CAPTURE_H
+#define PHIT_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PHIT_CAPTURE_MAGIC     "PHITCAP"         /* 8 bytes with the NUL */
+#define PHIT_CAPTURE_VERSION   1
+#define PHIT_CAPTURE_ENDIAN    0x01020304u
+#define PHIT_CAPTURE_CHUNK_MAGIC 0x4B484350u     /* "PCHK" */
+#define PHIT_CAPTURE_MAX_BITS  32
+
+/* 256 bytes */
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_bytes;      /* sizeof(phit_capture_header_t) */
+    uint32_t endian;            /* PHIT_CAPTURE_ENDIAN as written */
+    uint32_t raw_bits;          /* packed width, 1..PHIT_CAPTURE_MAX_BITS */
+    uint64_t raw_base;          /* subtracted before packing */
+    uint32_t cond_ratio;        /* raw deltas per conditioned word, 0 = none */
+    uint32_t chunk_samples;     /* raw deltas per chunk (the last may be short) */
+    uint32_t workload_iters;    /* PHIT_WORKLOAD_ITERS of the build */
+    int32_t  timer_backend;     /* PHIT_TIMER_COUNTER or PHIT_TIMER_NS */
+    char     platform[32];      /* "<os> <arch>" */
+    char     timer[16];         /* phit_timer_backend_name() */
+    /* Calibration: phit_timer_caps() of the capturing process */
+    double   ns_per_unit;
+    double   tick;
+    double   tick_ns;
+    double   read_ns;
+    double   delta_mean;
+    double   delta_entropy;
+    int32_t  lsb_shift;
+    int32_t  delta_levels;
+    uint64_t start_ns;          /* phit_now_ns() at the first sample */
+    int64_t  start_unix;        /* wall clock at the first sample, seconds */
+    uint8_t  reserved[256 - 168];
+} phit_capture_header_t;
+
+/* 48 bytes */
+typedef struct {
+    uint32_t magic;             /* PHIT_CAPTURE_CHUNK_MAGIC */
+    uint32_t index;
+    uint32_t samples;           /* raw deltas in this chunk */
+    uint32_t clamped;           /* deltas saturated to 2^raw_bits - 1 */
+    uint32_t raw_bytes;         /* ceil(samples * raw_bits / 8) */
+    uint32_t cond_bytes;        /* 8 * conditioned words */
+    uint64_t t_first;           /* phit_now_ticks() before the first workload */
+    uint64_t t_last;            /* ... after the last */
+    uint64_t stall_ns;          /* sampler wait for a free buffer before it */
+} phit_capture_chunk_t;
+
+typedef char phit__capture_header_size[sizeof(phit_capture_header_t) == 256 ? 1 : -1];
+typedef char phit__capture_chunk_size[sizeof(phit_capture_chunk_t) == 48 ? 1 : -1];
+
+static inline size_t phit_capture_raw_bytes(uint32_t samples, uint32_t bits) {
+    return ((size_t)samples * bits + 7) / 8;
+}
+
+/* Raw value i of a chunk's packed bytes (LSB first) */
+static inline uint32_t phit_capture_unpack(const uint8_t *raw, uint32_t bits, uint32_t i) {
+    uint64_t bit = (uint64_t)i * bits, v = 0;
+    const uint8_t *p = raw + bit / 8;
+    int shift = (int)(bit % 8);
+    for (int k = 0; k * 8 < shift + (int)bits; k++) v |= (uint64_t)p[k] << (8 * k);
+    return (uint32_t)((v >> shift) & ((bits == 32) ? 0xFFFFFFFFULL : ((1ULL << bits) - 1)));
+}
+
+#endif /* PHIT_CAPTURE_H */
@@ -15,7 +15,7 @@
  * l'informazione di fase come segreto condiviso tra chi conosce
  * i rapporti tra i clock.
  *
- * Compila: gcc -O0 -o phit_crypto phit_crypto.c -lm
+ * Compila: cmake -S . -B build && cmake --build build --target phit_crypto
  *
  * Author: Alessio Cazzaniga
  */
@@ -25,14 +25,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
-#include <mach/mach_time.h>
 
-static volatile uint64_t sink;
-
-static inline uint64_t now_ns(void) {
-    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
-}
+#include "libphit.h"
 
 /* ========== Phase Key Derivation ========== */
 
@@ -68,12 +62,7 @@ static uint8_t phase_keystream_byte(phase_key_t *key, double t, int index) {
                     + index * 0.618033988749895;  /* golden ratio perturbation */
 
     /* Hash-like mixing */
-    uint64_t x = (uint64_t)(combined * 1e15);
-    x ^= x >> 30;
-    x *= 0xBF58476D1CE4E5B9ULL;
-    x ^= x >> 27;
-    x *= 0x94D049BB133111EBULL;
-    x ^= x >> 31;
+    uint64_t x = phit_hash64((uint64_t)(combined * 1e15));
 
     return (uint8_t)(x & 0xFF);
 }
@@ -92,6 +81,50 @@ static void phase_decrypt(phase_key_t *key, double t,
     phase_encrypt(key, t, cipher, plain, len);
 }
 
+/* ========== Block Keystream ========== */
+
+/*
+ * phase_keystream_byte() ricalcola tre fmod e un finalizer per ogni byte.
+ * In modalità blocco il vettore di fase si calcola una volta per
+ * messaggio e diventa una chiave a 128 bit; il keystream è l'espansione
+ * a contatore di libphit (phit_expand_xor), sugli stessi kernel SIMD di
+ * phit_prng_fill: 8 byte per finalizer, 16 finalizer per iterazione con
+ * AVX-512. Cifra in place, anche a pezzi.
+ */
+
+typedef struct {
+    uint64_t k[2];      /* derived from Φ(t) */
+    uint64_t offset;    /* bytes processed so far */
+} phase_stream_t;
+
+static void phase_stream_init(phase_stream_t *s, const phase_key_t *key, double t) {
+    /* Hash the exact bits of each phase: any change in t or a frequency
+     * changes the key */
+    uint64_t h = 0;
+    for (int i = 0; i < 3; i++) {
+        double phi = fmod(key->freq[i] * t, 1.0);
+        uint64_t bits;
+        memcpy(&bits, &phi, sizeof(bits));
+        h = phit_hash64(h ^ bits);
+    }
+    s->k[0] = h;
+    s->k[1] = phit_hash64(h ^ 0x5048415345ULL);   /* "PHASE" */
+    s->offset = 0;
+}
+
+/* XOR the next len bytes of the stream into buf: encrypts and decrypts */
+static void phase_stream_xor(phase_stream_t *s, uint8_t *buf, size_t len) {
+    phit_expand_xor(s->k, s->offset, buf, len);
+    s->offset += len;
+}
+
+/* One-shot, in place */
+static void phase_encrypt_buffer(const phase_key_t *key, double t, uint8_t *buf, size_t len) {
+    phase_stream_t s;
+    phase_stream_init(&s, key, t);
+    phase_stream_xor(&s, buf, len);
+}
+
 /* ========== Phase Window Access ========== */
 
 /*
@@ -106,7 +139,7 @@ typedef struct {
     int clock_pair;         /* quale coppia (0=AB, 1=AC, 2=BC) */
 } phase_lock_t;
 
-static int phase_lock_check(phase_lock_t *lock, double t) {
+static int phase_lock_check(const phase_lock_t *lock, double t) {
     int i = lock->clock_pair;
     int j = (i + 1) % 3;
     double phi_i = fmod(lock->key.freq[i] * t, 1.0);
@@ -120,6 +153,174 @@ static int phase_lock_check(phase_lock_t *lock, double t) {
     return dist <= lock->window_width / 2.0;
 }
 
+/* ========== Phase-Lock Schedule ========== */
+
+/*
+ * phase_lock_check() valuta due fmod per ogni controllo. Le finestre
+ * però sono note in anticipo: Φ_rel(t) = (f_i - f_j)·t mod 1, quindi una
+ * finestra si apre ogni 1/|f_i - f_j| secondi. Lo schedule le calcola
+ * una volta per un orizzonte, come intervalli [lo, hi) in tick di
+ * phit_now_ticks(), e il controllo diventa un indice a bucket: nessun
+ * floating point sul percorso caldo.
+ *
+ * Un bucket è largo al più un periodo (meno l'arrotondamento), quindi
+ * contiene l'inizio di al più due finestre: il controllo legge l'indice
+ * del bucket e confronta due intervalli, senza salti.
+ */
+
+typedef struct {
+    phase_lock_t lock;
+    double    tick_s;           /* seconds per tick */
+    uint64_t  origin_ticks;     /* tick at lock time origin_s */
+    double    origin_s;
+    uint64_t  horizon;          /* ticks indexed ahead of the last extension */
+    double    beat;             /* |f_i - f_j| (Hz) */
+    double    center;           /* window center, in beat phase */
+    /* Open windows in ticks, sorted, followed by two closed sentinels */
+    uint64_t *lo, *hi;
+    int       count, cap;
+    int64_t   next_cycle;       /* next beat cycle to append */
+    uint64_t  base, end;        /* indexed span [base, end) */
+    int       shift;            /* bucket = (ticks - base) >> shift */
+    uint32_t *bucket;
+    size_t    nbuckets;
+} phase_schedule_t;
+
+/* Tick of lock time t: the first tick at or after it when up, else the
+ * last one at or before it */
+static uint64_t phase_schedule_ticks(const phase_schedule_t *s, double t, int up) {
+    double d = (t - s->origin_s) / s->tick_s;
+    d = up ? ceil(d) : floor(d);
+    if (d <= 0) return s->origin_ticks;
+    return s->origin_ticks + (uint64_t)d;
+}
+
+/* Room for need entries in lo/hi. 0 on OOM. */
+static int phase_schedule_reserve(phase_schedule_t *s, int need) {
+    if (need <= s->cap) return 1;
+    int cap = s->cap ? s->cap : 64;
+    while (cap < need) cap *= 2;
+    uint64_t *nlo = realloc(s->lo, sizeof(uint64_t) * (size_t)cap);
+    if (!nlo) return 0;
+    s->lo = nlo;
+    uint64_t *nhi = realloc(s->hi, sizeof(uint64_t) * (size_t)cap);
+    if (!nhi) return 0;
+    s->hi = nhi;
+    s->cap = cap;
+    return 1;
+}
+
+static int phase_schedule_push(phase_schedule_t *s, uint64_t lo, uint64_t hi) {
+    if (!phase_schedule_reserve(s, s->count + 1)) return 0;
+    s->lo[s->count] = lo;
+    s->hi[s->count] = hi;
+    s->count++;
+    return 1;
+}
+
+/* Drop windows closed before now, index [now, now + horizon). 0 on OOM. */
+static int phase_schedule_extend(phase_schedule_t *s, uint64_t now) {
+    int keep = 0;
+    for (int i = 0; i < s->count; i++) {
+        if (s->hi[i] > now) {
+            s->lo[keep] = s->lo[i];
+            s->hi[keep] = s->hi[i];
+            keep++;
+        }
+    }
+    s->count = keep;
+    s->base = now;
+    s->end = now + s->horizon;
+
+    double half = s->lock.window_width / 2.0;
+    if (s->beat == 0 || half >= 0.5) {
+        /* Φ_rel never moves, or the window is the whole circle */
+        double t = s->origin_s;
+        if (s->count == 0 && (half >= 0.5 || phase_lock_check(&s->lock, t)))
+            if (!phase_schedule_push(s, 0, UINT64_MAX)) return 0;
+    } else {
+        for (;;) {
+            double a = (s->next_cycle + s->center - half) / s->beat;
+            double b = (s->next_cycle + s->center + half) / s->beat;
+            uint64_t lo = phase_schedule_ticks(s, a, 1);
+            uint64_t hi = phase_schedule_ticks(s, b, 0) + 1;   /* b is inside */
+            if (lo >= s->end) break;
+            s->next_cycle++;
+            if (hi <= now) continue;
+            if (!phase_schedule_push(s, lo, hi)) return 0;
+        }
+    }
+    /* A closed static lock pushes nothing: the sentinels still need room */
+    if (!phase_schedule_reserve(s, s->count + 2)) return 0;
+    s->lo[s->count] = s->lo[s->count + 1] = UINT64_MAX;
+    s->hi[s->count] = s->hi[s->count + 1] = UINT64_MAX;
+
+    /* Bucket width: the largest power of two within one period */
+    double period = s->beat > 0 ? 1.0 / s->beat / s->tick_s : 1e18;
+    s->shift = 0;
+    while (s->shift < 62 && (double)(2ULL << s->shift) <= period - 2) s->shift++;
+    size_t n = (size_t)((s->horizon >> s->shift) + 1);
+    if (n > s->nbuckets) {
+        uint32_t *nb = realloc(s->bucket, sizeof(uint32_t) * n);
+        if (!nb) return 0;
+        s->bucket = nb;
+    }
+    s->nbuckets = n;
+    int i = 0;
+    for (size_t k = 0; k < n; k++) {
+        uint64_t start = s->base + ((uint64_t)k << s->shift);
+        while (i < s->count && s->hi[i] <= start) i++;
+        s->bucket[k] = (uint32_t)i;
+    }
+    return 1;
+}
+
+/* The lock's time t = origin_s at tick origin. 0 when the windows are
+ * shorter than a tick apart, which no tick index can resolve. */
+static int phase_schedule_init(phase_schedule_t *s, const phase_lock_t *lock,
+                               uint64_t origin, double origin_s, double horizon_s) {
+    memset(s, 0, sizeof(*s));
+    s->lock = *lock;
+    s->tick_s = phit_timer_caps()->ns_per_unit / 1e9;
+    s->origin_ticks = origin;
+    s->origin_s = origin_s;
+    s->horizon = (uint64_t)(horizon_s / s->tick_s);
+    int i = lock->clock_pair, j = (i + 1) % 3;
+    double beat = lock->key.freq[i] - lock->key.freq[j];
+    /* (f_i - f_j)·t - c ≡ k  ⇔  |f_i - f_j|·t - (±c) ≡ k' */
+    s->beat = fabs(beat);
+    s->center = beat < 0 ? -lock->window_center : lock->window_center;
+    if (s->beat > 0 && 1.0 / s->beat / s->tick_s < 4) return 0;
+    s->next_cycle = (int64_t)floor(s->beat * origin_s - s->center) - 1;
+    return phase_schedule_extend(s, origin);
+}
+
+static void phase_schedule_free(phase_schedule_t *s) {
+    free(s->lo);
+    free(s->hi);
+    free(s->bucket);
+}
+
+/* 1 open, 0 closed, -1 outside the indexed span (extend first) */
+static inline int phase_schedule_check(const phase_schedule_t *s, uint64_t now) {
+    if (now - s->base >= s->horizon) return -1;
+    uint32_t i = s->bucket[(now - s->base) >> s->shift];
+    return ((now >= s->lo[i]) & (now < s->hi[i])) |
+           ((now >= s->lo[i + 1]) & (now < s->hi[i + 1]));
+}
+
+/* Same answer by binary search over the window starts */
+static int phase_schedule_check_bsearch(const phase_schedule_t *s, uint64_t now) {
+    if (now - s->base >= s->horizon) return -1;
+    int lo = 0, hi = s->count;          /* first window starting after now */
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (s->lo[mid] <= now) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 && now < s->hi[lo - 1];
+}
+
 /* ========== Demo ========== */
 
 static void demo_basic_encrypt(void) {
@@ -137,7 +338,7 @@ static void demo_basic_encrypt(void) {
     uint8_t decrypted[256];
 
     /* Encrypt at current time */
-    double t = (double)now_ns() / 1e9;
+    double t = (double)phit_now_ns() / 1e9;
     phase_encrypt(&key, t, (const uint8_t *)message, cipher, len);
 
     printf("  Plaintext:   \"%s\"\n", message);
@@ -270,7 +471,7 @@ static void demo_temporal_otp(void) {
            "------------", "----------------", "-----------------------");
 
     uint8_t prev_cipher[256] = {0};
-    double base_t = (double)now_ns() / 1e9;
+    double base_t = (double)phit_now_ns() / 1e9;
 
     for (int i = 0; i < 10; i++) {
         double t = base_t + i * 1e-9;  /* 1 ns apart */
@@ -294,6 +495,174 @@ static void demo_temporal_otp(void) {
     printf("  → Hamming distance ≈ 50%% = maximum diffusion.\n");
 }
 
+static void demo_block_mode(void) {
+    printf("\n=== DEMO 4: Block Keystream ===\n");
+    printf("  One phase vector per message, counter-mode keystream, in place.\n\n");
+
+    phase_key_t key = {
+        .freq = {3228e6, 2064e6, 24e6},
+        .t_origin = 0
+    };
+    const size_t len = 1 << 20;
+    uint8_t *plain = malloc(len), *buf = malloc(len), *chunked = malloc(len);
+    for (size_t i = 0; i < len; i++) plain[i] = (uint8_t)(i * 31 + 7);
+    double t = (double)phit_now_ns() / 1e9;
+
+    /* Per-byte reference rate */
+    uint64_t t0 = phit_now_ns();
+    phase_encrypt(&key, t, plain, buf, (int)len);
+    uint64_t t1 = phit_now_ns();
+    double byte_rate = len / ((t1 - t0) / 1e9) / 1e6;
+
+    /* Block mode, repeated so the rate is not one cold pass */
+    const int reps = 64;
+    memcpy(buf, plain, len);
+    t0 = phit_now_ns();
+    for (int r = 0; r < reps; r++) phase_encrypt_buffer(&key, t, buf, len);
+    t1 = phit_now_ns();
+    double block_rate = reps * (double)len / ((t1 - t0) / 1e9) / 1e6;
+    int restored = memcmp(buf, plain, len) == 0;    /* an even number of passes */
+
+    /* Streaming: odd-sized chunks give the same ciphertext as one call */
+    memcpy(buf, plain, len);
+    phase_encrypt_buffer(&key, t, buf, len);
+    memcpy(chunked, plain, len);
+    phase_stream_t s;
+    phase_stream_init(&s, &key, t);
+    for (size_t done = 0, step = 1; done < len; step = step * 5 + 3) {
+        size_t n = step < len - done ? step : len - done;
+        phase_stream_xor(&s, chunked + done, n);
+        done += n;
+    }
+    int same = memcmp(buf, chunked, len) == 0;
+    phase_encrypt_buffer(&key, t, buf, len);
+    int decrypted = memcmp(buf, plain, len) == 0;
+
+    /* Wrong time → a different keystream */
+    memcpy(buf, plain, len);
+    phase_encrypt_buffer(&key, t, buf, len);
+    phase_encrypt_buffer(&key, t + 1e-6, buf, len);
+    size_t equal = 0;
+    for (size_t i = 0; i < len; i++) equal += buf[i] == plain[i];
+
+    printf("  Payload:      %zu bytes (SIMD: %s)\n", len, phit_simd_name(phit_simd_level()));
+    printf("  Per-byte:     %8.1f MB/s\n", byte_rate);
+    printf("  Block:        %8.1f MB/s (%.0fx)\n", block_rate, block_rate / byte_rate);
+    printf("  Round trip:   %s, chunked == one-shot: %s, %d passes restore: %s\n",
+           decrypted ? "CORRECT" : "WRONG", same ? "yes" : "NO", reps, restored ? "yes" : "NO");
+    printf("  Wrong time (1µs off): %.2f%% bytes recovered → GARBAGE\n", 100.0 * equal / len);
+
+    free(plain);
+    free(buf);
+    free(chunked);
+}
+
+/* Checks per second of one checker over a tick array */
+typedef int (*schedule_check_fn)(const phase_schedule_t *s, uint64_t now);
+
+static int schedule_check_float(const phase_schedule_t *s, uint64_t now) {
+    return phase_lock_check(&s->lock, s->origin_s + (double)(now - s->origin_ticks) * s->tick_s);
+}
+
+static int schedule_check_bucket(const phase_schedule_t *s, uint64_t now) {
+    return phase_schedule_check(s, now);
+}
+
+static double schedule_rate(schedule_check_fn fn, const phase_schedule_t *s,
+                            const uint64_t *ticks, int n, int *open) {
+    int acc = 0;
+    uint64_t t0 = phit_now_ns();
+    for (int r = 0; r < 8; r++) {
+        for (int i = 0; i < n; i++) acc += fn(s, ticks[i]);
+    }
+    uint64_t t1 = phit_now_ns();
+    *open = acc / 8;
+    return 8.0 * n / ((t1 - t0) / 1e9);
+}
+
+/* Float and index disagree only on ticks the float check rounds across */
+static int schedule_mismatches(const phase_schedule_t *s, uint64_t from, uint64_t span,
+                               uint64_t *ticks, int n) {
+    uint64_t x = 0x9E3779B97F4A7C15ULL ^ from;
+    int bad = 0;
+    for (int i = 0; i < n; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        ticks[i] = from + x % span;
+        int f = schedule_check_float(s, ticks[i]);
+        bad += f != phase_schedule_check(s, ticks[i]) ||
+               f != phase_schedule_check_bsearch(s, ticks[i]);
+    }
+    return bad;
+}
+
+static void demo_lock_schedule(void) {
+    printf("\n=== DEMO 5: Phase-Lock Schedule ===\n");
+    printf("  Open windows precomputed in tick space; checks are integer lookups.\n\n");
+
+    phase_lock_t lock = {
+        .key = {.freq = {5.0, 3.0, 1.0}},
+        .window_center = 0.0,
+        .window_width = 0.1,
+        .clock_pair = 0
+    };
+    phase_schedule_t s;
+    uint64_t origin = phit_now_ticks();
+    if (!phase_schedule_init(&s, &lock, origin, 0.0, 10.0)) {
+        printf("  Windows closer than a few ticks: nothing to index.\n");
+        return;
+    }
+
+    enum { N = 1 << 20 };
+    uint64_t *ticks = malloc(sizeof(uint64_t) * N);
+    int bad = schedule_mismatches(&s, s.base, s.horizon, ticks, N);
+    int open_f, open_b, open_k;
+    double rf = schedule_rate(schedule_check_float, &s, ticks, N, &open_f);
+    double rb = schedule_rate(phase_schedule_check_bsearch, &s, ticks, N, &open_b);
+    double rk = schedule_rate(schedule_check_bucket, &s, ticks, N, &open_k);
+
+    /* Live: read the timer and check, as a request path would */
+    int live = 0;
+    uint64_t t0 = phit_now_ns();
+    for (int i = 0; i < N; i++) live += phase_schedule_check(&s, phit_now_ticks()) == 1;
+    double rl = N / ((phit_now_ns() - t0) / 1e9);
+
+    printf("  Horizon:      10 s, %d windows, %zu buckets of 2^%d ticks\n",
+           s.count, s.nbuckets, s.shift);
+    printf("  Agreement:    %d/%d random ticks differ from phase_lock_check\n", bad, N);
+    printf("  %-14s %8.1f Mcheck/s (%.1f%% open)\n", "Float:", rf / 1e6, 100.0 * open_f / N);
+    printf("  %-14s %8.1f Mcheck/s (%.1f%% open)\n", "Binary search:", rb / 1e6, 100.0 * open_b / N);
+    printf("  %-14s %8.1f Mcheck/s (%.1f%% open, %.1fx float)\n", "Bucket:", rk / 1e6,
+           100.0 * open_k / N, rk / rf);
+    printf("  %-14s %8.1f Mcheck/s (phit_now_ticks + bucket)\n", "Live:", rl / 1e6);
+
+    /* Time moves on: drop the first 5 s, index 10 s from there */
+    uint64_t later = origin + s.horizon / 2;
+    int extended = phase_schedule_extend(&s, later);
+    int bad2 = schedule_mismatches(&s, s.base, s.horizon, ticks, N);
+    printf("  Extended:     %s, +5 s, %d windows, %d/%d differ\n",
+           extended ? "ok" : "FAILED", s.count, bad2, N);
+
+    free(ticks);
+    phase_schedule_free(&s);
+
+    /* Equal frequencies: Φ_rel stays 0, a window centred at 0.5 never opens */
+    phase_lock_t closed = {
+        .key = {.freq = {3.0, 3.0, 1.0}},
+        .window_center = 0.5,
+        .window_width = 0.1,
+        .clock_pair = 0
+    };
+    uint64_t now = phit_now_ticks();
+    int ok = phase_schedule_init(&s, &closed, now, 0.0, 10.0);
+    int shut = ok && s.count == 0 && phase_schedule_check(&s, now) == 0 &&
+               phase_schedule_check(&s, now + s.horizon - 1) == 0 &&
+               phase_schedule_check_bsearch(&s, now + s.horizon / 2) == 0;
+    printf("  Static lock:  %s, %d windows, always closed\n", shut ? "ok" : "FAILED", s.count);
+    phase_schedule_free(&s);
+}
+
 /* ========== Main ========== */
 
 int main(void) {
@@ -306,6 +675,8 @@ int main(void) {
     demo_basic_encrypt();
     demo_phase_lock();
     demo_temporal_otp();
+    demo_block_mode();
+    demo_lock_schedule();
 
     printf("\n╔══════════════════════════════════════════════════════════╗\n");
     printf("║  SUMMARY                                                ║\n");
@@ -313,6 +684,8 @@ int main(void) {
     printf("║  1. Phase-keyed: encrypt/decrypt needs exact time       ║\n");
     printf("║  2. Phase-locked: access only in specific phase window  ║\n");
     printf("║  3. Temporal OTP: same message → different cipher/ns    ║\n");
+    printf("║  4. Block mode: one phase per message, SIMD keystream   ║\n");
+    printf("║  5. Lock schedule: windows indexed in ticks, no float   ║\n");
     printf("║                                                         ║\n");
     printf("║  The 'key' is not stored — it's the relationship        ║\n");
     printf("║  between clock frequencies at a specific moment.        ║\n");
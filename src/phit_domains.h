@@ -0,0 +1,375 @@
+/*
+ * phit_domains.h — Cross-Domain Phase Sampling
+ * ============================================
+ *
+ * Companion to libphit.h. A phit_sample() key carries the phase of one
+ * core against its own timer. The triphase idea adds a second clock
+ * domain: helper threads pinned to other core clusters (P and E cores on
+ * hybrid parts, other CCDs or sockets) run their own workload and
+ * publish timestamps, and a consumer combining its local read with each
+ * helper's latest publication sees the helpers' phase as well as its
+ * own. A publication's age at the consumer's read is set by two
+ * unsynchronised loops on different cores, so each fresh one adds phits
+ * at the cost of a cache-line read instead of another timer read.
+ *
+ * Each helper owns one cache line (its seqlock slot): sequence, its
+ * timestamp, its own workload delta and a publication count. Writers
+ * never wait for readers; readers retry on a torn read.
+ *
+ *   phit_domains_start    start helpers on distinct nodes of a
+ *                         phit_topo.h topology (PHIT_TOPO_PERF for P/E)
+ *   phit_sample_domains   local read + every helper's slot -> 32-bit key
+ *   phit_domains_profile  phits per sample and ns per sample, measured
+ *
+ * Helpers spin: every helper takes a core for as long as the sampler
+ * runs. With fewer cores than helpers plus consumers they only publish
+ * while scheduled, few reads are fresh and the profile says so.
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_domains.h (it includes libphit.h and
+ * phit_topo.h), or link the libphit library, which already contains it.
+ * Link with -lpthread.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_DOMAINS_H
+#define PHIT_DOMAINS_H
+
+#include "libphit.h"
+#include "phit_topo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+#ifndef PHIT_DOMAINS_MAX_HELPERS
+#define PHIT_DOMAINS_MAX_HELPERS 8
+#endif
+
+/* Helper workload between publications: LCG steps */
+#ifndef PHIT_DOMAINS_HELPER_ITERS
+#define PHIT_DOMAINS_HELPER_ITERS 10
+#endif
+
+/* phit_domains_profile default sample count */
+#ifndef PHIT_DOMAINS_PROFILE_SAMPLES
+#define PHIT_DOMAINS_PROFILE_SAMPLES 100000
+#endif
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+typedef struct phit_domains phit_domains_t;    /* opaque */
+
+/* Per consumer thread: which publications it has already used */
+typedef struct {
+    uint64_t last[PHIT_DOMAINS_MAX_HELPERS];
+    uint64_t samples;
+    uint64_t fresh;             /* helper reads newer than the previous sample's */
+    uint64_t retries;           /* torn seqlock reads */
+} phit_domains_reader_t;
+
+typedef struct {
+    double ns_per_sample;
+    double local_phits;         /* Shannon entropy of the local delta */
+    double cross_phits;         /* sum over helpers: P(fresh) * H(age | fresh) */
+    double fresh_rate;          /* fresh helper reads per sample */
+    double phits_per_sample;    /* local + cross */
+} phit_domains_profile_t;
+
+/* ====================================================================
+ * API Declarations
+ * ==================================================================== */
+
+/* helpers 1..PHIT_DOMAINS_MAX_HELPERS; helper k goes to node
+ * (caller's node + 1 + k) mod num_nodes of topo, or of a PHIT_TOPO_PERF
+ * discovery when topo is NULL. NULL on failure. */
+phit_domains_t *phit_domains_start(const phit_topo_t *topo, int helpers);
+void     phit_domains_stop(phit_domains_t *d);          /* joins and frees */
+int      phit_domains_helpers(const phit_domains_t *d);
+int      phit_domains_helper_node(const phit_domains_t *d, int helper);
+int      phit_domains_helper_pinned(const phit_domains_t *d, int helper);
+uint64_t phit_domains_published(const phit_domains_t *d, int helper);
+
+/* r: the calling thread's reader, or NULL to skip freshness tracking */
+uint32_t phit_sample_domains(phit_domains_t *d, phit_domains_reader_t *r);
+void     phit_domains_profile(phit_domains_t *d, int samples, phit_domains_profile_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_DOMAINS_IMPLEMENTED)
+#define PHIT_DOMAINS_IMPLEMENTED
+
+#include <stdlib.h>
+#include <math.h>
+
+/* Written by one helper, read by every consumer */
+typedef struct {
+    uint64_t seq;               /* odd while the helper writes */
+    uint64_t ticks;             /* phit_now_ticks() at publication */
+    uint64_t delta;             /* the helper's workload delta before it */
+    uint64_t count;             /* publications so far */
+    char     pad[PHIT_CACHE_LINE - 4 * sizeof(uint64_t)];
+} phit__domain_slot_t;
+
+typedef struct {
+    phit_domains_t *d;
+    int             index;
+    int             node;
+    int             pinned;
+    int             started;
+    phit__thread_t  thread;
+} phit__domain_helper_t;
+
+struct phit_domains {
+    phit__domain_slot_t  *slots;        /* line aligned, one per helper */
+    void                 *mem;
+    int                   num_helpers;
+    int                   stop;
+    uint64_t              ready;        /* helpers pinned and running */
+    phit_topo_t           topo;
+    phit__domain_helper_t helpers[PHIT_DOMAINS_MAX_HELPERS];
+};
+
+/* ---- Helpers ---- */
+
+static void phit__domain_helper_loop(phit__domain_helper_t *h) {
+    phit_domains_t *d = h->d;
+    h->pinned = phit_topo_pin(&d->topo, h->node);
+    phit__domain_slot_t *s = &d->slots[h->index];
+    PHIT__FETCH_ADD64(&d->ready, 1);
+
+    uint64_t seq = 0, count = 0;
+    uint64_t prev = phit_now_ticks();
+    volatile uint64_t x = 0xC0FFEE ^ (uint64_t)h->index;
+    while (!PHIT__LOAD_INT(&d->stop)) {
+        PHIT__WL_LCG(x, PHIT_DOMAINS_HELPER_ITERS);
+        uint64_t t = phit_now_ticks();
+        /* Release stores keep the seqlock order: odd, data, even */
+        PHIT__STORE64(&s->seq, ++seq);
+        PHIT__STORE64(&s->ticks, t);
+        PHIT__STORE64(&s->delta, (t - prev) ^ (uint64_t)x);
+        PHIT__STORE64(&s->count, ++count);
+        PHIT__STORE64(&s->seq, ++seq);
+        prev = t;
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI phit__domain_helper_main(LPVOID arg) {
+    phit__domain_helper_loop((phit__domain_helper_t *)arg);
+    return 0;
+}
+#else
+static void *phit__domain_helper_main(void *arg) {
+    phit__domain_helper_loop((phit__domain_helper_t *)arg);
+    return NULL;
+}
+#endif
+
+phit_domains_t *phit_domains_start(const phit_topo_t *topo, int helpers) {
+    if (helpers < 1 || helpers > PHIT_DOMAINS_MAX_HELPERS) return NULL;
+    phit_domains_t *d = calloc(1, sizeof(phit_domains_t));
+    if (!d) return NULL;
+    d->mem = calloc(1, sizeof(phit__domain_slot_t) * (size_t)helpers + PHIT_CACHE_LINE);
+    if (!d->mem) {
+        free(d);
+        return NULL;
+    }
+    d->slots = (phit__domain_slot_t *)(((uintptr_t)d->mem + PHIT_CACHE_LINE - 1) &
+                                       ~(uintptr_t)(PHIT_CACHE_LINE - 1));
+    if (topo) memcpy(&d->topo, topo, sizeof(phit_topo_t));
+    else phit_topo_discover(&d->topo, PHIT_TOPO_PERF);
+    d->num_helpers = helpers;
+
+    int home = phit_topo_current_node(&d->topo);
+    for (int k = 0; k < helpers; k++) {
+        phit__domain_helper_t *h = &d->helpers[k];
+        h->d = d;
+        h->index = k;
+        h->node = (home + 1 + k) % d->topo.num_nodes;
+#if defined(_WIN32)
+        h->thread = CreateThread(NULL, 0, phit__domain_helper_main, h, 0, NULL);
+        h->started = h->thread != NULL;
+#else
+        h->started = pthread_create(&h->thread, NULL, phit__domain_helper_main, h) == 0;
+#endif
+        if (!h->started) {
+            d->num_helpers = k;
+            phit_domains_stop(d);
+            return NULL;
+        }
+    }
+    /* Every helper pinned and publishing before the first sample */
+    while (PHIT__LOAD64(&d->ready) < (uint64_t)helpers) phit__yield();
+    return d;
+}
+
+void phit_domains_stop(phit_domains_t *d) {
+    if (!d) return;
+    PHIT__STORE_INT(&d->stop, 1);
+    for (int k = 0; k < d->num_helpers; k++) {
+#if defined(_WIN32)
+        WaitForSingleObject(d->helpers[k].thread, INFINITE);
+        CloseHandle(d->helpers[k].thread);
+#else
+        pthread_join(d->helpers[k].thread, NULL);
+#endif
+    }
+    free(d->mem);
+    free(d);
+}
+
+int phit_domains_helpers(const phit_domains_t *d) {
+    return d->num_helpers;
+}
+
+int phit_domains_helper_node(const phit_domains_t *d, int helper) {
+    return helper >= 0 && helper < d->num_helpers ? d->helpers[helper].node : -1;
+}
+
+int phit_domains_helper_pinned(const phit_domains_t *d, int helper) {
+    return helper >= 0 && helper < d->num_helpers ? d->helpers[helper].pinned : 0;
+}
+
+uint64_t phit_domains_published(const phit_domains_t *d, int helper) {
+    if (helper < 0 || helper >= d->num_helpers) return 0;
+    return PHIT__LOAD64(&d->slots[helper].count);
+}
+
+/* ---- Sampling ---- */
+
+/* One consistent (ticks, delta, count); returns the torn reads retried */
+static uint64_t phit__domain_read(const phit__domain_slot_t *s, uint64_t *ticks, uint64_t *delta,
+                                  uint64_t *count) {
+    uint64_t retries = 0;
+    for (;;) {
+        uint64_t s0 = PHIT__LOAD64(&s->seq);
+        if (!(s0 & 1)) {
+            /* Acquire loads: the second seq read cannot move above them */
+            *ticks = PHIT__LOAD64(&s->ticks);
+            *delta = PHIT__LOAD64(&s->delta);
+            *count = PHIT__LOAD64(&s->count);
+            if (PHIT__LOAD64(&s->seq) == s0) return retries;
+        }
+        retries++;
+        PHIT__PAUSE();
+    }
+}
+
+/* The local read, then each helper's age at it and its own delta. Ages
+ * are raw phit_now_ticks() differences (the counter is shared across
+ * cores); a publication that lands between the local read and the slot
+ * read has age 0. */
+static uint32_t phit__domains_key(phit_domains_t *d, phit_domains_reader_t *r, uint64_t *raw_out,
+                                  uint64_t *age_out, int *fresh_out) {
+    int shift = phit_timer_caps()->lsb_shift;
+    volatile uint64_t x = 0xDEADBEEF;
+    PHIT__WL_LCG(x, 10);
+    phit__sink = x;
+    uint64_t raw = phit_now_ticks();
+    uint64_t t = raw >> shift;
+    uint32_t key = phit_hash32((uint32_t)((t & 0x3) | (((uint32_t)(t >> 2) ^ (uint32_t)x) << 2)));
+
+    for (int k = 0; k < d->num_helpers; k++) {
+        uint64_t ticks, delta, count;
+        uint64_t retries = phit__domain_read(&d->slots[k], &ticks, &delta, &count);
+        uint64_t age = (int64_t)(raw - ticks) > 0 ? raw - ticks : 0;
+        key ^= phit_hash32((uint32_t)(age >> shift) ^ ((uint32_t)delta << 11) ^ (uint32_t)(k + 1));
+        key = (key << 7) | (key >> 25);
+        if (age_out) age_out[k] = age;
+        if (r) {
+            int fresh = count != r->last[k];
+            r->last[k] = count;
+            r->fresh += (uint64_t)fresh;
+            r->retries += retries;
+            if (fresh_out) fresh_out[k] = fresh;
+        }
+    }
+    if (r) r->samples++;
+    if (raw_out) *raw_out = raw;
+    return phit_hash32(key);
+}
+
+uint32_t phit_sample_domains(phit_domains_t *d, phit_domains_reader_t *r) {
+    return phit__domains_key(d, r, NULL, NULL, NULL);
+}
+
+static double phit__domains_entropy(const uint32_t *hist, int levels, uint64_t n) {
+    double h = 0;
+    for (int l = 0; l < levels; l++) {
+        if (!hist[l]) continue;
+        double p = (double)hist[l] / (double)n;
+        h -= p * log2(p);
+    }
+    return h;
+}
+
+/* Histogram level for a raw tick delta: phit__quantize, last level open */
+static int phit__domains_level(uint64_t delta, int levels) {
+    if (delta > (1ULL << 30)) return levels - 1;    /* keeps the multiply in range */
+    int q = phit__quantize(delta);
+    return q < levels ? q : levels - 1;
+}
+
+/* Histograms as phit_sampler_profile (256 levels of quantized ticks)
+ * over the local delta and, per helper, the age of fresh publications: a
+ * stale slot's age only counts up with the local clock, so it adds no
+ * phits and is left out */
+void phit_domains_profile(phit_domains_t *d, int samples, phit_domains_profile_t *out) {
+    enum { LEVELS = 256 };
+    memset(out, 0, sizeof(phit_domains_profile_t));
+    if (samples < 2) samples = PHIT_DOMAINS_PROFILE_SAMPLES;
+    uint32_t *hist = calloc((size_t)(1 + d->num_helpers) * LEVELS, sizeof(uint32_t));
+    if (!hist) return;
+    uint64_t fresh_n[PHIT_DOMAINS_MAX_HELPERS] = { 0 };
+    uint64_t age[PHIT_DOMAINS_MAX_HELPERS];
+    int fresh[PHIT_DOMAINS_MAX_HELPERS];
+    phit_domains_reader_t r;
+    memset(&r, 0, sizeof(r));
+
+    uint64_t prev = 0, sink = 0;
+    phit__domains_key(d, &r, &prev, age, fresh);
+    uint64_t t0 = phit_now_ns();
+    for (int i = 0; i < samples; i++) {
+        uint64_t t;
+        sink += phit__domains_key(d, &r, &t, age, fresh);
+        hist[phit__domains_level(t - prev, LEVELS)]++;
+        prev = t;
+        for (int k = 0; k < d->num_helpers; k++) {
+            if (!fresh[k]) continue;
+            hist[(size_t)(1 + k) * LEVELS + (size_t)phit__domains_level(age[k], LEVELS)]++;
+            fresh_n[k]++;
+        }
+    }
+    out->ns_per_sample = (double)(phit_now_ns() - t0) / samples;
+    phit__sink = sink;
+
+    out->local_phits = phit__domains_entropy(hist, LEVELS, (uint64_t)samples);
+    for (int k = 0; k < d->num_helpers; k++) {
+        if (!fresh_n[k]) continue;
+        double p = (double)fresh_n[k] / samples;
+        out->cross_phits += p * phit__domains_entropy(hist + (size_t)(1 + k) * LEVELS, LEVELS,
+                                                      fresh_n[k]);
+        out->fresh_rate += p;
+    }
+    out->phits_per_sample = out->local_phits + out->cross_phits;
+    free(hist);
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_DOMAINS_H */
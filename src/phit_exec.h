@@ -0,0 +1,931 @@
+/*
+ * phit_exec.h — Phase-Routed Multi-Queue Task Executor
+ * =====================================================
+ *
+ * Companion to libphit.h. Each worker thread owns a bounded ring; a
+ * producer picks the ring with phit_route() (or a caller-owned
+ * phit_router_t), so dispatch needs no shared counter or lock. Every
+ * accepted task runs exactly once, on the worker whose ring it entered
+ * (or, with PHIT_EXEC_STEAL, on whichever worker claims it first).
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_exec.h (it includes libphit.h), or link the
+ * libphit library, which already contains both. Link with -lpthread.
+ *
+ * Rings are Vyukov-style sequence-numbered slots: multi-producer rings
+ * claim a slot with one CAS on the ring's tail, single-producer rings
+ * (PHIT_EXEC_SINGLE_PRODUCER) with a plain store. The owning worker is
+ * the only consumer. Idle workers spin PHIT_EXEC_SPIN polls, then sleep
+ * until a producer signals them.
+ *
+ * Work stealing (PHIT_EXEC_STEAL): phase routing balances task counts,
+ * not cost, so a few expensive tasks can leave one ring backed up while
+ * the others idle. With the flag set, each ring is also its worker's
+ * deque: the owner and thieves claim from the consuming end (the oldest
+ * task) with a CAS on head, producers keep appending at the tail. An
+ * idle worker probes PHIT_EXEC_STEAL_TRIES victims picked by
+ * phit_sample(), so victim selection shares no state, and sleeps at
+ * most PHIT_EXEC_STEAL_SLEEP_US between rounds. A stolen task still
+ * runs exactly once.
+ *
+ * Shutdown contract: call phit_exec_shutdown() once every producer has
+ * returned from its last submit. It stops new submissions (they return
+ * 0), runs everything already queued and joins the workers.
+ *
+ * Topology (phit_exec_create_topo): workers come in per-node groups, each
+ * restricted to its node's CPUs, and phit_exec_submit_local() routes
+ * with phit_route_hier() from the caller's node, so task payloads stay
+ * in the producer's socket or cache domain. A task leaves the node with
+ * the spill probability, or when the local ring it drew is at least the
+ * spill depth deep and the remote one is shallower.
+ *
+ * Async completions (phit_cq_t): an event-loop thread submits with
+ * phit_exec_submit_async(), which never blocks, and gets each task's
+ * handle back from phit_cq_poll() once it has run. Workers post
+ * completions to a lock-free ring and write the queue's notification fd
+ * (an eventfd on Linux, a pipe elsewhere, so epoll, io_uring poll and
+ * kqueue all take it) only for the first completion since the reactor
+ * last polled: one wakeup per batch, not per task. A queue belongs to
+ * one reactor thread, which both submits and polls; its capacity bounds
+ * the tasks in flight. src/phit_exec_coro.hpp wraps it in C++20
+ * awaitables.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_EXEC_H
+#define PHIT_EXEC_H
+
+#include "libphit.h"
+#include "phit_topo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+#ifndef PHIT_EXEC_MAX_WORKERS
+#define PHIT_EXEC_MAX_WORKERS 256
+#endif
+
+/* Default ring capacity per worker (rounded up to a power of two) */
+#ifndef PHIT_EXEC_QUEUE_CAPACITY
+#define PHIT_EXEC_QUEUE_CAPACITY 1024
+#endif
+
+/* Empty polls before an idle worker sleeps */
+#ifndef PHIT_EXEC_SPIN
+#define PHIT_EXEC_SPIN 512
+#endif
+
+/* phit_exec_submit_batch: tasks routed per phit_sample_compound_batch call */
+#ifndef PHIT_EXEC_BATCH
+#define PHIT_EXEC_BATCH 256
+#endif
+
+/* Default completion queue capacity: tasks in flight per phit_cq_t */
+#ifndef PHIT_EXEC_CQ_CAPACITY
+#define PHIT_EXEC_CQ_CAPACITY 4096
+#endif
+
+/* PHIT_EXEC_STEAL: victims probed per idle poll, and the sleep bound */
+#ifndef PHIT_EXEC_STEAL_TRIES
+#define PHIT_EXEC_STEAL_TRIES 2
+#endif
+
+#ifndef PHIT_EXEC_STEAL_SLEEP_US
+#define PHIT_EXEC_STEAL_SLEEP_US 200
+#endif
+
+/* phit_exec_create flags */
+#define PHIT_EXEC_SINGLE_PRODUCER 1   /* one submitting thread: SPSC rings */
+#define PHIT_EXEC_STEAL           2   /* idle workers steal from other rings */
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+typedef void (*phit_task_fn)(void *arg);
+
+typedef struct {
+    phit_task_fn fn;
+    void        *arg;
+} phit_task_t;
+
+typedef struct phit_exec phit_exec_t;   /* opaque */
+
+/* A finished async task: its handle and the arg it was submitted with */
+typedef struct {
+    uint64_t handle;
+    void    *arg;
+} phit_cqe_t;
+
+typedef struct phit_cq phit_cq_t;       /* opaque */
+
+/* ====================================================================
+ * API Declarations
+ * ==================================================================== */
+
+/* NULL if num_workers is out of range, allocation fails or a worker
+ * thread cannot start (those already started are joined first).
+ * queue_capacity 0 = PHIT_EXEC_QUEUE_CAPACITY. */
+phit_exec_t *phit_exec_create(int num_workers, int queue_capacity, int flags);
+/* workers_per_node workers on every node of topo (0 = one per CPU of the
+ * node), numbered node by node; spill starts at PHIT_TOPO_SPILL and half
+ * a ring. The executor keeps a copy of topo. NULL as phit_exec_create. */
+phit_exec_t *phit_exec_create_topo(const phit_topo_t *topo, int workers_per_node,
+                                   int queue_capacity, int flags);
+void     phit_exec_destroy(phit_exec_t *e);       /* shuts down first */
+void     phit_exec_shutdown(phit_exec_t *e);      /* drain and join; idempotent */
+
+/* Submit: 1 = queued, 0 = executor shut down. A full target ring spills
+ * to the next ring; if every ring is full the call waits for space. */
+int      phit_exec_submit(phit_exec_t *e, phit_task_fn fn, void *arg);
+/* Power-of-two choices between two phase-routed rings by queued depth */
+int      phit_exec_submit2(phit_exec_t *e, phit_task_fn fn, void *arg);
+int      phit_exec_submit_router(phit_exec_t *e, phit_router_t *r,
+                                 phit_task_fn fn, void *arg);
+int      phit_exec_submit_to(phit_exec_t *e, int worker, phit_task_fn fn, void *arg);
+int      phit_exec_submit_batch(phit_exec_t *e, const phit_task_t *tasks, int count);
+/* A worker on the caller's node (phit_topo_current_node), spilling as
+ * set below; phit_exec_submit() on an executor made without a topology */
+int      phit_exec_submit_local(phit_exec_t *e, phit_task_fn fn, void *arg);
+/* probability < 0 keeps the current one, depth 0 = half a ring, < 0 =
+ * never spill by depth. Call before submitting. */
+void     phit_exec_set_spill(phit_exec_t *e, double probability, int depth);
+
+/* Async submission, from the queue's reactor thread only: 1 = queued
+ * (handle, if not NULL, gets the task's nonzero handle), 0 = executor
+ * shut down, -1 = busy (queue at capacity or every ring full; poll
+ * completions and retry). Never waits. */
+int      phit_exec_submit_async(phit_exec_t *e, phit_cq_t *cq, phit_task_fn fn, void *arg,
+                                uint64_t *handle);
+/* Routes like phit_exec_submit_batch; stops at the first busy task and
+ * returns how many were queued. handles may be NULL. */
+int      phit_exec_submit_async_batch(phit_exec_t *e, phit_cq_t *cq, const phit_task_t *tasks,
+                                      int count, uint64_t *handles);
+
+/* capacity 0 = PHIT_EXEC_CQ_CAPACITY. NULL if allocation or the fd fails. */
+phit_cq_t *phit_cq_create(int capacity);
+/* Once no task submitted through it can still run */
+void     phit_cq_destroy(phit_cq_t *cq);
+/* Readable while completions wait; -1 where there is none (Windows) */
+int      phit_cq_fd(const phit_cq_t *cq);
+/* Up to max completions, oldest first; never blocks */
+int      phit_cq_poll(phit_cq_t *cq, phit_cqe_t *out, int max);
+/* Block until a completion may be ready: 1, or 0 after timeout_ms (< 0 =
+ * forever) or at once with nothing in flight. A busy submit with nothing
+ * in flight means other producers filled the rings: yield and retry. */
+int      phit_cq_wait(phit_cq_t *cq, int timeout_ms);
+int      phit_cq_inflight(const phit_cq_t *cq);   /* submitted, not yet polled */
+
+int      phit_exec_workers(const phit_exec_t *e);
+int      phit_exec_worker_node(const phit_exec_t *e, int worker);     /* -1 without a topology */
+uint64_t phit_exec_executed(const phit_exec_t *e, int worker);   /* own + stolen */
+uint64_t phit_exec_stolen(const phit_exec_t *e, int worker);     /* taken from others */
+uint64_t phit_exec_steal_attempts(const phit_exec_t *e, int worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_EXEC_IMPLEMENTED)
+#define PHIT_EXEC_IMPLEMENTED
+
+#include <stdlib.h>
+#if !defined(_WIN32)
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+  #if defined(__linux__)
+    #include <sys/eventfd.h>
+  #endif
+#endif
+
+/* Thread shim and ring atomics: libphit.h implementation */
+
+/* ---- Ring ---- */
+
+typedef struct {
+    uint64_t    seq;
+    phit_task_t task;
+} phit__slot_t;
+
+/* Producer, consumer and owner-only fields on separate cache lines */
+typedef struct {
+    uint64_t      tail;                 /* producers */
+    char          pad0[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t      head;                 /* owner, and thieves with PHIT_EXEC_STEAL */
+    char          pad1[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t      executed;             /* owning worker; read relaxed */
+    uint64_t      stolen;
+    uint64_t      steal_attempts;
+    int           sleeping;
+    char          pad2[PHIT_CACHE_LINE - 3 * sizeof(uint64_t) - sizeof(int)];
+    phit__slot_t *slots;                /* read-only after create */
+    uint64_t      mask;
+    phit__mutex_t mu;
+    phit__cond_t  cv;
+    phit__thread_t thread;
+    phit_exec_t  *exec;
+    int           index;
+    int           node;                 /* -1 without a topology */
+} phit__queue_t;
+
+struct phit_exec {
+    phit__queue_t *queues;
+    int            num_workers;
+    int            single_producer;
+    int            steal;
+    int            accepting;           /* cleared by shutdown */
+    int            closed;              /* workers drain and exit */
+    int            joined;
+    void          *mem;                 /* unaligned queue allocation */
+    phit_topo_t   *topo;                /* phit_exec_create_topo only */
+    phit_hier_t    hier;                /* workers per node */
+    int64_t        spill_depth;
+};
+
+static int phit__ring_push(phit__queue_t *q, int single, phit_task_fn fn, void *arg) {
+    phit__slot_t *slot;
+    uint64_t pos;
+    if (single) {
+        pos = PHIT__PEEK64(&q->tail);
+        slot = &q->slots[pos & q->mask];
+        if (PHIT__LOAD64(&slot->seq) != pos) return 0;
+        PHIT__STORE64(&q->tail, pos + 1);
+    } else {
+        pos = PHIT__LOAD64(&q->tail);
+        for (;;) {
+            slot = &q->slots[pos & q->mask];
+            int64_t diff = (int64_t)(PHIT__LOAD64(&slot->seq) - pos);
+            if (diff == 0) {
+                if (PHIT__CAS64(&q->tail, pos, pos + 1)) break;
+#if defined(_MSC_VER) && !defined(__clang__)
+                pos = PHIT__LOAD64(&q->tail);
+#endif
+            } else if (diff < 0) {
+                return 0;               /* full */
+            } else {
+                pos = PHIT__LOAD64(&q->tail);
+            }
+        }
+    }
+    slot->task.fn = fn;
+    slot->task.arg = arg;
+    PHIT__STORE64(&slot->seq, pos + 1);
+
+    /* Pairs with the fence in phit__worker_sleep */
+    PHIT__FENCE();
+    if (PHIT__LOAD_INT(&q->sleeping)) {
+        phit__mutex_lock(&q->mu);
+        phit__cond_signal(&q->cv);
+        phit__mutex_unlock(&q->mu);
+    }
+    return 1;
+}
+
+static int phit__ring_pop(phit__queue_t *q, phit_task_t *out) {
+    uint64_t pos = q->head;
+    phit__slot_t *slot = &q->slots[pos & q->mask];
+    if (PHIT__LOAD64(&slot->seq) != pos + 1) return 0;
+    *out = slot->task;
+    PHIT__STORE64(&slot->seq, pos + q->mask + 1);
+    PHIT__STORE64(&q->head, pos + 1);   /* read by phit__ring_depth */
+    return 1;
+}
+
+/* Multi-consumer pop: the owner and thieves race for the head slot */
+static int phit__ring_take(phit__queue_t *q, phit_task_t *out) {
+    phit__slot_t *slot;
+    uint64_t pos = PHIT__LOAD64(&q->head);
+    for (;;) {
+        slot = &q->slots[pos & q->mask];
+        int64_t diff = (int64_t)(PHIT__LOAD64(&slot->seq) - (pos + 1));
+        if (diff == 0) {
+            if (PHIT__CAS64(&q->head, pos, pos + 1)) break;
+#if defined(_MSC_VER) && !defined(__clang__)
+            pos = PHIT__LOAD64(&q->head);
+#endif
+        } else if (diff < 0) {
+            return 0;                   /* empty */
+        } else {
+            pos = PHIT__LOAD64(&q->head);
+        }
+    }
+    *out = slot->task;
+    PHIT__STORE64(&slot->seq, pos + q->mask + 1);
+    return 1;
+}
+
+static int phit__ring_empty(phit__queue_t *q) {
+    uint64_t pos = PHIT__LOAD64(&q->head);
+    return PHIT__LOAD64(&q->slots[pos & q->mask].seq) != pos + 1;
+}
+
+/* Victim from a phase sample, never the thief itself */
+static int phit__steal(phit__queue_t *q, phit_task_t *out) {
+    phit_exec_t *e = q->exec;
+    if (e->num_workers < 2) return 0;
+    for (int k = 0; k < PHIT_EXEC_STEAL_TRIES; k++) {
+        int v = (int)phit_reduce32(phit_sample(), (uint32_t)(e->num_workers - 1));
+        if (v >= q->index) v++;
+        PHIT__STORE64(&q->steal_attempts, q->steal_attempts + 1);
+        if (phit__ring_take(&e->queues[v], out)) {
+            PHIT__STORE64(&q->stolen, q->stolen + 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Shutdown drain: sweep every ring so no worker exits while others queue */
+static int phit__steal_any(phit__queue_t *q, phit_task_t *out) {
+    phit_exec_t *e = q->exec;
+    for (int v = 0; v < e->num_workers; v++) {
+        if (v != q->index && phit__ring_take(&e->queues[v], out)) {
+            PHIT__STORE64(&q->stolen, q->stolen + 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ---- Workers ---- */
+
+static void phit__worker_sleep(phit__queue_t *q) {
+    phit__mutex_lock(&q->mu);
+    PHIT__STORE_INT(&q->sleeping, 1);
+    PHIT__FENCE();
+    if (q->exec->steal) {
+        /* Bounded: other rings fill without signalling this worker */
+        if (phit__ring_empty(q) && !PHIT__LOAD_INT(&q->exec->closed))
+            phit__cond_wait_us(&q->cv, &q->mu, PHIT_EXEC_STEAL_SLEEP_US);
+    } else {
+        while (phit__ring_empty(q) && !PHIT__LOAD_INT(&q->exec->closed)) {
+            phit__cond_wait(&q->cv, &q->mu);
+        }
+    }
+    PHIT__STORE_INT(&q->sleeping, 0);
+    phit__mutex_unlock(&q->mu);
+}
+
+static void phit__worker_start(phit__queue_t *q);
+
+static void phit__worker_loop(phit__queue_t *q) {
+    phit__worker_start(q);
+    phit_task_t t;
+    int steal = q->exec->steal;
+    int idle = 0;
+    for (;;) {
+        if (steal ? phit__ring_take(q, &t) : phit__ring_pop(q, &t)) {
+            t.fn(t.arg);
+            PHIT__STORE64(&q->executed, q->executed + 1);
+            idle = 0;
+            continue;
+        }
+        if (PHIT__LOAD_INT(&q->exec->closed)) {
+            if (!phit__ring_empty(q)) continue;
+            if (!steal || !phit__steal_any(q, &t)) return;
+            t.fn(t.arg);
+            PHIT__STORE64(&q->executed, q->executed + 1);
+            continue;
+        }
+        if (steal && phit__steal(q, &t)) {
+            t.fn(t.arg);
+            PHIT__STORE64(&q->executed, q->executed + 1);
+            idle = 0;
+            continue;
+        }
+        if (++idle < PHIT_EXEC_SPIN) {
+            PHIT__PAUSE();
+            if ((idle & 63) == 0) phit__yield();
+            continue;
+        }
+        phit__worker_sleep(q);
+        /* After a bounded sleep: one more steal round, then back to sleep */
+        idle = steal ? PHIT_EXEC_SPIN - 1 : 0;
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI phit__worker_main(LPVOID arg) {
+    phit__worker_loop((phit__queue_t *)arg);
+    return 0;
+}
+#else
+static void *phit__worker_main(void *arg) {
+    phit__worker_loop((phit__queue_t *)arg);
+    return NULL;
+}
+#endif
+
+static void phit__worker_start(phit__queue_t *q) {
+    phit_exec_t *e = q->exec;
+    if (e->topo) phit_topo_pin(e->topo, q->node);
+}
+
+/* ---- Executor ---- */
+
+/* Queues without threads; phit__exec_start launches the workers */
+static phit_exec_t *phit__exec_alloc(int num_workers, int queue_capacity, int flags) {
+    if (num_workers < 1 || num_workers > PHIT_EXEC_MAX_WORKERS) return NULL;
+    if (queue_capacity <= 0) queue_capacity = PHIT_EXEC_QUEUE_CAPACITY;
+    uint64_t cap = 2;
+    while (cap < (uint64_t)queue_capacity) cap <<= 1;
+
+    phit_exec_t *e = calloc(1, sizeof(phit_exec_t));
+    if (!e) return NULL;
+    e->mem = calloc(1, sizeof(phit__queue_t) * (size_t)num_workers + PHIT_CACHE_LINE);
+    if (!e->mem) {
+        free(e);
+        return NULL;
+    }
+    e->queues = (phit__queue_t *)(((uintptr_t)e->mem + PHIT_CACHE_LINE - 1) &
+                                  ~(uintptr_t)(PHIT_CACHE_LINE - 1));
+    e->num_workers = num_workers;
+    e->single_producer = (flags & PHIT_EXEC_SINGLE_PRODUCER) != 0;
+    e->steal = (flags & PHIT_EXEC_STEAL) != 0;
+    e->accepting = 1;
+
+    for (int w = 0; w < num_workers; w++) {
+        phit__queue_t *q = &e->queues[w];
+        q->slots = malloc(sizeof(phit__slot_t) * (size_t)cap);
+        if (!q->slots) {
+            for (int k = 0; k < w; k++) free(e->queues[k].slots);
+            free(e->mem);
+            free(e);
+            return NULL;
+        }
+        for (uint64_t i = 0; i < cap; i++) q->slots[i].seq = i;
+        q->mask = cap - 1;
+        q->exec = e;
+        q->index = w;
+        q->node = -1;
+        phit__mutex_init(&q->mu);
+        phit__cond_init(&q->cv);
+    }
+    e->spill_depth = (int64_t)(cap / 2);
+    return e;
+}
+
+static void phit__exec_free(phit_exec_t *e) {
+    for (int w = 0; w < e->num_workers; w++) {
+        phit__mutex_destroy(&e->queues[w].mu);
+        phit__cond_destroy(&e->queues[w].cv);
+        free(e->queues[w].slots);
+    }
+    free(e->topo);
+    free(e->mem);
+    free(e);
+}
+
+/* Close the executor, wake every worker, join the first `started` */
+static void phit__exec_join(phit_exec_t *e, int started) {
+    PHIT__STORE_INT(&e->accepting, 0);
+    PHIT__STORE_INT(&e->closed, 1);
+    for (int w = 0; w < e->num_workers; w++) {
+        phit__queue_t *q = &e->queues[w];
+        phit__mutex_lock(&q->mu);
+        phit__cond_broadcast(&q->cv);
+        phit__mutex_unlock(&q->mu);
+    }
+    for (int w = 0; w < started; w++) {
+#if defined(_WIN32)
+        WaitForSingleObject(e->queues[w].thread, INFINITE);
+        CloseHandle(e->queues[w].thread);
+#else
+        pthread_join(e->queues[w].thread, NULL);
+#endif
+    }
+}
+
+/* Launch the workers; if one fails, join those running and free e */
+static phit_exec_t *phit__exec_start(phit_exec_t *e) {
+    for (int w = 0; w < e->num_workers; w++) {
+        phit__queue_t *q = &e->queues[w];
+#if defined(_WIN32)
+        q->thread = CreateThread(NULL, 0, phit__worker_main, q, 0, NULL);
+        int ok = q->thread != NULL;
+#else
+        int ok = pthread_create(&q->thread, NULL, phit__worker_main, q) == 0;
+#endif
+        if (!ok) {
+            phit__exec_join(e, w);
+            phit__exec_free(e);
+            return NULL;
+        }
+    }
+    return e;
+}
+
+phit_exec_t *phit_exec_create(int num_workers, int queue_capacity, int flags) {
+    phit_exec_t *e = phit__exec_alloc(num_workers, queue_capacity, flags);
+    return e ? phit__exec_start(e) : NULL;
+}
+
+phit_exec_t *phit_exec_create_topo(const phit_topo_t *topo, int workers_per_node,
+                                   int queue_capacity, int flags) {
+    int count[PHIT_TOPO_MAX_NODES], total = 0;
+    if (topo->num_nodes < 1 || topo->num_nodes > PHIT_TOPO_MAX_NODES) return NULL;
+    for (int n = 0; n < topo->num_nodes; n++) {
+        count[n] = workers_per_node > 0 ? workers_per_node : topo->node_cpus[n];
+        total += count[n];
+    }
+    phit_exec_t *e = phit__exec_alloc(total, queue_capacity, flags);
+    if (!e) return NULL;
+    e->topo = malloc(sizeof(phit_topo_t));
+    if (!e->topo || !phit_hier_init(&e->hier, count, topo->num_nodes, PHIT_TOPO_SPILL)) {
+        phit__exec_free(e);
+        return NULL;
+    }
+    memcpy(e->topo, topo, sizeof(phit_topo_t));
+    for (int n = 0; n < topo->num_nodes; n++) {
+        for (int k = 0; k < count[n]; k++) e->queues[e->hier.first[n] + k].node = n;
+    }
+    return phit__exec_start(e);
+}
+
+void phit_exec_shutdown(phit_exec_t *e) {
+    if (e->joined) return;
+    phit__exec_join(e, e->num_workers);
+    e->joined = 1;
+}
+
+void phit_exec_destroy(phit_exec_t *e) {
+    if (!e) return;
+    phit_exec_shutdown(e);
+    phit__exec_free(e);
+}
+
+int phit_exec_submit_to(phit_exec_t *e, int worker, phit_task_fn fn, void *arg) {
+    if (!PHIT__LOAD_INT(&e->accepting)) return 0;
+    int n = e->num_workers;
+    if (worker < 0 || worker >= n) worker = 0;
+    /* Spill to the following rings when the target is full */
+    for (int spins = 0;; spins++) {
+        for (int k = 0; k < n; k++) {
+            int w = worker + k < n ? worker + k : worker + k - n;
+            if (phit__ring_push(&e->queues[w], e->single_producer, fn, arg)) return 1;
+        }
+        if (spins & 1) phit__yield();
+        else PHIT__PAUSE();
+    }
+}
+
+int phit_exec_submit(phit_exec_t *e, phit_task_fn fn, void *arg) {
+    return phit_exec_submit_to(e, phit_route(e->num_workers), fn, arg);
+}
+
+/* Depth hint: tail and head are already padded counters, so reading them
+ * relaxed costs the producer no extra writes. May be stale or, briefly,
+ * off by in-flight claims; it only steers the choice. */
+static int64_t phit__ring_depth(phit__queue_t *q) {
+    return (int64_t)(PHIT__PEEK64(&q->tail) - PHIT__PEEK64(&q->head));
+}
+
+int phit_exec_submit2(phit_exec_t *e, phit_task_fn fn, void *arg) {
+    int a, b;
+    phit_route_pair(e->num_workers, &a, &b);
+    int w = phit__ring_depth(&e->queues[b]) < phit__ring_depth(&e->queues[a]) ? b : a;
+    return phit_exec_submit_to(e, w, fn, arg);
+}
+
+/* r must have num_slots == phit_exec_workers(e) and belong to the caller's thread */
+int phit_exec_submit_router(phit_exec_t *e, phit_router_t *r,
+                            phit_task_fn fn, void *arg) {
+    return phit_exec_submit_to(e, phit_router_route(r), fn, arg);
+}
+
+/* Routes PHIT_EXEC_BATCH tasks per pipelined sampling pass */
+int phit_exec_submit_batch(phit_exec_t *e, const phit_task_t *tasks, int count) {
+    uint32_t keys[PHIT_EXEC_BATCH];
+    int done = 0;
+    while (done < count) {
+        int n = count - done < PHIT_EXEC_BATCH ? count - done : PHIT_EXEC_BATCH;
+        phit_sample_compound_batch(keys, n, 2);
+        for (int i = 0; i < n; i++) {
+            int w = (int)phit_reduce32(keys[i], (uint32_t)e->num_workers);
+            if (!phit_exec_submit_to(e, w, tasks[done + i].fn, tasks[done + i].arg))
+                return done + i;
+        }
+        done += n;
+    }
+    return done;
+}
+
+int phit_exec_submit_local(phit_exec_t *e, phit_task_fn fn, void *arg) {
+    if (!e->topo) return phit_exec_submit(e, fn, arg);
+    int l, r;
+    int node = phit_topo_current_node(e->topo);
+    if (phit_route_hier_pair(&e->hier, node, &l, &r)) return phit_exec_submit_to(e, r, fn, arg);
+    if (r != l && e->spill_depth >= 0) {
+        int64_t dl = phit__ring_depth(&e->queues[l]);
+        if (dl >= e->spill_depth && phit__ring_depth(&e->queues[r]) < dl)
+            return phit_exec_submit_to(e, r, fn, arg);
+    }
+    /* A full ring spills within the node; a full node spills remote, or
+     * waits for local space with depth spill off */
+    if (!PHIT__LOAD_INT(&e->accepting)) return 0;
+    int first = e->hier.first[node], n = e->hier.count[node];
+    for (int spins = 0;; spins++) {
+        for (int k = 0; k < n; k++) {
+            int w = first + (l - first + k) % n;
+            if (phit__ring_push(&e->queues[w], e->single_producer, fn, arg)) return 1;
+        }
+        if (e->spill_depth >= 0 && r != l) return phit_exec_submit_to(e, r, fn, arg);
+        if (spins & 1) phit__yield();
+        else PHIT__PAUSE();
+    }
+}
+
+void phit_exec_set_spill(phit_exec_t *e, double probability, int depth) {
+    if (probability >= 0) {
+        if (probability > 1) probability = 1;
+        e->hier.spill = (uint32_t)(probability * 65536.0 + 0.5);
+    }
+    e->spill_depth = depth == 0 ? (int64_t)((e->queues[0].mask + 1) / 2) : depth;
+}
+
+int phit_exec_workers(const phit_exec_t *e) {
+    return e->num_workers;
+}
+
+int phit_exec_worker_node(const phit_exec_t *e, int worker) {
+    if (worker < 0 || worker >= e->num_workers) return -1;
+    return e->queues[worker].node;
+}
+
+uint64_t phit_exec_executed(const phit_exec_t *e, int worker) {
+    if (worker < 0 || worker >= e->num_workers) return 0;
+    return PHIT__LOAD64(&e->queues[worker].executed);
+}
+
+uint64_t phit_exec_stolen(const phit_exec_t *e, int worker) {
+    if (worker < 0 || worker >= e->num_workers) return 0;
+    return PHIT__LOAD64(&e->queues[worker].stolen);
+}
+
+uint64_t phit_exec_steal_attempts(const phit_exec_t *e, int worker) {
+    if (worker < 0 || worker >= e->num_workers) return 0;
+    return PHIT__LOAD64(&e->queues[worker].steal_attempts);
+}
+
+/* ---- Async completions ----
+ *
+ * An async task is a record from the queue's slab, run through
+ * phit__async_run; the slab's free list is reactor-only, since records
+ * are taken on submit and returned on poll. The completion ring is the
+ * exec ring's protocol with one consumer: a worker claims a position
+ * with a fetch-add and never finds it full, because no more records than
+ * ring slots are ever in flight. */
+
+#define PHIT__CQ_NONE 0xFFFFFFFFu
+
+typedef struct {
+    uint64_t seq;
+    uint32_t rec;
+} phit__cq_slot_t;
+
+typedef struct {
+    phit_task_fn fn;
+    void        *arg;
+    uint64_t     handle;
+    phit_cq_t   *cq;
+    uint32_t     index;
+    uint32_t     next_free;
+} phit__async_t;
+
+struct phit_cq {
+    uint64_t         tail;              /* workers */
+    char             pad0[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t         signalled;         /* fd written since the last poll */
+    char             pad1[PHIT_CACHE_LINE - sizeof(uint64_t)];
+    /* Reactor only */
+    uint64_t         head;
+    uint64_t         next_handle;
+    uint32_t         free_head;
+    int              inflight;
+    int              capacity;
+    phit__cq_slot_t *ring;
+    uint64_t         mask;
+    phit__async_t   *recs;
+    int              fd_read;
+    int              fd_write;
+};
+
+static void phit__cq_notify(phit_cq_t *cq) {
+#if defined(_WIN32)
+    (void)cq;
+#else
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(cq->fd_write, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    (void)n;   /* EAGAIN: a full pipe is already readable */
+#endif
+}
+
+static void phit__cq_post(phit_cq_t *cq, uint32_t rec) {
+    uint64_t pos = PHIT__FETCH_ADD64(&cq->tail, 1);
+    phit__cq_slot_t *slot = &cq->ring[pos & cq->mask];
+    while (PHIT__LOAD64(&slot->seq) != pos) PHIT__PAUSE();   /* the reactor frees it */
+    slot->rec = rec;
+    PHIT__STORE64(&slot->seq, pos + 1);
+    /* Pairs with the fence in phit_cq_poll: either the reactor sees this
+     * entry, or this worker sees signalled cleared and writes the fd */
+    PHIT__FENCE();
+    if (!PHIT__LOAD64(&cq->signalled) && PHIT__XCHG64(&cq->signalled, 1) == 0)
+        phit__cq_notify(cq);
+}
+
+static void phit__async_run(void *arg) {
+    phit__async_t *r = (phit__async_t *)arg;
+    r->fn(r->arg);
+    phit__cq_post(r->cq, r->index);
+}
+
+phit_cq_t *phit_cq_create(int capacity) {
+    if (capacity <= 0) capacity = PHIT_EXEC_CQ_CAPACITY;
+    uint64_t size = 2;
+    while (size < (uint64_t)capacity) size <<= 1;
+
+    phit_cq_t *cq = calloc(1, sizeof(phit_cq_t));
+    if (!cq) return NULL;
+    cq->ring = malloc(sizeof(phit__cq_slot_t) * (size_t)size);
+    cq->recs = malloc(sizeof(phit__async_t) * (size_t)capacity);
+    cq->fd_read = cq->fd_write = -1;
+    int fd_ok = 1;
+#if defined(__linux__)
+    cq->fd_read = cq->fd_write = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    fd_ok = cq->fd_read >= 0;
+#elif !defined(_WIN32)
+    int fds[2];
+    fd_ok = pipe(fds) == 0;
+    if (fd_ok) {
+        for (int i = 0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        cq->fd_read = fds[0];
+        cq->fd_write = fds[1];
+    }
+#endif
+    if (!cq->ring || !cq->recs || !fd_ok) {
+        phit_cq_destroy(cq);
+        return NULL;
+    }
+    for (uint64_t i = 0; i < size; i++) cq->ring[i].seq = i;
+    cq->mask = size - 1;
+    cq->capacity = capacity;
+    for (int i = 0; i < capacity; i++) {
+        cq->recs[i].cq = cq;
+        cq->recs[i].index = (uint32_t)i;
+        cq->recs[i].next_free = i + 1 < capacity ? (uint32_t)(i + 1) : PHIT__CQ_NONE;
+    }
+    cq->free_head = 0;
+    return cq;
+}
+
+void phit_cq_destroy(phit_cq_t *cq) {
+    if (!cq) return;
+#if !defined(_WIN32)
+    if (cq->fd_read >= 0) close(cq->fd_read);
+    if (cq->fd_write >= 0 && cq->fd_write != cq->fd_read) close(cq->fd_write);
+#endif
+    free(cq->ring);
+    free(cq->recs);
+    free(cq);
+}
+
+int phit_cq_fd(const phit_cq_t *cq) {
+    return cq->fd_read;
+}
+
+int phit_cq_inflight(const phit_cq_t *cq) {
+    return cq->inflight;
+}
+
+static int phit__cq_ready(const phit_cq_t *cq) {
+    return PHIT__LOAD64(&cq->ring[cq->head & cq->mask].seq) == cq->head + 1;
+}
+
+/* Drain the fd and clear signalled before looking at the ring, so the
+ * next post after this look writes the fd again */
+static void phit__cq_rearm(phit_cq_t *cq) {
+    if (!PHIT__LOAD64(&cq->signalled)) return;
+#if !defined(_WIN32)
+    uint64_t buf[8];
+    while (read(cq->fd_read, buf, sizeof(buf)) > 0) {}
+#endif
+    PHIT__STORE64(&cq->signalled, 0);
+    PHIT__FENCE();
+}
+
+int phit_cq_poll(phit_cq_t *cq, phit_cqe_t *out, int max) {
+    phit__cq_rearm(cq);
+    int n = 0;
+    while (n < max) {
+        phit__cq_slot_t *slot = &cq->ring[cq->head & cq->mask];
+        if (PHIT__LOAD64(&slot->seq) != cq->head + 1) break;
+        phit__async_t *r = &cq->recs[slot->rec];
+        PHIT__STORE64(&slot->seq, cq->head + cq->mask + 1);
+        cq->head++;
+        out[n].handle = r->handle;
+        out[n].arg = r->arg;
+        n++;
+        r->next_free = cq->free_head;
+        cq->free_head = r->index;
+        cq->inflight--;
+    }
+    /* Stopped at max with more waiting: keep the fd readable */
+    if (n == max && phit__cq_ready(cq) && PHIT__XCHG64(&cq->signalled, 1) == 0)
+        phit__cq_notify(cq);
+    return n;
+}
+
+int phit_cq_wait(phit_cq_t *cq, int timeout_ms) {
+    uint64_t t0 = phit_now_ns();
+    for (;;) {
+        if (phit__cq_ready(cq)) return 1;
+        if (cq->inflight == 0) return 0;   /* nothing can arrive */
+#if defined(_WIN32)
+        if (timeout_ms >= 0 && phit_now_ns() - t0 >= (uint64_t)timeout_ms * 1000000) return 0;
+        Sleep(1);
+#else
+        int left = -1;
+        if (timeout_ms >= 0) {
+            uint64_t spent = (phit_now_ns() - t0) / 1000000;
+            if (spent >= (uint64_t)timeout_ms) return 0;
+            left = timeout_ms - (int)spent;
+        }
+        struct pollfd p = { cq->fd_read, POLLIN, 0 };
+        if (poll(&p, 1, left) == 0) return 0;
+        /* Readable with nothing at the head: a wakeup for entries an
+         * earlier poll already took */
+        if (!phit__cq_ready(cq)) phit__cq_rearm(cq);
+#endif
+    }
+}
+
+/* One pass over the rings from the routed one; 0 when all are full */
+static int phit__submit_try(phit_exec_t *e, int worker, phit_task_fn fn, void *arg) {
+    int n = e->num_workers;
+    for (int k = 0; k < n; k++) {
+        int w = worker + k < n ? worker + k : worker + k - n;
+        if (phit__ring_push(&e->queues[w], e->single_producer, fn, arg)) return 1;
+    }
+    return 0;
+}
+
+static int phit__submit_async_to(phit_exec_t *e, phit_cq_t *cq, int worker, phit_task_fn fn,
+                                 void *arg, uint64_t *handle) {
+    if (!PHIT__LOAD_INT(&e->accepting)) return 0;
+    if (cq->free_head == PHIT__CQ_NONE) return -1;
+    phit__async_t *r = &cq->recs[cq->free_head];
+    r->fn = fn;
+    r->arg = arg;
+    r->handle = ++cq->next_handle;
+    if (!phit__submit_try(e, worker, phit__async_run, r)) return -1;
+    cq->free_head = r->next_free;
+    cq->inflight++;
+    if (handle) *handle = r->handle;
+    return 1;
+}
+
+int phit_exec_submit_async(phit_exec_t *e, phit_cq_t *cq, phit_task_fn fn, void *arg,
+                           uint64_t *handle) {
+    return phit__submit_async_to(e, cq, phit_route(e->num_workers), fn, arg, handle);
+}
+
+int phit_exec_submit_async_batch(phit_exec_t *e, phit_cq_t *cq, const phit_task_t *tasks,
+                                 int count, uint64_t *handles) {
+    uint32_t keys[PHIT_EXEC_BATCH];
+    int done = 0;
+    while (done < count) {
+        int n = count - done < PHIT_EXEC_BATCH ? count - done : PHIT_EXEC_BATCH;
+        phit_sample_compound_batch(keys, n, 2);
+        for (int i = 0; i < n; i++) {
+            int w = (int)phit_reduce32(keys[i], (uint32_t)e->num_workers);
+            if (phit__submit_async_to(e, cq, w, tasks[done + i].fn, tasks[done + i].arg,
+                                      handles ? &handles[done + i] : NULL) != 1)
+                return done + i;
+        }
+        done += n;
+    }
+    return done;
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_EXEC_H */
@@ -0,0 +1,151 @@
+/*
+ * phit_exec_coro.hpp — C++20 Awaitables over phit_exec Async Completions
+ * ======================================================================
+ *
+ * Companion to phit_exec.h. An async_queue owns one phit_cq_t; inside a
+ * coroutine running on the queue's reactor thread,
+ *
+ *   int n = co_await q.run([] { return work(); });
+ *
+ * submits the callable with phit_exec_submit_async() and suspends. The
+ * reactor watches q.fd() in its event loop and calls q.drain() when it
+ * is readable; drain() resumes each coroutine whose task has finished,
+ * on the reactor thread, with the callable's result (or its exception
+ * rethrown). When the queue is busy or the executor shut down, the
+ * callable runs inline and the coroutine does not suspend.
+ *
+ * The awaiter lives in the suspended coroutine's frame, so a coroutine
+ * must not be destroyed while it waits on a task.
+ *
+ * Header-only over the C API; link libphit (or define
+ * LIBPHIT_IMPLEMENTATION in one C file) as for phit_exec.h.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_EXEC_CORO_HPP
+#define PHIT_EXEC_CORO_HPP
+
+#include "phit_exec.h"
+
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace phit {
+
+namespace detail {
+
+/* What a completion's arg points at: the awaiter's type-erased half */
+struct async_node {
+    std::coroutine_handle<> waiter;
+    void (*invoke)(async_node *) = nullptr;
+};
+
+inline void async_trampoline(void *arg) {
+    async_node *n = static_cast<async_node *>(arg);
+    n->invoke(n);
+}
+
+}  // namespace detail
+
+class async_queue {
+public:
+    template <class F>
+    class awaiter;
+
+    /* capacity 0 = PHIT_EXEC_CQ_CAPACITY; throws std::bad_alloc on failure */
+    explicit async_queue(phit_exec_t *exec, int capacity = 0)
+        : exec_(exec), cq_(phit_cq_create(capacity)) {
+        if (!cq_) throw std::bad_alloc();
+    }
+    ~async_queue() { phit_cq_destroy(cq_); }
+    async_queue(const async_queue &) = delete;
+    async_queue &operator=(const async_queue &) = delete;
+
+    int fd() const { return phit_cq_fd(cq_); }
+    int inflight() const { return phit_cq_inflight(cq_); }
+    phit_cq_t *native() const { return cq_; }
+
+    template <class F>
+    awaiter<std::decay_t<F>> run(F &&f) {
+        return awaiter<std::decay_t<F>>(*this, std::forward<F>(f));
+    }
+
+    /* Resume every coroutine whose task has finished; returns how many */
+    int drain() {
+        phit_cqe_t cqe[64];
+        int total = 0, n;
+        while ((n = phit_cq_poll(cq_, cqe, 64)) > 0) {
+            for (int i = 0; i < n; i++)
+                static_cast<detail::async_node *>(cqe[i].arg)->waiter.resume();
+            total += n;
+        }
+        return total;
+    }
+
+    /* phit_cq_wait, then drain */
+    int wait_drain(int timeout_ms = -1) {
+        return phit_cq_wait(cq_, timeout_ms) ? drain() : 0;
+    }
+
+    template <class F>
+    class awaiter : detail::async_node {
+        using result_t = std::invoke_result_t<F &>;
+        using stored_t = std::conditional_t<std::is_void_v<result_t>, bool, result_t>;
+
+    public:
+        awaiter(async_queue &q, F f) : q_(q), f_(std::move(f)) {
+            invoke = [](detail::async_node *n) {
+                static_cast<awaiter *>(n)->call();
+            };
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            waiter = h;
+            if (phit_exec_submit_async(q_.exec_, q_.cq_, detail::async_trampoline,
+                                       static_cast<detail::async_node *>(this), nullptr) == 1)
+                return true;
+            call();
+            return false;
+        }
+
+        result_t await_resume() {
+            if (error_) std::rethrow_exception(error_);
+            if constexpr (!std::is_void_v<result_t>) return std::move(*result_);
+        }
+
+    private:
+        void call() noexcept {
+            try {
+                if constexpr (std::is_void_v<result_t>) {
+                    f_();
+                    result_.emplace(true);
+                } else {
+                    result_.emplace(f_());
+                }
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+        }
+
+        async_queue           &q_;
+        F                      f_;
+        std::optional<stored_t> result_;
+        std::exception_ptr     error_;
+    };
+
+private:
+    phit_exec_t *exec_;
+    phit_cq_t   *cq_;
+};
+
+}  // namespace phit
+
+#endif /* PHIT_EXEC_CORO_HPP */
@@ -15,7 +15,10 @@
  * Il vantaggio: entropia genuina dall'asincronia dei clock,
  * senza hardware RNG dedicato.
  *
- * Compila: gcc -O0 -o phit_prng phit_prng.c -lm
+ * Il pool di entropia e il PRNG sono quelli di libphit.h
+ * (phit_pool_*, phit_prng_*); qui restano solo i test di qualità.
+ *
+ * Compila: cmake -S . -B build && cmake --build build --target phit_prng
  *
  * Author: Alessio Cazzaniga
  */
@@ -25,110 +28,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
-#include <mach/mach_time.h>
-
-static volatile uint64_t sink;
-
-static inline uint64_t now_ns(void) {
-    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
-}
-
-/* ========== Phit entropy pool ========== */
-
-typedef struct {
-    uint64_t pool[4];      /* 256-bit entropy pool */
-    uint64_t mix_counter;  /* monotonic counter for mixing */
-    int bits_collected;    /* estimated phits accumulated */
-} phit_pool_t;
-
-/* Rotate left */
-static inline uint64_t rotl64(uint64_t x, int k) {
-    return (x << k) | (x >> (64 - k));
-}
-
-/* Mix a phit sample into the pool (inspired by SplitMix64) */
-static void pool_feed(phit_pool_t *p, uint64_t phit_sample) {
-    p->mix_counter++;
-
-    /* Combine sample with counter to prevent cycles */
-    uint64_t z = phit_sample + p->mix_counter * 0x9E3779B97F4A7C15ULL;
-    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
-    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
-    z = z ^ (z >> 31);
-
-    /* XOR into rotating pool position */
-    int slot = p->mix_counter & 3;
-    p->pool[slot] ^= z;
-
-    /* Cross-mix pool lanes */
-    p->pool[(slot + 1) & 3] ^= rotl64(p->pool[slot], 17);
-
-    p->bits_collected += 2;  /* ~2 phits per feed */
-}
-
-/* Harvest workload: do real work, measure phase */
-static void pool_harvest(phit_pool_t *p) {
-    volatile uint64_t x = 0xCAFEBABE;
-    for (int i = 0; i < 20; i++) {
-        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-        x ^= x >> 17;
-    }
-    sink = x;
 
-    uint64_t t = now_ns();
-    /* Feed both delta-derived and absolute-timer info */
-    pool_feed(p, t);
-    pool_feed(p, x ^ t);
-}
-
-/* Extract a 64-bit random value from the pool */
-static uint64_t pool_extract(phit_pool_t *p) {
-    /* Harvest fresh phits */
-    for (int i = 0; i < 4; i++) {
-        pool_harvest(p);
-    }
-
-    /* Output: combine all pool lanes */
-    uint64_t out = p->pool[0];
-    out ^= rotl64(p->pool[1], 13);
-    out ^= rotl64(p->pool[2], 29);
-    out ^= rotl64(p->pool[3], 43);
-
-    /* Forward-secure: hash the pool after extraction */
-    p->pool[0] ^= rotl64(out, 7);
-    p->pool[1] ^= rotl64(out, 23);
-
-    return out;
-}
-
-/* ========== PRNG interface ========== */
-
-typedef struct {
-    phit_pool_t pool;
-    uint64_t generated;
-} phit_prng_t;
+#include "libphit.h"
 
-static void prng_init(phit_prng_t *rng) {
-    memset(rng, 0, sizeof(phit_prng_t));
-    /* Seed with initial phase readings */
-    for (int i = 0; i < 16; i++) {
-        pool_harvest(&rng->pool);
-    }
-}
-
-static uint64_t prng_u64(phit_prng_t *rng) {
-    rng->generated++;
-    return pool_extract(&rng->pool);
-}
-
-static double prng_double(phit_prng_t *rng) {
-    return (double)(prng_u64(rng) >> 11) / (double)(1ULL << 53);
-}
-
-static uint32_t prng_range(phit_prng_t *rng, uint32_t max) {
-    return (uint32_t)(prng_u64(rng) % max);
-}
+static volatile uint64_t sink;
 
 /* ========== Quality tests ========== */
 
@@ -140,7 +43,7 @@ static void test_monobit(phit_prng_t *rng) {
     int total_bits = n * 64;
 
     for (int i = 0; i < n; i++) {
-        uint64_t v = prng_u64(rng);
+        uint64_t v = phit_prng_u64(rng);
         ones += __builtin_popcountll(v);
     }
 
@@ -165,7 +68,7 @@ static void test_runs(phit_prng_t *rng) {
     int ones = 0;
 
     for (int i = 0; i < n; i++) {
-        uint64_t v = prng_u64(rng);
+        uint64_t v = phit_prng_u64(rng);
         for (int b = 0; b < 64; b++) {
             int bit = (v >> b) & 1;
             ones += bit;
@@ -196,7 +99,7 @@ static void test_byte_distribution(phit_prng_t *rng) {
     int hist[256] = {0};
 
     for (int i = 0; i < n; i++) {
-        uint64_t v = prng_u64(rng);
+        uint64_t v = phit_prng_u64(rng);
         for (int b = 0; b < 8; b++) {
             hist[(v >> (b * 8)) & 0xFF]++;
         }
@@ -229,7 +132,7 @@ static void test_bit_entropy(phit_prng_t *rng) {
     int ones[64] = {0};
 
     for (int i = 0; i < n; i++) {
-        uint64_t v = prng_u64(rng);
+        uint64_t v = phit_prng_u64(rng);
         for (int b = 0; b < 64; b++) {
             if ((v >> b) & 1) ones[b]++;
         }
@@ -267,11 +170,11 @@ static void test_throughput(phit_prng_t *rng) {
     int n = 100000;
     uint64_t x = 0;
 
-    uint64_t t1 = now_ns();
+    uint64_t t1 = phit_now_ns();
     for (int i = 0; i < n; i++) {
-        x ^= prng_u64(rng);
+        x ^= phit_prng_u64(rng);
     }
-    uint64_t t2 = now_ns();
+    uint64_t t2 = phit_now_ns();
     sink = x;
 
     double elapsed_ms = (t2 - t1) / 1e6;
@@ -297,12 +200,12 @@ int main(void) {
     printf("╚══════════════════════════════════════════════════════════╝\n");
 
     phit_prng_t rng;
-    prng_init(&rng);
+    phit_prng_init(&rng);
 
     printf("\n  Sample output (first 10 values):\n");
     for (int i = 0; i < 10; i++) {
         printf("    %2d: 0x%016llX  (%.6f)\n",
-               i, (unsigned long long)prng_u64(&rng), prng_double(&rng));
+               i, (unsigned long long)phit_prng_u64(&rng), phit_prng_double(&rng));
     }
 
     printf("\n═══════════════════════════════════════════════════════════\n");
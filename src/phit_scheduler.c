@@ -11,7 +11,10 @@
  *   - Naturalmente decorrelato (nessun pattern periodico)
  *   - Scaling gratuito: più worker = più bit dal phit
  *
- * Compila: gcc -O0 -o phit_scheduler phit_scheduler.c -lm -lpthread
+ * Il routing è phit_route() di libphit.h (campionamento composto N=2);
+ * la demo 3 usa l'executor multi-coda di phit_exec.h.
+ *
+ * Compila: cmake -S . -B build && cmake --build build --target phit_scheduler
  *
  * Author: Alessio Cazzaniga
  */
@@ -21,58 +24,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
-#include <pthread.h>
-#include <mach/mach_time.h>
-
-static volatile uint64_t sink;
-
-static inline uint64_t now_ns(void) {
-    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
-}
-
-/* ========== Phit Router ========== */
 
-static inline uint32_t phit_hash(uint32_t key) {
-    key *= 2654435761u;
-    key ^= key >> 16;
-    key *= 0x85ebca6bu;
-    key ^= key >> 13;
-    return key;
-}
-
-static int phit_route(int num_workers) {
-    /* Read phase: workload + timer combined */
-    volatile uint64_t x = 0xDEADBEEF;
-    for (int i = 0; i < 10; i++) {
-        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
-    }
-    sink = x;
+#include "phit_exec.h"
 
-    uint64_t t = now_ns();
-    uint32_t key = (uint32_t)((t & 0x3) | (((uint32_t)(t >> 2) ^ (uint32_t)x) << 2));
-    key = phit_hash(key);
-    return key % num_workers;
-}
+static volatile uint64_t sink;
 
 /* ========== Task System ========== */
 
 #define MAX_WORKERS 16
-#define MAX_TASKS 500000
-
-typedef struct {
-    int id;
-    int type;         /* 0=compute, 1=io, 2=mixed */
-    uint64_t payload;
-    int assigned_worker;
-} phit_task_t;
-
-typedef struct {
-    int id;
-    int tasks_received;
-    uint64_t total_work;
-    uint64_t result;
-} worker_t;
 
 /* ========== Demo 1: Basic phit scheduling ========== */
 
@@ -186,73 +145,72 @@ static void demo_variable_cost(void) {
 
 /* ========== Demo 3: Lock-free dispatch ========== */
 
-static volatile int global_task_counter = 0;
-
-typedef struct {
-    int worker_id;
-    int num_workers;
-    int tasks_done;
-    uint64_t result;
-} thread_arg_t;
-
-static void *worker_thread(void *arg) {
-    thread_arg_t *a = (thread_arg_t *)arg;
-    a->tasks_done = 0;
-    a->result = 0;
-
-    /* Each worker does work independently.
-     * Task "ownership" is determined by phit at dispatch time. */
-    for (int i = 0; i < 50000; i++) {
-        int assigned = phit_route(a->num_workers);
-        if (assigned == a->worker_id) {
-            /* This task is "mine" — do the work */
-            volatile uint64_t x = i;
-            x = x * 2654435761u + 1;
-            a->result ^= x;
-            a->tasks_done++;
-        }
-    }
+/*
+ * phit_exec.h: ogni worker ha la sua coda; il producer sceglie la coda
+ * con phit_route(). Nessun contatore condiviso, e ogni task gira
+ * esattamente una volta (prima ogni worker filtrava tutti i task).
+ */
 
-    return NULL;
+#define DEMO3_TASKS 50000
+
+static phit_task_t demo3_tasks[DEMO3_TASKS];
+static uint64_t demo3_result[DEMO3_TASKS];
+static int demo3_runs[DEMO3_TASKS];
+
+static void demo3_task(void *arg) {
+    int i = (int)(uintptr_t)arg;
+    volatile uint64_t x = i;
+    x = x * 2654435761u + 1;
+    demo3_result[i] = x;
+    demo3_runs[i]++;
 }
 
 static void demo_lockfree_dispatch(void) {
     printf("\n=== DEMO 3: Lock-Free Multi-Thread Dispatch ===\n");
-    printf("  Each thread routes tasks using phits — no shared state.\n\n");
+    printf("  Producer routes each task to a worker queue using phits.\n\n");
 
     int num_workers = 4;
-    pthread_t threads[MAX_WORKERS];
-    thread_arg_t args[MAX_WORKERS];
-
-    uint64_t t_start = now_ns();
-
-    for (int w = 0; w < num_workers; w++) {
-        args[w].worker_id = w;
-        args[w].num_workers = num_workers;
-        pthread_create(&threads[w], NULL, worker_thread, &args[w]);
+    phit_exec_t *exec = phit_exec_create(num_workers, 0, PHIT_EXEC_SINGLE_PRODUCER);
+    if (!exec) {
+        printf("  cannot start the executor\n");
+        return;
     }
 
-    for (int w = 0; w < num_workers; w++) {
-        pthread_join(threads[w], NULL);
+    for (int i = 0; i < DEMO3_TASKS; i++) {
+        demo3_tasks[i].fn = demo3_task;
+        demo3_tasks[i].arg = (void *)(uintptr_t)i;
     }
 
-    uint64_t t_end = now_ns();
+    uint64_t t_start = phit_now_ns();
+    phit_exec_submit_batch(exec, demo3_tasks, DEMO3_TASKS);
+    phit_exec_shutdown(exec);
+    uint64_t t_end = phit_now_ns();
     double elapsed_ms = (t_end - t_start) / 1e6;
 
-    printf("  %6s | %8s | %16s\n", "Worker", "Tasks", "Result hash");
-    printf("  %6s-+-%8s-+-%16s\n", "------", "--------", "----------------");
+    printf("  %6s | %8s\n", "Worker", "Tasks");
+    printf("  %6s-+-%8s\n", "------", "--------");
 
-    int total_tasks = 0;
+    uint64_t total_tasks = 0;
     for (int w = 0; w < num_workers; w++) {
-        printf("  %6d | %8d | 0x%014llX\n",
-               w, args[w].tasks_done, (unsigned long long)args[w].result);
-        total_tasks += args[w].tasks_done;
+        uint64_t n = phit_exec_executed(exec, w);
+        printf("  %6d | %8llu\n", w, (unsigned long long)n);
+        total_tasks += n;
+    }
+
+    int exactly_once = 1;
+    uint64_t hash = 0;
+    for (int i = 0; i < DEMO3_TASKS; i++) {
+        if (demo3_runs[i] != 1) exactly_once = 0;
+        hash ^= demo3_result[i];
     }
+    phit_exec_destroy(exec);
 
-    printf("\n  Total tasks executed: %d\n", total_tasks);
+    printf("\n  Total tasks executed: %llu (%s)\n", (unsigned long long)total_tasks,
+           exactly_once ? "each exactly once" : "LOST OR DUPLICATED");
+    printf("  Result hash: 0x%014llX\n", (unsigned long long)hash);
     printf("  Elapsed: %.1f ms\n", elapsed_ms);
     printf("  Tasks/sec: %.0f\n", total_tasks / (elapsed_ms / 1000.0));
-    printf("\n  Key insight: NO mutex, NO atomic counter, NO shared state.\n");
+    printf("\n  Key insight: NO mutex, NO atomic counter on the dispatch path.\n");
     printf("  The phase relationship IS the coordination mechanism.\n");
 }
 
@@ -271,13 +229,13 @@ static void demo_throughput(void) {
     for (int ci = 0; ci < nc; ci++) {
         int K = configs[ci];
 
-        uint64_t t1 = now_ns();
+        uint64_t t1 = phit_now_ns();
         volatile int s = 0;
         for (int i = 0; i < n; i++) {
             s += phit_route(K);
         }
         sink = s;
-        uint64_t t2 = now_ns();
+        uint64_t t2 = phit_now_ns();
 
         double elapsed_s = (t2 - t1) / 1e9;
         double routes_per_sec = n / elapsed_s;
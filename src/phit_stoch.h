@@ -0,0 +1,199 @@
+/*
+ * phit_stoch.h — Stochastic Computing on Bit-Packed Streams
+ * =========================================================
+ *
+ * Companion to libphit.h. A value p in [0, 1] is a bitstream whose bits
+ * are 1 with probability p (docs/STOCHASTIC_COMPUTING.md); arithmetic is
+ * logic over whole streams:
+ *
+ *   phit_stoch_and    a * b            (independent a, b)
+ *   phit_stoch_mux    (a + b) / 2      (selector stream at p = 0.5)
+ *   phit_stoch_not    1 - a
+ *   phit_stoch_count  ones, so phit_stoch_value = ones / bits
+ *
+ * Streams are packed 64 bits per word: every word operation is 64 gates
+ * at once, and the loops are plain word loops the compiler vectorizes.
+ *
+ * The encoder is a comparator bank driven by the phit pool instead of an
+ * LFSR. One phit_pool_extract() word keys the counter-mode expansion of
+ * libphit's buffered PRNG (the dispatched NEON/AVX2/AVX-512 kernels), and
+ * each output word takes PHIT_STOCH_BITS expansion words as bit planes:
+ * lane i compares the PHIT_STOCH_BITS-bit number held in bit i of the
+ * planes against p. The comparison runs on whole planes, LSB first,
+ *
+ *   z = p_j ? (plane_j | z) : (plane_j & z)
+ *
+ * so each plane costs one gate per 64 lanes and P(z) is exactly p
+ * quantized to PHIT_STOCH_BITS bits. Streams that are combined with AND
+ * or MUX must come from different keys (separate extractions).
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_stoch.h (it includes libphit.h and
+ * phit_battery.h), or link the libphit library, which already contains it.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_STOCH_H
+#define PHIT_STOCH_H
+
+#include "libphit.h"
+#include "phit_battery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+/* Comparator precision: p is quantized to this many bits */
+#ifndef PHIT_STOCH_BITS
+#define PHIT_STOCH_BITS 16
+#endif
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+/* nwords * 64 bits; words are owned by the stream */
+typedef struct {
+    uint64_t *words;
+    size_t    nwords;
+} phit_bitstream_t;
+
+/* ====================================================================
+ * API Declarations
+ * ==================================================================== */
+
+/* bits rounded up to a multiple of 64; 0 when out of memory */
+int      phit_bitstream_init(phit_bitstream_t *s, size_t bits);
+void     phit_bitstream_free(phit_bitstream_t *s);
+size_t   phit_bitstream_bits(const phit_bitstream_t *s);
+
+/* Bits with P(1) = p (clamped to [0, 1], quantized to PHIT_STOCH_BITS).
+ * The same key always gives the same stream. */
+void     phit_stoch_encode(phit_bitstream_t *s, double p, uint64_t key);
+/* Keyed from one phit_pool_extract(pool) */
+void     phit_stoch_encode_pool(phit_bitstream_t *s, double p, phit_pool_t *pool);
+
+/* Word-wise ops over min(nwords) of the operands; out may alias any */
+void     phit_stoch_and(phit_bitstream_t *out, const phit_bitstream_t *a,
+                        const phit_bitstream_t *b);
+/* sel bit 0 takes a, 1 takes b */
+void     phit_stoch_mux(phit_bitstream_t *out, const phit_bitstream_t *a,
+                        const phit_bitstream_t *b, const phit_bitstream_t *sel);
+void     phit_stoch_not(phit_bitstream_t *out, const phit_bitstream_t *a);
+uint64_t phit_stoch_count(const phit_bitstream_t *s);
+double   phit_stoch_value(const phit_bitstream_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_STOCH_IMPLEMENTED)
+#define PHIT_STOCH_IMPLEMENTED
+
+#include <stdlib.h>
+
+/* Output words per block: the planes of one block are 8 KB at the
+ * default precision */
+#define PHIT__STOCH_BLOCK 64
+
+int phit_bitstream_init(phit_bitstream_t *s, size_t bits) {
+    s->nwords = (bits + 63) / 64;
+    s->words = calloc(s->nwords ? s->nwords : 1, sizeof(uint64_t));
+    if (!s->words) s->nwords = 0;
+    return s->words != NULL;
+}
+
+void phit_bitstream_free(phit_bitstream_t *s) {
+    free(s->words);
+    s->words = NULL;
+    s->nwords = 0;
+}
+
+size_t phit_bitstream_bits(const phit_bitstream_t *s) {
+    return s->nwords * 64;
+}
+
+/* ---- Encoder ---- */
+
+void phit_stoch_encode(phit_bitstream_t *s, double p, uint64_t key) {
+    const uint64_t one = 1ULL << PHIT_STOCH_BITS;
+    double scaled = p * (double)one + 0.5;
+    uint64_t q = scaled <= 0 ? 0 : scaled >= (double)one ? one : (uint64_t)scaled;
+    if (q == one) {
+        memset(s->words, 0xFF, s->nwords * sizeof(uint64_t));
+        return;
+    }
+    const uint64_t k0 = key, k1 = phit_hash64(key ^ 0x53544F4348ULL);   /* "STOCH" */
+
+    PHIT__ALIGNED(64) uint64_t planes[PHIT_STOCH_BITS][PHIT__STOCH_BLOCK];
+    uint64_t ctr = 0;
+    for (size_t at = 0; at < s->nwords; at += PHIT__STOCH_BLOCK) {
+        size_t n = s->nwords - at < PHIT__STOCH_BLOCK ? s->nwords - at : PHIT__STOCH_BLOCK;
+        /* Whole blocks of planes, so a stream's prefix does not depend on
+         * its length */
+        phit__expand_words(k0, k1, ctr, (uint8_t *)planes, sizeof(planes) / 8);
+        ctr += sizeof(planes) / 8;
+
+        uint64_t *out = s->words + at;
+        for (size_t w = 0; w < n; w++) out[w] = 0;
+        for (int j = 0; j < PHIT_STOCH_BITS; j++) {
+            const uint64_t m = 0 - ((q >> j) & 1);     /* bit j of p, as a mask */
+            const uint64_t *r = planes[j];
+            for (size_t w = 0; w < n; w++) out[w] = (r[w] & out[w]) | (m & (r[w] | out[w]));
+        }
+    }
+}
+
+void phit_stoch_encode_pool(phit_bitstream_t *s, double p, phit_pool_t *pool) {
+    phit_stoch_encode(s, p, phit_pool_extract(pool));
+}
+
+/* ---- Arithmetic ---- */
+
+static size_t phit__stoch_min(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+void phit_stoch_and(phit_bitstream_t *out, const phit_bitstream_t *a,
+                    const phit_bitstream_t *b) {
+    size_t n = phit__stoch_min(out->nwords, phit__stoch_min(a->nwords, b->nwords));
+    for (size_t w = 0; w < n; w++) out->words[w] = a->words[w] & b->words[w];
+}
+
+void phit_stoch_mux(phit_bitstream_t *out, const phit_bitstream_t *a,
+                    const phit_bitstream_t *b, const phit_bitstream_t *sel) {
+    size_t n = phit__stoch_min(phit__stoch_min(out->nwords, sel->nwords),
+                               phit__stoch_min(a->nwords, b->nwords));
+    for (size_t w = 0; w < n; w++) {
+        uint64_t s = sel->words[w];
+        out->words[w] = (a->words[w] & ~s) | (b->words[w] & s);
+    }
+}
+
+void phit_stoch_not(phit_bitstream_t *out, const phit_bitstream_t *a) {
+    size_t n = phit__stoch_min(out->nwords, a->nwords);
+    for (size_t w = 0; w < n; w++) out->words[w] = ~a->words[w];
+}
+
+uint64_t phit_stoch_count(const phit_bitstream_t *s) {
+    /* phit_battery.h's counter: VPOPCNTQ, POPCNT or SWAR by CPU */
+    return phit__battery_count_best(s->words, s->nwords);
+}
+
+double phit_stoch_value(const phit_bitstream_t *s) {
+    return s->nwords ? (double)phit_stoch_count(s) / (double)(s->nwords * 64) : 0.0;
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_STOCH_H */
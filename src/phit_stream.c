@@ -0,0 +1,290 @@
+/*
+ * phit_stream — Conditioned PRNG output to stdout at generator speed
+ * ==================================================================
+ *
+ * Writes phit_prng_fill() output to stdout in large blocks, for test
+ * suites that read a byte stream:
+ *
+ *   phit_stream | dieharder -g 200 -a
+ *   phit_stream -t 4 | RNG_test stdin64          (PractRand)
+ *   phit_stream -n 1e9 > sample.bin
+ *
+ *   -t THREADS   generator threads, one buffered PRNG each (default 1)
+ *   -b BYTES     block size (default 1 MiB)
+ *   -n BYTES     stop after this many bytes (default: until the reader exits)
+ *   -O           ordered: blocks leave in claim order, not completion order
+ *   -S           never vmsplice, always write(2)
+ *   -v           rate summary on stderr
+ *
+ * Generators fill blocks of a shared ring; the main thread writes them
+ * out. Unordered mode writes whichever block is ready first; ordered
+ * mode writes block k before block k + 1, so the interleaving of the
+ * threads' generators is fixed. There is no rate limit anywhere.
+ *
+ * On Linux, when stdout is a pipe, blocks go out with vmsplice(): the pipe
+ * references the ring's pages instead of copying them. The pipe is sized to
+ * at most one block, so once block k + 1 is fully spliced the reader has
+ * consumed block k and its buffer can be refilled.
+ *
+ * Compile: cmake -S . -B build && cmake --build build --target phit_stream
+ *
+ * Author: Alessio Cazzaniga
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* vmsplice, F_SETPIPE_SZ */
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/uio.h>
+#endif
+
+#include "libphit.h"
+
+#define STREAM_MAX_THREADS 256
+
+enum { SLOT_FREE, SLOT_FILLING, SLOT_READY, SLOT_WRITING };
+
+typedef struct {
+    uint8_t *mem;
+    uint64_t seq;
+    int      state;
+} stream_slot_t;
+
+typedef struct {
+    stream_slot_t  *slots;
+    int             nslots;
+    size_t          block;
+    uint64_t        blocks;         /* total to produce, 0 = unbounded */
+    uint64_t        claimed;        /* next sequence number */
+    int             ordered;
+    int             stop;
+    pthread_mutex_t mu;
+    pthread_cond_t  ready;          /* a slot became READY */
+    pthread_cond_t  freed;          /* a slot became FREE */
+} stream_ring_t;
+
+static stream_ring_t ring;
+
+static void *stream_generator(void *arg) {
+    (void)arg;
+    phit_prng_t rng;
+    phit_prng_init_buffered(&rng, 0, 0);
+    for (;;) {
+        pthread_mutex_lock(&ring.mu);
+        /* Ordered: sequence k always lands in slot k % nslots, which the
+         * writer looks up. Unordered: any free slot. */
+        stream_slot_t *s = NULL;
+        for (;;) {
+            if (ring.stop || (ring.blocks && ring.claimed >= ring.blocks)) {
+                pthread_mutex_unlock(&ring.mu);
+                return NULL;
+            }
+            if (ring.ordered) {
+                s = &ring.slots[ring.claimed % (uint64_t)ring.nslots];
+                if (s->state == SLOT_FREE) break;
+            } else {
+                for (int i = 0; i < ring.nslots; i++) {
+                    if (ring.slots[i].state == SLOT_FREE) {
+                        s = &ring.slots[i];
+                        break;
+                    }
+                }
+                if (s) break;
+            }
+            pthread_cond_wait(&ring.freed, &ring.mu);
+        }
+        s->seq = ring.claimed++;
+        s->state = SLOT_FILLING;
+        pthread_mutex_unlock(&ring.mu);
+
+        phit_prng_fill(&rng, s->mem, (int)ring.block);
+
+        pthread_mutex_lock(&ring.mu);
+        s->state = SLOT_READY;
+        pthread_cond_broadcast(&ring.ready);
+        pthread_mutex_unlock(&ring.mu);
+    }
+}
+
+/* Wait for the next block to write: the oldest in ordered mode, any
+ * ready one otherwise. NULL once every block has been written. */
+static stream_slot_t *stream_next(uint64_t next_seq, int ordered) {
+    pthread_mutex_lock(&ring.mu);
+    stream_slot_t *s = NULL;
+    while (!s) {
+        if (ring.blocks && next_seq >= ring.blocks) break;
+        if (ordered) {
+            stream_slot_t *c = &ring.slots[next_seq % (uint64_t)ring.nslots];
+            if (c->state == SLOT_READY && c->seq == next_seq) s = c;
+        } else {
+            for (int i = 0; i < ring.nslots && !s; i++) {
+                if (ring.slots[i].state == SLOT_READY) s = &ring.slots[i];
+            }
+        }
+        if (s) s->state = SLOT_WRITING;
+        else pthread_cond_wait(&ring.ready, &ring.mu);
+    }
+    pthread_mutex_unlock(&ring.mu);
+    return s;
+}
+
+static void stream_release(stream_slot_t *s) {
+    pthread_mutex_lock(&ring.mu);
+    s->state = SLOT_FREE;
+    pthread_cond_broadcast(&ring.freed);
+    pthread_mutex_unlock(&ring.mu);
+}
+
+/* 0 on success, -1 when the reader has gone */
+static int stream_write(int fd, const uint8_t *p, size_t len, int splice) {
+    while (len) {
+        ssize_t n;
+#if defined(__linux__)
+        if (splice) {
+            struct iovec iov = { (void *)p, len };
+            n = vmsplice(fd, &iov, 1, 0);
+        } else
+#endif
+        {
+            (void)splice;
+            n = write(fd, p, len);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* vmsplice is safe when the pipe holds at most one block (see top) */
+static int stream_splice_setup(int fd, size_t block) {
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) return 0;
+    fcntl(fd, F_SETPIPE_SZ, (int)block);
+    int sz = fcntl(fd, F_GETPIPE_SZ);
+    return sz > 0 && (size_t)sz <= block;
+#else
+    (void)fd;
+    (void)block;
+    return 0;
+#endif
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-t THREADS] [-b BYTES] [-n BYTES] [-O] [-S] [-v]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int threads = 1, ordered = 0, no_splice = 0, verbose = 0;
+    double block = 1 << 20, total = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-O")) ordered = 1;
+        else if (!strcmp(argv[i], "-S")) no_splice = 1;
+        else if (!strcmp(argv[i], "-v")) verbose = 1;
+        else if (i + 1 >= argc) usage(argv[0]);
+        else if (!strcmp(argv[i], "-t")) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b")) block = strtod(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-n")) total = strtod(argv[++i], NULL);
+        else usage(argv[0]);
+    }
+    if (threads < 1 || threads > STREAM_MAX_THREADS || block < 4096 || block > (1 << 30) ||
+        total < 0)
+        usage(argv[0]);
+
+    /* A closed reader ends the stream with EPIPE instead of a signal */
+    signal(SIGPIPE, SIG_IGN);
+
+    const int fd = 1;
+    ring.ordered = ordered;
+    ring.block = (size_t)block & ~(size_t)4095;
+    uint64_t last_len = 0;
+    if (total > 0) {
+        uint64_t bytes = (uint64_t)total;
+        ring.blocks = (bytes + ring.block - 1) / ring.block;
+        last_len = bytes - (ring.blocks - 1) * ring.block;
+    }
+    int splice = !no_splice && stream_splice_setup(fd, ring.block);
+    /* Two slots per generator keep every thread busy while one is written,
+     * plus the one a splice still pins */
+    ring.nslots = 2 * threads + 2;
+    ring.slots = calloc((size_t)ring.nslots, sizeof(stream_slot_t));
+    for (int i = 0; i < ring.nslots; i++) {
+        /* Page-aligned, so a splice hands the pipe whole pages */
+        void *mem = NULL;
+        if (posix_memalign(&mem, 4096, ring.block) != 0) mem = NULL;
+        ring.slots[i].mem = mem;
+        if (!mem) {
+            fprintf(stderr, "phit_stream: out of memory\n");
+            return 1;
+        }
+    }
+    pthread_mutex_init(&ring.mu, NULL);
+    pthread_cond_init(&ring.ready, NULL);
+    pthread_cond_init(&ring.freed, NULL);
+
+    pthread_t th[STREAM_MAX_THREADS];
+    int started = 0;
+    while (started < threads && pthread_create(&th[started], NULL, stream_generator, NULL) == 0)
+        started++;
+    if (started == 0) {
+        fprintf(stderr, "phit_stream: cannot start a generator thread\n");
+        return 1;
+    }
+    if (started < threads && verbose)
+        fprintf(stderr, "phit_stream: started %d of %d generator threads\n", started, threads);
+
+    uint64_t t0 = phit_now_ns(), written = 0, seq = 0;
+    stream_slot_t *pinned = NULL;   /* spliced, maybe still referenced by the pipe */
+    int broken = 0;
+    stream_slot_t *s;
+    while ((s = stream_next(seq, ordered)) != NULL) {
+        size_t len = ring.blocks && seq == ring.blocks - 1 ? (size_t)last_len : ring.block;
+        if (stream_write(fd, s->mem, len, splice) != 0) {
+            broken = 1;
+            stream_release(s);
+            break;
+        }
+        written += len;
+        seq++;
+        if (splice) {
+            if (pinned) stream_release(pinned);
+            pinned = s;
+        } else {
+            stream_release(s);
+        }
+    }
+    pthread_mutex_lock(&ring.mu);
+    ring.stop = 1;
+    pthread_cond_broadcast(&ring.freed);
+    pthread_mutex_unlock(&ring.mu);
+    if (pinned) stream_release(pinned);
+    for (int t = 0; t < started; t++) pthread_join(th[t], NULL);
+    uint64_t t1 = phit_now_ns();
+
+    if (verbose) {
+        fprintf(stderr, "phit_stream: %llu bytes in %.2f s, %.2f GB/s, %d thread(s), %s, %s%s\n",
+                (unsigned long long)written, (t1 - t0) / 1e9,
+                (double)written / (double)(t1 - t0), started, ordered ? "ordered" : "unordered",
+                splice ? "vmsplice" : "write", broken ? ", reader closed" : "");
+    }
+    for (int i = 0; i < ring.nslots; i++) free(ring.slots[i].mem);
+    free(ring.slots);
+    /* A reader that stops early (dieharder, head) is the normal way out */
+    return broken && ring.blocks ? 1 : 0;
+}
@@ -0,0 +1,642 @@
+/*
+ * phit_topo.h — CPU Topology and Hierarchical Phase Routing
+ * =========================================================
+ *
+ * Companion to libphit.h. phit_route(K) treats its K destinations as
+ * equivalent; on multi-socket and chiplet machines half of those picks
+ * cross the interconnect, and the task payload's cache misses cost more
+ * than the route. This header groups CPUs into nodes and routes within
+ * the caller's node first:
+ *
+ *   phit_topo_discover   nodes from the OS: NUMA nodes, last-level cache
+ *                        domains (chiplets) or performance classes
+ *   phit_route_hier      a destination in the caller's node, or with
+ *                        probability spill one on another node
+ *
+ * Discovery reads sysfs on Linux (nodeN/cpulist, the cache indexes'
+ * shared_cpu_list, cpu_core/cpu_atom or cpu_capacity for hybrid parts),
+ * hw.perflevelN on macOS and GetLogicalProcessorInformationEx on Windows.
+ * Anything it cannot read becomes one flat node, so callers never need a
+ * second code path. macOS reports neither the running CPU nor affinity:
+ * there nodes are its performance levels, phit_topo_pin() sets a QoS
+ * class instead of a mask, and threads name their node with
+ * phit_topo_set_thread_node().
+ *
+ * The caller's node is cached per thread and re-read every
+ * PHIT_TOPO_NODE_REFRESH lookups, so a route costs a TLS read, not a
+ * getcpu. phit_exec.h builds per-node worker groups on this
+ * (phit_exec_create_topo, phit_exec_submit_local).
+ *
+ * Usage: as libphit.h. Define LIBPHIT_IMPLEMENTATION in exactly ONE .c
+ * file before including phit_topo.h (it includes libphit.h), or link the
+ * libphit library, which already contains it. On Linux the running CPU
+ * and affinity need _GNU_SOURCE before the first include (the library
+ * build defines it); without it every thread is on node 0 unless it says
+ * otherwise.
+ *
+ * Author: Alessio Cazzaniga
+ * License: BSL 1.1 (see LICENSE).
+ */
+
+#ifndef PHIT_TOPO_H
+#define PHIT_TOPO_H
+
+#include "libphit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+#ifndef PHIT_TOPO_MAX_CPUS
+#define PHIT_TOPO_MAX_CPUS 1024
+#endif
+
+#ifndef PHIT_TOPO_MAX_NODES
+#define PHIT_TOPO_MAX_NODES 64
+#endif
+
+/* Lookups between re-reads of the calling thread's CPU */
+#ifndef PHIT_TOPO_NODE_REFRESH
+#define PHIT_TOPO_NODE_REFRESH 1024
+#endif
+
+/* Default probability that phit_route_hier leaves the caller's node */
+#ifndef PHIT_TOPO_SPILL
+#define PHIT_TOPO_SPILL 0.0
+#endif
+
+/* ====================================================================
+ * Types
+ * ==================================================================== */
+
+/* What a node is (phit_topo_discover level, phit_topo_t.kind) */
+enum {
+    PHIT_TOPO_FLAT,         /* one node: nothing better was readable */
+    PHIT_TOPO_NUMA,         /* memory nodes (sockets, SNC/NPS domains) */
+    PHIT_TOPO_CACHE,        /* last-level cache domains, e.g. CCDs */
+    PHIT_TOPO_PERF,         /* performance classes: node 0 = fastest */
+    PHIT_TOPO_SYNTHETIC     /* phit_topo_synthetic */
+};
+
+typedef struct {
+    int      kind;
+    int      num_cpus;                          /* highest CPU id + 1 */
+    int      num_nodes;
+    int16_t  node_of[PHIT_TOPO_MAX_CPUS];       /* -1 = offline */
+    uint8_t  perf_class[PHIT_TOPO_MAX_CPUS];    /* 0 = fastest */
+    int      node_cpus[PHIT_TOPO_MAX_NODES];    /* online CPUs per node */
+} phit_topo_t;
+
+/* Destinations numbered node by node: node n owns [first[n], first[n] + count[n]) */
+typedef struct {
+    int      num_nodes;
+    int      total;
+    uint32_t spill;                             /* P(remote) * 2^16 */
+    int      first[PHIT_TOPO_MAX_NODES];
+    int      count[PHIT_TOPO_MAX_NODES];
+} phit_hier_t;
+
+/* ====================================================================
+ * API Declarations
+ * ==================================================================== */
+
+/* level: PHIT_TOPO_NUMA, _CACHE or _PERF. Returns num_nodes (>= 1);
+ * t->kind is PHIT_TOPO_FLAT when the level could not be read. */
+int      phit_topo_discover(phit_topo_t *t, int level);
+/* num_nodes nodes of cpus_per_node consecutive CPUs, for tests and for
+ * benchmarks on single-node machines */
+void     phit_topo_synthetic(phit_topo_t *t, int num_nodes, int cpus_per_node);
+const char *phit_topo_kind_name(int kind);
+
+/* k-th online CPU of node, -1 past the end */
+int      phit_topo_node_cpu(const phit_topo_t *t, int node, int k);
+/* CPU the calling thread runs on, -1 where the OS does not say */
+int      phit_topo_current_cpu(void);
+/* Calling thread's node: the declared one, else from its (cached) CPU */
+int      phit_topo_current_node(const phit_topo_t *t);
+/* Declare the calling thread's node; -1 returns to detection */
+void     phit_topo_set_thread_node(int node);
+/* Restrict the calling thread to node's CPUs (a QoS class on macOS).
+ * 1 = applied; also declares the node either way. */
+int      phit_topo_pin(const phit_topo_t *t, int node);
+
+/* count[n] destinations on node n; spill in [0, 1] (< 0 = PHIT_TOPO_SPILL).
+ * 0 if num_nodes or the total is out of range. */
+int      phit_hier_init(phit_hier_t *h, const int *count, int num_nodes, double spill);
+/* Both candidates from one phase key: a destination on node, and one
+ * uniform over every other node (the local one when there is no other).
+ * Returns 1 when the spill draw chose remote. */
+int      phit_route_hier_pair(const phit_hier_t *h, int node, int *local, int *remote);
+int      phit_route_hier(const phit_hier_t *h, int node);
+/* Spill under load as well: remote when the local pick is at least
+ * depth_limit deep and the remote one is shallower */
+int      phit_route_hier_load(const phit_hier_t *h, int node, const phit_load_t *loads,
+                              int64_t depth_limit);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ====================================================================
+ * Implementation
+ * ==================================================================== */
+
+#if defined(LIBPHIT_IMPLEMENTATION) && !defined(PHIT_TOPO_IMPLEMENTED)
+#define PHIT_TOPO_IMPLEMENTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__APPLE__)
+  #include <sys/types.h>
+  #include <sys/sysctl.h>
+  #include <pthread.h>
+#elif defined(__linux__)
+  #include <unistd.h>
+  #if defined(_GNU_SOURCE)
+    #include <sched.h>
+  #endif
+#endif
+
+#define PHIT__TOPO_WORDS ((PHIT_TOPO_MAX_CPUS + 63) / 64)
+
+const char *phit_topo_kind_name(int kind) {
+    switch (kind) {
+    case PHIT_TOPO_NUMA:      return "numa";
+    case PHIT_TOPO_CACHE:     return "cache";
+    case PHIT_TOPO_PERF:      return "perf";
+    case PHIT_TOPO_SYNTHETIC: return "synthetic";
+    default:                  return "flat";
+    }
+}
+
+static void phit__topo_clear(phit_topo_t *t) {
+    memset(t, 0, sizeof(phit_topo_t));
+    for (int c = 0; c < PHIT_TOPO_MAX_CPUS; c++) t->node_of[c] = -1;
+}
+
+/* Count CPUs per node and drop empty node numbers */
+static void phit__topo_finish(phit_topo_t *t) {
+    int remap[PHIT_TOPO_MAX_NODES], used = 0;
+    memset(t->node_cpus, 0, sizeof(t->node_cpus));
+    for (int c = 0; c < t->num_cpus; c++) {
+        if (t->node_of[c] >= 0) t->node_cpus[t->node_of[c]]++;
+    }
+    for (int n = 0; n < PHIT_TOPO_MAX_NODES; n++) remap[n] = t->node_cpus[n] ? used++ : -1;
+    for (int c = 0; c < t->num_cpus; c++) {
+        if (t->node_of[c] >= 0) t->node_of[c] = (int16_t)remap[t->node_of[c]];
+    }
+    memset(t->node_cpus, 0, sizeof(t->node_cpus));
+    for (int c = 0; c < t->num_cpus; c++) {
+        if (t->node_of[c] >= 0) t->node_cpus[t->node_of[c]]++;
+    }
+    t->num_nodes = used;
+}
+
+/* Online CPUs 0..n-1 in one node */
+static void phit__topo_flat(phit_topo_t *t, int n) {
+    phit__topo_clear(t);
+    if (n < 1) n = 1;
+    if (n > PHIT_TOPO_MAX_CPUS) n = PHIT_TOPO_MAX_CPUS;
+    t->kind = PHIT_TOPO_FLAT;
+    t->num_cpus = n;
+    for (int c = 0; c < n; c++) t->node_of[c] = 0;
+    phit__topo_finish(t);
+}
+
+void phit_topo_synthetic(phit_topo_t *t, int num_nodes, int cpus_per_node) {
+    if (num_nodes < 1) num_nodes = 1;
+    if (num_nodes > PHIT_TOPO_MAX_NODES) num_nodes = PHIT_TOPO_MAX_NODES;
+    if (cpus_per_node < 1) cpus_per_node = 1;
+    if (num_nodes * cpus_per_node > PHIT_TOPO_MAX_CPUS) cpus_per_node = PHIT_TOPO_MAX_CPUS / num_nodes;
+    phit__topo_clear(t);
+    t->kind = PHIT_TOPO_SYNTHETIC;
+    t->num_cpus = num_nodes * cpus_per_node;
+    for (int c = 0; c < t->num_cpus; c++) t->node_of[c] = (int16_t)(c / cpus_per_node);
+    phit__topo_finish(t);
+}
+
+/* ---- Linux: sysfs ---- */
+
+#if defined(__linux__)
+
+static int phit__topo_read(const char *path, char *out, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    size_t n = fread(out, 1, size - 1, f);
+    fclose(f);
+    out[n] = 0;
+    return n > 0;
+}
+
+/* "0-3,8,10-11" into a CPU mask; returns the CPUs listed */
+static int phit__topo_parse_list(const char *s, uint64_t *mask) {
+    int n = 0;
+    while (*s) {
+        char *end;
+        long a = strtol(s, &end, 10);
+        if (end == s) break;
+        long b = a;
+        s = end;
+        if (*s == '-') {
+            b = strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long c = a < 0 ? 0 : a; c <= b && c < PHIT_TOPO_MAX_CPUS; c++) {
+            mask[c / 64] |= 1ULL << (c % 64);
+            n++;
+        }
+        if (*s != ',') break;
+        s++;
+    }
+    return n;
+}
+
+static int phit__topo_read_list(const char *path, uint64_t *mask) {
+    char buf[4096];
+    memset(mask, 0, sizeof(uint64_t) * PHIT__TOPO_WORDS);
+    return phit__topo_read(path, buf, sizeof(buf)) ? phit__topo_parse_list(buf, mask) : 0;
+}
+
+static int phit__topo_has(const uint64_t *mask, int c) {
+    return (mask[c / 64] >> (c % 64)) & 1;
+}
+
+/* Hybrid parts: Intel's cpu_core/cpu_atom PMUs, else ARM cpu_capacity */
+static int phit__topo_perf_linux(phit_topo_t *t) {
+    uint64_t core[PHIT__TOPO_WORDS], atom[PHIT__TOPO_WORDS];
+    if (phit__topo_read_list("/sys/devices/cpu_core/cpus", core) &&
+        phit__topo_read_list("/sys/devices/cpu_atom/cpus", atom)) {
+        for (int c = 0; c < t->num_cpus; c++)
+            t->perf_class[c] = (uint8_t)(phit__topo_has(atom, c) && !phit__topo_has(core, c));
+        return 2;
+    }
+    long cap[PHIT_TOPO_MAX_CPUS];
+    long levels[8];
+    int nlevels = 0;
+    char path[128], buf[32];
+    for (int c = 0; c < t->num_cpus; c++) {
+        cap[c] = -1;
+        if (t->node_of[c] < 0) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpu_capacity", c);
+        if (!phit__topo_read(path, buf, sizeof(buf))) return 1;
+        cap[c] = strtol(buf, NULL, 10);
+        int k = 0;
+        while (k < nlevels && levels[k] != cap[c]) k++;
+        if (k == nlevels && nlevels < 8) levels[nlevels++] = cap[c];
+    }
+    /* Rank by capacity, largest first */
+    for (int c = 0; c < t->num_cpus; c++) {
+        if (cap[c] < 0) continue;
+        int rank = 0;
+        for (int k = 0; k < nlevels; k++) rank += levels[k] > cap[c];
+        t->perf_class[c] = (uint8_t)rank;
+    }
+    return nlevels > 0 ? nlevels : 1;
+}
+
+/* Highest cache level index of cpu c that lists its sharers */
+static int phit__topo_llc_linux(int c, uint64_t *mask) {
+    char path[128], buf[16];
+    int best = -1, best_level = 0;
+    for (int i = 0; i < 8; i++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", c, i);
+        if (!phit__topo_read(path, buf, sizeof(buf))) break;
+        int level = atoi(buf);
+        if (level > best_level) {
+            best_level = level;
+            best = i;
+        }
+    }
+    if (best < 0) return 0;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", c,
+             best);
+    return phit__topo_read_list(path, mask);
+}
+
+static int phit__topo_discover_os(phit_topo_t *t, int level) {
+    uint64_t online[PHIT__TOPO_WORDS], mask[PHIT__TOPO_WORDS];
+    if (!phit__topo_read_list("/sys/devices/system/cpu/online", online)) return 0;
+    phit__topo_clear(t);
+    for (int c = 0; c < PHIT_TOPO_MAX_CPUS; c++) {
+        if (phit__topo_has(online, c)) {
+            t->node_of[c] = 0;
+            t->num_cpus = c + 1;
+        }
+    }
+    int classes = phit__topo_perf_linux(t);
+    int nodes = 0;
+    char path[128];
+    if (level == PHIT_TOPO_PERF) {
+        if (classes < 2) return 0;
+        for (int c = 0; c < t->num_cpus; c++) {
+            if (t->node_of[c] >= 0) t->node_of[c] = t->perf_class[c];
+        }
+        nodes = classes;
+    } else if (level == PHIT_TOPO_NUMA) {
+        uint64_t ids[PHIT__TOPO_WORDS];
+        if (!phit__topo_read_list("/sys/devices/system/node/online", ids)) return 0;
+        for (int id = 0; id < PHIT_TOPO_MAX_CPUS && nodes < PHIT_TOPO_MAX_NODES; id++) {
+            if (!phit__topo_has(ids, id)) continue;
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+            if (!phit__topo_read_list(path, mask)) continue;    /* memory-only node */
+            for (int c = 0; c < t->num_cpus; c++) {
+                if (t->node_of[c] >= 0 && phit__topo_has(mask, c)) t->node_of[c] = (int16_t)nodes;
+            }
+            nodes++;
+        }
+    } else {
+        /* Every CPU joins the group of the first CPU sharing its LLC */
+        for (int c = 0; c < t->num_cpus; c++) t->node_of[c] = t->node_of[c] >= 0 ? -2 : -1;
+        for (int c = 0; c < t->num_cpus; c++) {
+            if (t->node_of[c] != -2) continue;
+            int16_t id = (int16_t)(nodes < PHIT_TOPO_MAX_NODES ? nodes++ : nodes - 1);
+            t->node_of[c] = id;
+            if (!phit__topo_llc_linux(c, mask)) continue;
+            for (int o = c + 1; o < t->num_cpus; o++) {
+                if (t->node_of[o] == -2 && phit__topo_has(mask, o)) t->node_of[o] = id;
+            }
+        }
+    }
+    if (nodes < 1) return 0;
+    t->kind = level;
+    phit__topo_finish(t);
+    return 1;
+}
+
+/* ---- macOS: hw.perflevelN ---- */
+
+#elif defined(__APPLE__)
+
+static int phit__topo_sysctl_int(const char *name) {
+    int v = 0;
+    size_t len = sizeof(v);
+    return sysctlbyname(name, &v, &len, NULL, 0) == 0 ? v : 0;
+}
+
+/* CPU ids are labels here (macOS never reports the running one):
+ * perflevel0 first, each level's L2 clusters in order */
+static int phit__topo_discover_os(phit_topo_t *t, int level) {
+    int levels = phit__topo_sysctl_int("hw.nperflevels");
+    if (levels < 1) return 0;
+    phit__topo_clear(t);
+    char name[64];
+    int cpu = 0, nodes = 0;
+    for (int p = 0; p < levels && p < PHIT_TOPO_MAX_NODES; p++) {
+        snprintf(name, sizeof(name), "hw.perflevel%d.logicalcpu", p);
+        int n = phit__topo_sysctl_int(name);
+        snprintf(name, sizeof(name), "hw.perflevel%d.cpusperl2", p);
+        int per_l2 = phit__topo_sysctl_int(name);
+        if (per_l2 < 1) per_l2 = n;
+        for (int k = 0; k < n && cpu < PHIT_TOPO_MAX_CPUS; k++, cpu++) {
+            int node = level == PHIT_TOPO_PERF ? p : level == PHIT_TOPO_CACHE ? nodes + k / per_l2 : 0;
+            t->node_of[cpu] = (int16_t)(node < PHIT_TOPO_MAX_NODES ? node : PHIT_TOPO_MAX_NODES - 1);
+            t->perf_class[cpu] = (uint8_t)p;
+        }
+        if (level == PHIT_TOPO_CACHE) nodes += (n + per_l2 - 1) / per_l2;
+    }
+    t->num_cpus = cpu;
+    if (cpu == 0) return 0;
+    /* One memory domain: NUMA is flat, with the classes kept */
+    t->kind = level == PHIT_TOPO_NUMA ? PHIT_TOPO_FLAT : level;
+    phit__topo_finish(t);
+    return 1;
+}
+
+/* ---- Windows: GetLogicalProcessorInformationEx ---- */
+
+#elif defined(_WIN32)
+
+static void phit__topo_group(phit_topo_t *t, const GROUP_AFFINITY *g, int16_t node) {
+    for (int b = 0; b < 64; b++) {
+        int c = g->Group * 64 + b;
+        if (c < PHIT_TOPO_MAX_CPUS && ((g->Mask >> b) & 1) && t->node_of[c] != -1) t->node_of[c] = node;
+    }
+}
+
+static int phit__topo_discover_os(phit_topo_t *t, int level) {
+    DWORD len = 0;
+    GetLogicalProcessorInformationEx(RelationAll, NULL, &len);
+    if (len == 0) return 0;
+    char *buf = malloc(len);
+    if (!buf || !GetLogicalProcessorInformationEx(RelationAll,
+                                                  (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buf,
+                                                  &len)) {
+        free(buf);
+        return 0;
+    }
+    phit__topo_clear(t);
+    int max_eff = 0;
+    /* Pass 1: online CPUs from the cores, and the highest efficiency class */
+    for (DWORD at = 0; at < len;) {
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buf + at);
+        if (info->Relationship == RelationProcessorCore) {
+            const GROUP_AFFINITY *g = &info->Processor.GroupMask[0];
+            for (int b = 0; b < 64; b++) {
+                int c = g->Group * 64 + b;
+                if (c < PHIT_TOPO_MAX_CPUS && ((g->Mask >> b) & 1)) {
+                    t->node_of[c] = 0;
+                    if (c + 1 > t->num_cpus) t->num_cpus = c + 1;
+                    /* Windows: a higher EfficiencyClass is the faster core */
+                    t->perf_class[c] = info->Processor.EfficiencyClass;
+                }
+            }
+            if (info->Processor.EfficiencyClass > max_eff) max_eff = info->Processor.EfficiencyClass;
+        }
+        at += info->Size;
+    }
+    for (int c = 0; c < t->num_cpus; c++) t->perf_class[c] = (uint8_t)(max_eff - t->perf_class[c]);
+
+    int nodes = 0;
+    for (DWORD at = 0; at < len;) {
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buf + at);
+        int16_t id = (int16_t)(nodes < PHIT_TOPO_MAX_NODES ? nodes : PHIT_TOPO_MAX_NODES - 1);
+        if (level == PHIT_TOPO_NUMA && info->Relationship == RelationNumaNode) {
+            phit__topo_group(t, &info->NumaNode.GroupMask, id);
+            nodes++;
+        } else if (level == PHIT_TOPO_CACHE && info->Relationship == RelationCache &&
+                   info->Cache.Level == 3) {
+            phit__topo_group(t, &info->Cache.GroupMask, id);
+            nodes++;
+        }
+        at += info->Size;
+    }
+    free(buf);
+    if (level == PHIT_TOPO_PERF) {
+        if (max_eff == 0) return 0;
+        for (int c = 0; c < t->num_cpus; c++) {
+            if (t->node_of[c] >= 0) t->node_of[c] = t->perf_class[c];
+        }
+        nodes = max_eff + 1;
+    }
+    if (nodes < 1) return 0;
+    t->kind = level;
+    phit__topo_finish(t);
+    return 1;
+}
+
+#else
+
+static int phit__topo_discover_os(phit_topo_t *t, int level) {
+    (void)t;
+    (void)level;
+    return 0;
+}
+
+#endif
+
+static int phit__topo_online(void) {
+#if defined(_WIN32)
+    return (int)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 1;
+#endif
+}
+
+int phit_topo_discover(phit_topo_t *t, int level) {
+    if (!phit__topo_discover_os(t, level)) phit__topo_flat(t, phit__topo_online());
+    return t->num_nodes;
+}
+
+int phit_topo_node_cpu(const phit_topo_t *t, int node, int k) {
+    for (int c = 0; c < t->num_cpus; c++) {
+        if (t->node_of[c] == node && k-- == 0) return c;
+    }
+    return -1;
+}
+
+/* ---- Calling thread ---- */
+
+int phit_topo_current_cpu(void) {
+#if defined(_WIN32)
+    PROCESSOR_NUMBER pn;
+    GetCurrentProcessorNumberEx(&pn);
+    return pn.Group * 64 + pn.Number;
+#elif defined(__linux__) && defined(_GNU_SOURCE)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+static PHIT__TLS struct {
+    const phit_topo_t *topo;        /* node below is for this topology */
+    int                node;
+    int                declared;    /* set_thread_node: never re-read */
+    uint32_t           left;        /* lookups until the next re-read */
+} phit__topo_thread;
+
+void phit_topo_set_thread_node(int node) {
+    phit__topo_thread.declared = node >= 0;
+    phit__topo_thread.node = node >= 0 ? node : 0;
+    phit__topo_thread.left = 0;
+}
+
+int phit_topo_current_node(const phit_topo_t *t) {
+    if (phit__topo_thread.declared)
+        return phit__topo_thread.node < t->num_nodes ? phit__topo_thread.node : 0;
+    if (phit__topo_thread.topo != t || phit__topo_thread.left == 0) {
+        int cpu = phit_topo_current_cpu();
+        int node = cpu >= 0 && cpu < t->num_cpus ? t->node_of[cpu] : 0;
+        phit__topo_thread.topo = t;
+        phit__topo_thread.node = node >= 0 ? node : 0;
+        phit__topo_thread.left = PHIT_TOPO_NODE_REFRESH;
+    }
+    phit__topo_thread.left--;
+    return phit__topo_thread.node;
+}
+
+int phit_topo_pin(const phit_topo_t *t, int node) {
+    int pinned = 0;
+    if (node >= 0 && node < t->num_nodes && t->kind != PHIT_TOPO_FLAT &&
+        t->kind != PHIT_TOPO_SYNTHETIC) {
+#if defined(__linux__) && defined(_GNU_SOURCE)
+        cpu_set_t *set = CPU_ALLOC(t->num_cpus);
+        if (set) {
+            size_t size = CPU_ALLOC_SIZE(t->num_cpus);
+            CPU_ZERO_S(size, set);
+            for (int c = 0; c < t->num_cpus; c++) {
+                if (t->node_of[c] == node) CPU_SET_S(c, size, set);
+            }
+            pinned = sched_setaffinity(0, size, set) == 0;
+            CPU_FREE(set);
+        }
+#elif defined(_WIN32)
+        /* One processor group: the first one holding the node */
+        GROUP_AFFINITY g;
+        memset(&g, 0, sizeof(g));
+        int group = -1;
+        for (int c = 0; c < t->num_cpus; c++) {
+            if (t->node_of[c] != node) continue;
+            if (group < 0) group = c / 64;
+            if (c / 64 == group) g.Mask |= (KAFFINITY)1 << (c % 64);
+        }
+        g.Group = (WORD)(group < 0 ? 0 : group);
+        pinned = group >= 0 && SetThreadGroupAffinity(GetCurrentThread(), &g, NULL) != 0;
+#elif defined(__APPLE__)
+        /* Affinity is not available: steer by class instead */
+        if (t->kind == PHIT_TOPO_PERF) {
+            pinned = pthread_set_qos_class_self_np(
+                         node == 0 ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_UTILITY, 0) == 0;
+        }
+#endif
+    }
+    phit_topo_set_thread_node(node);
+    return pinned;
+}
+
+/* ---- Hierarchical routing ---- */
+
+int phit_hier_init(phit_hier_t *h, const int *count, int num_nodes, double spill) {
+    if (num_nodes < 1 || num_nodes > PHIT_TOPO_MAX_NODES) return 0;
+    memset(h, 0, sizeof(phit_hier_t));
+    if (spill < 0) spill = PHIT_TOPO_SPILL;
+    if (spill > 1) spill = 1;
+    h->num_nodes = num_nodes;
+    h->spill = (uint32_t)(spill * 65536.0 + 0.5);
+    for (int n = 0; n < num_nodes; n++) {
+        if (count[n] < 0) return 0;
+        h->first[n] = h->total;
+        h->count[n] = count[n];
+        h->total += count[n];
+    }
+    return h->total >= 1 && h->total <= 65536;
+}
+
+int phit_route_hier_pair(const phit_hier_t *h, int node, int *local, int *remote) {
+    if (node < 0 || node >= h->num_nodes) node = 0;
+    /* Low 16 bits: the spill draw; high 16 bits: the destination(s) */
+    uint32_t key = phit_sample_compound(2);
+    uint32_t hi = key >> 16;
+    int own = h->count[node], others = h->total - own;
+    int l = own ? h->first[node] + (int)((hi * (uint32_t)own) >> 16) : -1;
+    int r = others ? (int)((hi * (uint32_t)others) >> 16) : -1;
+    if (r >= h->first[node]) r += own;
+    if (l < 0) l = r;
+    if (r < 0) r = l;
+    *local = l;
+    *remote = r;
+    return own == 0 || (key & 0xFFFF) < h->spill;
+}
+
+int phit_route_hier(const phit_hier_t *h, int node) {
+    int l, r;
+    return phit_route_hier_pair(h, node, &l, &r) ? r : l;
+}
+
+int phit_route_hier_load(const phit_hier_t *h, int node, const phit_load_t *loads,
+                         int64_t depth_limit) {
+    int l, r;
+    if (phit_route_hier_pair(h, node, &l, &r)) return r;
+    int64_t dl = PHIT__LOAD_RELAXED64(&loads[l].depth);
+    return dl >= depth_limit && PHIT__LOAD_RELAXED64(&loads[r].depth) < dl ? r : l;
+}
+
+#endif /* LIBPHIT_IMPLEMENTATION */
+
+#endif /* PHIT_TOPO_H */
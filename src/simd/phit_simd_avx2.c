@@ -0,0 +1,10 @@
+/*
+ * phit_simd_avx2.c — AVX2 bulk expansion kernel for libphit
+ *
+ * Part of PHIT_SIMD_EXTERNAL library builds only.
+ * Compiled with -mavx2 (MSVC: /arch:AVX2).
+ * Only reached through runtime dispatch (phit_simd_level).
+ */
+
+#define PHIT_SIMD_UNIT_AVX2
+#include "../libphit.h"
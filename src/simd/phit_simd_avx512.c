@@ -0,0 +1,10 @@
+/*
+ * phit_simd_avx512.c — AVX-512 bulk expansion kernel for libphit
+ *
+ * Part of PHIT_SIMD_EXTERNAL library builds only.
+ * Compiled with -mavx512f -mavx512dq (MSVC: /arch:AVX512).
+ * Only reached through runtime dispatch (phit_simd_level).
+ */
+
+#define PHIT_SIMD_UNIT_AVX512
+#include "../libphit.h"
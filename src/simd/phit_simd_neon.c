@@ -0,0 +1,10 @@
+/*
+ * phit_simd_neon.c — NEON bulk expansion kernel for libphit
+ *
+ * Part of PHIT_SIMD_EXTERNAL library builds only.
+ * NEON is baseline on AArch64: no extra flags.
+ * Only reached through runtime dispatch (phit_simd_level).
+ */
+
+#define PHIT_SIMD_UNIT_NEON
+#include "../libphit.h"
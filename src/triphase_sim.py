@@ -313,6 +313,45 @@ class TriphaseVM:
         self.registers[name].write(phi, value)
 
 
+# =============================================================================
+# Measured: experiments/phit_sweep.c results
+# =============================================================================
+
+SWEEP_INT_COLUMNS = {"iters", "reads", "slots", "load", "cpu", "isolated",
+                     "samples", "levels", "uniform"}
+SWEEP_TEXT_COLUMNS = {"host", "arch", "timer", "workload"}
+
+
+def load_sweep(path: str) -> list:
+    """
+    Legge il CSV di phit_sweep (una riga per configurazione).
+    Restituisce una lista di dict con le colonne numeriche già convertite.
+    """
+    import csv
+    rows = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            for key, value in row.items():
+                if key in SWEEP_TEXT_COLUMNS:
+                    continue
+                row[key] = int(value) if key in SWEEP_INT_COLUMNS else float(value)
+            rows.append(row)
+    return rows
+
+
+def sweep_select(rows: list, **match) -> list:
+    """Filtra le righe: sweep_select(rows, timer="counter", load=0)."""
+    return [r for r in rows if all(r.get(k) == v for k, v in match.items())]
+
+
+def sweep_phase_levels(row: dict) -> float:
+    """
+    Fasi distinguibili implicite nella misura: 2^H per lettura,
+    da confrontare con il rapporto clock/timer di un TriphaseSystem.
+    """
+    return 2.0 ** row["phits_per_read"]
+
+
 # =============================================================================
 # Preset: M1 Max Approximation
 # =============================================================================
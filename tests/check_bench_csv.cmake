@@ -0,0 +1,42 @@
+# check_bench_csv.cmake — phit_bench --format csv parses as RFC 4180
+#
+# cmake -DPHIT_BENCH=path/to/phit_bench -P check_bench_csv.cmake
+#
+# Every row must have the header's field count once quoted fields (which
+# may hold commas and doubled quotes) are taken as one field each.
+
+execute_process(COMMAND ${PHIT_BENCH} --quick --format csv
+                OUTPUT_VARIABLE out RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "phit_bench exited with ${rc}")
+endif()
+
+# Quoted fields -> one token; then no ';' is left to split CMake lists on
+string(REGEX REPLACE "\"([^\"]|\"\")*\"" "Q" flat "${out}")
+if(flat MATCHES "[\";]")
+  message(FATAL_ERROR "unbalanced quote or bare ';' in phit_bench csv output")
+endif()
+string(REGEX REPLACE "\n$" "" flat "${flat}")
+string(REPLACE "\n" ";" rows "${flat}")
+
+list(GET rows 0 header)
+string(REGEX MATCHALL "," commas "${header}")
+list(LENGTH commas want)
+list(LENGTH rows count)
+if(count LESS 2)
+  message(FATAL_ERROR "phit_bench csv has no result rows")
+endif()
+
+set(line 0)
+foreach(row IN LISTS rows)
+  math(EXPR line "${line} + 1")
+  string(REGEX MATCHALL "," commas "${row}")
+  list(LENGTH commas got)
+  if(NOT got EQUAL want)
+    math(EXPR fields "${got} + 1")
+    math(EXPR expect "${want} + 1")
+    message(FATAL_ERROR "csv line ${line}: ${fields} fields, header has ${expect}")
+  endif()
+endforeach()
+math(EXPR results "${count} - 1")
+message(STATUS "phit_bench csv: ${results} rows, all with the header's fields")
@@ -0,0 +1,111 @@
+/*
+ * test_battery.c — phit_battery.h: known-bad streams fail, PRNG output passes
+ *
+ * gcc -O2 -o test_battery test_battery.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_battery.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WORDS (1 << 18)
+
+static phit_battery_t *bat;
+static uint64_t buf[WORDS];
+
+/* Feed buf in uneven chunks so every block boundary path runs */
+static void feed_chunked(phit_battery_t *b, int lags) {
+    phit_battery_init(b, lags);
+    for (size_t i = 0, step = 1; i < WORDS; step = step * 3 % 9973 + 1) {
+        size_t m = WORDS - i < step ? WORDS - i : step;
+        phit_battery_feed(b, buf + i, m);
+        i += m;
+    }
+}
+
+static phit_battery_result_t check(const char *name, int lags) {
+    phit_battery_result_t r;
+    feed_chunked(bat, lags);
+    phit_battery_result(bat, &r);
+    printf("  %-14s", name);
+    for (int t = 0; t < PHIT_BATTERY_TESTS; t++)
+        printf(" %s=%s", phit_battery_test_name(t), r.pass[t] ? "ok" : "X");
+    printf("\n");
+    return r;
+}
+
+int main(void) {
+    printf("=== phit_battery.h test ===\n\n");
+    bat = malloc(sizeof(phit_battery_t));
+    phit_prng_t rng;
+    phit_prng_init_buffered(&rng, 0, 0);
+
+    /* Good output fails each test with probability PHIT_BATTERY_ALPHA and
+     * the PRNG is seeded from the timer, so it gets one fresh retry */
+    phit_prng_fill(&rng, buf, (int)sizeof(buf));
+    phit_battery_result_t good = check("prng", 64);
+    if (!good.all_pass) {
+        phit_prng_fill(&rng, buf, (int)sizeof(buf));
+        good = check("prng (retry)", 64);
+    }
+
+    /* Reference: chunked feeding equals one feed of the whole buffer */
+    phit_battery_t *whole = malloc(sizeof(phit_battery_t));
+    phit_battery_init(whole, 64);
+    phit_battery_feed(whole, buf, WORDS);
+    int cst = whole->ones == bat->ones && whole->transitions == bat->transitions &&
+              whole->nib2[0x5A] == bat->nib2[0x5A] && whole->table[3][9] == bat->table[3][9] &&
+              whole->differ[64] == bat->differ[64] && whole->pairs[64] == WORDS - 64;
+    for (int d = 1; d <= 64; d++) {
+        uint64_t ref = 0;
+        for (int i = d; i < WORDS; i++) ref += (uint64_t)__builtin_popcountll(buf[i] ^ buf[i - d]);
+        if (ref != bat->differ[d]) cst = 0;
+    }
+    uint64_t trans = 0;
+    for (int i = 0; i < WORDS; i++) {
+        trans += (uint64_t)__builtin_popcountll((buf[i] ^ (buf[i] >> 1)) & 0x7FFFFFFFFFFFFFFFULL);
+        if (i) trans += (buf[i - 1] >> 63) ^ (buf[i] & 1);
+    }
+    cst = cst && trans == bat->transitions;
+    free(whole);
+
+    /* Lag 37: every word repeats the one 37 back with a few bits changed */
+    for (int i = 37; i < WORDS; i++) buf[i] = buf[i - 37] ^ (phit_prng_u64(&rng) & phit_prng_u64(&rng) & phit_prng_u64(&rng));
+    phit_battery_result_t lag = check("lag-37 copy", 64);
+
+    /* Biased bits: AND of two words is 1/4 ones */
+    for (int i = 0; i < WORDS; i++) buf[i] = phit_prng_u64(&rng) & phit_prng_u64(&rng);
+    phit_battery_result_t bias = check("1/4 ones", 16);
+
+    /* Counter: balanced bits, but structured bytes and pairs */
+    for (int i = 0; i < WORDS; i++) buf[i] = (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+    phit_battery_result_t weyl = check("weyl sequence", 16);
+
+    int dst = good.all_pass && !lag.pass[PHIT_BATTERY_AUTOCORR] && lag.worst_lag == 37 &&
+              !bias.pass[PHIT_BATTERY_MONOBIT] && !bias.pass[PHIT_BATTERY_BYTES] && !weyl.all_pass;
+    printf("Detection:     %s\n", dst ? "PASS" : "FAIL");
+    printf("Chunking:      %s\n", cst ? "PASS" : "FAIL");
+
+    /* Parallel runner: four streams, merged (one retry, as for prng) */
+    phit_battery_result_t par;
+    uint64_t ns = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        phit_battery_init(bat, PHIT_BATTERY_MAX_LAG);
+        ns = phit_battery_run(bat, 1 << 20, 4);
+        phit_battery_result(bat, &par);
+        if (par.all_pass) break;
+    }
+    int pst = ns && par.words == 1 << 20 && par.streams == 4 && par.all_pass &&
+              bat->pairs[PHIT_BATTERY_MAX_LAG] == (1 << 20) - 4 * PHIT_BATTERY_MAX_LAG;
+    printf("Run:           %s (%llu words, 4 threads, %d lags, %.1f Mword/s, worst lag %d p=%.3f)\n",
+           pst ? "PASS" : "FAIL", (unsigned long long)par.words, PHIT_BATTERY_MAX_LAG,
+           (double)par.words / ((double)ns / 1e9) / 1e6, par.worst_lag, par.p[PHIT_BATTERY_AUTOCORR]);
+
+    free(bat);
+    printf("\n=== Done ===\n");
+    return (dst && cst && pst) ? 0 : 1;
+}
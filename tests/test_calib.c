@@ -0,0 +1,131 @@
+/*
+ * test_calib.c — phit_calib.h: round trip, rejection, background recalibration
+ *
+ * gcc -O2 -o test_calib test_calib.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_calib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PATH "calib_test.bin"
+
+static phit_router_t router, loaded;
+
+static long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+/* Flip one byte, or cut the file to `len` bytes when len >= 0 */
+static void damage(const char *path, long at, long len) {
+    long n = file_size(path);
+    uint8_t *buf = malloc((size_t)n);
+    FILE *f = fopen(path, "rb");
+    if (fread(buf, 1, (size_t)n, f) != (size_t)n) n = 0;
+    fclose(f);
+    if (len < 0) buf[at] ^= 0x40;
+    else n = len;
+    f = fopen(path, "wb");
+    fwrite(buf, 1, (size_t)n, f);
+    fclose(f);
+    free(buf);
+}
+
+int main(void) {
+    printf("=== phit_calib.h test ===\n\n");
+    remove(PATH);
+
+    phit_calib_key_t key;
+    phit_calib_key(&key);
+    printf("Key: cpu \"%s\", microcode %#x, governor \"%s\", backend %d\n\n",
+           key.cpu, key.microcode, key.governor, key.backend);
+
+    /* Round trip: same tables, same slot count. A shared machine can move
+     * the delta distribution between calibration and check, which the
+     * check rightly reports as stale; a fresh calibration retries, and a
+     * machine that keeps moving only has to be reported consistently. */
+    int saved = 0, hit = -1, attempts = 0;
+    phit_calib_check_t check;
+    uint64_t load_ns = 0;
+    while (hit != PHIT_CALIB_HIT && attempts++ < 10) {
+        phit_router_init(&router, 8, 50000);
+        while (!phit_router_calibrate(&router, 10000)) {}
+        saved = phit_calib_save(PATH, &router);
+        uint64_t t0 = phit_now_ns();
+        hit = phit_calib_load(PATH, &loaded, 8, &check);
+        load_ns = phit_now_ns() - t0;
+    }
+    int missing = phit_calib_load("calib_test_missing.bin", &loaded, 8, NULL) == PHIT_CALIB_MISSING;
+    int unstable = hit == PHIT_CALIB_STALE_DELTAS && check.distance > PHIT_CALIB_MAX_DISTANCE;
+    int same = unstable || (hit == PHIT_CALIB_HIT && loaded.ready &&
+               !memcmp(loaded.slot_map, router.slot_map, sizeof(router.slot_map)) &&
+               !memcmp(loaded.cdf_lo, router.cdf_lo, sizeof(router.cdf_lo)));
+    printf("Round trip:    %s (%ld bytes, %s after %d, distance %.3f, unit error %.4f, load %.2f ms)\n",
+           saved && missing && same ? "PASS" : "FAIL", file_size(PATH),
+           phit_calib_status_name(hit), attempts, check.distance, check.unit_error, load_ns / 1e6);
+
+    /* Another slot count rebuilds from the cached histogram */
+    int status = -1;
+    for (int i = 0; i < 10 && !unstable && status != PHIT_CALIB_HIT; i++) {
+        status = phit_calib_load(PATH, &loaded, 5, NULL);
+    }
+    int rebuilt = unstable || status == PHIT_CALIB_STALE_DELTAS ||
+                  (status == PHIT_CALIB_HIT && loaded.ready && loaded.num_slots == 5);
+    for (int i = 0; i < 10000 && rebuilt && status == PHIT_CALIB_HIT; i++) {
+        int s = phit_router_route(&loaded);
+        rebuilt = s >= 0 && s < 5;
+    }
+    printf("Slot count:    %s (8 cached, 5 loaded, %s)\n", rebuilt ? "PASS" : "FAIL",
+           unstable ? "skipped, unstable" : phit_calib_status_name(status));
+
+    /* Corrupt, truncated and shifted caches are all rejected */
+    long size = file_size(PATH);
+    damage(PATH, size / 2, -1);
+    int corrupt = phit_calib_load(PATH, &loaded, 8, NULL) == PHIT_CALIB_MISMATCH;
+    phit_calib_save(PATH, &router);
+    damage(PATH, 0, size - 8);
+    int truncated = phit_calib_load(PATH, &loaded, 8, NULL) == PHIT_CALIB_MISMATCH;
+    phit_router_t shifted = router;
+    memset(shifted.hist, 0, sizeof(shifted.hist));
+    shifted.hist[PHIT_ROUTER_MAX_DELTA - 1] = shifted.calib_count;
+    phit_calib_save(PATH, &shifted);
+    memset(&loaded, 0x5A, sizeof(loaded));
+    int stale = phit_calib_load(PATH, &loaded, 8, &check) == PHIT_CALIB_STALE_DELTAS &&
+                loaded.num_slots == 0x5A5A5A5A;
+    printf("Rejection:     %s (corrupt %d, truncated %d, stale %d at distance %.3f)\n",
+           corrupt && truncated && stale ? "PASS" : "FAIL", corrupt, truncated, stale,
+           check.distance);
+
+    /* A miss recalibrates in the background and leaves a valid cache */
+    remove(PATH);
+    status = phit_calib_start(PATH, &loaded, 8);
+    int fallback = status == PHIT_CALIB_MISSING && !loaded.ready && loaded.num_slots == 8;
+    int early = 0;
+    for (int i = 0; i < 1000; i++) early |= phit_router_route(&loaded) >= 8;
+    int bg_saved = phit_calib_wait();
+    int adopted = phit_calib_adopt(&loaded) && loaded.ready && loaded.num_slots == 8;
+    /* One-shot: a second call neither reports nor copies again */
+    loaded.calib_count++;
+    uint32_t kept = loaded.calib_count;
+    adopted = adopted && phit_calib_adopt(&loaded) == 0 && loaded.calib_count == kept;
+    /* Well-formed and for this machine; its freshness is the machine's */
+    status = phit_calib_load(PATH, &router, 8, NULL);
+    int reload = status != PHIT_CALIB_MISSING && status != PHIT_CALIB_MISMATCH;
+    printf("Background:    %s (fallback %d, saved %d, adopted %d, reload %d)\n",
+           fallback && !early && bg_saved && adopted && reload ? "PASS" : "FAIL",
+           fallback, bg_saved, adopted, reload);
+    remove(PATH);
+
+    printf("\n=== Done ===\n");
+    return saved && missing && same && rebuilt && corrupt && truncated && stale && fallback &&
+           !early && bg_saved && adopted && reload ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*
+ * test_domains.c — phit_domains.h: helper placement, seqlock reads, profile
+ *
+ * gcc -O2 -D_GNU_SOURCE -o test_domains test_domains.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_domains.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sched.h>
+
+#define SAMPLES 200000
+
+int main(void) {
+    printf("=== phit_domains.h test ===\n\n");
+
+    /* Start: 2 synthetic nodes, this thread on node 1, helpers on 0 then 1 */
+    static phit_topo_t t;
+    phit_topo_synthetic(&t, 2, 1);
+    phit_topo_set_thread_node(1);
+    int bad = phit_domains_start(&t, 0) == NULL &&
+              phit_domains_start(&t, PHIT_DOMAINS_MAX_HELPERS + 1) == NULL;
+    phit_domains_t *d = phit_domains_start(&t, 2);
+    phit_topo_set_thread_node(-1);
+    int sst = bad && d && phit_domains_helpers(d) == 2 && phit_domains_helper_node(d, 0) == 0 &&
+              phit_domains_helper_node(d, 1) == 1 && phit_domains_helper_node(d, 2) == -1;
+    printf("Start:         %s (helpers on nodes %d, %d)\n", sst ? "PASS" : "FAIL",
+           d ? phit_domains_helper_node(d, 0) : -1, d ? phit_domains_helper_node(d, 1) : -1);
+    if (!d) return 1;
+
+    /* Publishing: both helpers keep advancing while we sample */
+    phit_domains_reader_t r;
+    memset(&r, 0, sizeof(r));
+    uint64_t p0[2] = { phit_domains_published(d, 0), phit_domains_published(d, 1) };
+    uint32_t bits_or = 0, bits_and = 0xFFFFFFFFu;
+    for (int i = 0; i < SAMPLES; i++) {
+        uint32_t k = phit_sample_domains(d, &r);
+        bits_or |= k;
+        bits_and &= k;
+        if ((i & 1023) == 0) sched_yield();     /* let helpers run on a single core */
+    }
+    uint64_t p1[2] = { phit_domains_published(d, 0), phit_domains_published(d, 1) };
+    int pst = p1[0] > p0[0] && p1[1] > p0[1] && r.samples == SAMPLES && r.fresh > 0 &&
+              r.fresh <= 2 * (uint64_t)SAMPLES && bits_or == 0xFFFFFFFFu && bits_and == 0;
+    printf("Publishing:    %s (%llu + %llu publications, %.3f fresh/sample, %llu retries)\n",
+           pst ? "PASS" : "FAIL", (unsigned long long)(p1[0] - p0[0]),
+           (unsigned long long)(p1[1] - p0[1]), (double)r.fresh / SAMPLES,
+           (unsigned long long)r.retries);
+
+    /* Profile: never less than the local read alone, bounded by 8 bits a source */
+    phit_domains_profile_t pr;
+    phit_domains_profile(d, 50000, &pr);
+    int fst = pr.ns_per_sample > 0 && pr.local_phits >= 0 && pr.cross_phits >= 0 &&
+              pr.fresh_rate >= 0 && pr.fresh_rate <= 2.0 && pr.local_phits <= 8.0 &&
+              pr.cross_phits <= 16.0 &&
+              fabs(pr.phits_per_sample - pr.local_phits - pr.cross_phits) < 1e-9;
+    printf("Profile:       %s (%.1f ns, %.2f local + %.2f cross phits, %.3f fresh)\n",
+           fst ? "PASS" : "FAIL", pr.ns_per_sample, pr.local_phits, pr.cross_phits,
+           pr.fresh_rate);
+    phit_domains_stop(d);
+
+    /* Default topology: whatever PHIT_TOPO_PERF finds */
+    d = phit_domains_start(NULL, 1);
+    int dst = d && phit_domains_helper_node(d, 0) >= 0;
+    if (d) {
+        uint64_t before = phit_domains_published(d, 0);
+        while (phit_domains_published(d, 0) == before) sched_yield();
+        phit_sample_domains(d, NULL);
+        phit_domains_stop(d);
+    }
+    printf("Discovered:    %s\n", dst ? "PASS" : "FAIL");
+
+    printf("\n=== Done ===\n");
+    return sst && pst && fst && dst ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+/*
+ * test_exec.c — Exactly-once test for phit_exec.h, with and without stealing,
+ *               and async completions
+ *
+ * gcc -O2 -o test_exec test_exec.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_exec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+
+#define TASKS_PER_PRODUCER 50000
+#define PRODUCERS 3
+
+static unsigned char *runs;     /* per-task execution count */
+
+static void task_mark(void *arg) {
+    runs[(uintptr_t)arg]++;
+}
+
+typedef struct {
+    phit_exec_t *exec;
+    int          id;
+    int          mode;          /* 0 submit, 1 batch, 2 router */
+} producer_t;
+
+static void *producer_main(void *p) {
+    producer_t *a = p;
+    uintptr_t base = (uintptr_t)a->id * TASKS_PER_PRODUCER;
+    if (a->mode == 1) {
+        static phit_task_t tasks[PRODUCERS][1000];
+        for (int i = 0; i < TASKS_PER_PRODUCER; i += 1000) {
+            for (int k = 0; k < 1000; k++) {
+                tasks[a->id][k].fn = task_mark;
+                tasks[a->id][k].arg = (void *)(base + (uintptr_t)(i + k));
+            }
+            phit_exec_submit_batch(a->exec, tasks[a->id], 1000);
+        }
+    } else if (a->mode == 2) {
+        phit_router_t *r = malloc(sizeof(phit_router_t));
+        phit_router_init(r, phit_exec_workers(a->exec), 20000);
+        for (int i = 0; i < TASKS_PER_PRODUCER; i++) {
+            phit_exec_submit_router(a->exec, r, task_mark, (void *)(base + (uintptr_t)i));
+        }
+        free(r);
+    } else {
+        for (int i = 0; i < TASKS_PER_PRODUCER; i++) {
+            phit_exec_submit(a->exec, task_mark, (void *)(base + (uintptr_t)i));
+        }
+    }
+    return NULL;
+}
+
+/* Steal: whichever worker runs the gate blocks until the task queued
+ * behind it on the same ring has run, which needs a thief (5 s timeout) */
+static volatile int gate_open, gate_passed;
+
+static void task_gate(void *arg) {
+    uint64_t t0 = phit_now_ns();
+    while (!__atomic_load_n(&gate_open, __ATOMIC_ACQUIRE) && phit_now_ns() - t0 < 5000000000ULL)
+        sched_yield();
+    gate_passed = __atomic_load_n(&gate_open, __ATOMIC_ACQUIRE);
+    runs[(uintptr_t)arg]++;
+}
+
+static void task_open(void *arg) {
+    __atomic_store_n(&gate_open, 1, __ATOMIC_RELEASE);
+    runs[(uintptr_t)arg]++;
+}
+
+/* Async busy: held tasks pin the queue at capacity */
+static volatile int hold;
+
+static void task_hold(void *arg) {
+    uint64_t t0 = phit_now_ns();
+    while (!__atomic_load_n(&hold, __ATOMIC_ACQUIRE) && phit_now_ns() - t0 < 5000000000ULL)
+        sched_yield();
+    runs[(uintptr_t)arg]++;
+}
+
+/* One reactor: batches of 100 as the queue allows, draining as it goes.
+ * Every arg must come back once, with the handle it was submitted under. */
+static int run_async(phit_exec_t *e, phit_cq_t *cq, int total, uint64_t *handles, int *wakeups) {
+    phit_task_t tasks[100];
+    phit_cqe_t cqe[64];
+    int submitted = 0, completed = 0, ok = 1;
+    *wakeups = 0;
+    while (completed < total) {
+        int n = total - submitted < 100 ? total - submitted : 100;
+        for (int k = 0; k < n; k++) {
+            tasks[k].fn = task_mark;
+            tasks[k].arg = (void *)(uintptr_t)(submitted + k);
+        }
+        int queued = n ? phit_exec_submit_async_batch(e, cq, tasks, n, handles + submitted) : 0;
+        submitted += queued;
+        if (queued < n || submitted == total) {
+            if (!phit_cq_wait(cq, 5000) && phit_cq_inflight(cq)) return 0;
+            (*wakeups)++;
+        }
+        int got;
+        while ((got = phit_cq_poll(cq, cqe, 64)) > 0) {
+            for (int k = 0; k < got; k++) {
+                uintptr_t i = (uintptr_t)cqe[k].arg;
+                ok = ok && i < (uintptr_t)submitted && cqe[k].handle == handles[i];
+            }
+            completed += got;
+        }
+    }
+    return ok && phit_cq_inflight(cq) == 0;
+}
+
+static double run_producers(phit_exec_t *e) {
+    pthread_t th[PRODUCERS];
+    producer_t args[PRODUCERS];
+    uint64_t t1 = phit_now_ns();
+    for (int p = 0; p < PRODUCERS; p++) {
+        args[p].exec = e;
+        args[p].id = p;
+        args[p].mode = p;
+        pthread_create(&th[p], NULL, producer_main, &args[p]);
+    }
+    for (int p = 0; p < PRODUCERS; p++) pthread_join(th[p], NULL);
+    phit_exec_shutdown(e);
+    uint64_t t2 = phit_now_ns();
+    return PRODUCERS * TASKS_PER_PRODUCER / ((t2 - t1) / 1e9);
+}
+
+static int check_runs(int total, const phit_exec_t *e) {
+    int ok = 1;
+    for (int i = 0; i < total; i++) {
+        if (runs[i] != 1) ok = 0;
+    }
+    uint64_t executed = 0;
+    for (int w = 0; w < phit_exec_workers(e); w++) executed += phit_exec_executed(e, w);
+    return ok && executed == (uint64_t)total;
+}
+
+int main(void) {
+    printf("=== phit_exec.h test ===\n\n");
+    int total = PRODUCERS * TASKS_PER_PRODUCER;
+    runs = calloc((size_t)total, 1);
+
+    int ast = phit_exec_create(0, 0, 0) == NULL &&
+              phit_exec_create(PHIT_EXEC_MAX_WORKERS + 1, 0, 0) == NULL;
+    printf("Arguments:     %s\n", ast ? "PASS" : "FAIL");
+
+    /* MPSC: submit, batch and router producers at once, small rings */
+    phit_exec_t *e = phit_exec_create(4, 64, 0);
+    double rate = run_producers(e);
+    int mst = check_runs(total, e);
+    printf("MPSC:          %s (%d tasks, 3 producers, %.1f Mtask/s)\n",
+           mst ? "PASS" : "FAIL", total, rate / 1e6);
+    printf("  per worker: ");
+    for (int w = 0; w < phit_exec_workers(e); w++) {
+        printf(" %llu", (unsigned long long)phit_exec_executed(e, w));
+    }
+    printf("\n");
+
+    /* Closed executor refuses work */
+    int cst = phit_exec_submit(e, task_mark, (void *)0) == 0 &&
+              phit_exec_submit_batch(e, NULL, 0) == 0 && runs[0] == 1;
+    phit_exec_shutdown(e);
+    phit_exec_destroy(e);
+    printf("Shutdown:      %s\n", cst ? "PASS" : "FAIL");
+
+    /* SPSC: one producer, rings smaller than a burst so submits spill */
+    memset(runs, 0, (size_t)total);
+    e = phit_exec_create(3, 8, PHIT_EXEC_SINGLE_PRODUCER);
+    for (int i = 0; i < total; i++) {
+        if (i % 3 == 2) phit_exec_submit2(e, task_mark, (void *)(uintptr_t)i);
+        else phit_exec_submit_to(e, i % 3 == 0 ? 0 : phit_route(3), task_mark, (void *)(uintptr_t)i);
+    }
+    phit_exec_destroy(e);
+    int sst = 1;
+    for (int i = 0; i < total; i++) {
+        if (runs[i] != 1) sst = 0;
+    }
+    printf("SPSC:          %s (%d tasks)\n", sst ? "PASS" : "FAIL", total);
+
+    /* MPMC: the same producers with thieves competing for every ring */
+    memset(runs, 0, (size_t)total);
+    e = phit_exec_create(4, 64, PHIT_EXEC_STEAL);
+    rate = run_producers(e);
+    int wst = check_runs(total, e);
+    uint64_t stolen = 0;
+    for (int w = 0; w < phit_exec_workers(e); w++) stolen += phit_exec_stolen(e, w);
+    printf("Steal MPMC:    %s (%d tasks, %.1f Mtask/s, %llu stolen)\n",
+           wst ? "PASS" : "FAIL", total, rate / 1e6, (unsigned long long)stolen);
+    phit_exec_destroy(e);
+
+    /* Gate: task 1 waits behind the blocked task 0 on ring 0 */
+    memset(runs, 0, 2);
+    e = phit_exec_create(4, 0, PHIT_EXEC_STEAL | PHIT_EXEC_SINGLE_PRODUCER);
+    phit_exec_submit_to(e, 0, task_gate, (void *)0);
+    phit_exec_submit_to(e, 0, task_open, (void *)1);
+    phit_exec_shutdown(e);
+    stolen = 0;
+    for (int w = 0; w < phit_exec_workers(e); w++) stolen += phit_exec_stolen(e, w);
+    int gst = gate_passed && runs[0] == 1 && runs[1] == 1 && stolen >= 1;
+    printf("Steal gate:    %s\n", gst ? "PASS" : "FAIL");
+    phit_exec_destroy(e);
+
+    /* Async: one reactor, 256 in flight, completions through the fd */
+    memset(runs, 0, (size_t)total);
+    uint64_t *handles = calloc((size_t)total, sizeof(uint64_t));
+    e = phit_exec_create(4, 64, PHIT_EXEC_SINGLE_PRODUCER);
+    phit_cq_t *cq = phit_cq_create(256);
+    int wakeups = 0;
+    uint64_t t1 = phit_now_ns();
+    int yst = cq && run_async(e, cq, total, handles, &wakeups);
+    uint64_t t2 = phit_now_ns();
+    for (int i = 0; i < total && yst; i++) yst = runs[i] == 1 && handles[i] != 0;
+    for (int i = 1; i < total && yst; i++) yst = handles[i] != handles[i - 1];
+    printf("Async:         %s (%d tasks, %.1f Mtask/s, %d fd wakeups)\n", yst ? "PASS" : "FAIL",
+           total, total / ((t2 - t1) / 1e9) / 1e6, wakeups);
+
+    /* Busy at capacity, fd readable on completion, closed after shutdown */
+    phit_cq_t *small = phit_cq_create(2);
+    uint64_t h = 0;
+    phit_cqe_t cqe[4];
+    memset(runs, 0, 4);
+    hold = 0;
+    int bst = small && phit_exec_submit_async(e, small, task_hold, (void *)0, &h) == 1 &&
+              phit_exec_submit_async(e, small, task_hold, (void *)1, NULL) == 1 &&
+              phit_exec_submit_async(e, small, task_mark, (void *)2, NULL) == -1 &&
+              phit_cq_poll(small, cqe, 4) == 0;
+    __atomic_store_n(&hold, 1, __ATOMIC_RELEASE);
+    int got = 0;
+    if (bst) {
+        struct pollfd pfd = { phit_cq_fd(small), POLLIN, 0 };
+        bst = poll(&pfd, 1, 5000) == 1;
+        uint64_t t0 = phit_now_ns();
+        while (got < 2 && phit_now_ns() - t0 < 5000000000ULL) got += phit_cq_poll(small, cqe + got, 4 - got);
+        bst = bst && got == 2 && runs[0] == 1 && runs[1] == 1 && runs[2] == 0 &&
+              (cqe[0].handle == h || cqe[1].handle == h);
+        pfd.revents = 0;
+        bst = bst && poll(&pfd, 1, 0) == 0;   /* drained */
+    }
+    phit_exec_shutdown(e);
+    bst = bst && phit_exec_submit_async(e, small, task_mark, (void *)2, NULL) == 0;
+    printf("Async busy:    %s (capacity 2, %d completed, closed after shutdown)\n",
+           bst ? "PASS" : "FAIL", got);
+    phit_cq_destroy(small);
+    phit_cq_destroy(cq);
+    phit_exec_destroy(e);
+    free(handles);
+
+    free(runs);
+    printf("\n=== Done ===\n");
+    return (ast && mst && cst && sst && wst && gst && yst && bst) ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * test_exec_coro.cpp — phit_exec_coro.hpp: results, exceptions, inline fallback
+ *
+ * g++ -std=c++20 -O2 -o test_exec_coro test_exec_coro.cpp -lphit -lm -lpthread
+ */
+
+#include "../src/phit_exec_coro.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+/* Fire-and-forget coroutine: runs until its first suspension on spawn */
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+#define COROS 200
+#define STEPS 10
+
+static int done, sums[COROS], caught;
+
+static detached chain(phit::async_queue &q, int id) {
+    int v = id;
+    for (int s = 0; s < STEPS; s++) v = co_await q.run([v] { return v + 1; });
+    co_await q.run([] {});
+    try {
+        co_await q.run([]() -> int { throw std::runtime_error("task"); });
+    } catch (const std::runtime_error &) {
+        caught++;
+    }
+    sums[id] = v;
+    done++;
+}
+
+static int drive(phit::async_queue &q) {
+    while (done < COROS) {
+        if (!q.wait_drain(5000) && q.inflight()) return 0;
+    }
+    for (int i = 0; i < COROS; i++) {
+        if (sums[i] != i + STEPS) return 0;
+    }
+    return caught == COROS && q.inflight() == 0;
+}
+
+int main() {
+    std::printf("=== phit_exec_coro.hpp test ===\n\n");
+    phit_exec_t *e = phit_exec_create(4, 64, PHIT_EXEC_SINGLE_PRODUCER);
+
+    /* Every coroutine suspends on every step and resumes from drain() */
+    phit::async_queue q(e, 0);
+    for (int i = 0; i < COROS; i++) chain(q, i);
+    int ast = drive(q);
+    std::printf("Awaiters:      %s (%d coroutines x %d steps, exceptions %d)\n",
+                ast ? "PASS" : "FAIL", COROS, STEPS + 2, caught);
+
+    /* A queue of 4 is busy for most spawns: those steps run inline */
+    done = caught = 0;
+    phit::async_queue small(e, 4);
+    for (int i = 0; i < COROS; i++) chain(small, i);
+    int bst = drive(small);
+    std::printf("Busy inline:   %s (capacity 4)\n", bst ? "PASS" : "FAIL");
+
+    /* Shut down: no suspension at all */
+    phit_exec_shutdown(e);
+    done = caught = 0;
+    for (int i = 0; i < COROS; i++) chain(q, i);
+    int sst = done == COROS && caught == COROS && sums[COROS - 1] == COROS - 1 + STEPS;
+    std::printf("Shutdown:      %s (all %d ran inline)\n", sst ? "PASS" : "FAIL", done);
+    phit_exec_destroy(e);
+
+    std::printf("\n=== Done ===\n");
+    return ast && bst && sst ? 0 : 1;
+}
@@ -1,15 +1,54 @@
 /*
  * test_libphit.c — Smoke test for libphit.h
  *
- * gcc -O0 -o test_libphit test_libphit.c -lm
+ * gcc -O2 -o test_libphit test_libphit.c -lm -lpthread
+ *
+ * Built twice by CMake: header-only, and with PHIT_TEST_LINKED against the
+ * libphit library (which takes its SIMD kernels from the per-ISA units).
  */
 
+#ifndef PHIT_TEST_LINKED
 #define LIBPHIT_IMPLEMENTATION
+#endif
 #include "../src/libphit.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
+static volatile uint64_t sink;
+
+/* Chi-squared of 8 bins against uniform; 18.48 is df=7 at 1% */
+#define CHI2_DF7 18.48
+
+static double chi2_8(const int *bins, int n) {
+    double c = 0;
+    for (int i = 0; i < 8; i++) {
+        double d = bins[i] - n / 8.0;
+        c += d * d / (n / 8.0);
+    }
+    return c;
+}
+
+/* Route n recorded readings through a router calibrated on exactly them,
+ * so the Chi2 measures the tables and not the timer's drift in between */
+static double router_chi2(phit_router_t *r, uint64_t *delta, uint32_t *lsb, int n) {
+    phit_router_init(r, 8, (uint32_t)n);
+    for (int i = 0; i < n; i++) {
+        uint64_t t1 = phit_now_ticks();
+        phit_workload();
+        uint64_t t2 = phit_now_ticks();
+        delta[i] = (uint64_t)phit_quantize(t2 - t1);
+        lsb[i] = phit_hash32((uint32_t)t2);
+        r->hist[delta[i] < PHIT_ROUTER_MAX_DELTA ? delta[i] : PHIT_ROUTER_MAX_DELTA - 1]++;
+    }
+    r->calib_count = (uint32_t)n;
+    phit_router_rebuild(r);
+    int bins[8] = {0};
+    for (int i = 0; i < n; i++) bins[phit_router_slot(r, delta[i], lsb[i])]++;
+    return chi2_8(bins, n);
+}
+
 int main(void) {
     printf("=== libphit.h smoke test ===\n\n");
 
@@ -21,6 +60,43 @@ int main(void) {
     uint64_t t = phit_now_ns();
     printf("Timer:         %llu ns\n", (unsigned long long)t);
 
+    /* Timer capabilities */
+    const phit_timer_caps_t *caps = phit_timer_caps();
+    printf("Timer caps:    backend=%s, unit=%.3f ns, tick=%.2f ns, read=%.1f ns, dead LSBs=%d\n",
+           phit_timer_backend_name(), caps->ns_per_unit, caps->tick_ns,
+           caps->read_ns, caps->lsb_shift);
+    printf("               workload delta %.1f ticks, %d levels, %.2f bits (probe %.2f ms)\n",
+           caps->delta_mean, caps->delta_levels, caps->delta_entropy,
+           caps->probe_cost_ns / 1e6);
+    int cst = caps->tick >= 1.0 && caps->probe_cost_ns < 50000000ULL &&
+              phit_quantize((uint64_t)(caps->tick * 3 + 0.5)) == 3;
+
+    /* Timer backends: cost per read and per phit_sample() */
+    {
+        enum { READS = 200000 };
+        uint64_t acc = 0;
+        uint64_t b0 = phit_now_ns();
+        for (int i = 0; i < READS; i++) acc += phit_now_ns();
+        uint64_t b1 = phit_now_ns();
+        for (int i = 0; i < READS; i++) acc += phit_now_ticks();
+        uint64_t b2 = phit_now_ns();
+        for (int i = 0; i < READS; i++) acc += phit_sample();
+        uint64_t b3 = phit_now_ns();
+        sink = acc;
+        printf("Timer reads:   phit_now_ns %.1f ns | phit_now_ticks (%s) %.1f ns | phit_sample %.1f ns\n",
+               (double)(b1 - b0) / READS, phit_timer_backend_name(),
+               (double)(b2 - b1) / READS, (double)(b3 - b2) / READS);
+#ifdef PHIT_HAVE_TICKS_CPU
+        uint32_t cpu = 0;
+        uint64_t b4 = phit_now_ns();
+        for (int i = 0; i < READS; i++) acc += phit_now_ticks_cpu(&cpu);
+        uint64_t b5 = phit_now_ns();
+        sink = acc;
+        printf("               phit_now_ticks_cpu %.1f ns (cpu %u)\n",
+               (double)(b5 - b4) / READS, cpu);
+#endif
+    }
+
     /* Sample */
     printf("Samples:       ");
     for (int i = 0; i < 5; i++) {
@@ -80,13 +156,334 @@ int main(void) {
     for (int i = 0; i < n; i++) {
         x ^= phit_prng_u64(&rng);
     }
-    phit__sink = x;
+    sink = x;
     uint64_t t2 = phit_now_ns();
     double elapsed_s = (t2 - t1) / 1e9;
     double mbit_s = (n * 64.0) / elapsed_s / 1e6;
     printf("\nThroughput:    %.1f Mbit/s (%d values in %.1f ms)\n",
            mbit_s, n, elapsed_s * 1000);
 
+    /* Batch sampling vs per-call loop */
+    enum { BATCH = 10000 };
+    static uint32_t batch[BATCH];
+    int ust = 1;
+    printf("\nBatch sampling (%d samples):\n", BATCH);
+    for (int reads = 1; reads <= 2; reads++) {
+        uint32_t acc = 0;
+        t1 = phit_now_ns();
+        for (int r = 0; r < 10; r++) {
+            for (int i = 0; i < BATCH; i++) {
+                batch[i] = reads == 1 ? phit_sample() : phit_sample_compound(reads);
+            }
+            acc ^= batch[r];
+        }
+        t2 = phit_now_ns();
+        double per_call = 10.0 * BATCH / ((t2 - t1) / 1e9);
+
+        t1 = phit_now_ns();
+        for (int r = 0; r < 10; r++) {
+            if (reads == 1) phit_sample_batch(batch, BATCH);
+            else phit_sample_compound_batch(batch, BATCH, reads);
+            acc ^= batch[r];
+        }
+        t2 = phit_now_ns();
+        double batched = 10.0 * BATCH / ((t2 - t1) / 1e9);
+        sink = acc;
+
+        /* The last batch must look uniform mod 8 (df=7, one fresh batch on retry) */
+        double bchi2 = 0;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (attempt) {
+                if (reads == 1) phit_sample_batch(batch, BATCH);
+                else phit_sample_compound_batch(batch, BATCH, reads);
+            }
+            int bb[8] = {0};
+            for (int i = 0; i < BATCH; i++) bb[batch[i] % 8]++;
+            bchi2 = chi2_8(bb, BATCH);
+            if (bchi2 < CHI2_DF7) break;
+        }
+        ust = ust && bchi2 < CHI2_DF7;
+        printf("  N=%d  per-call %6.2f Msample/s | batch %6.2f Msample/s (%.1fx) Chi2(8)=%.1f %s\n",
+               reads, per_call / 1e6, batched / 1e6, batched / per_call, bchi2,
+               bchi2 < CHI2_DF7 ? "PASS" : "FAIL");
+    }
+
+    /* CDF router: incremental calibration, then table lookup */
+    phit_router_t *router = malloc(sizeof(phit_router_t));
+    int rst = phit_router_init(router, 8, 50000);
+    int steps = 0;
+    while (!phit_router_calibrate(router, 5000)) steps++;
+    for (int i = 0; i < 4 * PHIT_ROUTER_TRACK_WINDOW; i++) phit_router_route(router);
+    int rb[8] = {0};
+    t1 = phit_now_ns();
+    for (int i = 0; i < N; i++) rb[phit_router_route(router)]++;
+    t2 = phit_now_ns();
+    double live = chi2_8(rb, N);
+    /* Uniform against its own calibration (df=7, one retry); live routes
+     * also see the drift since the last rebuild, so that Chi2 is reported */
+    uint64_t *rdelta = malloc(sizeof(uint64_t) * (size_t)N);
+    uint32_t *rlsb = malloc(sizeof(uint32_t) * (size_t)N);
+    phit_router_t *fit = malloc(sizeof(phit_router_t));
+    double rchi2 = router_chi2(fit, rdelta, rlsb, N);
+    if (rchi2 >= CHI2_DF7) rchi2 = router_chi2(fit, rdelta, rlsb, N);
+    rst = rst && router->ready && rchi2 < CHI2_DF7;
+    printf("\nCDF router:    %s (%d calibration steps, %.1f Mroute/s, Chi2=%.1f, df=7)\n",
+           rst ? "PASS" : "FAIL", steps + 1, N / ((t2 - t1) / 1e9) / 1e6, rchi2);
+    printf("  live Chi2=%.1f after drift tracking warm-up; see experiments/phi_uniform.c\n", live);
+    rst = rst && !phit_router_init(router, 0, 0);
+    free(fit);
+    free(rlsb);
+    free(rdelta);
+    free(router);
+
+    /* Power-of-two choices: 64 bins, 64 balls per bin, gap = max - mean */
+    static phit_load_t loads[64];
+    int gap1 = 0, gap2 = 0;
+    int ones1[64] = {0};
+    for (int i = 0; i < 64 * 64; i++) {
+        int d = phit_route(64);
+        if (++ones1[d] - 64 > gap1) gap1 = ones1[d] - 64;
+        d = phit_route2(loads, 64);
+        phit_load_add(&loads[d], 1);
+    }
+    for (int i = 0; i < 64; i++) {
+        if (loads[i].depth - 64 > gap2) gap2 = (int)(loads[i].depth - 64);
+    }
+    int pst = gap2 * 2 < gap1 || gap2 <= 2;
+    printf("\nRoute2:        %s (64x64 balls, max-mean gap %d vs %d for phit_route)\n",
+           pst ? "PASS" : "FAIL", gap2, gap1);
+    rst = rst && pst;
+
+    /* Range reduction: multiply-shift edges, n < 2, exact primes/pow2 */
+    int gst = phit_reduce32(0xFFFFFFFFu, 10) == 9 && phit_reduce32(0x80000000u, 2) == 1 &&
+              phit_reduce32(0x12345678u, 256) == 0x12 && phit_route(0) == 0 &&
+              phit_route(1) == 0 && phit_prng_range(&rng, 0) == 0 && phit_prng_range(&rng, 1) == 0;
+    int r3[3] = {0};
+    for (int i = 0; i < 300000; i++) r3[phit_prng_range(&rng, 3)]++;
+    phit_adapt_t ad0, ad1;
+    phit_adapt_state(&ad0);
+    for (int i = 0; i < 1000; i++) {
+        int c8 = phit_route_const(8), c6 = phit_route_const(6);
+        if (c8 < 0 || c8 >= 8 || c6 < 0 || c6 >= 6) gst = 0;
+    }
+    /* The mask path draws phit_route()'s key, so it feeds the same controller */
+    phit_adapt_state(&ad1);
+    if (PHIT_ROUTE_ADAPTIVE && ad1.keys - ad0.keys < 2000) gst = 0;
+    gst = gst && phit_route_const(1) == 0;
+    double gchi2 = 0;
+    for (int i = 0; i < 3; i++) gchi2 += (r3[i] - 1e5) * (r3[i] - 1e5) / 1e5;
+    gst = gst && gchi2 < 13.8;
+    printf("Range:         %s (phit_prng_range(3) Chi2=%.1f, df=2)\n", gst ? "PASS" : "FAIL", gchi2);
+    rst = rst && gst;
+
+    /* Sampler kernels: every specialization yields varying keys, and the
+     * selector picks a kernel with the requested read count */
+    phit_sampler_profile_t kp[64];
+    int kn = phit_sampler_count(), kst = kn > 0 && kn <= 64 && !phit_sampler_selected();
+    const phit_sampler_t *ksel = kst ? phit_sampler_select(2, 0, kp) : NULL;
+    kst = kst && ksel && ksel->reads == 2 && phit_sampler_selected() == ksel;
+    for (int i = 0; i < kn && kst; i++) {
+        const phit_sampler_t *k = phit_sampler_get(i);
+        uint32_t k0 = k->sample();
+        int varied = 0;
+        for (int j = 0; j < 64; j++) varied |= k->sample() != k0;
+        kst = varied && k->reads >= 1 && kp[i].levels >= 1 && kp[i].ns_per_key > 0;
+    }
+    uint32_t ks0 = phit_sample_selected();
+    kst = kst && phit_sample_selected() != ks0;
+    printf("\nSamplers:      %s (%d kernels, reads=2 -> %s %s: %.1f ns, %.2f phits/read)\n",
+           kst ? "PASS" : "FAIL", kn, ksel ? ksel->name : "-",
+           ksel ? phit_workload_name(ksel->kind) : "-",
+           ksel ? kp[ksel - phit_sampler_get(0)].ns_per_key : 0.0,
+           ksel ? kp[ksel - phit_sampler_get(0)].phits_per_read : 0.0);
+    rst = rst && kst;
+
+    /* Adaptive reads: two until the first estimate, then fewer for a
+     * narrower target, never outside [1, PHIT_ADAPT_MAX_READS] */
+    phit_adapt_reset();
+    int ast = phit_adapt_reads(3.0) == 2;
+    uint64_t ak = phit_sample_adaptive(3.0), adiff = 0;
+    for (int i = 0; i < 20000; i++) adiff += phit_sample_adaptive(3.0) != ak;
+    phit_adapt_t as;
+    phit_adapt_state(&as);
+    int alo = phit_adapt_reads(1.0), ahi = phit_adapt_reads(64.0);
+    ast = ast && as.estimates > 0 && as.phits > 0 && alo >= 1 && alo <= ahi &&
+          ahi <= PHIT_ADAPT_MAX_READS && as.iters >= PHIT_ADAPT_MIN_ITERS &&
+          as.iters <= PHIT_ADAPT_MAX_ITERS && adiff > 10000;
+    printf("Adaptive:      %s (%.2f phits/read at %d iters, %llu estimates, reads %d..%d)\n",
+           ast ? "PASS" : "FAIL", as.phits, as.iters, (unsigned long long)as.estimates, alo, ahi);
+    rst = rst && ast;
+
+    /* Health tests: a stuck source trips RCT at the cutoff, a biased one
+     * without long runs trips APT only, the live pool stays clean */
+    phit_health_t stuck, biased;
+    memset(&stuck, 0, sizeof(stuck));
+    memset(&biased, 0, sizeof(biased));
+    uint64_t hf0 = phit_health_failures();
+    int rct_at = 0;
+    for (int i = 1; i <= PHIT_HEALTH_APT_WINDOW; i++) {
+        if ((phit_health_update(&stuck, 7) & PHIT_HEALTH_RCT) && !rct_at) rct_at = i;
+        phit_health_update(&biased, i % 10 ? 7 : (uint64_t)i);
+    }
+    phit_pool_t hpool;
+    phit_pool_init(&hpool);
+    for (int i = 0; i < 200000; i++) phit_pool_harvest(&hpool);
+    int est = rct_at == PHIT_HEALTH_RCT_CUTOFF && stuck.flags == (PHIT_HEALTH_RCT | PHIT_HEALTH_APT) &&
+              biased.flags == PHIT_HEALTH_APT && phit_health_failures() - hf0 >= 3;
+#if PHIT_HEALTH_TESTS
+    est = est && hpool.health.samples == 199999 && phit_pool_health(&hpool) == 0;
+#endif
+    printf("\nHealth tests:  %s (stuck: RCT at %d, biased: flags %u, live pool: %llu deltas, flags %d)\n",
+           est ? "PASS" : "FAIL", rct_at, biased.flags,
+           (unsigned long long)hpool.health.samples, phit_pool_health(&hpool));
+    rst = rst && est;
+
+    /* Shared pool: bootstrap on first use, distinct extractions, local PRNG */
+    uint64_t sk[1024];
+    int hst = 1;
+    for (int i = 0; i < 1024; i++) {
+        sk[i] = phit_shared_extract();
+        for (int j = 0; j < i; j++) {
+            if (sk[j] == sk[i]) hst = 0;
+        }
+    }
+    phit_prng_t *local = phit_prng_local();
+    phit_prng_t srng;
+    phit_prng_init_shared(&srng, 256, 0);
+    int sones = 0;
+    for (int i = 0; i < 10000; i++) {
+        sones += __builtin_popcountll(phit_prng_u64(local) ^ phit_prng_u64(&srng));
+    }
+    double sratio = sones / (10000.0 * 64.0);
+    hst = hst && phit_shared_harvests() >= PHIT_SHARED_MIN_HARVESTS &&
+          local == phit_prng_local() && sratio > 0.49 && sratio < 0.51;
+    printf("\nShared pool:   %s (%llu harvests folded, local^shared ones=%.4f)\n",
+           hst ? "PASS" : "FAIL", (unsigned long long)phit_shared_harvests(), sratio);
+    rst = rst && hst;
+
+    /* Background harvester: fills the ring, direct PRNG pops, stays under its duty */
+    phit_prng_t drng;
+    phit_prng_init(&drng);
+    int vst = phit_harvester_start(50) && phit_harvester_start(50);
+    phit_harvester_stats_t hs;
+    uint64_t hw = phit_now_ns();
+    do {
+        phit_harvester_stats(&hs);
+    } while (hs.depth < 256 && phit_now_ns() - hw < 2000000000ULL);
+    uint64_t before = hs.consumed;
+    for (int i = 0; i < 200; i++) sink ^= phit_prng_u64(&drng);
+    phit_harvester_stats(&hs);
+    vst = vst && hs.running && hs.consumed - before >= 200 && hs.duty < 0.75 &&
+          hs.capacity == PHIT_HARVESTER_RING;
+    printf("\nHarvester:     %s (depth %llu/%llu, %.2f Mword/s refill, duty %.0f%% of %d%%, "
+           "%llu underruns)\n", vst ? "PASS" : "FAIL",
+           (unsigned long long)hs.depth, (unsigned long long)hs.capacity,
+           hs.refill_rate / 1e6, hs.duty * 100, hs.duty_limit,
+           (unsigned long long)hs.underruns);
+    phit_harvester_stop();
+    phit_harvester_stats(&hs);
+    vst = vst && !hs.running;
+    rst = rst && vst;
+
+    /* Buffered PRNG: reseed every 1024 outputs or 10 ms */
+    phit_prng_t brng;
+    phit_prng_init_buffered(&brng, 1024, 10000000ULL);
+    uint64_t first = phit_prng_u64(&brng);
+    int distinct = 1;
+    for (int i = 0; i < 4096; i++) {
+        if (phit_prng_u64(&brng) == first) distinct = 0;
+    }
+    int ones = 0;
+    for (int i = 0; i < 100000; i++) {
+        ones += __builtin_popcountll(phit_prng_u64(&brng));
+    }
+    double ratio = ones / (100000.0 * 64.0);
+    int bst = distinct && ratio > 0.495 && ratio < 0.505;
+    printf("\nBuffered PRNG: %s (ones=%.4f)\n", bst ? "PASS" : "FAIL", ratio);
+
+    n = 10000000;
+    t1 = phit_now_ns();
+    for (int i = 0; i < n; i++) {
+        x ^= phit_prng_u64(&brng);
+    }
+    sink = x;
+    t2 = phit_now_ns();
+    elapsed_s = (t2 - t1) / 1e9;
+    printf("Throughput:    %.1f Mbit/s (%d values in %.1f ms)\n",
+           (n * 64.0) / elapsed_s / 1e6, n, elapsed_s * 1000);
+
+    /* Bulk fill: every SIMD kernel must match the scalar u64 stream */
+    int fill_len = (1 << 20) + 13;
+    uint8_t *ref = malloc((size_t)fill_len);
+    uint8_t *out = malloc((size_t)fill_len + 64);
+    phit_prng_t tmpl;
+    phit_prng_init_buffered(&tmpl, 1 << 20, 0);
+    phit_prng_t r0 = tmpl;
+    for (int i = 0; i < fill_len; i += 8) {
+        uint64_t v = phit_prng_u64(&r0);
+        memcpy(ref + i, &v, fill_len - i < 8 ? (size_t)(fill_len - i) : 8);
+    }
+    int sst = 1;
+    printf("\nBulk fill (%d bytes):\n", fill_len);
+    for (int level = PHIT_SIMD_SCALAR; level <= phit_simd_level(); level++) {
+        if (phit_simd_select(level) != level) continue;
+        for (int off = 0; off < 4; off += 3) {
+            phit_prng_t r1 = tmpl;
+            phit_prng_fill(&r1, out + off, fill_len);
+            if (memcmp(out + off, ref, (size_t)fill_len) != 0) sst = 0;
+        }
+        /* Keystream XOR over zeros is the same stream, in odd-sized chunks */
+        memset(out, 0, (size_t)fill_len + 64);
+        uint64_t at = tmpl.counter * 8;
+        for (int done = 0, step = 1; done < fill_len; step = step * 3 + 1) {
+            int n = step < fill_len - done ? step : fill_len - done;
+            phit_expand_xor(tmpl.key, at + (uint64_t)done, out + 3 + done, (size_t)n);
+            done += n;
+        }
+        if (memcmp(out + 3, ref, (size_t)fill_len) != 0) sst = 0;
+        phit_prng_t r2 = tmpl;
+        t1 = phit_now_ns();
+        for (int i = 0; i < 16; i++) phit_prng_fill(&r2, out, fill_len);
+        t2 = phit_now_ns();
+        printf("  %-7s %s  %.2f GB/s\n", phit_simd_name(level),
+               sst ? "match" : "MISMATCH",
+               16.0 * fill_len / ((t2 - t1) / 1e9) / 1e9);
+    }
+    phit_simd_select(phit_simd_level());
+    free(ref);
+    free(out);
+
+    /* Instrumentation: exact call deltas when built in, all zero otherwise */
+    phit_stats_t s0, s1;
+    phit_stats_snapshot(&s0);
+    for (int i = 0; i < 1000; i++) sink ^= phit_sample();
+    for (int i = 0; i < 500; i++) sink ^= (uint64_t)phit_route(7);
+    phit_stats_snapshot(&s1);
+    uint64_t timed = 0;
+    for (int b = 0; b < PHIT_STATS_BUCKETS; b++)
+        timed += s1.hist[PHIT_STAT_SAMPLE][b] - s0.hist[PHIT_STAT_SAMPLE][b];
+    int ist;
+    if (s1.enabled) {
+        ist = s1.calls[PHIT_STAT_SAMPLE] - s0.calls[PHIT_STAT_SAMPLE] == 1000 &&
+              s1.calls[PHIT_STAT_ROUTE] - s0.calls[PHIT_STAT_ROUTE] == 500 &&
+              s1.calls[PHIT_STAT_COMPOUND] - s0.calls[PHIT_STAT_COMPOUND] >= 500 &&
+              timed >= 1000 / PHIT_STATS_SAMPLE && s1.threads >= 1;
+        printf("\nStats:         %s (%d thread(s), 1 in %d timed)\n", ist ? "PASS" : "FAIL",
+               s1.threads, s1.sample_every);
+        for (int op = 0; op < PHIT_STAT_OPS; op++) {
+            printf("  %-21s %10llu calls  p50 <%6.0f ns  p99 <%6.0f ns\n",
+                   phit_stats_op_name(op), (unsigned long long)s1.calls[op],
+                   phit_stats_percentile(&s1, op, 0.5), phit_stats_percentile(&s1, op, 0.99));
+        }
+        for (int ev = 0; ev < PHIT_EVENT_COUNT; ev++) {
+            printf("  %-21s %10llu\n", phit_stats_event_name(ev),
+                   (unsigned long long)s1.events[ev]);
+        }
+    } else {
+        ist = s1.calls[PHIT_STAT_SAMPLE] == 0 && timed == 0;
+        printf("\nStats:         %s (not built in, PHIT_STATS=0)\n", ist ? "PASS" : "FAIL");
+    }
+
     printf("\n=== Done ===\n");
-    return st ? 0 : 1;
+    return (st && bst && sst && ust && rst && cst && ist) ? 0 : 1;
 }
@@ -0,0 +1,91 @@
+/*
+ * test_stoch.c — phit_stoch.h: encoder accuracy, AND/MUX/NOT arithmetic
+ *
+ * gcc -O2 -o test_stoch test_stoch.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_stoch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define BITS (1 << 20)
+
+/* Within 5 sigma of a binomial mean over BITS bits */
+static int near(double got, double want) {
+    double sigma = sqrt(want * (1 - want) / BITS);
+    return fabs(got - want) <= 5 * sigma + 1.0 / (1 << PHIT_STOCH_BITS);
+}
+
+int main(void) {
+    printf("=== phit_stoch.h test ===\n\n");
+    phit_pool_t pool;
+    phit_pool_init(&pool);
+    phit_bitstream_t a, b, c, sel;
+    if (!phit_bitstream_init(&a, BITS) || !phit_bitstream_init(&b, BITS) ||
+        !phit_bitstream_init(&c, BITS) || !phit_bitstream_init(&sel, BITS)) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    /* Encoder: mean of every p, exact endpoints, same key same stream */
+    static const double ps[] = { 0.0, 0.001, 0.1, 0.25, 0.5, 0.7, 0.999, 1.0 };
+    int enc = 1;
+    for (int i = 0; i < 8; i++) {
+        phit_stoch_encode_pool(&a, ps[i], &pool);
+        double v = phit_stoch_value(&a);
+        int ok = ps[i] == 0.0 ? phit_stoch_count(&a) == 0
+               : ps[i] == 1.0 ? phit_stoch_count(&a) == BITS : near(v, ps[i]);
+        enc = enc && ok;
+        printf("  encode %-6g -> %.5f %s\n", ps[i], v, ok ? "ok" : "X");
+    }
+    phit_stoch_encode(&a, 0.3, 42);
+    phit_stoch_encode(&b, 0.3, 42);
+    phit_bitstream_t prefix;
+    phit_bitstream_init(&prefix, 1000);
+    phit_stoch_encode(&prefix, 0.3, 42);
+    int same = !memcmp(a.words, b.words, a.nwords * 8) &&
+               !memcmp(prefix.words, a.words, prefix.nwords * 8);
+    phit_bitstream_free(&prefix);
+    printf("Encoder:       %s (deterministic per key, length-independent prefix: %d)\n",
+           enc && same ? "PASS" : "FAIL", same);
+
+    /* Arithmetic on independently keyed streams */
+    phit_stoch_encode_pool(&a, 0.6, &pool);
+    phit_stoch_encode_pool(&b, 0.3, &pool);
+    phit_stoch_encode_pool(&sel, 0.5, &pool);
+    phit_stoch_and(&c, &a, &b);
+    double mul = phit_stoch_value(&c);
+    phit_stoch_mux(&c, &a, &b, &sel);
+    double add = phit_stoch_value(&c);
+    phit_stoch_not(&c, &a);
+    double inv = phit_stoch_value(&c);
+    /* Correlated operands: a AND a is a, not a^2 */
+    phit_stoch_and(&c, &a, &a);
+    int corr = phit_stoch_count(&c) == phit_stoch_count(&a);
+    int ar = near(mul, 0.18) && near(add, 0.45) && near(inv, 0.4) && corr;
+    printf("Arithmetic:    %s (0.6*0.3 = %.5f, (0.6+0.3)/2 = %.5f, 1-0.6 = %.5f)\n",
+           ar ? "PASS" : "FAIL", mul, add, inv);
+
+    /* Odd lengths: ops stop at the shortest operand */
+    phit_bitstream_t s3;
+    phit_bitstream_init(&s3, 130);
+    memset(c.words, 0, c.nwords * 8);
+    phit_stoch_encode(&s3, 1.0, 7);
+    phit_stoch_and(&c, &s3, &s3);
+    size_t words3 = s3.nwords;
+    int len = words3 == 3 && phit_bitstream_bits(&s3) == 192 && phit_stoch_count(&c) == 192;
+    phit_bitstream_free(&s3);
+    printf("Lengths:       %s (130 bits -> %zu words)\n", len ? "PASS" : "FAIL", words3);
+
+    phit_bitstream_free(&a);
+    phit_bitstream_free(&b);
+    phit_bitstream_free(&c);
+    phit_bitstream_free(&sel);
+    printf("\n=== Done ===\n");
+    return enc && same && ar && len ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+ * test_topo.c — phit_topo.h: discovery, hierarchical routing, per-node executor
+ *
+ * gcc -O2 -D_GNU_SOURCE -o test_topo test_topo.c -lm -lpthread
+ */
+
+#ifndef PHIT_TEST_LINKED
+#define LIBPHIT_IMPLEMENTATION
+#endif
+#include "../src/phit_exec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define ROUTES 200000
+#define TASKS  40000
+
+static void task_nop(void *arg) {
+    (void)arg;
+}
+
+/* Fraction of routes from node 1 that leave it, and whether every local
+ * destination was hit */
+static double remote_share(const phit_hier_t *h, int *spread) {
+    int hits[16] = { 0 }, remote = 0;
+    for (int i = 0; i < ROUTES; i++) {
+        int d = phit_route_hier(h, 1);
+        if (d < h->first[1] || d >= h->first[1] + h->count[1]) remote++;
+        else hits[d - h->first[1]]++;
+    }
+    *spread = 1;
+    for (int k = 0; k < h->count[1]; k++) {
+        double want = (double)(ROUTES - remote) / h->count[1];
+        if (fabs(hits[k] - want) > 6 * sqrt(want) + 0.01 * want) *spread = 0;
+    }
+    return (double)remote / ROUTES;
+}
+
+int main(void) {
+    printf("=== phit_topo.h test ===\n\n");
+
+    /* Discovery: every level gives at least one node covering the online CPUs */
+    static phit_topo_t t;
+    static const int levels[] = { PHIT_TOPO_NUMA, PHIT_TOPO_CACHE, PHIT_TOPO_PERF };
+    int dst = 1;
+    for (int i = 0; i < 3; i++) {
+        int nodes = phit_topo_discover(&t, levels[i]);
+        int cpus = 0;
+        for (int n = 0; n < t.num_nodes; n++) cpus += t.node_cpus[n];
+        int ok = nodes >= 1 && nodes == t.num_nodes && cpus >= 1 &&
+                 phit_topo_node_cpu(&t, 0, 0) >= 0 && phit_topo_node_cpu(&t, 0, cpus) == -1;
+        int node = phit_topo_current_node(&t);
+        ok = ok && node >= 0 && node < nodes;
+        dst = dst && ok;
+        printf("  %-5s -> %d node(s) (%s), %d CPUs, this thread on node %d %s\n",
+               i == 0 ? "numa" : i == 1 ? "cache" : "perf", nodes, phit_topo_kind_name(t.kind),
+               cpus, node, ok ? "ok" : "X");
+    }
+    printf("Discovery:     %s (current cpu %d)\n", dst ? "PASS" : "FAIL", phit_topo_current_cpu());
+
+    /* Routing: spill 0 never leaves the node, spill p leaves it p of the time */
+    phit_hier_t h;
+    static const int counts[] = { 3, 4, 5 };
+    int init = phit_hier_init(&h, counts, 3, 0.0) && h.total == 12 && h.first[1] == 3 &&
+               !phit_hier_init(&h, counts, 0, 0.0);
+    phit_hier_init(&h, counts, 3, 0.0);
+    int spread0, spread1;
+    double r0 = remote_share(&h, &spread0);
+    phit_hier_init(&h, counts, 3, 0.25);
+    double r1 = remote_share(&h, &spread1);
+    static const int lonely[] = { 2, 0 };
+    phit_hier_init(&h, lonely, 2, 0.0);
+    int empty = 1;
+    for (int i = 0; i < 1000; i++) {
+        int d = phit_route_hier(&h, 1);
+        empty = empty && d >= 0 && d < 2;
+    }
+    int rst = init && r0 == 0.0 && fabs(r1 - 0.25) < 0.01 && spread0 && spread1 && empty;
+    printf("Routing:       %s (remote %.4f at spill 0, %.4f at spill 0.25, empty node %d)\n",
+           rst ? "PASS" : "FAIL", r0, r1, empty);
+
+    /* Load: a deep local pick goes to the shallower remote one */
+    phit_load_t loads[12];
+    memset(loads, 0, sizeof(loads));
+    phit_hier_init(&h, counts, 3, 0.0);
+    for (int k = 3; k < 7; k++) phit_load_add(&loads[k], 100);
+    int lst = 1;
+    for (int i = 0; i < 1000; i++) {
+        int d = phit_route_hier_load(&h, 1, loads, 50);
+        lst = lst && (d < 3 || d >= 7);
+    }
+    printf("Load spill:    %s\n", lst ? "PASS" : "FAIL");
+
+    /* Executor: 2 synthetic nodes x 2 workers; this thread says node 1 */
+    phit_topo_synthetic(&t, 2, 2);
+    phit_exec_t *e = phit_exec_create_topo(&t, 0, 0, 0);
+    phit_exec_set_spill(e, -1, -1);     /* a burst would spill by depth */
+    phit_topo_set_thread_node(1);
+    for (int i = 0; i < TASKS; i++) phit_exec_submit_local(e, task_nop, NULL);
+    phit_exec_shutdown(e);
+    uint64_t on[2] = { 0, 0 };
+    int nodes_ok = phit_exec_workers(e) == 4 && phit_exec_worker_node(e, 9) == -1;
+    for (int w = 0; w < phit_exec_workers(e); w++) {
+        nodes_ok = nodes_ok && phit_exec_worker_node(e, w) == w / 2;
+        on[w / 2] += phit_exec_executed(e, w);
+    }
+    phit_exec_destroy(e);
+    int est = nodes_ok && on[0] == 0 && on[1] == TASKS;
+
+    /* Spill 1/2 by probability, no depth spill */
+    e = phit_exec_create_topo(&t, 0, 0, 0);
+    phit_exec_set_spill(e, 0.5, -1);
+    for (int i = 0; i < TASKS; i++) phit_exec_submit_local(e, task_nop, NULL);
+    phit_exec_shutdown(e);
+    uint64_t spilled = phit_exec_executed(e, 0) + phit_exec_executed(e, 1);
+    phit_exec_destroy(e);
+    phit_topo_set_thread_node(-1);
+    est = est && fabs((double)spilled / TASKS - 0.5) < 0.03;
+    printf("Executor:      %s (node 1 ran %llu of %d local, %.3f spilled at 0.5)\n",
+           est ? "PASS" : "FAIL", (unsigned long long)on[1], TASKS, (double)spilled / TASKS);
+
+    printf("\n=== Done ===\n");
+    return dst && rst && lst && est ? 0 : 1;
+}